@@ -0,0 +1,98 @@
+/**
+ * Batch benchmark for REBOUNDx
+ *
+ * Evaluates gr_potential, gravitational_harmonics and tides_constant_time_lag on ensembles of K small planetary
+ * systems, once by calling each simulation's additional_forces, and once with rebx_batch_additional_forces, which
+ * evaluates each force for all K systems at once. Both give identical accelerations. Results are written to stdout
+ * as CSV, one line per K, with the time per system and force evaluation:
+ *
+ *     ./batch > batch.csv
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+#define BATCH_MAX_K 256
+#define BATCH_N_PLANETS 3
+#define BATCH_EVALUATIONS 20000
+#define BATCH_C 10065.32                    // speed of light in AU/(yr/2pi)
+
+static double walltime(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1.e-6*tv.tv_usec;
+}
+
+static struct reb_simulation* create_member(const int k){
+    struct reb_simulation* sim = reb_create_simulation();
+    struct reb_particle star = {0};
+    star.m = 1.;
+    star.r = 5.e-3;
+    reb_add(sim, star);
+    for (int i=1; i<=BATCH_N_PLANETS; i++){
+        struct reb_particle p = reb_tools_orbit_to_particle(sim->G, star, 1.e-5, 0.05*i*(1. + 1.e-3*k), 0.02, 0.01*i, 0., 0., 1.3*i);
+        p.r = 1.e-4;
+        reb_add(sim, p);
+    }
+    reb_move_to_com(sim);
+
+    struct rebx_extras* rebx = rebx_attach(sim);
+    struct rebx_force* gr = rebx_load_force(rebx, "gr_potential");
+    rebx_add_force(rebx, gr);
+    rebx_set_param_double(rebx, &gr->ap, "c", BATCH_C);
+
+    struct rebx_force* gh = rebx_load_force(rebx, "gravitational_harmonics");
+    rebx_add_force(rebx, gh);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "J2", 1.e-3);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "R_eq", 5.e-3);
+
+    struct rebx_force* tides = rebx_load_force(rebx, "tides_constant_time_lag");
+    rebx_add_force(rebx, tides);
+    for (int i=1; i<=BATCH_N_PLANETS; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tctl_k2", 0.3);
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tctl_tau", 1.e-4);
+    }
+    return sim;
+}
+
+int main(void){
+    struct reb_simulation* sims[BATCH_MAX_K];
+    for (int k=0; k<BATCH_MAX_K; k++){
+        sims[k] = create_member(k);
+    }
+
+    printf("K,N,evaluations,per_sim_ns,batch_ns,speedup\n");
+    for (int K=1; K<=BATCH_MAX_K; K*=2){
+        double start = walltime();
+        for (int e=0; e<BATCH_EVALUATIONS; e++){
+            for (int k=0; k<K; k++){
+                sims[k]->additional_forces(sims[k]);
+            }
+        }
+        const double per_sim = (walltime() - start)/BATCH_EVALUATIONS/K*1.e9;
+
+        struct rebx_batch* batch = rebx_batch_create(sims, K);
+        if (batch == NULL){
+            fprintf(stderr, "Could not create batch of %d simulations.\n", K);
+            exit(1);
+        }
+        start = walltime();
+        for (int e=0; e<BATCH_EVALUATIONS; e++){
+            rebx_batch_additional_forces(batch);
+        }
+        const double batched = (walltime() - start)/BATCH_EVALUATIONS/K*1.e9;
+        rebx_batch_free(batch);
+
+        printf("%d,%d,%d,%.1f,%.1f,%.2f\n", K, BATCH_N_PLANETS+1, BATCH_EVALUATIONS, per_sim, batched, per_sim/batched);
+        fflush(stdout);
+    }
+
+    for (int k=0; k<BATCH_MAX_K; k++){
+        rebx_free(sims[k]->extras);
+        reb_free_simulation(sims[k]);
+    }
+    return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * Benchmarks for REBOUNDx effects
+ *
+ * Times each force and operator, plus a typical stack of effects (gr, tides_spin and gravitational_harmonics),
+ * with WHFast and IAS15 at N = 10, 1e3 and 1e5. The simulation is a central star with N-1 bodies that are
+ * treated as test particles by REBOUND (N_active = 1), so the gravity calculation stays O(N) and the timings
+ * are dominated by REBOUNDx. Effects that loop over pairs of bodies are only run up to the N they list below.
+ *
+ * The time spent in the effects is taken from the profiles REBOUNDx records when rebx_extras.profiling is set,
+ * and the total from the wall time of the whole step. Results are written to stdout as CSV, one line per run,
+ * in ns per particle per step:
+ *
+ *     ./benchmark [name] > results.csv
+ *
+ * Passing a name only runs the benchmarks whose name contains it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+#define BENCHMARK_C 10065.32                // speed of light in AU/(yr/2pi)
+#define BENCHMARK_PARTICLE_STEPS 2.e6       // particles*steps per run. Sets the number of steps at each N.
+
+static double walltime(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1.e-6*tv.tv_usec;
+}
+
+static void add_gr(struct reb_simulation* sim, struct rebx_extras* rebx, const char* name){
+    struct rebx_force* gr = rebx_load_force(rebx, name);
+    rebx_add_force(rebx, gr);
+    rebx_set_param_double(rebx, &gr->ap, "c", BENCHMARK_C);
+}
+
+static void setup_gr(struct reb_simulation* sim, struct rebx_extras* rebx){
+    add_gr(sim, rebx, "gr");
+}
+
+static void setup_gr_full(struct reb_simulation* sim, struct rebx_extras* rebx){
+    add_gr(sim, rebx, "gr_full");
+}
+
+static void setup_gr_potential(struct reb_simulation* sim, struct rebx_extras* rebx){
+    add_gr(sim, rebx, "gr_potential");
+}
+
+static void setup_central_force(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* cf = rebx_load_force(rebx, "central_force");
+    rebx_add_force(rebx, cf);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "Acentral", 1.e-4);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "gammacentral", -1.);
+}
+
+static void setup_modify_orbits_forces(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* mof = rebx_load_force(rebx, "modify_orbits_forces");
+    rebx_add_force(rebx, mof);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tau_a", -1.e6);
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tau_e", -1.e4);
+    }
+}
+
+static void setup_exponential_migration(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* em = rebx_load_force(rebx, "exponential_migration");
+    rebx_add_force(rebx, em);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "em_tau_a", 1.e6);
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "em_aini", 1.);
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "em_afin", 2.);
+    }
+}
+
+static void setup_gravitational_harmonics(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* gh = rebx_load_force(rebx, "gravitational_harmonics");
+    rebx_add_force(rebx, gh);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "J2", 1.e-3);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "J4", -1.e-5);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "R_eq", 5.e-3);
+}
+
+static void setup_radiation_forces(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* rf = rebx_load_force(rebx, "radiation_forces");
+    rebx_add_force(rebx, rf);
+    rebx_set_param_double(rebx, &rf->ap, "c", BENCHMARK_C);
+    rebx_set_param_int(rebx, &sim->particles[0].ap, "radiation_source", 1);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "beta", 0.01);
+    }
+}
+
+static void setup_stochastic_forces(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* sf = rebx_load_force(rebx, "stochastic_forces");
+    rebx_add_force(rebx, sf);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "kappa", 1.e-6);
+    }
+}
+
+static void setup_tides_constant_time_lag(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* tctl = rebx_load_force(rebx, "tides_constant_time_lag");
+    rebx_add_force(rebx, tctl);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "tctl_k2", 0.03);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "tctl_tau", 0.04);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "OmegaMag", 2.*M_PI/25.);
+}
+
+static void setup_type_I_migration(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* tIm = rebx_load_force(rebx, "type_I_migration");
+    rebx_add_force(rebx, tIm);
+    rebx_set_param_double(rebx, &tIm->ap, "ide_position", 0.3);
+    rebx_set_param_double(rebx, &tIm->ap, "ide_width", 0.02);
+    rebx_set_param_double(rebx, &tIm->ap, "tIm_flaring_index", 0.25);
+    rebx_set_param_double(rebx, &tIm->ap, "tIm_surface_density_exponent", 1);
+    rebx_set_param_double(rebx, &tIm->ap, "tIm_surface_density_1", 0.00011255);
+    rebx_set_param_double(rebx, &tIm->ap, "tIm_scale_height_1", 0.03);
+}
+
+static void setup_tides_spin(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* ts = rebx_load_force(rebx, "tides_spin");
+    rebx_add_force(rebx, ts);
+    for (int i=0; i<sim->N; i++){
+        struct reb_particle* const p = &sim->particles[i];
+        const double n = i ? sqrt(sim->G*sim->particles[0].m/pow(1.+i*4./sim->N, 3)) : 2.*M_PI/25.;
+        rebx_set_param_double(rebx, &p->ap, "k2", i ? 0.3 : 0.03);
+        rebx_set_param_double(rebx, &p->ap, "tau", i ? 1.e-3 : 1.e-4);
+        rebx_set_param_double(rebx, &p->ap, "I", 0.25*p->m*p->r*p->r);
+        rebx_set_param_vec3d(rebx, &p->ap, "Omega", (struct reb_vec3d){.z=(i ? 10. : 1.)*n});
+    }
+    rebx_spin_initialize_ode(rebx, ts);
+}
+
+static void setup_yarkovsky_effect(struct reb_simulation* sim, struct rebx_extras* rebx){
+    // units of AU, yr/2pi and solar masses, converted from SI as in the yarkovsky_effect example
+    const double au_conv = 1.495978707e11;
+    const double msun_conv = 1.9885e30;
+    const double yr_conv = 31557600.0/(2.*M_PI);
+    struct rebx_force* ye = rebx_load_force(rebx, "yarkovsky_effect");
+    rebx_add_force(rebx, ye);
+    rebx_set_param_double(rebx, &ye->ap, "ye_lstar", (3.828e26*yr_conv*yr_conv*yr_conv)/(msun_conv*au_conv*au_conv));
+    rebx_set_param_double(rebx, &ye->ap, "ye_c", BENCHMARK_C);
+    rebx_set_param_double(rebx, &ye->ap, "ye_stef_boltz", ((5.670e-8)*yr_conv*yr_conv*yr_conv)/(msun_conv));
+    for (int i=1; i<sim->N; i++){
+        struct reb_particle* const p = &sim->particles[i];
+        p->r = 1000./au_conv;
+        rebx_set_param_double(rebx, &p->ap, "ye_body_density", (3000.0*au_conv*au_conv*au_conv)/msun_conv);
+        rebx_set_param_int(rebx, &p->ap, "ye_flag", 0);
+        rebx_set_param_double(rebx, &p->ap, "ye_albedo", 0.017);
+        rebx_set_param_double(rebx, &p->ap, "ye_emissivity", 0.9);
+        rebx_set_param_double(rebx, &p->ap, "ye_k", 0.25);
+        rebx_set_param_double(rebx, &p->ap, "ye_thermal_inertia", (310*sqrt(yr_conv)*yr_conv*yr_conv)/msun_conv);
+        rebx_set_param_double(rebx, &p->ap, "ye_rotation_period", 15470.9/yr_conv);
+        rebx_set_param_double(rebx, &p->ap, "ye_spin_axis_x", 0.);
+        rebx_set_param_double(rebx, &p->ap, "ye_spin_axis_y", 0.);
+        rebx_set_param_double(rebx, &p->ap, "ye_spin_axis_z", 1.);
+    }
+}
+
+static void setup_modify_mass(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_operator* mm = rebx_load_operator(rebx, "modify_mass");
+    rebx_add_operator(rebx, mm);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tau_mass", -1.e6);
+    }
+}
+
+static void setup_integrate_force(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_force* gr = rebx_load_force(rebx, "gr");
+    rebx_set_param_double(rebx, &gr->ap, "c", BENCHMARK_C);
+    struct rebx_operator* intf = rebx_load_operator(rebx, "integrate_force");
+    rebx_set_param_pointer(rebx, &intf->ap, "force", gr);
+    rebx_add_operator(rebx, intf);
+}
+
+static void setup_modify_orbits_direct(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_operator* mod = rebx_load_operator(rebx, "modify_orbits_direct");
+    rebx_add_operator(rebx, mod);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tau_a", -1.e6);
+    }
+}
+
+static void setup_track_min_distance(struct reb_simulation* sim, struct rebx_extras* rebx){
+    struct rebx_operator* tmd = rebx_load_operator(rebx, "track_min_distance");
+    rebx_add_operator(rebx, tmd);
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "min_distance", 10.);
+    }
+}
+
+static void setup_stack(struct reb_simulation* sim, struct rebx_extras* rebx){
+    setup_gr(sim, rebx);
+    setup_gravitational_harmonics(sim, rebx);
+    setup_tides_spin(sim, rebx);
+}
+
+struct benchmark{
+    const char* name;
+    void (*setup)(struct reb_simulation* sim, struct rebx_extras* rebx);
+    int N_max;          // largest N to run the benchmark at
+};
+
+// The integrator building blocks (drift, kick, kepler, jump, interaction, ias15) are left out, since they replace
+// REBOUND's own integration rather than add an effect on top of it.
+static const struct benchmark benchmarks[] = {
+    {"gr",                          setup_gr,                       100000},
+    {"gr_full",                     setup_gr_full,                  1000},
+    {"gr_potential",                setup_gr_potential,             100000},
+    {"central_force",               setup_central_force,            100000},
+    {"modify_orbits_forces",        setup_modify_orbits_forces,     100000},
+    {"exponential_migration",       setup_exponential_migration,    100000},
+    {"gravitational_harmonics",     setup_gravitational_harmonics,  100000},
+    {"radiation_forces",            setup_radiation_forces,         100000},
+    {"stochastic_forces",           setup_stochastic_forces,        100000},
+    {"tides_constant_time_lag",     setup_tides_constant_time_lag,  100000},
+    {"type_I_migration",            setup_type_I_migration,         100000},
+    {"tides_spin",                  setup_tides_spin,               1000},
+    {"yarkovsky_effect",            setup_yarkovsky_effect,         100000},
+    {"modify_mass",                 setup_modify_mass,              100000},
+    {"integrate_force",             setup_integrate_force,          100000},
+    {"modify_orbits_direct",        setup_modify_orbits_direct,     100000},
+    {"track_min_distance",          setup_track_min_distance,       100000},
+    {"gr+gravitational_harmonics+tides_spin", setup_stack,          1000},
+};
+
+static struct reb_simulation* create_sim(int N, enum REB_INTEGRATOR integrator){
+    struct reb_simulation* sim = reb_create_simulation();
+    sim->integrator = integrator;
+    sim->dt = 1.e-2;
+
+    struct reb_particle star = {0};
+    star.m = 1.;
+    star.r = 5.e-3;
+    reb_add(sim, star);
+
+    srand(42);
+    for (int i=1; i<N; i++){
+        double a = 1.+i*4./N;
+        double e = 0.05*rand()/RAND_MAX;
+        double inc = 0.05*rand()/RAND_MAX;
+        double Omega = 2.*M_PI*rand()/RAND_MAX;
+        double omega = 2.*M_PI*rand()/RAND_MAX;
+        double f = 2.*M_PI*rand()/RAND_MAX;
+        struct reb_particle p = reb_tools_orbit_to_particle(sim->G, star, 1.e-9, a, e, inc, Omega, omega, f);
+        p.r = 4.e-5;
+        reb_add(sim, p);
+    }
+    sim->N_active = 1;
+    reb_move_to_com(sim);
+    return sim;
+}
+
+// Wall time spent in the effects added to the simulation. Forces only evaluated by an operator are counted in the operator.
+static double effects_walltime(struct rebx_extras* rebx){
+    double time = 0.;
+    for (struct rebx_node* node = rebx->additional_forces; node != NULL; node = node->next){
+        time += ((struct rebx_force*)node->object)->profile.walltime;
+    }
+    for (struct rebx_node* node = rebx->allocated_operators; node != NULL; node = node->next){
+        time += ((struct rebx_operator*)node->object)->profile.walltime;
+    }
+    return time;
+}
+
+static void run(const struct benchmark* b, int N, enum REB_INTEGRATOR integrator, const char* integrator_name){
+    struct reb_simulation* sim = create_sim(N, integrator);
+    struct rebx_extras* rebx = rebx_attach(sim);
+    b->setup(sim, rebx);
+
+    reb_step(sim);      // warm up caches and lazily built workspaces before timing
+    rebx_profile_reset(rebx);
+    rebx->profiling = 1;
+
+    const long steps = BENCHMARK_PARTICLE_STEPS/N > 10 ? BENCHMARK_PARTICLE_STEPS/N : 10;
+    double start = walltime();
+    for (long i=0; i<steps; i++){
+        reb_step(sim);
+    }
+    double total = walltime() - start;
+    const double ns = 1.e9/((double)N*steps);
+    printf("%s,%s,%d,%ld,%.3f,%.3f\n", b->name, integrator_name, N, steps, effects_walltime(rebx)*ns, total*ns);
+    fflush(stdout);
+
+    rebx_free(rebx);
+    reb_free_simulation(sim);
+}
+
+int main(int argc, char* argv[]){
+    const char* filter = argc > 1 ? argv[1] : NULL;
+    const int Ns[] = {10, 1000, 100000};
+    const struct {enum REB_INTEGRATOR integrator; const char* name;} integrators[] = {
+        {REB_INTEGRATOR_WHFAST, "whfast"},
+        {REB_INTEGRATOR_IAS15, "ias15"},
+    };
+
+    printf("effect,integrator,N,steps,effect_ns_per_particle_step,total_ns_per_particle_step\n");
+    for (size_t i=0; i<sizeof(benchmarks)/sizeof(benchmarks[0]); i++){
+        const struct benchmark* b = &benchmarks[i];
+        if (filter && strstr(b->name, filter) == NULL){
+            continue;
+        }
+        for (size_t j=0; j<sizeof(integrators)/sizeof(integrators[0]); j++){
+            for (size_t k=0; k<sizeof(Ns)/sizeof(Ns[0]); k++){
+                if (Ns[k] <= b->N_max){
+                    run(b, Ns[k], integrators[j].integrator, integrators[j].name);
+                }
+            }
+        }
+    }
+    return 0;
+}
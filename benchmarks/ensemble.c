@@ -0,0 +1,136 @@
+/**
+ * Ensemble benchmark for REBOUNDx
+ *
+ * Integrates an ensemble of small planetary systems with gr, gravitational_harmonics and modify_mass on a pool of
+ * worker threads. The effects are set up once on a template, and each member gets its own copy with rebx_clone,
+ * on the thread that integrates it. Members share no state, so the wall time should drop linearly with the number
+ * of threads (up to the number of cores). Results are written to stdout as CSV, one line per number of threads:
+ *
+ *     ./ensemble [max_threads] > ensemble.csv
+ *
+ * max_threads defaults to the number of online cores.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+#define ENSEMBLE_N_MEMBERS 64
+#define ENSEMBLE_N_PLANETS 5
+#define ENSEMBLE_STEPS 20000
+#define ENSEMBLE_C 10065.32                 // speed of light in AU/(yr/2pi)
+
+static double walltime(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1.e-6*tv.tv_usec;
+}
+
+static struct reb_simulation* create_template(void){
+    struct reb_simulation* sim = reb_create_simulation();
+    sim->integrator = REB_INTEGRATOR_WHFAST;
+    sim->dt = 1.e-2;
+
+    struct reb_particle star = {0};
+    star.m = 1.;
+    star.r = 5.e-3;
+    reb_add(sim, star);
+    for (int i=1; i<=ENSEMBLE_N_PLANETS; i++){
+        struct reb_particle p = reb_tools_orbit_to_particle(sim->G, star, 1.e-5, 0.5*i, 0.02, 0.01*i, 0., 0., 1.3*i);
+        reb_add(sim, p);
+    }
+    reb_move_to_com(sim);
+
+    struct rebx_extras* rebx = rebx_attach(sim);
+    struct rebx_force* gr = rebx_load_force(rebx, "gr");
+    rebx_add_force(rebx, gr);
+    rebx_set_param_double(rebx, &gr->ap, "c", ENSEMBLE_C);
+
+    struct rebx_force* gh = rebx_load_force(rebx, "gravitational_harmonics");
+    rebx_add_force(rebx, gh);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "J2", 1.e-3);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "R_eq", 5.e-3);
+
+    struct rebx_operator* mm = rebx_load_operator(rebx, "modify_mass");
+    rebx_add_operator(rebx, mm);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "tau_mass", -1.e8);
+    return sim;
+}
+
+struct ensemble_worker{
+    struct rebx_extras* template;
+    int first;          // Members first, first+stride, ... are integrated by this worker
+    int stride;
+    double x;           // Sum of final positions, so the work can't be optimized away
+};
+
+static void* integrate_members(void* arg){
+    struct ensemble_worker* const w = arg;
+    const struct reb_simulation* const template_sim = w->template->sim;
+    w->x = 0.;
+    for (int m=w->first; m<ENSEMBLE_N_MEMBERS; m+=w->stride){
+        struct reb_simulation* sim = reb_create_simulation();
+        sim->integrator = template_sim->integrator;
+        sim->dt = template_sim->dt;
+        for (int i=0; i<template_sim->N; i++){
+            struct reb_particle p = template_sim->particles[i];
+            p.vx *= 1. + 1.e-6*m;   // perturb each member
+            reb_add(sim, p);        // p.ap still points to the template's params. rebx_clone gives the member its own
+        }
+        struct rebx_extras* rebx = rebx_clone(w->template, sim);
+        if (rebx == NULL){
+            fprintf(stderr, "Could not clone REBOUNDx instance for member %d.\n", m);
+            exit(1);
+        }
+        for (int s=0; s<ENSEMBLE_STEPS; s++){
+            reb_step(sim);
+        }
+        w->x += sim->particles[1].x;
+        rebx_free(rebx);
+        reb_free_simulation(sim);
+    }
+    return NULL;
+}
+
+static double run(struct rebx_extras* template, const int N_threads){
+    pthread_t threads[N_threads];
+    struct ensemble_worker workers[N_threads];
+    double start = walltime();
+    for (int t=0; t<N_threads; t++){
+        workers[t] = (struct ensemble_worker){.template = template, .first = t, .stride = N_threads};
+        pthread_create(&threads[t], NULL, integrate_members, &workers[t]);
+    }
+    for (int t=0; t<N_threads; t++){
+        pthread_join(threads[t], NULL);
+    }
+    return walltime() - start;
+}
+
+int main(int argc, char* argv[]){
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1){
+        max_threads = 1;
+    }
+    // Creating the template also sets up the tables shared by all instances, before any threads start
+    struct reb_simulation* sim = create_template();
+    struct rebx_extras* template = sim->extras;
+
+    printf("threads,members,steps,walltime,speedup,efficiency\n");
+    double serial = 0.;
+    for (int N_threads=1; N_threads<=max_threads; N_threads*=2){
+        const double time = run(template, N_threads);
+        if (N_threads == 1){
+            serial = time;
+        }
+        printf("%d,%d,%d,%.3f,%.2f,%.2f\n", N_threads, ENSEMBLE_N_MEMBERS, ENSEMBLE_STEPS, time, serial/time, serial/time/N_threads);
+        fflush(stdout);
+    }
+
+    rebx_free(template);
+    reb_free_simulation(sim);
+    return 0;
+}
@@ -0,0 +1,240 @@
+/**
+ * @file    central_stack.c
+ * @brief   Fused gr_potential, gravitational_harmonics, tides_constant_time_lag around particles[0]
+ *
+ * Generated by reboundx/scripts/fuse_effects.py with
+ *
+ *     python fuse_effects.py central_stack gr_potential gravitational_harmonics tides_constant_time_lag
+ *
+ * Rerun the script rather than editing this file. Evaluates gr_potential, gravitational_harmonics, tides_constant_time_lag in this order in a single pass over the particles,
+ * giving the same accelerations as the individual forces (to rounding for the back reactions on particles[0]). See fuse_effects.py for the differences.
+ * Call rebx_register_central_stack once, and then load the force with rebx_load_force(rebx, "central_stack") and set the params as for the individual effects.
+ */
+
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+void rebx_central_stack(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
+    struct rebx_extras* const rebx = sim->extras;
+    const double G = sim->G;
+    if (N < 2){
+        return;
+    }
+    const struct reb_particle p0 = particles[0];
+
+    const double* const R_eq = rebx_get_param(rebx, p0.ap, "R_eq");
+
+    // gr_potential
+    const double* const c = rebx_get_param(rebx, force->ap, "c");
+    if (c == NULL){
+        reb_error(sim, "REBOUNDx Error: Need to set speed of light in gr effect.  See examples in documentation.\n");
+        return;
+    }
+    const double C2 = (*c)*(*c);
+    const double gr_prefac1 = 6.*(G*p0.m)*(G*p0.m)/C2;
+
+    // J2 of particles[0] (gravitational_harmonics)
+    const double* const J2 = rebx_get_param(rebx, p0.ap, "J2");
+    const int J2_on = J2 != NULL && R_eq != NULL;
+    const double J2_fac = J2_on ? 3.*(*J2)*(*R_eq)*(*R_eq) : 0.;
+
+    // J4 of particles[0] (gravitational_harmonics)
+    const double* const J4 = rebx_get_param(rebx, p0.ap, "J4");
+    const int J4_on = J4 != NULL && R_eq != NULL;
+    const double J4_fac = J4_on ? 5.*(*J4)*(*R_eq)*(*R_eq)*(*R_eq)*(*R_eq) : 0.;
+
+    // Tides raised on particles[0] (tides_constant_time_lag). No tides at all if particles[0] is massless
+    const int tides_on = p0.m != 0;
+    const double* const primary_k2 = rebx_get_param(rebx, p0.ap, "tctl_k2");
+    const int primary_tides_on = tides_on && primary_k2 != NULL && p0.r != 0;
+    double primary_tau = 0.;
+    double primary_Omega = 0.;
+    if (primary_tides_on){
+        const double* const tau = rebx_get_param(rebx, p0.ap, "tctl_tau");
+        if (tau){
+            primary_tau = *tau;
+            const double* const Omega = rebx_get_param(rebx, p0.ap, "OmegaMag");
+            if (Omega){
+                primary_Omega = *Omega;
+            }
+        }
+    }
+
+    // Tides raised on the other particles by particles[0] (tides_constant_time_lag). The list is in particle order, so it's walked along with the particles
+    const struct rebx_param_list* const k2s = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "tctl_k2"));
+    if (k2s == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for central_stack.\n");
+        return;
+    }
+    const int id_tau = rebx_intern(rebx, "tctl_tau");
+    const int id_Omega = rebx_intern(rebx, "OmegaMag");
+    int k2_next = (k2s->N_particles > 0 && k2s->index[0] == 0) ? 1 : 0;
+
+    double ax0 = 0.;
+    double ay0 = 0.;
+    double az0 = 0.;
+    for (int i=1; i<N; i++){
+        const struct reb_particle p = particles[i];
+        const double dx = p.x - p0.x;
+        const double dy = p.y - p0.y;
+        const double dz = p.z - p0.z;
+        const double r2 = dx*dx + dy*dy + dz*dz;
+        const double r = sqrt(r2);
+        const double dvx = p.vx - p0.vx;
+        const double dvy = p.vy - p0.vy;
+        const double dvz = p.vz - p0.vz;
+        double ax = p.ax;
+        double ay = p.ay;
+        double az = p.az;
+
+        // gr_potential
+        {
+            const double prefac = gr_prefac1/(r2*r2);
+            ax -= prefac*dx;
+            ay -= prefac*dy;
+            az -= prefac*dz;
+            ax0 += p.m/p0.m*prefac*dx;
+            ay0 += p.m/p0.m*prefac*dy;
+            az0 += p.m/p0.m*prefac*dz;
+        }
+
+        // J2 of particles[0] (gravitational_harmonics)
+        if (J2_on){
+            const double costheta2 = dz*dz/r2;
+            const double prefac = J2_fac/r2/r2/r/2.;
+            const double fac = 5.*costheta2-1.;
+            ax += G*p0.m*prefac*fac*dx;
+            ay += G*p0.m*prefac*fac*dy;
+            az += G*p0.m*prefac*(fac-2.)*dz;
+            ax0 -= G*p.m*prefac*fac*dx;
+            ay0 -= G*p.m*prefac*fac*dy;
+            az0 -= G*p.m*prefac*(fac-2.)*dz;
+        }
+
+        // J4 of particles[0] (gravitational_harmonics)
+        if (J4_on){
+            const double costheta2 = dz*dz/r2;
+            const double prefac = J4_fac/r2/r2/r2/r/8.;
+            const double fac = 63.*costheta2*costheta2-42.*costheta2 + 3.;
+            ax += G*p0.m*prefac*fac*dx;
+            ay += G*p0.m*prefac*fac*dy;
+            az += G*p0.m*prefac*(fac+12.-28.*costheta2)*dz;
+            ax0 -= G*p.m*prefac*fac*dx;
+            ay0 -= G*p.m*prefac*fac*dy;
+            az0 -= G*p.m*prefac*(fac+12.-28.*costheta2)*dz;
+        }
+
+        // Tides raised on particles[0] by particles[i] (tides_constant_time_lag)
+        if (primary_tides_on && p.m != 0){
+            const double ms = p.m;
+            const double mt = p0.m;
+            const double Rt = p0.r;
+            const double tau = primary_tau;
+            const double Omega = primary_Omega;
+            const double mratio = ms/mt;
+            const double fac = mratio*(*primary_k2)*Rt*Rt*Rt*Rt*Rt;
+            const double tdx = -1.*dx;
+            const double tdy = -1.*dy;
+            const double tdz = -1.*dz;
+            const double prefac = -3*G/(r2*r2*r2*r2)*fac;
+            double rfac = prefac;
+            if (tau != 0){
+                const double tdvx = -1.*dvx;
+                const double tdvy = -1.*dvy;
+                const double tdvz = -1.*dvz;
+                rfac *= (1. + 3.*tau/r2*(tdx*tdvx + tdy*tdvy + tdz*tdvz));
+                const double thetafac = -prefac*tau;
+                const double hx = tdy*tdvz - tdz*tdvy;
+                const double hy = tdz*tdvx - tdx*tdvz;
+                const double hz = tdx*tdvy - tdy*tdvx;
+                const double thetadotcrossrx = (hy*tdz - hz*tdy)/r2;
+                const double thetadotcrossry = (hz*tdx - hx*tdz)/r2;
+                const double thetadotcrossrz = (hx*tdy - hy*tdx)/r2;
+                const double Omegacrossrx = -Omega*tdy;
+                const double Omegacrossry = Omega*tdx;
+                const double Omegacrossrz = 0.;
+                ax0 += thetafac*ms*(Omegacrossrx-thetadotcrossrx);
+                ay0 += thetafac*ms*(Omegacrossry-thetadotcrossry);
+                az0 += thetafac*ms*(Omegacrossrz-thetadotcrossrz);
+                ax -= thetafac*mt*(Omegacrossrx-thetadotcrossrx);
+                ay -= thetafac*mt*(Omegacrossry-thetadotcrossry);
+                az -= thetafac*mt*(Omegacrossrz-thetadotcrossrz);
+            }
+            ax0 += rfac*ms*tdx;
+            ay0 += rfac*ms*tdy;
+            az0 += rfac*ms*tdz;
+            ax -= rfac*mt*tdx;
+            ay -= rfac*mt*tdy;
+            az -= rfac*mt*tdz;
+        }
+
+        // Tides raised on particles[i] by particles[0] (tides_constant_time_lag)
+        if (k2_next < k2s->N_particles && k2s->index[k2_next] == i){
+            const double* const k2 = k2s->values[k2_next];
+            k2_next++;
+            if (tides_on && p.r != 0 && p.m != 0){
+                double tau = 0.;
+                double Omega = 0.;
+                const double* const tauptr = rebx_get_param_by_id(rebx, p.ap, id_tau);
+                if (tauptr){
+                    tau = *tauptr;
+                    const double* const Omegaptr = rebx_get_param_by_id(rebx, p.ap, id_Omega);
+                    if (Omegaptr){
+                        Omega = *Omegaptr;
+                    }
+                }
+                const double ms = p0.m;
+                const double mt = p.m;
+                const double Rt = p.r;
+                const double mratio = ms/mt;
+                const double fac = mratio*(*k2)*Rt*Rt*Rt*Rt*Rt;
+                const double tdx = 1.*dx;
+                const double tdy = 1.*dy;
+                const double tdz = 1.*dz;
+                const double prefac = -3*G/(r2*r2*r2*r2)*fac;
+                double rfac = prefac;
+                if (tau != 0){
+                    const double tdvx = 1.*dvx;
+                    const double tdvy = 1.*dvy;
+                    const double tdvz = 1.*dvz;
+                    rfac *= (1. + 3.*tau/r2*(tdx*tdvx + tdy*tdvy + tdz*tdvz));
+                    const double thetafac = -prefac*tau;
+                    const double hx = tdy*tdvz - tdz*tdvy;
+                    const double hy = tdz*tdvx - tdx*tdvz;
+                    const double hz = tdx*tdvy - tdy*tdvx;
+                    const double thetadotcrossrx = (hy*tdz - hz*tdy)/r2;
+                    const double thetadotcrossry = (hz*tdx - hx*tdz)/r2;
+                    const double thetadotcrossrz = (hx*tdy - hy*tdx)/r2;
+                    const double Omegacrossrx = -Omega*tdy;
+                    const double Omegacrossry = Omega*tdx;
+                    const double Omegacrossrz = 0.;
+                    ax += thetafac*ms*(Omegacrossrx-thetadotcrossrx);
+                    ay += thetafac*ms*(Omegacrossry-thetadotcrossry);
+                    az += thetafac*ms*(Omegacrossrz-thetadotcrossrz);
+                    ax0 -= thetafac*mt*(Omegacrossrx-thetadotcrossrx);
+                    ay0 -= thetafac*mt*(Omegacrossry-thetadotcrossry);
+                    az0 -= thetafac*mt*(Omegacrossrz-thetadotcrossrz);
+                }
+                ax += rfac*ms*tdx;
+                ay += rfac*ms*tdy;
+                az += rfac*ms*tdz;
+                ax0 -= rfac*mt*tdx;
+                ay0 -= rfac*mt*tdy;
+                az0 -= rfac*mt*tdz;
+            }
+        }
+
+        particles[i].ax = ax;
+        particles[i].ay = ay;
+        particles[i].az = az;
+    }
+    particles[0].ax += ax0;
+    particles[0].ay += ay0;
+    particles[0].az += az0;
+}
+
+int rebx_register_central_stack(struct rebx_extras* const rebx){
+    const struct rebx_registered_effect effect = {.name = "central_stack", .update_accelerations = rebx_central_stack, .force_type = REBX_FORCE_VEL};
+    return rebx_register_effect(rebx, &effect);
+}
@@ -0,0 +1,96 @@
+/**
+ * Fusing a stack of effects around the central body into one force
+ *
+ * central_stack.c was generated with
+ *     python ../../scripts/fuse_effects.py central_stack gr_potential gravitational_harmonics tides_constant_time_lag
+ * and evaluates all three effects in a single pass over the particles. This example integrates the same system once with the
+ * three individual forces and once with the fused force, and prints the difference in the final positions, which is at the level of rounding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+int rebx_register_central_stack(struct rebx_extras* const rebx);
+
+struct reb_simulation* create_sim(){
+    struct reb_simulation* sim = reb_create_simulation();
+    sim->G = 4*M_PI*M_PI;           // Units of AU, yr and Msun
+    sim->dt = 1.e-3;
+    sim->integrator = REB_INTEGRATOR_IAS15;
+    sim->ri_ias15.epsilon = 0;      // fixed timestep, so both runs take the same steps
+
+    struct reb_particle star = {0};
+    star.m = 1.;
+    star.r = 0.005;                 // AU
+    reb_add(sim, star);
+
+    for (int i=0; i<3; i++){
+        double m = 3.e-6*(i+1);
+        double a = 0.05*(i+1);
+        double e = 0.05;
+        double inc = 0.02*i;
+        struct reb_particle planet = reb_tools_orbit_to_particle(sim->G, star, m, a, e, inc, 0., 0., 2.*i);
+        planet.r = 4.e-5;
+        reb_add(sim, planet);
+    }
+    reb_move_to_com(sim);
+    return sim;
+}
+
+void set_params(struct rebx_extras* rebx, struct reb_simulation* sim){
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "J2", 1.e-4);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "R_eq", 0.005);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "tctl_k2", 0.03);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "tctl_tau", 1.e-6);
+    rebx_set_param_double(rebx, &sim->particles[0].ap, "OmegaMag", 2*M_PI/(10./365.)); // 10 day rotation rate
+    for (int i=1; i<sim->N; i++){
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tctl_k2", 0.3);
+        rebx_set_param_double(rebx, &sim->particles[i].ap, "tctl_tau", 1.e-4);
+    }
+}
+
+int main(int argc, char* argv[]){
+    double tmax = 10.; // years
+
+    // The individual forces. The most recently added force is evaluated first, so add them in the reverse of the order they were fused in
+    struct reb_simulation* sim = create_sim();
+    struct rebx_extras* rebx = rebx_attach(sim);
+    struct rebx_force* tides = rebx_load_force(rebx, "tides_constant_time_lag");
+    rebx_add_force(rebx, tides);
+    struct rebx_force* gh = rebx_load_force(rebx, "gravitational_harmonics");
+    rebx_add_force(rebx, gh);
+    struct rebx_force* gr = rebx_load_force(rebx, "gr_potential");
+    rebx_set_param_double(rebx, &gr->ap, "c", 63241.077);  // in AU/yr
+    rebx_add_force(rebx, gr);
+    set_params(rebx, sim);
+    reb_integrate(sim, tmax);
+
+    // The fused force takes the params of all three effects. It only has to be registered once
+    struct reb_simulation* fused_sim = create_sim();
+    struct rebx_extras* fused_rebx = rebx_attach(fused_sim);
+    if (!rebx_register_central_stack(fused_rebx)){
+        return 1;
+    }
+    struct rebx_force* central_stack = rebx_load_force(fused_rebx, "central_stack");
+    rebx_set_param_double(fused_rebx, &central_stack->ap, "c", 63241.077);
+    rebx_add_force(fused_rebx, central_stack);
+    set_params(fused_rebx, fused_sim);
+    reb_integrate(fused_sim, tmax);
+
+    double dmax = 0.;
+    for (int i=0; i<sim->N; i++){
+        const double dx = sim->particles[i].x - fused_sim->particles[i].x;
+        const double dy = sim->particles[i].y - fused_sim->particles[i].y;
+        const double dz = sim->particles[i].z - fused_sim->particles[i].z;
+        dmax = fmax(dmax, sqrt(dx*dx + dy*dy + dz*dz));
+    }
+    printf("Largest difference in final positions between the individual and fused forces: %e AU\n", dmax);
+
+    rebx_free(rebx);
+    reb_free_simulation(sim);
+    rebx_free(fused_rebx);
+    reb_free_simulation(fused_sim);
+}
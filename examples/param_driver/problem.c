@@ -0,0 +1,70 @@
+/**
+ * Stellar evolution with a parameter driver
+ *
+ * This example does the same as parameter_interpolation, but instead of
+ * setting the star's mass from a heartbeat function, it binds the
+ * interpolated track to the mass with the param_driver operator, which sets
+ * it at every timestep. The track's second series drives the star's radius.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+void heartbeat(struct reb_simulation* sim);
+double tmax = 1e4;
+int main(int argc, char* argv[]) {
+    struct reb_simulation* sim = reb_create_simulation();
+    sim->G = 4*M_PI*M_PI; // use units of AU, yr and solar masses
+    sim->heartbeat = heartbeat;
+    sim->integrator = REB_INTEGRATOR_WHFAST;
+    sim->dt = 1e-2;
+
+    struct reb_particle sun = {0};
+    sun.m = 1.;
+    sun.r = 0.00465;
+    reb_add(sim, sun);
+    // Initialize planets on circular orbits, each 2 times farther than last.
+    struct reb_particle planet = {0};
+    planet.x = 1.;
+    planet.vy = 2.*M_PI;
+    reb_add(sim, planet);
+    planet.x *= 2.;
+    planet.vy /= sqrt(2.);
+    reb_add(sim, planet);
+    planet.x *= 2.;
+    planet.vy /= sqrt(2.);
+    reb_add(sim, planet);
+
+    reb_move_to_com(sim);
+    struct rebx_extras* rebx = rebx_attach(sim); // initialize reboundx
+
+    // Mass (in Msun) and radius (in AU) of the star at each of the times, one series after the other
+    int n = 6; // size of arrays
+    double times[] = {0, 2500, 5000, 7500, 10000, 12500}; // in yr
+    double values[] = {1., 0.77880078307, 0.60653065971, 0.47236655274, 0.36787944117, 0.28650479686,
+                       0.00465, 0.0052, 0.0061, 0.0075, 0.0098, 0.0130};
+    struct rebx_interpolator* track = rebx_create_interpolator_channels(rebx, n, 2, times, values, REBX_INTERPOLATION_SPLINE);
+
+    struct rebx_operator* driver = rebx_load_operator(rebx, "param_driver");
+    rebx_add_operator(rebx, driver);
+    rebx_drive_particle_param(rebx, driver, 0, "m", track, 0);
+    rebx_drive_particle_param(rebx, driver, 0, "r", track, 1);
+    rebx_free_interpolator(track); // the driver keeps its own copy
+
+    // Mass loss is slow, so we could instead only update the mass every 100 steps with
+    // rebx_add_operator_every(rebx, driver, 100, 0);
+
+    reb_integrate(sim, tmax);
+    rebx_free(rebx); // explicitly free all the memory allocated by REBOUNDx
+    reb_free_simulation(sim);
+}
+
+void heartbeat(struct reb_simulation* sim) {
+    if (reb_output_check(sim, tmax/1000)) {
+        struct reb_orbit o = reb_tools_particle_to_orbit(sim->G, sim->particles[1], sim->particles[0]);
+        printf("t=%e, Sun mass = %f, Sun radius = %f, planet semimajor axis = %f\n", sim->t, sim->particles[0].m, sim->particles[0].r, o.a);
+    }
+}
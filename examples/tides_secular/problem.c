@@ -0,0 +1,81 @@
+/**
+ * Orbit-averaged tides (Hut 1981)
+ *
+ * This example shows how to evolve the tidal circularization of a fiducial hot Jupiter with the orbit-averaged equations of Hut (1981),
+ * rather than resolving the tidal forces along the orbit like tides_spin.
+ * Since the secular equations only change appreciably over many orbits, the tides_secular operator is applied once every 100 timesteps.
+ * To see anything interesting within a short integration, the tidal dissipation in the planet is strongly exaggerated.
+ * The eccentricity damps, the semimajor axis shrinks, and the planet's rotation spins down toward the pseudo-synchronous value.
+ * See the documentation for tides_spin for more in-depth explanations regarding the various parameters that may be set in this simulation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+void heartbeat(struct reb_simulation* sim);
+double tmax = 2e4;
+
+int main(int argc, char* argv[]){
+    struct reb_simulation* sim = reb_create_simulation();
+
+    // Star
+    const double solar_mass = 1.;
+    const double solar_rad = 0.00465; // one solar radius in AU
+    reb_add_fmt(sim, "m r", solar_mass, solar_rad);
+
+    // Fiducial hot Jupiter
+    const double p1_mass = 1. * 9.55e-4; // in Jupiter masses * 1 Jupiter Mass / 1 Solar Mass
+    const double p1_rad = 1. * 4.676e-4; // in Jupiter rad * 1 jupiter rad / 1 AU
+    reb_add_fmt(sim, "m a e r", p1_mass, 0.04072, 0.2, p1_rad);
+
+    struct reb_orbit orb = reb_tools_particle_to_orbit(sim->G, sim->particles[1], sim->particles[0]);
+    sim->integrator = REB_INTEGRATOR_WHFAST;
+    sim->dt = orb.P/20.;
+    sim->heartbeat = heartbeat;
+
+    struct rebx_extras* rebx = rebx_attach(sim);
+    struct rebx_operator* tides = rebx_load_operator(rebx, "tides_secular");
+    // The operator is applied once every 100 timesteps, evolving the orbit and spins over the 100 timesteps at once
+    rebx_add_operator_every(rebx, tides, 100, 0);
+
+    // The parameters are the same as for tides_spin. We only raise tides on the planet here.
+    // The spin is assumed to be along the orbit normal (here the z axis)
+    const double spin_period_1 = 0.5 * 2. * M_PI / 365.; // 0.5 days in reb years
+    const double planet_Q = 1.; // Exaggerated, a realistic hot Jupiter would have Q ~ 1e5
+    rebx_set_param_double(rebx, &sim->particles[1].ap, "k2", 0.3);
+    rebx_set_param_vec3d(rebx, &sim->particles[1].ap, "Omega", (struct reb_vec3d){.z=2.*M_PI/spin_period_1});
+    rebx_set_param_double(rebx, &sim->particles[1].ap, "tau", 1./(2*planet_Q*orb.n));
+
+    // Without setting the moment of inertia, the spin would be held fixed
+    rebx_set_param_double(rebx, &sim->particles[1].ap, "I", 0.25 * p1_mass * p1_rad * p1_rad);
+
+    reb_move_to_com(sim);
+
+    system("rm -v output.txt"); // remove previous output file
+    reb_integrate(sim, tmax);
+    rebx_free(rebx);
+    reb_free_simulation(sim);
+}
+
+void heartbeat(struct reb_simulation* sim){
+    if(reb_output_check(sim, 100.)){
+        struct rebx_extras* const rebx = sim->extras;
+        FILE* of = fopen("output.txt", "a");
+        if (of==NULL){
+            reb_error(sim, "Can not open file.");
+            return;
+        }
+        struct reb_particle* p = &sim->particles[1];
+        struct reb_orbit orb = reb_tools_particle_to_orbit(sim->G, *p, sim->particles[0]);
+        struct reb_vec3d* Omega = rebx_get_param(rebx, p->ap, "Omega");
+        fprintf(of, "%e,%e,%e,%e\n", sim->t, orb.a, orb.e, Omega->z/orb.n); // spin in units of the mean motion
+        fclose(of);
+    }
+
+    if(reb_output_check(sim, 1000.)){
+        reb_output_timing(sim, tmax);
+    }
+}
@@ -41,9 +41,9 @@ def params(self):
 
 rebound.Particle.params = params
 
-from .extras import Extras, Param, Node, Force, Operator, integrators, Interpolator
+from .extras import Extras, Param, Node, Force, Operator, integrators, Interpolator, ParticleArrays, numpy_force
 from .simulationarchive import SimulationArchive
 from .tools import coordinates, install_test
 from .params import Params
 
-__all__ = ["__version__", "__build__", "__githash__", "Extras", "SimulationArchive", "Param", "Interpolator", "Params", "coordinates", "integrators"]
+__all__ = ["__version__", "__build__", "__githash__", "Extras", "SimulationArchive", "Param", "Interpolator", "Params", "coordinates", "integrators", "ParticleArrays", "numpy_force"]
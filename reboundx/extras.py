@@ -1,14 +1,16 @@
 from . import clibreboundx
-from ctypes import Structure, c_double, POINTER, c_int, c_uint, c_long, c_ulong, c_void_p, c_char_p, CFUNCTYPE, byref, c_uint32, c_uint, cast, c_char, pointer
+from ctypes import Structure, Union, c_double, POINTER, c_int, c_uint, c_long, c_ulong, c_void_p, c_char_p, CFUNCTYPE, byref, c_uint32, c_uint, cast, c_char, pointer, c_size_t, c_ulonglong, addressof, sizeof
 import rebound
 import reboundx
 import warnings
+import os
 
-integrators = {"implicit_midpoint": 0, "rk4":1, "euler": 2, "rk2": 3, "none": -1}
+integrators = {"implicit_midpoint": 0, "rk4":1, "euler": 2, "rk2": 3, "rk45": 4, "none": -1}
 
 REBX_TIMING = {"pre":-1, "post":1}
 REBX_FORCE_TYPE = {"none":0, "pos":1, "vel":2}
 REBX_OPERATOR_TYPE = {"none":0, "updater":1, "recorder":2}
+REBX_SUBSTEP_TYPE = {"kepler":0, "jump":1, "interaction":2}
 
 REBX_BINARY_WARNINGS = [
     (True, 1, "REBOUNDx: Cannot open binary file. Check filename."),
@@ -25,7 +27,8 @@ REBX_BINARY_WARNINGS = [
     (False, 2048, "REBOUNDx: Unknown field found in binary file. Any unknown fields not loaded.  This can happen if the binary was created with a later version of REBOUNDx than the one used to read it."),
     (False, 4096, "REBOUNDx: Unknown list in the REBOUNDx structure wasn't loaded. This can happen if the binary was created with a later version of REBOUNDx than the one used to read it."),
     (False, 8192, "REBOUNDx: The value of at least one parameter was not loaded. This can happen if a custom structure was added by the user as a parameter. See Parameters.ipynb jupyter notebook example."),
-    (False,16384, "REBOUNDx: Binary file was saved with a different version of REBOUNDx. Binary format might have changed. Check that effects and parameters are loaded as expected.")
+    (False,16384, "REBOUNDx: Binary file was saved with a different version of REBOUNDx. Binary format might have changed. Check that effects and parameters are loaded as expected."),
+    (True, 65536, "REBOUNDx: Requested snapshot is not in the binary file.")
 ]
 
 class Extras(Structure):
@@ -36,11 +39,22 @@ class Extras(Structure):
     The fastest way to understand it is to follow the examples at :ref:`ipython_examples`.
     """
 
-    def __new__(cls, sim, filename=None):
+    def __new__(cls, sim, filename=None, snapshot=-1):
         rebx = super(Extras,cls).__new__(cls)
         return rebx
 
-    def __init__(self, sim, filename=None):
+    def __init__(self, sim, filename=None, snapshot=-1):
+        """
+        Arguments
+        ---------
+        sim : rebound.Simulation
+            Simulation to attach REBOUNDx to.
+        filename : str or bytes
+            REBOUNDx binary to load effects and parameters from (optional). Can also be the contents of a binary
+            already in memory (bytes, bytearray or an mmap), which avoids going through a file.
+        snapshot : int
+            Snapshot to load if filename holds several (negative values count from the end, default -1 loads the last).
+        """
         sim._extras_ref = self # add a reference to this instance in sim to make sure it's not garbage collected_
         clibreboundx.rebx_initialize(byref(sim), byref(self))
         # Create simulation
@@ -51,7 +65,14 @@ class Extras(Structure):
             # Recreate existing simulation.
             # Load registered parameters from binary
             w = c_int(0)
-            clibreboundx.rebx_init_extras_from_binary(byref(self), c_char_p(filename.encode('ascii')), byref(w))
+            if isinstance(filename, str):
+                clibreboundx.rebx_init_extras_from_binary_snapshot(byref(self), c_char_p(filename.encode('ascii')), c_long(snapshot), byref(w))
+            else:
+                try:
+                    buf = (c_char*len(filename)).from_buffer(filename) # no copy for writable buffers (bytearray, mmap)
+                except TypeError:
+                    buf = c_char_p(bytes(filename)) # no copy if already bytes
+                clibreboundx.rebx_init_extras_from_buffer(byref(self), buf, c_size_t(len(filename)), c_long(snapshot), byref(w))
             for majorerror, value, message in REBX_BINARY_WARNINGS:
                 if w.value & value:
                     if majorerror:
@@ -68,6 +89,22 @@ class Extras(Structure):
         sim._extras_ref = None # remove reference to rebx so it can be garbage collected
         clibreboundx.rebx_detach(byref(sim), byref(self))
 
+    def clone(self, sim):
+        """
+        Returns a copy of this instance (effects, operators and params) attached to sim, e.g. for each member of an ensemble.
+        Params on sim's particles are copied by index. Pointer params (e.g. custom structures) are not copied.
+        Clones share no state with one another, so they can be integrated on different threads. See rebx_clone.
+        """
+        if addressof(sim) == addressof(self._sim.contents):
+            raise ValueError("REBOUNDx Error: Can't clone a REBOUNDx instance onto the simulation it's attached to. Pass a different simulation.")
+        rebx = Extras.__new__(Extras, sim)
+        sim._extras_ref = rebx
+        rebx._clone_source = self # custom effects' functions are kept alive by the source
+        clibreboundx.rebx_initialize(byref(sim), byref(rebx))
+        clibreboundx.rebx_init_extras_from_clone(byref(rebx), byref(self))
+        rebx.process_messages()
+        return rebx
+
     #######################################
     # Functions for manipulating REBOUNDx effects
     #######################################
@@ -77,12 +114,162 @@ class Extras(Structure):
         clibreboundx.rebx_register_param(byref(self), c_char_p(name.encode('ascii')), c_int(type_enum))
         self.process_messages()
 
+    def add_param_column(self, name):
+        """
+        Stores the (double) parameter name contiguously across all particles. Particle params are set and read as usual,
+        but effects that support columns (e.g. radiation_forces with beta) can then loop over them without chasing pointers.
+        """
+        clibreboundx.rebx_add_param_column(byref(self), c_char_p(name.encode('ascii')))
+        self.process_messages()
+
+    def get_param_column(self, name):
+        """
+        Returns a numpy view (no copy) of the column added with add_param_column for the parameter name, with one entry
+        per particle in sim.particles (0 for particles without the parameter). Writing to it sets the parameter on the
+        particles that have it. Only valid until particles are added or removed.
+        """
+        import numpy as np
+        clibreboundx.rebx_intern.restype = c_int
+        param_id = clibreboundx.rebx_intern(byref(self), c_char_p(name.encode('ascii')))
+        self.process_messages()
+        clibreboundx.rebx_get_param_column.restype = POINTER(ParamColumn)
+        column = clibreboundx.rebx_get_param_column(byref(self), c_int(param_id))
+        if not column:
+            raise AttributeError("REBOUNDx Error: Parameter '{0}' is not stored in a column. Call add_param_column first.".format(name))
+        column = column.contents
+        if column.N == 0:
+            return np.zeros(0)
+        return np.ctypeslib.as_array(column.values, shape=(column.N,))
+
+    def _particle_param_dtype(self, name):
+        import numpy as np
+        ctype = REBX_CTYPES[clibreboundx.rebx_get_type(byref(self), c_char_p(name.encode('ascii')))]
+        if ctype == None:
+            raise AttributeError("REBOUNDx Error: Parameter '{0}' not found in REBOUNDx. Need to register it first.".format(name))
+        if ctype == rebound._Vec3d:
+            return np.dtype(np.float64), (3,)
+        if ctype in [c_double, c_int, c_uint32]:
+            return np.dtype(ctype), ()
+        raise AttributeError("REBOUNDx Error: Parameter '{0}' can't be accessed in bulk. Must be a float, int, uint32 or vector parameter.".format(name))
+
+    def set_particle_params(self, name, values, indices=None):
+        """
+        Sets the parameter name on many particles in a single call, which is much faster than setting
+        sim.particles[i].params[name] in a loop. values is an array (or a single value for all particles) with one
+        entry per particle (shape (N, 3) for vector params). indices lists the particles to set (default all particles,
+        or the first len(values)).
+        """
+        import numpy as np
+        dtype, shape = self._particle_param_dtype(name)
+        if indices is not None:
+            indices = np.ascontiguousarray(indices, dtype=np.intc)
+            N = indices.shape[0]
+        elif np.ndim(values) > len(shape):
+            N = np.shape(values)[0]
+        else:
+            N = self._sim.contents.N
+        values = np.ascontiguousarray(np.broadcast_to(values, (N,)+shape), dtype=dtype)
+        indptr = None if indices is None else indices.ctypes.data_as(c_void_p)
+        clibreboundx.rebx_set_particle_params(byref(self), c_char_p(name.encode('ascii')), values.ctypes.data_as(c_void_p), indptr, c_int(N))
+        self.process_messages()
+
+    def get_particle_params(self, name, indices=None, default=None):
+        """
+        Returns a numpy array with the parameter name for many particles in a single call. indices lists the particles
+        (default all). Raises an AttributeError if a particle doesn't have the parameter, unless a default is passed
+        to fill in for those particles.
+        """
+        import numpy as np
+        dtype, shape = self._particle_param_dtype(name)
+        if indices is not None:
+            indices = np.ascontiguousarray(indices, dtype=np.intc)
+            N = indices.shape[0]
+        else:
+            N = self._sim.contents.N
+        values = np.zeros((N,)+shape, dtype=dtype)
+        if default is not None:
+            values[...] = default
+        indptr = None if indices is None else indices.ctypes.data_as(c_void_p)
+        clibreboundx.rebx_get_particle_params.restype = c_int
+        Nfound = clibreboundx.rebx_get_particle_params(byref(self), c_char_p(name.encode('ascii')), values.ctypes.data_as(c_void_p), indptr, c_int(N))
+        self.process_messages()
+        if Nfound < N and default is None:
+            raise AttributeError("REBOUNDx Error: Parameter '{0}' not found on all particles. Pass a default to fill in missing values.".format(name))
+        return values
+
+    @property
+    def profiling(self):
+        """
+        Set to True to record how often each force and operator is evaluated, and the wall time spent in it. See profile().
+        """
+        return bool(self._profiling)
+
+    @profiling.setter
+    def profiling(self, value):
+        self._profiling = 1 if value else 0
+
+    def profile(self, reset=False):
+        """
+        Returns a dictionary with an entry for each loaded force and operator (by name), with the number of 'calls',
+        the cumulative 'walltime' in seconds, and the number of 'particles' passed and those 'culled' (skipped by forces
+        with a cull_threshold param) summed over calls, recorded while profiling was set. Operators' times include the
+        forces they evaluate (e.g. integrate_force).
+        Counters are zeroed afterwards if reset is True.
+        """
+        stats = {}
+        for node, cls in [(self._allocated_forces, Force), (self._allocated_operators, Operator)]:
+            while node:
+                effect = cast(node.contents.object, POINTER(cls)).contents
+                p = effect._profile
+                stats[effect.name.decode('ascii')] = {'calls': p.calls, 'walltime': p.walltime, 'particles': p.particles, 'culled': p.culled}
+                node = node.contents.next
+        if reset:
+            clibreboundx.rebx_profile_reset(byref(self))
+        return stats
+
+    def memory_usage(self):
+        """
+        Returns a dictionary with the memory REBOUNDx currently holds in each category ('params', 'forces', 'operators',
+        'workspaces', 'interpolators' and 'other'), as well as the 'total', each a dictionary with the number of 'bytes' and
+        'allocations'. Nothing is recorded ahead of time, so this costs nothing until called. Interpolators created with
+        Interpolator aren't included.
+        """
+        usage = MemoryUsage()
+        clibreboundx.rebx_memory_usage(byref(self), byref(usage))
+        names = ['params', 'forces', 'operators', 'workspaces', 'interpolators', 'other']
+        stats = {name: {'bytes': usage.bytes[k], 'allocations': usage.allocations[k]} for k, name in enumerate(names)}
+        stats['total'] = {'bytes': sum(usage.bytes), 'allocations': sum(usage.allocations)}
+        return stats
+
     def load_force(self, name):
         clibreboundx.rebx_load_force.restype = POINTER(Force)
         ptr = clibreboundx.rebx_load_force(byref(self), c_char_p(name.encode('ascii')))
         self.process_messages()
         return ptr.contents
 
+    def register_effect(self, name, force_type=None, update_accelerations=None, update_constants=None, operator_type=None, step_function=None):
+        """
+        Registers a custom force (pass update_accelerations and force_type, and optionally update_constants) or operator (pass
+        step_function and operator_type), so it can be loaded by name with load_force or load_operator, including when loading
+        a binary. The registry is shared by all Extras instances, so this only needs to be done once.
+        """
+        effect = RegisteredEffect()
+        effect.name = name.encode('ascii') # copied by REBOUNDx
+        if force_type is not None:
+            effect.force_type = REBX_FORCE_TYPE[force_type.lower()]
+        if update_accelerations is not None:
+            effect.update_accelerations = FORCEFUNCPTR(update_accelerations)
+        if update_constants is not None:
+            effect.update_constants = FORCEFUNCPTR(update_constants)
+        if operator_type is not None:
+            effect.operator_type = REBX_OPERATOR_TYPE[operator_type.lower()]
+        if step_function is not None:
+            effect.step_function = STEPFUNCPTR(step_function)
+        success = clibreboundx.rebx_register_effect(byref(self), byref(effect))
+        self.process_messages()
+        if success:
+            _registered_effects.append(effect) # registered effects are never removed, so keep their functions from getting garbage collected
+
     def create_force(self, name):
         clibreboundx.rebx_create_force.restype = POINTER(Force)
         ptr = clibreboundx.rebx_create_force(byref(self), c_char_p(name.encode('ascii')))
@@ -107,14 +294,18 @@ class Extras(Structure):
         clibreboundx.rebx_add_force(byref(self), byref(force))
         self.process_messages()
 
-    def add_operator(self, operator, dtfraction=None, timing="post"):
+    def add_operator(self, operator, dtfraction=None, timing="post", every=1, phase=0):
+        """
+        With every > 1, the operator is only applied once every that many timesteps, for every times as long (windows of
+        timesteps start when sim.steps_done % every == phase). Useful for slow processes. Assumes a fixed sim.dt.
+        """
         if not isinstance(operator, reboundx.extras.Operator):
             raise TypeError("REBOUNDx Error: Object passed to rebx.add_operator is not a reboundx.Operator instance.")
         if dtfraction is None:
-            clibreboundx.rebx_add_operator(byref(self), byref(operator))
+            clibreboundx.rebx_add_operator_every(byref(self), byref(operator), c_int(every), c_int(phase))
         else:
             timingint = REBX_TIMING[timing]
-            clibreboundx.rebx_add_operator_step(byref(self), byref(operator), c_double(dtfraction), c_int(timingint))
+            clibreboundx.rebx_add_operator_step_every(byref(self), byref(operator), c_double(dtfraction), c_int(timingint), c_int(every), c_int(phase))
         self.process_messages()
 
     def get_force(self, name):
@@ -148,14 +339,63 @@ class Extras(Structure):
         if not success:
             raise AttributeError("REBOUNDx Error: Operator {0} passed to rebx.remove_operator not found in simulation.")
 
+    def composite_add_substep(self, operator, name, dtfraction):
+        """
+        Appends a substep ('kepler', 'jump' or 'interaction') to an operator loaded with rebx.load_operator('composite').
+        """
+        if not isinstance(operator, reboundx.extras.Operator):
+            raise TypeError("REBOUNDx Error: Object passed to rebx.composite_add_substep is not a reboundx.Operator instance.")
+        try:
+            substep = REBX_SUBSTEP_TYPE[name.lower()]
+        except KeyError:
+            raise ValueError("REBOUNDx Error: Substep type {0} not recognized. Must be one of {1}.".format(name, list(REBX_SUBSTEP_TYPE.keys())))
+        clibreboundx.rebx_composite_add_substep(byref(self), byref(operator), c_int(substep), c_double(dtfraction))
+        self.process_messages()
+
     #######################################
     # Input/Output Routines
     #######################################
-    def save(self, filename):
+    def save(self, filename, append=False, delta=False):
         """
         Save the entire REBOUND simulation to a binary file.
+        If append is True, add a snapshot to the end of filename (creating it if it doesn't exist) instead of overwriting it.
+        If delta is also True, only store the particle params that changed since the last full snapshot when possible (see rebx_output_binary_append_delta).
         """
-        clibreboundx.rebx_output_binary(byref(self), c_char_p(filename.encode("ascii")))
+        if append and delta:
+            clibreboundx.rebx_output_binary_append_delta(byref(self), c_char_p(filename.encode("ascii")))
+        elif append:
+            clibreboundx.rebx_output_binary_append(byref(self), c_char_p(filename.encode("ascii")))
+        else:
+            clibreboundx.rebx_output_binary(byref(self), c_char_p(filename.encode("ascii")))
+        self.process_messages()
+
+    def automateSimulationArchive(self, filename, interval=None, step=None, deletefile=False):
+        """
+        Append a snapshot of all REBOUNDx effects and parameters to filename at regular intervals,
+        so that parameters that evolve (e.g. with modify_mass or tides_spin) can be recovered at any point in a SimulationArchive.
+        Uses the same rule as rebound.Simulation.automateSimulationArchive, so call both with the
+        same interval or step once all effects are set up, and load them together with reboundx.SimulationArchive.
+        A first snapshot is written immediately. Later ones only store the particle params that changed when possible.
+
+        Arguments
+        ---------
+        filename : str
+            REBOUNDx binary to append snapshots to.
+        interval : float
+            Simulation time between snapshots.
+        step : int
+            Number of timesteps between snapshots.
+        deletefile : bool
+            Delete filename first if it exists (default False).
+        """
+        if (interval is None) == (step is None):
+            raise AttributeError("Need to specify exactly one of interval or step.")
+        if deletefile and os.path.isfile(filename):
+            os.remove(filename)
+        if interval is not None:
+            clibreboundx.rebx_output_binary_archive_automate_interval(byref(self), c_char_p(filename.encode("ascii")), c_double(interval))
+        else:
+            clibreboundx.rebx_output_binary_archive_automate_step(byref(self), c_char_p(filename.encode("ascii")), c_ulonglong(step))
         self.process_messages()
 
     #######################################
@@ -180,6 +420,23 @@ class Extras(Structure):
         self.process_messages()
         return Acentral
 
+    def drive_particle_param(self, driver, index, name, interpolator, channel=0):
+        """
+        Sets the parameter name of sim.particles[index] from interpolator each time the param_driver operator driver
+        is applied. name can also be "m" or "r". channel selects the series for interpolators with several.
+        """
+        clibreboundx.rebx_drive_particle_param.restype = c_int
+        clibreboundx.rebx_drive_particle_param(byref(self), byref(driver), c_int(index), c_char_p(name.encode('ascii')), byref(interpolator), c_int(channel))
+        self.process_messages()
+
+    def drive_force_param(self, driver, force, name, interpolator, channel=0):
+        """
+        Sets the parameter name of force from interpolator each time the param_driver operator driver is applied.
+        """
+        clibreboundx.rebx_drive_force_param.restype = c_int
+        clibreboundx.rebx_drive_force_param(byref(self), byref(driver), byref(force), c_char_p(name.encode('ascii')), byref(interpolator), c_int(channel))
+        self.process_messages()
+
     # Hamiltonian calculation functions
     def gr_full_hamiltonian(self, force):
         clibreboundx.rebx_gr_full_hamiltonian.restype = c_double
@@ -241,11 +498,39 @@ class Extras(Structure):
 #################################################
 
 
+class ParamStorage(Union):
+    _fields_ = [("d", c_double),
+                ("i", c_int),
+                ("u", c_uint32),
+                ("v", rebound._Vec3d)]
+
 class Param(Structure): # need to define fields afterward because of circular ref in linked list
     pass
 Param._fields_ =  [ ("name", c_char_p),
                     ("type", c_int),
-                    ("value", c_void_p)]
+                    ("value", c_void_p),
+                    ("id", c_int),
+                    ("in_column", c_int),
+                    ("_storage", ParamStorage)]
+
+REBX_POOL_N = 2 # Number of pools in C enum rebx_pool_type
+
+class Pool(Structure):
+    _fields_ = [("object_size", c_size_t),
+                ("_free_list", c_void_p),
+                ("_slabs", c_void_p),
+                ("_next", c_void_p),
+                ("_end", c_void_p)]
+
+class Profile(Structure):
+    _fields_ = [("calls", c_ulonglong),
+                ("particles", c_ulonglong),
+                ("walltime", c_double),
+                ("culled", c_ulonglong)]
+
+class MemoryUsage(Structure):
+    _fields_ = [("bytes", c_size_t*6),
+                ("allocations", c_size_t*6)]
 
 class Node(Structure): # need to define fields afterward because of circular ref in linked list
     pass
@@ -284,7 +569,8 @@ Operator._fields_ = [   ("name", c_char_p),
                         ("ap", POINTER(Node)),
                         ("_sim", POINTER(rebound.Simulation)),
                         ("_operator_type", c_int),
-                        ("_step_function", STEPFUNCPTR)]
+                        ("_step_function", STEPFUNCPTR),
+                        ("_profile", Profile)]
 class Force(Structure):
     @property
     def force_type(self):
@@ -303,6 +589,34 @@ class Force(Structure):
         self._ffp = FORCEFUNCPTR(func) # keep a reference to func so it doesn't get garbage collected
         self._update_accelerations = self._ffp
 
+    @property
+    def update_accelerations_numpy(self):
+        """
+        Vectorized alternative to update_accelerations. Set it to a function func(sim, force, particles), where particles
+        is a ParticleArrays with numpy views of the particles passed to the force, e.g.
+
+            def drag(sim, force, p):
+                p.ax -= 1.e-3*p.vx
+                p.ay -= 1.e-3*p.vy
+
+        Views point into the particle array, so nothing is copied. They're only valid during the call.
+        """
+        return getattr(self, '_update_accelerations_numpy', None)
+
+    @update_accelerations_numpy.setter
+    def update_accelerations_numpy(self, func):
+        self._update_accelerations_numpy = func
+        self.update_accelerations = numpy_force(func)
+
+    @property
+    def update_constants(self):
+        return self._update_constants
+
+    @update_constants.setter
+    def update_constants(self, func):
+        self._cfp = FORCEFUNCPTR(func) # keep a reference to func so it doesn't get garbage collected
+        self._update_constants = self._cfp
+
     @property
     def params(self):
         params = Params(self)
@@ -310,11 +624,73 @@ class Force(Structure):
 
 FORCEFUNCPTR = CFUNCTYPE(None, POINTER(rebound.Simulation), POINTER(Force), POINTER(rebound.Particle), c_int)
 
+class ParticleArrays(object):
+    """
+    Numpy views of the N particles passed to a force (see Force.update_accelerations_numpy), strided over the particle
+    structs so nothing is copied. x, y, z, vx, vy, vz and m are read only, and ax, ay, az writable.
+    params[name] is the column for name (see Extras.add_param_column) for the same particles.
+    """
+    _read_only = ["x", "y", "z", "vx", "vy", "vz", "m"]
+    _writable = ["ax", "ay", "az"]
+
+    def __init__(self, sim, particles, N):
+        import numpy as np
+        self.N = N
+        self.params = _ParticleArrayParams(cast(sim.contents.extras, POINTER(Extras)).contents, N)
+        size = sizeof(rebound.Particle)
+        buf = (c_char*(N*size)).from_address(cast(particles, c_void_p).value) if N > 0 else bytearray(0)
+        for name in ParticleArrays._read_only + ParticleArrays._writable:
+            view = np.ndarray((N,), dtype=np.float64, buffer=buf, offset=getattr(rebound.Particle, name).offset if N > 0 else 0, strides=(size,))
+            view.flags.writeable = name in ParticleArrays._writable
+            setattr(self, name, view)
+
+class _ParticleArrayParams(object):
+    def __init__(self, rebx, N):
+        self._rebx = rebx
+        self._N = N
+
+    def __getitem__(self, name):
+        return self._rebx.get_param_column(name)[:self._N]
+
+def numpy_force(func):
+    """
+    Wraps a vectorized force func(sim, force, particles) (see Force.update_accelerations_numpy) into a function that can be
+    passed as update_accelerations or update_constants, e.g. to Extras.register_effect.
+    """
+    def update_accelerations(sim, force, particles, N):
+        func(sim, force, ParticleArrays(sim, particles, N))
+    return update_accelerations
+
 Force._fields_ = [  ("name", c_char_p),
                     ("ap", POINTER(Node)),
                     ("_sim", POINTER(rebound.Simulation)),
                     ("_force_type", c_int),
-                    ("_update_accelerations", FORCEFUNCPTR)]
+                    ("_update_accelerations", FORCEFUNCPTR),
+                    ("_update_constants", FORCEFUNCPTR),
+                    ("_profile", Profile),
+                    ("_skip", c_void_p)]
+
+class ParamColumn(Structure):
+    _fields_ = [("id", c_int),
+                ("N", c_int),
+                ("values", POINTER(c_double)),
+                ("present", POINTER(c_uint32))]
+
+class RegisteredEffect(Structure):
+    _fields_ = [("name", c_char_p),
+                ("force_type", c_int),
+                ("update_accelerations", FORCEFUNCPTR),
+                ("update_constants", FORCEFUNCPTR),
+                ("operator_type", c_int),
+                ("step_function", STEPFUNCPTR),
+                ("update_accelerations_batch", c_void_p)]
+
+_registered_effects = []
+
+class NameTable(Structure):
+    _fields_ = [("_entries", c_void_p),
+                ("size", c_int),
+                ("N", c_int)]
 
 # Need to put fields after class definition because of self-referencing
 Extras._fields_ =  [("_sim", POINTER(rebound.Simulation)),
@@ -323,35 +699,101 @@ Extras._fields_ =  [("_sim", POINTER(rebound.Simulation)),
                     ("_post_timestep_modifications", POINTER(Node)),
                     ("_registered_params", POINTER(Node)),
                     ("_allocated_forces", POINTER(Node)),
-                    ("_allocated_operators", POINTER(Node))]
+                    ("_allocated_operators", POINTER(Node)),
+                    ("_registered_param_table", POINTER(POINTER(Param))),
+                    ("_registered_param_table_size", c_int),
+                    ("_N_registered_params", c_int),
+                    ("_param_columns", POINTER(Node)),
+                    ("_param_columns_dirty", c_int),
+                    ("_pools", Pool*REBX_POOL_N),
+                    ("_geometries", POINTER(Node)),
+                    ("_coordinates", POINTER(Node)),
+                    ("_geometry_epoch", c_uint),
+                    ("_param_generation", c_uint),
+                    ("_param_lists", POINTER(Node)),
+                    ("_archive_filename", c_char_p),
+                    ("_archive_auto_interval", c_double),
+                    ("_archive_next", c_double),
+                    ("_archive_auto_step", c_ulonglong),
+                    ("_archive_next_step", c_ulonglong),
+                    ("_archive_delta", c_void_p),
+                    ("_profiling", c_int),
+                    ("_force_names", NameTable),
+                    ("_operator_names", NameTable),
+                    ("_default_params", c_int)]
 
 class Interpolator(Structure):
-    def __new__(cls, rebx, times, values, interpolation):
+    def __new__(cls, *args, **kwargs):
         interp = super(Interpolator, cls).__new__(cls)
         return interp
 
-    def __init__(self, rebx, times, values, interpolation="spline"):
-        try:
-            Nvalues = len(times)
-            Nvalues2 = len(values)
-        except:
-            raise TypeError("REBOUNDx Error: Times and values passed to Interpolator must be lists or arrays")
-        if Nvalues != Nvalues2:
-            raise ValueError("REBOUNDx Error: Times and values must be same length)")
-
+    def __init__(self, rebx, times, values, interpolation="spline", copy=True):
+        """
+        values can either be a list of values at each of the times, or a list of several such lists,
+        which are then interpolated together (e.g. mass, radius and luminosity along a stellar evolution track).
+        interpolation can be "spline", "hermite" (monotone cubic, which doesn't overshoot), "linear" or "none"
+        (holds the last tabulated value).
+        With copy=False, times and values are used in place instead of being copied, which saves time and memory
+        for long tracks. They are converted to contiguous float64 numpy arrays (values with shape (Nchannels, Nvalues)),
+        which is free if they already are, and must not be modified afterwards.
+        """
         interpolation = interpolation.lower()
         if interpolation in INTERPOLATION_TYPE:
             interp = INTERPOLATION_TYPE[interpolation]
         else:
             raise ValueError("REBOUNDx Error: Interpolation type not supported")
 
+        if not copy:
+            import numpy as np
+            self._times = np.ascontiguousarray(times, dtype=np.float64)
+            self._values = np.ascontiguousarray(values, dtype=np.float64)
+            Nvalues = self._times.shape[0]
+            Nchannels = 1 if self._values.ndim == 1 else self._values.shape[0]
+            if self._times.ndim != 1 or self._values.ndim > 2 or self._values.shape[-1] != Nvalues:
+                raise ValueError("REBOUNDx Error: Times and values must be same length)")
+            clibreboundx.rebx_init_interpolator_borrowed(byref(rebx), byref(self), c_int(Nvalues), c_int(Nchannels), self._times.ctypes.data_as(POINTER(c_double)), self._values.ctypes.data_as(POINTER(c_double)), c_int(interp))
+            return
+
+        try:
+            Nvalues = len(times)
+            Nvalues2 = len(values)
+        except:
+            raise TypeError("REBOUNDx Error: Times and values passed to Interpolator must be lists or arrays")
+        try:
+            series = [list(v) for v in values]
+        except TypeError:
+            series = [list(values)]
+        for v in series:
+            if Nvalues != len(v):
+                raise ValueError("REBOUNDx Error: Times and values must be same length)")
+
+        Nchannels = len(series)
         DblArr = c_double * Nvalues
-        clibreboundx.rebx_init_interpolator(byref(rebx), byref(self), c_int(Nvalues), DblArr(*times), DblArr(*values), c_int(interp))
+        flat = [value for v in series for value in v]
+        clibreboundx.rebx_init_interpolator_channels(byref(rebx), byref(self), c_int(Nvalues), c_int(Nchannels), DblArr(*times), (c_double*(Nvalues*Nchannels))(*flat), c_int(interp))
 
     def interpolate(self, rebx, t):
+        """
+        Returns the interpolated value at time t, or a list with the value of each series if several were passed.
+        """
+        if self.Nchannels > 1:
+            return self.interpolate_many(rebx, [t])[0]
         clibreboundx.rebx_interpolate.restype = c_double
         return clibreboundx.rebx_interpolate(byref(rebx), byref(self), c_double(t))
 
+    def interpolate_many(self, rebx, ts):
+        """
+        Interpolates at each of the times in ts in a single call. Returns a list of values, or of lists with the value
+        of each series if several were passed.
+        """
+        N = len(ts)
+        Nchannels = self.Nchannels
+        out = (c_double*(N*Nchannels))()
+        clibreboundx.rebx_interpolate_many(byref(rebx), byref(self), (c_double*N)(*ts), out, c_int(N))
+        if Nchannels == 1:
+            return list(out)
+        return [list(out[i*Nchannels:(i+1)*Nchannels]) for i in range(N)]
+
     def __del__(self):
         if self._b_needsfree_ == 1:
             clibreboundx.rebx_free_interpolator_pointers(byref(self))
@@ -361,9 +803,11 @@ Interpolator._fields_ = [  ("interpolation", c_int),
                     ("values", POINTER(c_double)),
                     ("Nvalues", c_int),
                     ("y2", POINTER(c_double)),
-                    ("klo", c_int)]
+                    ("klo", c_int),
+                    ("Nchannels", c_int),
+                    ("owns_data", c_int)]
 
-INTERPOLATION_TYPE = {"none":0, "spline":1}
+INTERPOLATION_TYPE = {"none":0, "spline":1, "linear":2, "hermite":3}
 
 # This list keeps pairing from C rebx_param_type enum to ctypes type 1-to-1. Derive the required mappings from it
 REBX_C_TO_CTYPES = [["REBX_TYPE_NONE", None], ["REBX_TYPE_DOUBLE", c_double], ["REBX_TYPE_INT",c_int], ["REBX_TYPE_POINTER", c_void_p], ["REBX_TYPE_FORCE", Force], ["REBX_TYPE_UNIT32", c_uint32], ["REBX_TYPE_ORBIT", rebound.Orbit], ["REBX_TYPE_ODE", rebound.ODE], ["REBX_TYPE_VEC3D", rebound._Vec3d]]
@@ -1,5 +1,8 @@
 import rebound
 import reboundx
+from . import clibreboundx
+import os
+from ctypes import c_char_p, c_double, c_int, c_long, c_size_t, byref
 
 class SimulationArchive(rebound.SimulationArchive):
     """
@@ -12,18 +15,41 @@ class SimulationArchive(rebound.SimulationArchive):
         filename : str
             Filename of the SimulationArchive file to be opened.
         rebxfilename : str
-            Filename of the REBOUNDx binary file.
+            Filename of the REBOUNDx binary file. If it holds several snapshots (see Extras.automateSimulationArchive),
+            each simulation is loaded with the REBOUNDx snapshot closest to it in time.
         """
         super(SimulationArchive, self).__init__(filename, *args, **kwargs)
         self.rebxfilename = rebxfilename
+        self._rebxbinary = None
         sim, rebx = self[0] # test you can open rebxfilename to warn user if not
 
+    def _load_rebxbinary(self):
+        # Read the binary once and parse each snapshot from memory. Reread only if the file has changed size,
+        # e.g. an archive that's still being appended to by automateSimulationArchive
+        try:
+            size = os.path.getsize(self.rebxfilename)
+        except OSError:
+            return None
+        if self._rebxbinary is None or len(self._rebxbinary) != size:
+            with open(self.rebxfilename, 'rb') as f:
+                self._rebxbinary = f.read()
+        return self._rebxbinary
+
+    def _load_rebx(self, sim):
+        rebxbinary = self._load_rebxbinary()
+        if rebxbinary is None:
+            return reboundx.Extras(sim, self.rebxfilename) # raises an informative error
+        w = c_int(0)
+        clibreboundx.rebx_input_find_snapshot_in_buffer.restype = c_long
+        snapshot = clibreboundx.rebx_input_find_snapshot_in_buffer(c_char_p(rebxbinary), c_size_t(len(rebxbinary)), c_double(sim.t), byref(w))
+        return reboundx.Extras(sim, rebxbinary, snapshot=snapshot if snapshot >= 0 else -1)
+
     def __getitem__(self, key):
         sim = super(SimulationArchive, self).__getitem__(key)
-        rebx = reboundx.Extras(sim, self.rebxfilename)
+        rebx = self._load_rebx(sim)
         return sim, rebx
 
     def getSimulation(self, *args, **kwargs):
         sim = super(SimulationArchive, self).getSimulation(*args, **kwargs)
-        rebx = reboundx.Extras(sim, self.rebxfilename)
+        rebx = self._load_rebx(sim)
         return sim, rebx
@@ -80,5 +80,45 @@ class TestConservation(unittest.TestCase):
         H = sim.energy() + rebx.gravitational_harmonics_potential()
         self.assertLess(abs((H-H0)/H0), 1.e-12)
 
+    def test_potentials_after_param_changes(self):
+        # The potentials loop over cached lists of the particles with a param, so after changing params they must match a fresh simulation
+        def setup(changed):
+            sim = rebound.Simulation(binary)
+            rebx = reboundx.Extras(sim)
+            ps = sim.particles
+            for p in ps:
+                p.r = 1.e-3
+            ps[0].params['tctl_k2'] = 0.1
+            ps[0].params['J2'] = 1.e-3
+            ps[0].params['R_eq'] = 1.e-3
+            ps[1].params['k2'] = 0.2
+            ps[1].params['Omega'] = [0., 0., 1.]
+            ps[1].params['I'] = 1.e-7
+            if changed:
+                ps[0].params['J2'] = 2.e-3
+                ps[2].params['tctl_k2'] = 0.3
+                ps[2].params['k2'] = 0.4
+            return sim, rebx
+        def potentials(rebx):
+            return [rebx.tides_constant_time_lag_potential(), rebx.gravitational_harmonics_potential(), rebx.tides_spin_energy()]
+
+        sim, rebx = setup(False)
+        H0 = potentials(rebx)
+        ps = sim.particles
+        ps[0].params['J2'] = 2.e-3
+        ps[2].params['tctl_k2'] = 0.3
+        ps[2].params['k2'] = 0.4
+        H = potentials(rebx)
+        simref, rebxref = setup(True)
+        for h0, h, href in zip(H0, H, potentials(rebxref)):
+            self.assertNotEqual(h, h0)
+            self.assertEqual(h, href)
+
+        sim.remove(1)
+        simref, rebxref = setup(True)
+        simref.remove(1)
+        for h, href in zip(potentials(rebx), potentials(rebxref)):
+            self.assertEqual(h, href)
+
 if __name__ == '__main__':
     unittest.main()
@@ -26,6 +26,114 @@ class TestForces(unittest.TestCase):
         self.sim.integrate(10)
         self.assertGreater(self.sim.particles[1].pomega, -0.01)
 
+    def test_customforcenumpy(self):
+        self.sim.add(a=2., e=0.1)
+        sim2 = self.sim.copy()
+        rebx2 = reboundx.Extras(sim2)
+        for rebx in [self.rebx, rebx2]:
+            rebx.register_param('tau_drag', 'REBX_TYPE_DOUBLE')
+            rebx.add_param_column('tau_drag')
+        for sim in [self.sim, sim2]:
+            sim.particles[1].params['tau_drag'] = 1.e3
+            sim.particles[2].params['tau_drag'] = 2.e3
+        def drag(sim, force, particles, N):
+            ps = sim.contents.particles
+            for i in range(1, N):
+                tau = ps[i].params['tau_drag']
+                particles[i].ax -= particles[i].vx/tau
+                particles[i].ay -= particles[i].vy/tau
+                particles[i].az -= particles[i].vz/tau
+        def drag_numpy(sim, force, p):
+            tau = p.params['tau_drag'][1:]
+            p.ax[1:] -= p.vx[1:]/tau
+            p.ay[1:] -= p.vy[1:]/tau
+            p.az[1:] -= p.vz[1:]/tau
+            with self.assertRaises(ValueError):
+                p.x[0] = 0. # read only
+        cust = self.rebx.create_force('drag')
+        cust.force_type = 'vel'
+        cust.update_accelerations = drag
+        self.rebx.add_force(cust)
+        cust2 = rebx2.create_force('drag')
+        cust2.force_type = 'vel'
+        cust2.update_accelerations_numpy = drag_numpy
+        rebx2.add_force(cust2)
+        self.sim.integrate(10.)
+        sim2.integrate(10.)
+        self.assertLess(self.sim.particles[1].a, 1.)
+        for i in [1, 2]:
+            self.assertAlmostEqual(self.sim.particles[i].x, sim2.particles[i].x, delta=1.e-14)
+            self.assertAlmostEqual(self.sim.particles[i].vy, sim2.particles[i].vy, delta=1.e-14)
+
+    def test_paramlistafterremove(self):
+        # removing a particle shifts the ones after it, so cached lists of particles with a param can't be reused
+        self.sim.add(a=2.)
+        self.sim.particles[2].params['beta'] = 0.5
+        rf = self.rebx.load_force('radiation_forces')
+        rf.params['c'] = 1.e4
+        self.rebx.add_force(rf)
+        self.sim.integrate(0.1)
+        self.sim.remove(1)
+        self.sim.add(a=3.)
+        self.sim.integrate(1.)
+        self.assertAlmostEqual(self.sim.particles[2].a, 3., delta=1.e-8)
+
+    def test_grwarmstart(self):
+        sim2 = rebound.Simulation()
+        sim2.add(m=1.)
+        sim2.add(a=1., e=0.2)
+        rebx2 = reboundx.Extras(sim2)
+        for rebx, warm in [(self.rebx, 0), (rebx2, 1)]:
+            gr = rebx.load_force('gr')
+            gr.params['c'] = 100.
+            gr.params['gr_warm_start'] = warm
+            rebx.add_force(gr)
+        self.sim.integrate(10.)
+        sim2.integrate(10.)
+        self.assertAlmostEqual(self.sim.particles[1].pomega, sim2.particles[1].pomega, delta=1.e-10)
+
+    def test_grfullopeningangle(self):
+        import random
+        random.seed(1)
+        sims = []
+        for opening_angle in [None, 0.3]:
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            for i in range(50):
+                sim.add(m=1.e-3, a=random.uniform(1., 10.), e=random.uniform(0., 0.3), inc=random.uniform(0., 1.), Omega=random.uniform(0., 6.28), f=random.uniform(0., 6.28))
+            sim.move_to_com()
+            rebx = reboundx.Extras(sim)
+            gr = rebx.load_force('gr_full')
+            gr.params['c'] = 100.
+            if opening_angle is not None:
+                gr.params['gr_full_opening_angle'] = opening_angle
+            rebx.add_force(gr)
+            sim.integrate(1.)
+            sims.append((sim, rebx))
+        for p, q in zip(sims[0][0].particles, sims[1][0].particles):
+            self.assertAlmostEqual(p.x, q.x, delta=1.e-6)
+            self.assertAlmostEqual(p.y, q.y, delta=1.e-6)
+            self.assertAlmostEqual(p.z, q.z, delta=1.e-6)
+
+    def test_grfulltestparticles(self):
+        # particles beyond N_active don't act on the active ones with testparticle_type 0, even if they have mass
+        sim2 = rebound.Simulation()
+        sim2.add(m=1.)
+        sim2.add(a=1., e=0.2)
+        for a in [2., 3., 4.]:
+            sim2.add(m=1.e-3, a=a)
+        sim2.N_active = 2
+        rebx2 = reboundx.Extras(sim2)
+        for sim, rebx in [(self.sim, self.rebx), (sim2, rebx2)]:
+            sim.integrator = "leapfrog"
+            sim.dt = 0.01
+            gr = rebx.load_force('gr_full')
+            gr.params['c'] = 100.
+            rebx.add_force(gr)
+            sim.integrate(10.)
+        self.assertAlmostEqual(self.sim.particles[1].x, sim2.particles[1].x, delta=1.e-12)
+        self.assertAlmostEqual(self.sim.particles[1].y, sim2.particles[1].y, delta=1.e-12)
+
     def test_customnoforce(self):
         cust = self.rebx.create_force('myforce')
         cust.force_type = 'pos'
@@ -176,6 +284,119 @@ class TestOperators(unittest.TestCase):
         with self.assertRaises(AttributeError):
             self.rebx.remove_operator(mm)
 
+    def test_modifymasscominterval(self):
+        self.sim.add(a=2.)
+        self.sim.particles[0].params['tau_mass'] = -10.
+        mm = self.rebx.load_operator('modify_mass')
+        mm.params['mm_com_interval'] = 3
+        self.rebx.add_operator(mm)
+        self.sim.integrate(10.)
+        mm.params['mm_com_interval'] = 1 # remove the offset accumulated since the last correction
+        self.sim.step()
+        com = self.sim.com()
+        self.assertLess(abs(com.x) + abs(com.y) + abs(com.vx) + abs(com.vy), 1.e-12)
+
+    def test_integrateforceaddparticles(self):
+        gr = self.rebx.load_force('gr')
+        gr.params['c'] = 100.
+        for integrator in ['implicit_midpoint', 'rk4', 'rk2', 'euler']:
+            integforce = self.rebx.load_operator('integrate_force')
+            integforce.params['force'] = gr
+            integforce.params['integrator'] = reboundx.integrators[integrator]
+            self.rebx.add_operator(integforce)
+            self.sim.integrate(self.sim.t + 1.)
+            for i in range(10): # outgrow the stage buffers allocated at the first N
+                self.sim.add(a=2.+i, primary=self.sim.particles[0])
+                self.sim.step()
+            self.rebx.remove_operator(integforce)
+            self.sim.remove(index=self.sim.N-1)
+            self.sim.step()
+        self.assertGreater(self.sim.particles[1].pomega, 0.)
+
+    def test_integrateforcerk45(self):
+        sim2 = rebound.Simulation()
+        sim2.add(m=1.)
+        sim2.add(a=1., e=0.2)
+        rebx2 = reboundx.Extras(sim2)
+        for sim, rebx, integrator in [(self.sim, self.rebx, 'rk4'), (sim2, rebx2, 'rk45')]:
+            sim.integrator = 'whfast'
+            sim.dt = 0.05
+            gr = rebx.load_force('gr')
+            gr.params['c'] = 100.
+            integforce = rebx.load_operator('integrate_force')
+            integforce.params['force'] = gr
+            integforce.params['integrator'] = reboundx.integrators[integrator]
+            integforce.params['integrator_tolerance'] = 1.e-12
+            rebx.add_operator(integforce)
+            sim.integrate(10.)
+        self.assertGreater(sim2.particles[1].pomega, 1.e-3)
+        self.assertAlmostEqual(self.sim.particles[1].pomega, sim2.particles[1].pomega, delta=1.e-8)
+
+    def test_ias15keepstate(self):
+        sim2 = rebound.Simulation()
+        sim2.add(m=1.)
+        sim2.add(a=1., e=0.2)
+        rebx2 = reboundx.Extras(sim2)
+        for sim, rebx, keep in [(self.sim, self.rebx, 0), (sim2, rebx2, 1)]:
+            sim.integrator = 'none'
+            sim.dt = 0.1
+            ias = rebx.load_operator('ias15')
+            ias.params['ias15_keep_state'] = keep
+            rebx.add_operator(ias, dtfraction=1., timing='post')
+            sim.integrate(10.)
+        self.assertAlmostEqual(self.sim.particles[1].x, sim2.particles[1].x, delta=1.e-12)
+        self.assertAlmostEqual(self.sim.particles[1].y, sim2.particles[1].y, delta=1.e-12)
+
+    def test_composite(self):
+        sim2 = rebound.Simulation()
+        sim2.add(m=1.)
+        sim2.add(a=1., e=0.2)
+        rebx2 = reboundx.Extras(sim2)
+        for sim in [self.sim, sim2]:
+            sim.add(m=1.e-3, a=2.)
+            sim.integrator = 'none'
+            sim.dt = 0.05
+        kep = self.rebx.load_operator('kepler')
+        inter = self.rebx.load_operator('interaction')
+        self.rebx.add_operator(kep, dtfraction=0.5, timing='post')
+        self.rebx.add_operator(inter, dtfraction=1., timing='post')
+        self.rebx.add_operator(kep, dtfraction=0.5, timing='post')
+        composite = rebx2.load_operator('composite')
+        rebx2.composite_add_substep(composite, 'kepler', 0.5)
+        rebx2.composite_add_substep(composite, 'interaction', 1.)
+        rebx2.composite_add_substep(composite, 'kepler', 0.5)
+        rebx2.add_operator(composite, dtfraction=1., timing='post')
+        self.sim.integrate(10.)
+        sim2.integrate(10.)
+        for i in range(1, 3):
+            self.assertAlmostEqual(self.sim.particles[i].x, sim2.particles[i].x, delta=1.e-12)
+            self.assertAlmostEqual(self.sim.particles[i].vy, sim2.particles[i].vy, delta=1.e-12)
+
+    def test_kickreuseaccelerations(self):
+        sim2 = rebound.Simulation()
+        sim2.add(m=1.)
+        sim2.add(a=1., e=0.2)
+        rebx2 = reboundx.Extras(sim2)
+        for sim, rebx, reuse in [(self.sim, self.rebx, 0), (sim2, rebx2, 1)]:
+            sim.add(m=1.e-3, a=2.)
+            sim.integrator = 'none'
+            sim.dt = 0.05
+            kick = rebx.load_operator('kick')
+            kick.params['kick_reuse_accelerations'] = reuse
+            drift = rebx.load_operator('drift')
+            rebx.add_operator(kick, dtfraction=0.5, timing='post')
+            rebx.add_operator(drift, dtfraction=1., timing='post')
+            rebx.add_operator(kick, dtfraction=0.5, timing='post')
+            sim.integrate(10.)
+        for i in range(1, 3):
+            self.assertEqual(self.sim.particles[i].x, sim2.particles[i].x)
+            self.assertEqual(self.sim.particles[i].vy, sim2.particles[i].vy)
+
+    def test_compositenosubstep(self):
+        composite = self.rebx.load_operator('composite')
+        with self.assertRaises(ValueError):
+            self.rebx.composite_add_substep(composite, 'drift', 1.)
+
 class TestAddOperator(unittest.TestCase):
     def setUp(self):
         self.sim = rebound.Simulation()
@@ -230,6 +451,46 @@ class TestAddOperator(unittest.TestCase):
         self.sim.step()
         self.assertEqual(self.cust.params['ctr'], 1)
 
+class TestTrackMinDistance(unittest.TestCase):
+    def setUp(self):
+        self.sim = rebound.Simulation()
+        self.sim.add(m=1., hash='star')
+        self.sim.add(m=1.e-3, a=1., hash='inner')
+        self.sim.add(m=1.e-3, a=2., f=3., hash='outer')
+        self.sim.add(a=1.9, e=0.05, hash='tp')
+        self.sim.move_to_com()
+        self.rebx = reboundx.Extras(self.sim)
+        self.tmd = self.rebx.load_operator('track_min_distance')
+        self.rebx.add_operator(self.tmd)
+        self.sim.particles['tp'].params['min_distance'] = 100.
+
+    def test_from(self):
+        self.sim.particles['tp'].params['min_distance_from'] = self.sim.particles['outer'].hash.value
+        self.sim.integrate(10.)
+        self.assertLess(self.sim.particles['tp'].params['min_distance'], 1.)
+
+    def test_targets(self):
+        self.sim.particles['inner'].params['min_distance_target'] = 1
+        self.sim.particles['outer'].params['min_distance_target'] = 1
+        self.sim.integrate(10.)
+        self.assertLess(self.sim.particles['tp'].params['min_distance'], 1.)
+        self.assertIn(self.sim.particles['tp'].params['min_distance_closest'], [self.sim.particles['inner'].hash.value, self.sim.particles['outer'].hash.value])
+
+    def test_skip(self):
+        self.sim.particles['inner'].params['min_distance_target'] = 1
+        self.sim.particles['outer'].params['min_distance_target'] = 1
+        self.tmd.params['min_distance_skip_factor'] = 2.
+        self.sim.integrate(10.)
+        self.assertLess(self.sim.particles['tp'].params['min_distance'], 1.)
+
+    def test_interpolate(self):
+        self.sim.integrate(10.)
+        sampled = self.sim.particles['tp'].params['min_distance']
+        self.setUp()
+        self.tmd.params['min_distance_interpolate'] = 1
+        self.sim.integrate(10.)
+        self.assertLessEqual(self.sim.particles['tp'].params['min_distance'], sampled)
+
 if __name__ == '__main__':
     unittest.main()
 
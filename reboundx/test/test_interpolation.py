@@ -71,6 +71,129 @@ class TestConservation(unittest.TestCase):
             sim.move_to_com() # lost mass had momentum, so need to move back to COM frame
         self.assertLess(abs((ps[0].m-m0)/m0), 1.e-2)
         self.assertLess(abs((ps[1].a-a10)/a10), 1.e-2)
-    
+
+    def test_interpolate_many(self):
+        sim = rebound.Simulation(binary)
+        rebx = reboundx.Extras(sim)
+        times = [0, 2000., 4000., 6000., 8000., 10000.]
+        values = [1., 0.8, 0.6, 0.4, 0.3, 0.2]
+        starmass = reboundx.Interpolator(rebx, times, values, "spline")
+        ts = [9000., 100., 5000., 7000., 0.]
+        many = starmass.interpolate_many(rebx, ts)
+        for t, m in zip(ts, many):
+            self.assertEqual(m, starmass.interpolate(rebx, t=t))
+
+    def test_channels(self):
+        sim = rebound.Simulation(binary)
+        rebx = reboundx.Extras(sim)
+        times = [0, 2000., 4000., 6000., 8000., 10000.]
+        masses = [1., 0.8, 0.6, 0.4, 0.3, 0.2]
+        radii = [1., 1.5, 3., 10., 50., 100.]
+        track = reboundx.Interpolator(rebx, times, [masses, radii], "spline")
+        starmass = reboundx.Interpolator(rebx, times, masses, "spline")
+        starradius = reboundx.Interpolator(rebx, times, radii, "spline")
+        for t in [3000., 500., 9500.]:
+            m, R = track.interpolate(rebx, t=t)
+            self.assertEqual(m, starmass.interpolate(rebx, t=t))
+            self.assertEqual(R, starradius.interpolate(rebx, t=t))
+
+    def test_modes(self):
+        sim = rebound.Simulation(binary)
+        rebx = reboundx.Extras(sim)
+        times = [0., 1., 2., 3., 4., 5.]
+        values = [0., 0., 0., 1., 1., 1.]
+        linear = reboundx.Interpolator(rebx, times, values, "linear")
+        self.assertEqual(linear.interpolate(rebx, t=2.25), 0.25)
+        hold = reboundx.Interpolator(rebx, times, values, "none")
+        self.assertEqual(hold.interpolate(rebx, t=2.9), 0.)
+        self.assertEqual(hold.interpolate(rebx, t=3.), 1.)
+        hermite = reboundx.Interpolator(rebx, times, values, "hermite")
+        ys = hermite.interpolate_many(rebx, np.linspace(0., 5., 101))
+        self.assertGreaterEqual(min(ys), 0.)
+        self.assertLessEqual(max(ys), 1.)
+        spline = reboundx.Interpolator(rebx, times, values, "spline")
+        self.assertGreater(max(spline.interpolate_many(rebx, np.linspace(0., 5., 101))), 1.) # overshoots
+
+    def test_borrowed(self):
+        sim = rebound.Simulation(binary)
+        rebx = reboundx.Extras(sim)
+        times = np.linspace(0., 1.e4, 1001)
+        values = np.array([1. - 0.5*times/1.e4, 1. + times/1.e4])
+        copied = reboundx.Interpolator(rebx, times, values, "spline")
+        borrowed = reboundx.Interpolator(rebx, times, values, "spline", copy=False)
+        ts = [123.4, 5678.9, 42.]
+        self.assertEqual(copied.interpolate_many(rebx, ts), borrowed.interpolate_many(rebx, ts))
+
+class TestParamDriver(unittest.TestCase):
+    def setUp(self):
+        self.sim = rebound.Simulation(binary)
+        self.sim.integrator = "ias15"
+        self.rebx = reboundx.Extras(self.sim)
+        self.times = [0, 2000., 4000., 6000., 8000., 10000.]
+        self.values = [1., 0.8, 0.6, 0.4, 0.3, 0.2]
+        self.driver = self.rebx.load_operator("param_driver")
+        self.rebx.add_operator(self.driver)
+
+    def test_adiabatic_mass_loss(self):
+        starmass = reboundx.Interpolator(self.rebx, self.times, self.values, "spline")
+        self.rebx.drive_particle_param(self.driver, 0, "m", starmass)
+        ps = self.sim.particles
+        a10 = ps[1].a
+        self.sim.integrate(1.e4)
+        self.assertLess(abs((ps[0].m-starmass.interpolate(self.rebx, t=self.sim.t))/ps[0].m), 1.e-12)
+        self.assertLess(abs((ps[0].m-self.values[-1])/self.values[-1]), 1.e-4)
+        self.assertLess(abs((ps[1].a-5*a10)/a10), 1.e-2)
+
+    def test_params(self):
+        gr = self.rebx.load_force("gr")
+        self.rebx.add_force(gr)
+        gr.params["c"] = 1.e4
+        track = reboundx.Interpolator(self.rebx, self.times, [self.values, [1.e4*v for v in self.values]], "linear")
+        self.rebx.drive_force_param(self.driver, gr, "c", track, channel=1)
+        self.rebx.drive_particle_param(self.driver, 1, "tau_mass", track, channel=0)
+        del track # driver keeps its own copy
+        self.sim.integrate(3000.)
+        t = self.sim.t
+        self.assertAlmostEqual(gr.params["c"], 1.e4*(0.8 - 0.2*(t-2000.)/2000.), delta=1.e-8)
+        self.assertAlmostEqual(self.sim.particles[1].params["tau_mass"], 0.8 - 0.2*(t-2000.)/2000., delta=1.e-12)
+
+        with self.assertRaises(RuntimeError):
+            self.rebx.drive_particle_param(self.driver, 1, "not_a_param", reboundx.Interpolator(self.rebx, self.times, self.values))
+
+    def test_remove_particle(self):
+        sim = rebound.Simulation()
+        sim.add(m=1., hash="star")
+        sim.add(m=1.e-3, a=1., hash="inner")
+        sim.add(m=1.e-3, a=2., hash="outer")
+        rebx = reboundx.Extras(sim)
+        driver = rebx.load_operator("param_driver")
+        rebx.add_operator(driver)
+        radius = reboundx.Interpolator(rebx, self.times, self.values, "linear")
+        rebx.drive_particle_param(driver, 2, "r", radius)
+        rebx.drive_particle_param(driver, 1, "m", radius)
+        sim.remove(hash="inner")
+        sim.integrate(3000.)
+        self.assertAlmostEqual(sim.particles["outer"].r, radius.interpolate(rebx, t=sim.t), delta=1.e-12)
+        self.assertEqual(sim.particles["outer"].m, 1.e-3) # binding of the removed particle is skipped
+        self.assertEqual(sim.particles["star"].r, 0.)
+
+    def test_save_load(self):
+        gr = self.rebx.load_force("gr")
+        self.rebx.add_force(gr)
+        self.rebx.drive_force_param(self.driver, gr, "c", reboundx.Interpolator(self.rebx, self.times, [1.e4*v for v in self.values]))
+        self.rebx.drive_particle_param(self.driver, 0, "m", reboundx.Interpolator(self.rebx, self.times, self.values, "hermite"))
+        self.sim.integrate(1000.)
+        self.sim.save("test_param_driver.bin")
+        self.rebx.save("test_param_driver.rebx")
+        sim2 = rebound.Simulation("test_param_driver.bin")
+        rebx2 = reboundx.Extras(sim2, "test_param_driver.rebx")
+        os.remove("test_param_driver.bin")
+        os.remove("test_param_driver.rebx")
+        self.sim.integrate(5000.)
+        sim2.integrate(5000.)
+        self.assertEqual(self.sim.particles[0].m, sim2.particles[0].m)
+        self.assertEqual(gr.params["c"], rebx2.get_force("gr").params["c"])
+        self.assertEqual(self.sim.particles[1].x, sim2.particles[1].x)
+
 if __name__ == '__main__':
     unittest.main()
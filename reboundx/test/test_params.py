@@ -184,6 +184,73 @@ class TestParams(unittest.TestCase):
         self.gr.params['my_new_int'] = 2
         self.assertEqual(self.gr.params["my_new_int"], 2)
 
+    def test_manyregistered(self):
+        # Enough to force the registered param hash table to grow
+        for i in range(300):
+            self.rebx.register_param('my_param{0}'.format(i), 'REBX_TYPE_DOUBLE')
+        for i in range(0, 300, 7):
+            self.p.params['my_param{0}'.format(i)] = float(i)
+        self.p.params['c'] = 1.7
+        for i in range(0, 300, 7):
+            self.assertAlmostEqual(self.p.params['my_param{0}'.format(i)], float(i), delta=1.e-15)
+        self.assertAlmostEqual(self.p.params["c"], 1.7, delta=1.e-15)
+        with self.assertRaises(AttributeError):
+            b = self.p.params['my_param1']
+
+    def test_registeredperinstance(self):
+        # Default params are shared, but user registrations stay with their instance
+        self.rebx.register_param('my_new_int', 'REBX_TYPE_INT')
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(a=1.)
+        rebx = reboundx.Extras(sim)
+        with self.assertRaises(AttributeError):
+            sim.particles[1].params['my_new_int'] = 2
+        sim.particles[1].params['c'] = 1.7
+        self.assertAlmostEqual(sim.particles[1].params['c'], 1.7, delta=1.e-15)
+
+    def test_paramcolumn(self):
+        self.sim.add(a=2.)
+        self.sim.particles[1].params['beta'] = 0.1
+        self.rebx.add_param_column('beta')
+        self.sim.particles[2].params['beta'] = 0.2
+        self.sim.add(a=3.)
+        self.sim.particles[3].params['beta'] = 0.3
+        self.sim.remove(1)
+        self.assertAlmostEqual(self.sim.particles[1].params['beta'], 0.2, delta=1.e-15)
+        self.assertAlmostEqual(self.sim.particles[2].params['beta'], 0.3, delta=1.e-15)
+        self.sim.particles[1].params['beta'] = 0.4
+        self.assertAlmostEqual(self.sim.particles[1].params['beta'], 0.4, delta=1.e-15)
+
+    def test_particleparams(self):
+        for i in range(8):
+            self.sim.add(a=2.+i)
+        betas = np.linspace(0., 1., self.sim.N)
+        self.rebx.set_particle_params('beta', betas)
+        self.assertEqual(self.sim.particles[5].params['beta'], betas[5])
+        self.rebx.set_particle_params('beta', [7., 8.], indices=[2, 4])
+        self.assertEqual(self.sim.particles[4].params['beta'], 8.)
+        self.rebx.add_param_column('beta')
+        self.rebx.set_particle_params('beta', 0.5, indices=[3])
+        self.assertEqual(list(self.rebx.get_particle_params('beta', indices=[2, 3, 4])), [7., 0.5, 8.])
+        self.assertEqual(self.rebx.get_particle_params('beta')[9], betas[9])
+
+        self.rebx.set_particle_params('gr_source', [1, 2], indices=[0, 1])
+        self.assertEqual(self.sim.particles[1].params['gr_source'], 2)
+        with self.assertRaises(AttributeError):
+            self.rebx.get_particle_params('gr_source')
+        self.assertEqual(list(self.rebx.get_particle_params('gr_source', default=-1)[:3]), [1, 2, -1])
+        self.rebx.set_particle_params('Omega', [[0., 0., 1.]], indices=[1])
+        self.assertEqual(self.sim.particles[1].params['Omega'].z, 1.)
+        with self.assertRaises(RuntimeError):
+            self.rebx.set_particle_params('beta', [1.], indices=[self.sim.N])
+        with self.assertRaises(AttributeError):
+            self.rebx.set_particle_params('force', [self.gr])
+
+    def test_paramcolumnnotdouble(self):
+        with self.assertRaises(RuntimeError):
+            self.rebx.add_param_column('gr_source')
+
     def test_length(self):
         self.gr.params['c'] = 1.3
         self.gr.params['gr_source'] = 7
@@ -1,6 +1,7 @@
 import rebound
 import reboundx
 import unittest
+import os
 
 class TestRebx(unittest.TestCase):
     def setUp(self):
@@ -15,7 +16,125 @@ class TestRebx(unittest.TestCase):
         self.gr.params['c'] = 1e2
         self.sim.integrate(10)
         self.assertGreater(self.sim.particles[1].pomega, 1.e-4)
-    
+
+    def test_profile(self):
+        gr = self.rebx.load_force('gr')
+        self.rebx.add_force(gr)
+        gr.params['c'] = 1e2
+        mm = self.rebx.load_operator('modify_mass')
+        self.rebx.add_operator(mm)
+        self.sim.integrate(1)
+        self.assertEqual(self.rebx.profile()['gr']['calls'], 0) # off by default
+
+        self.rebx.profiling = True
+        self.sim.integrator = "whfast"
+        self.sim.dt = 0.01
+        self.sim.integrate(2)
+        stats = self.rebx.profile(reset=True)
+        self.assertGreater(stats['gr']['calls'], 0)
+        self.assertEqual(stats['gr']['particles'], 2*stats['gr']['calls'])
+        self.assertGreater(stats['modify_mass']['calls'], 0)
+        self.assertGreaterEqual(stats['gr']['walltime'], 0.)
+        self.assertEqual(self.rebx.profile()['gr']['calls'], 0)
+
+    def test_culling(self):
+        self.sim.add(a=100., e=0.1)
+        self.sim.integrator = "whfast"
+        self.sim.dt = 0.01
+        sim2 = self.sim.copy()
+        rebx2 = reboundx.Extras(sim2)
+        for sim, rebx in [(self.sim, self.rebx), (sim2, rebx2)]:
+            gr = rebx.load_force('gr_potential')
+            rebx.add_force(gr)
+            gr.params['c'] = 1e2
+        gr = self.rebx.get_force('gr_potential')
+        gr.params['cull_threshold'] = 1e-4
+        gr.params['cull_every'] = 10
+        self.rebx.profiling = True
+        self.sim.integrate(10)
+        sim2.integrate(10)
+        stats = self.rebx.profile()
+        self.assertGreater(stats['gr_potential']['culled'], 0.8*stats['gr_potential']['calls']) # only the outer planet
+        self.assertLess(stats['gr_potential']['culled'], 2*stats['gr_potential']['calls'])
+        self.assertLess(abs(self.sim.particles[1].pomega - sim2.particles[1].pomega), 1e-12)
+        self.assertLess(abs(self.sim.particles[2].x - sim2.particles[2].x), 1e-6)
+
+    def test_memory_usage(self):
+        usage = self.rebx.memory_usage()
+        self.assertEqual(usage['workspaces']['bytes'], 0)
+        for p in self.sim.particles:
+            p.params['tau_a'] = 1e3
+        gr = self.rebx.load_force('gr')
+        self.rebx.add_force(gr)
+        gr.params['c'] = 1e4
+        self.sim.integrate(1)
+        new = self.rebx.memory_usage()
+        self.assertGreater(new['params']['bytes'], usage['params']['bytes'])
+        self.assertGreater(new['forces']['allocations'], usage['forces']['allocations'])
+        self.assertGreater(new['workspaces']['bytes'], 0)
+        self.assertEqual(new['total']['bytes'], sum(new[k]['bytes'] for k in ['params', 'forces', 'operators', 'workspaces', 'interpolators', 'other']))
+
+    def test_operator_every(self):
+        sim2 = self.sim.copy()
+        rebx2 = reboundx.Extras(sim2)
+        for sim, rebx, every in [(self.sim, self.rebx, 1), (sim2, rebx2, 4)]:
+            sim.integrator = "whfast"
+            sim.dt = 0.01
+            mm = rebx.load_operator('modify_mass')
+            rebx.add_operator(mm, every=every)
+            sim.particles[0].params['tau_mass'] = -1e2
+        self.sim.steps(40)
+        sim2.steps(40)
+        self.assertLess(self.sim.particles[0].m, 1.)
+        self.assertAlmostEqual(self.sim.particles[0].m, sim2.particles[0].m, delta=1e-14)
+        with self.assertRaises(RuntimeError):
+            self.rebx.add_operator(self.rebx.get_operator('modify_mass'), every=0)
+
+    def test_register_effect(self):
+        calls = []
+        def counting_force(sim, force, particles, N):
+            calls.append(N)
+        self.rebx.register_effect('test_counting_force', force_type='pos', update_accelerations=counting_force)
+        with self.assertRaises(RuntimeError):
+            self.rebx.register_effect('test_counting_force', force_type='pos', update_accelerations=counting_force)
+        with self.assertRaises(RuntimeError):
+            self.rebx.load_operator('test_counting_force')
+        force = self.rebx.load_force('test_counting_force')
+        self.rebx.add_force(force)
+        self.sim.integrate(1)
+        self.assertGreater(len(calls), 0)
+        self.assertEqual(self.rebx.get_force('test_counting_force').name, b'test_counting_force')
+
+        self.rebx.save('test.rebx')
+        rebx = reboundx.Extras(self.sim, 'test.rebx')
+        del calls[:]
+        self.sim.integrate(2)
+        self.assertGreater(len(calls), 0)
+        os.remove('test.rebx')
+
+    def test_clone(self):
+        gr = self.rebx.load_force('gr')
+        self.rebx.add_force(gr)
+        gr.params['c'] = 1e2
+        mm = self.rebx.load_operator('modify_mass')
+        self.rebx.add_operator(mm)
+        self.sim.particles[1].params['tau_mass'] = -1e3
+        sim2 = self.sim.copy()
+        rebx2 = self.rebx.clone(sim2)
+        self.assertEqual(sim2.particles[1].params['tau_mass'], -1e3)
+        self.assertEqual(rebx2.get_force('gr').params['c'], 1e2)
+
+        sim2.particles[1].params['tau_mass'] = -2e3 # not shared with the source
+        self.assertEqual(self.sim.particles[1].params['tau_mass'], -1e3)
+        sim2.particles[1].params['tau_mass'] = -1e3
+        self.sim.integrate(10)
+        sim2.integrate(10)
+        self.assertEqual(self.sim.particles[1].x, sim2.particles[1].x)
+        self.assertEqual(self.sim.particles[1].m, sim2.particles[1].m)
+
+        with self.assertRaises(ValueError):
+            self.rebx.clone(self.sim)
+
     def test_total_angular_momentum(self):
         sim = rebound.Simulation()
         sim.add(m=1)
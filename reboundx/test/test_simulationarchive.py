@@ -2,6 +2,7 @@ import rebound
 import reboundx
 import unittest
 import numpy as np
+import os
 
 """
 Acts as both a test on various integration options for forces working (add_force vs step before/after/both)
@@ -143,6 +144,93 @@ class TestSimulationArchive(unittest.TestCase):
                 sim.integrate(tmax)
                 self.assertEqual(self.sim.particles[1].x, sim.particles[1].x, msg='REB integrator: {0}, REBX integrator: {1}'.format(integrator, rebxintegrator))
 
+    def test_append(self):
+        self.rebx.save('test.rebx')
+        self.gr.params['c'] = 2e2
+        self.rebx.save('test.rebx', append=True)
+
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(m=1.e-4, a=1., e=0.2)
+        rebx = reboundx.Extras(sim, 'test.rebx', snapshot=0)
+        self.assertEqual(rebx.get_force('gr').params['c'], 1e2)
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(m=1.e-4, a=1., e=0.2)
+        rebx = reboundx.Extras(sim, 'test.rebx')
+        self.assertEqual(rebx.get_force('gr').params['c'], 2e2)
+        sim = rebound.Simulation()
+        with self.assertRaises(RuntimeError):
+            rebx = reboundx.Extras(sim, 'test.rebx', snapshot=2)
+
+    def test_appenddelta(self):
+        ps = self.sim.particles
+        ps[1].params['tau_a'] = -1e3
+        ps[1].params['tau_e'] = -1e2
+        if os.path.isfile('test.rebx'):
+            os.remove('test.rebx')
+        self.rebx.save('test.rebx', append=True, delta=True)
+        ps[1].params['tau_e'] = -2e2
+        self.rebx.save('test.rebx', append=True, delta=True)
+        self.gr.params['c'] = 2e2 # effect params changes are stored in a full snapshot
+        self.rebx.save('test.rebx', append=True, delta=True)
+        
+        taus = []
+        for snapshot in range(3):
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1.e-4, a=1., e=0.2)
+            rebx = reboundx.Extras(sim, 'test.rebx', snapshot=snapshot)
+            taus.append((sim.particles[1].params['tau_a'], sim.particles[1].params['tau_e'], rebx.get_force('gr').params['c']))
+        self.assertEqual(taus, [(-1e3, -1e2, 1e2), (-1e3, -2e2, 1e2), (-1e3, -2e2, 2e2)])
+
+    def test_frombytes(self):
+        self.sim.particles[1].params['tau_a'] = -1e3
+        self.rebx.save('test.rebx')
+        self.gr.params['c'] = 2e2
+        self.rebx.save('test.rebx', append=True, delta=True)
+        with open('test.rebx', 'rb') as f:
+            data = f.read()
+
+        for buf in [data, bytearray(data)]:
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1.e-4, a=1., e=0.2)
+            rebx = reboundx.Extras(sim, buf, snapshot=0)
+            self.assertEqual(rebx.get_force('gr').params['c'], 1e2)
+            self.assertEqual(sim.particles[1].params['tau_a'], -1e3)
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1.e-4, a=1., e=0.2)
+            rebx = reboundx.Extras(sim, buf)
+            self.assertEqual(rebx.get_force('gr').params['c'], 2e2)
+        sim = rebound.Simulation()
+        with self.assertRaises(RuntimeError):
+            rebx = reboundx.Extras(sim, data[:32])
+
+    def test_automate(self):
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(m=1.e-3, a=1., e=0.5, f=np.pi) # reaches pericenter at t=pi
+        sim.move_to_com()
+        sim.integrator = "whfast"
+        sim.dt = 1.e-3
+        rebx = reboundx.Extras(sim)
+        mind = rebx.load_operator("track_min_distance")
+        rebx.add_operator(mind)
+        sim.particles[1].params['min_distance'] = 10.
+        sim.automateSimulationArchive('test.sa', interval=0.5, deletefile=True)
+        rebx.automateSimulationArchive('test.rebx', interval=0.5, deletefile=True)
+        sim.integrate(2.*np.pi)
+
+        sa = reboundx.SimulationArchive('test.sa', 'test.rebx')
+        mins = [sa[i][0].particles[1].params['min_distance'] for i in range(len(sa))]
+        self.assertEqual(mins[0], 10.)
+        self.assertLess(abs(mins[-1] - 0.5), 1.e-2)
+        self.assertEqual(mins[-1], sim.particles[1].params['min_distance'])
+        for i in range(1, len(mins)):
+            self.assertLessEqual(mins[i], mins[i-1])
+
 if __name__ == '__main__':
     unittest.main()
 
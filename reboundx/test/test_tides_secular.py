@@ -0,0 +1,54 @@
+import rebound
+import reboundx
+import unittest
+import numpy as np
+
+class TestTidesSecular(unittest.TestCase):
+    def setUp(self):
+        self.sim = rebound.Simulation()
+        self.sim.add(m=0.86, r = 0.78)
+        self.sim.add(m=3.e-6, a=1., e=0.05)
+        self.sim.move_to_com()
+        self.sim.integrator = "whfast"
+        self.sim.dt = self.sim.particles[1].P/20.
+        ps = self.sim.particles
+
+        self.rebx = reboundx.Extras(self.sim)
+        self.tides = self.rebx.load_operator("tides_secular")
+        self.rebx.add_operator(self.tides, every=100)
+        ps[0].params["k2"] = 0.023
+        ps[0].params["tau"] = 0.3
+        ps[0].params["Omega"] = [0.,0.,0.]
+
+        self.q = (ps[1].m/ps[0].m)
+        self.T = ps[0].r**3/self.sim.G/ps[0].m/ps[0].params["tau"]
+        self.taua = self.T/6/ps[0].params["k2"]/self.q/(1+self.q)*(ps[1].a/ps[0].r)**8
+
+    def test_adamping(self):
+        ps = self.sim.particles
+        tmax = 2e4*ps[1].P
+        apred = ps[0].r*((ps[1].a/ps[0].r)**8 - 48.*ps[0].params["k2"]*self.q*(1+self.q)*tmax/self.T)**(1./8.)
+
+        self.sim.integrate(tmax)
+        self.assertLess(abs((ps[1].a-apred)/apred), 1.e-2) # 1%
+
+    def test_linear_edamping(self):
+        ps = self.sim.particles
+        tmax = self.taua/1000
+        epred = ps[1].e*np.exp(-tmax/(6./27.*self.taua))
+
+        self.sim.integrate(tmax)
+        self.assertLess(abs((ps[1].e-epred)/epred), 0.1) # 10%
+
+    def test_angular_momentum_conservation(self):
+        ps = self.sim.particles
+        ps[0].params["Omega"] = [0.,0.,0.1]
+        ps[0].params["I"] = 0.07*ps[0].m*ps[0].r**2
+        L0 = np.array(self.sim.angular_momentum()) + np.array(self.rebx.spin_angular_momentum())
+        self.sim.integrate(1e3*ps[1].P)
+        L = np.array(self.sim.angular_momentum()) + np.array(self.rebx.spin_angular_momentum())
+        self.assertLess(np.linalg.norm(L-L0)/np.linalg.norm(L0), 1.e-10)
+        self.assertNotEqual(ps[0].params["Omega"].z, 0.1)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -35,6 +35,14 @@ REBX_BINARY_FIELD_TYPE = {
         24: 'Particles',
         25: 'Force',
         26: 'Snapshot',
+        27: 'Snapshot time',
+        28: 'Snapshot steps done',
+        29: 'Snapshot index',
+        30: 'Snapshot delta',
+        31: 'Delta base',
+        32: 'Delta column',
+        33: 'Step every',
+        34: 'Step phase',
         }
 
 class BinaryField(Structure):
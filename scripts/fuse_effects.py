@@ -0,0 +1,318 @@
+#!/usr/bin/python
+# Generates a single force that evaluates a fixed stack of effects acting between particles[0] and the other particles in one pass over
+# the particles, e.g.
+#
+#     python fuse_effects.py central_stack gr_potential gravitational_harmonics tides_constant_time_lag
+#
+# writes central_stack.c with rebx_central_stack (the fused update_accelerations) and rebx_register_central_stack, which registers it
+# so that rebx_load_force(rebx, "central_stack") loads it like any other force. Compile the file with your problem (see examples/fused_effects).
+#
+# Each particle is loaded once, the separation from particles[0] is computed once and shared by all terms, and only the params of the
+# chosen effects are looked up. The effects are evaluated in the order given, and the accelerations of particles[1..N-1] are the same
+# bit for bit as adding the individual forces in the reverse order (rebx_additional_forces evaluates the most recently added force first).
+# The back reactions on particles[0] are summed over particles first, so they only agree to rounding.
+# Difference from the individual forces: gravitational_harmonics only includes the harmonics of particles[0].
+
+import argparse
+import os
+import sys
+
+STAGES = {"gr_potential": ["gr_potential"],
+          "gravitational_harmonics": ["J2", "J4"],
+          "J2": ["J2"],
+          "J4": ["J4"],
+          "tides_constant_time_lag": ["tides_primary", "tides_bodies"]}
+
+SETUP = {}
+BODY = {}
+
+SETUP["gr_potential"] = """
+    // gr_potential
+    const double* const c = rebx_get_param(rebx, force->ap, "c");
+    if (c == NULL){
+        reb_error(sim, "REBOUNDx Error: Need to set speed of light in gr effect.  See examples in documentation.\\n");
+        return;
+    }
+    const double C2 = (*c)*(*c);
+    const double gr_prefac1 = 6.*(G*p0.m)*(G*p0.m)/C2;
+"""
+BODY["gr_potential"] = """
+        // gr_potential
+        {
+            const double prefac = gr_prefac1/(r2*r2);
+            ax -= prefac*dx;
+            ay -= prefac*dy;
+            az -= prefac*dz;
+            ax0 += p.m/p0.m*prefac*dx;
+            ay0 += p.m/p0.m*prefac*dy;
+            az0 += p.m/p0.m*prefac*dz;
+        }
+"""
+
+SETUP["J2"] = """
+    // J2 of particles[0] (gravitational_harmonics)
+    const double* const J2 = rebx_get_param(rebx, p0.ap, "J2");
+    const int J2_on = J2 != NULL && R_eq != NULL;
+    const double J2_fac = J2_on ? 3.*(*J2)*(*R_eq)*(*R_eq) : 0.;
+"""
+BODY["J2"] = """
+        // J2 of particles[0] (gravitational_harmonics)
+        if (J2_on){
+            const double costheta2 = dz*dz/r2;
+            const double prefac = J2_fac/r2/r2/r/2.;
+            const double fac = 5.*costheta2-1.;
+            ax += G*p0.m*prefac*fac*dx;
+            ay += G*p0.m*prefac*fac*dy;
+            az += G*p0.m*prefac*(fac-2.)*dz;
+            ax0 -= G*p.m*prefac*fac*dx;
+            ay0 -= G*p.m*prefac*fac*dy;
+            az0 -= G*p.m*prefac*(fac-2.)*dz;
+        }
+"""
+
+SETUP["J4"] = """
+    // J4 of particles[0] (gravitational_harmonics)
+    const double* const J4 = rebx_get_param(rebx, p0.ap, "J4");
+    const int J4_on = J4 != NULL && R_eq != NULL;
+    const double J4_fac = J4_on ? 5.*(*J4)*(*R_eq)*(*R_eq)*(*R_eq)*(*R_eq) : 0.;
+"""
+BODY["J4"] = """
+        // J4 of particles[0] (gravitational_harmonics)
+        if (J4_on){
+            const double costheta2 = dz*dz/r2;
+            const double prefac = J4_fac/r2/r2/r2/r/8.;
+            const double fac = 63.*costheta2*costheta2-42.*costheta2 + 3.;
+            ax += G*p0.m*prefac*fac*dx;
+            ay += G*p0.m*prefac*fac*dy;
+            az += G*p0.m*prefac*(fac+12.-28.*costheta2)*dz;
+            ax0 -= G*p.m*prefac*fac*dx;
+            ay0 -= G*p.m*prefac*fac*dy;
+            az0 -= G*p.m*prefac*(fac+12.-28.*costheta2)*dz;
+        }
+"""
+
+SETUP["tides_primary"] = """
+    // Tides raised on particles[0] (tides_constant_time_lag). No tides at all if particles[0] is massless
+    const int tides_on = p0.m != 0;
+    const double* const primary_k2 = rebx_get_param(rebx, p0.ap, "tctl_k2");
+    const int primary_tides_on = tides_on && primary_k2 != NULL && p0.r != 0;
+    double primary_tau = 0.;
+    double primary_Omega = 0.;
+    if (primary_tides_on){
+        const double* const tau = rebx_get_param(rebx, p0.ap, "tctl_tau");
+        if (tau){
+            primary_tau = *tau;
+            const double* const Omega = rebx_get_param(rebx, p0.ap, "OmegaMag");
+            if (Omega){
+                primary_Omega = *Omega;
+            }
+        }
+    }
+"""
+BODY["tides_primary"] = """
+        // Tides raised on particles[0] by particles[i] (tides_constant_time_lag)
+        if (primary_tides_on && p.m != 0){
+            const double ms = p.m;
+            const double mt = p0.m;
+            const double Rt = p0.r;
+            const double tau = primary_tau;
+            const double Omega = primary_Omega;
+            const double mratio = ms/mt;
+            const double fac = mratio*(*primary_k2)*Rt*Rt*Rt*Rt*Rt;
+            const double tdx = -1.*dx;
+            const double tdy = -1.*dy;
+            const double tdz = -1.*dz;
+            const double prefac = -3*G/(r2*r2*r2*r2)*fac;
+            double rfac = prefac;
+            if (tau != 0){
+                const double tdvx = -1.*dvx;
+                const double tdvy = -1.*dvy;
+                const double tdvz = -1.*dvz;
+                rfac *= (1. + 3.*tau/r2*(tdx*tdvx + tdy*tdvy + tdz*tdvz));
+                const double thetafac = -prefac*tau;
+                const double hx = tdy*tdvz - tdz*tdvy;
+                const double hy = tdz*tdvx - tdx*tdvz;
+                const double hz = tdx*tdvy - tdy*tdvx;
+                const double thetadotcrossrx = (hy*tdz - hz*tdy)/r2;
+                const double thetadotcrossry = (hz*tdx - hx*tdz)/r2;
+                const double thetadotcrossrz = (hx*tdy - hy*tdx)/r2;
+                const double Omegacrossrx = -Omega*tdy;
+                const double Omegacrossry = Omega*tdx;
+                const double Omegacrossrz = 0.;
+                ax0 += thetafac*ms*(Omegacrossrx-thetadotcrossrx);
+                ay0 += thetafac*ms*(Omegacrossry-thetadotcrossry);
+                az0 += thetafac*ms*(Omegacrossrz-thetadotcrossrz);
+                ax -= thetafac*mt*(Omegacrossrx-thetadotcrossrx);
+                ay -= thetafac*mt*(Omegacrossry-thetadotcrossry);
+                az -= thetafac*mt*(Omegacrossrz-thetadotcrossrz);
+            }
+            ax0 += rfac*ms*tdx;
+            ay0 += rfac*ms*tdy;
+            az0 += rfac*ms*tdz;
+            ax -= rfac*mt*tdx;
+            ay -= rfac*mt*tdy;
+            az -= rfac*mt*tdz;
+        }
+"""
+
+SETUP["tides_bodies"] = """
+    // Tides raised on the other particles by particles[0] (tides_constant_time_lag). The list is in particle order, so it's walked along with the particles
+    const struct rebx_param_list* const k2s = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "tctl_k2"));
+    if (k2s == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for {name}.\\n");
+        return;
+    }
+    const int id_tau = rebx_intern(rebx, "tctl_tau");
+    const int id_Omega = rebx_intern(rebx, "OmegaMag");
+    int k2_next = (k2s->N_particles > 0 && k2s->index[0] == 0) ? 1 : 0;
+"""
+BODY["tides_bodies"] = """
+        // Tides raised on particles[i] by particles[0] (tides_constant_time_lag)
+        if (k2_next < k2s->N_particles && k2s->index[k2_next] == i){
+            const double* const k2 = k2s->values[k2_next];
+            k2_next++;
+            if (tides_on && p.r != 0 && p.m != 0){
+                double tau = 0.;
+                double Omega = 0.;
+                const double* const tauptr = rebx_get_param_by_id(rebx, p.ap, id_tau);
+                if (tauptr){
+                    tau = *tauptr;
+                    const double* const Omegaptr = rebx_get_param_by_id(rebx, p.ap, id_Omega);
+                    if (Omegaptr){
+                        Omega = *Omegaptr;
+                    }
+                }
+                const double ms = p0.m;
+                const double mt = p.m;
+                const double Rt = p.r;
+                const double mratio = ms/mt;
+                const double fac = mratio*(*k2)*Rt*Rt*Rt*Rt*Rt;
+                const double tdx = 1.*dx;
+                const double tdy = 1.*dy;
+                const double tdz = 1.*dz;
+                const double prefac = -3*G/(r2*r2*r2*r2)*fac;
+                double rfac = prefac;
+                if (tau != 0){
+                    const double tdvx = 1.*dvx;
+                    const double tdvy = 1.*dvy;
+                    const double tdvz = 1.*dvz;
+                    rfac *= (1. + 3.*tau/r2*(tdx*tdvx + tdy*tdvy + tdz*tdvz));
+                    const double thetafac = -prefac*tau;
+                    const double hx = tdy*tdvz - tdz*tdvy;
+                    const double hy = tdz*tdvx - tdx*tdvz;
+                    const double hz = tdx*tdvy - tdy*tdvx;
+                    const double thetadotcrossrx = (hy*tdz - hz*tdy)/r2;
+                    const double thetadotcrossry = (hz*tdx - hx*tdz)/r2;
+                    const double thetadotcrossrz = (hx*tdy - hy*tdx)/r2;
+                    const double Omegacrossrx = -Omega*tdy;
+                    const double Omegacrossry = Omega*tdx;
+                    const double Omegacrossrz = 0.;
+                    ax += thetafac*ms*(Omegacrossrx-thetadotcrossrx);
+                    ay += thetafac*ms*(Omegacrossry-thetadotcrossry);
+                    az += thetafac*ms*(Omegacrossrz-thetadotcrossrz);
+                    ax0 -= thetafac*mt*(Omegacrossrx-thetadotcrossrx);
+                    ay0 -= thetafac*mt*(Omegacrossry-thetadotcrossry);
+                    az0 -= thetafac*mt*(Omegacrossrz-thetadotcrossrz);
+                }
+                ax += rfac*ms*tdx;
+                ay += rfac*ms*tdy;
+                az += rfac*ms*tdz;
+                ax0 -= rfac*mt*tdx;
+                ay0 -= rfac*mt*tdy;
+                az0 -= rfac*mt*tdz;
+            }
+        }
+"""
+
+TEMPLATE = """/**
+ * @file    {name}.c
+ * @brief   Fused {effects} around particles[0]
+ *
+ * Generated by reboundx/scripts/fuse_effects.py with
+ *
+ *     python fuse_effects.py {args}
+ *
+ * Rerun the script rather than editing this file. Evaluates {effects} in this order in a single pass over the particles,
+ * giving the same accelerations as the individual forces (to rounding for the back reactions on particles[0]). See fuse_effects.py for the differences.
+ * Call rebx_register_{name} once, and then load the force with rebx_load_force(rebx, "{name}") and set the params as for the individual effects.
+ */
+
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+void rebx_{name}(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){{
+    struct rebx_extras* const rebx = sim->extras;
+    const double G = sim->G;
+    if (N < 2){{
+        return;
+    }}
+    const struct reb_particle p0 = particles[0];
+{setup}
+    double ax0 = 0.;
+    double ay0 = 0.;
+    double az0 = 0.;
+    for (int i=1; i<N; i++){{
+        const struct reb_particle p = particles[i];
+        const double dx = p.x - p0.x;
+        const double dy = p.y - p0.y;
+        const double dz = p.z - p0.z;
+        const double r2 = dx*dx + dy*dy + dz*dz;
+{distances}        double ax = p.ax;
+        double ay = p.ay;
+        double az = p.az;
+{body}
+        particles[i].ax = ax;
+        particles[i].ay = ay;
+        particles[i].az = az;
+    }}
+    particles[0].ax += ax0;
+    particles[0].ay += ay0;
+    particles[0].az += az0;
+}}
+
+int rebx_register_{name}(struct rebx_extras* const rebx){{
+    const struct rebx_registered_effect effect = {{.name = "{name}", .update_accelerations = rebx_{name}, .force_type = {force_type}}};
+    return rebx_register_effect(rebx, &effect);
+}}
+"""
+
+def generate(name, effects, args):
+    stages = []
+    for effect in effects:
+        if effect not in STAGES:
+            sys.exit("Can't fuse '{0}'. Supported effects are {1}.".format(effect, ", ".join(sorted(STAGES))))
+        for stage in STAGES[effect]:
+            if stage in stages:
+                sys.exit("'{0}' is included more than once.".format(stage))
+            stages.append(stage)
+    if "tides_bodies" in stages and "tides_primary" not in stages:
+        sys.exit("Internal error: tides stages out of sync.")
+
+    setup = ""
+    if "J2" in stages or "J4" in stages:
+        setup += """
+    const double* const R_eq = rebx_get_param(rebx, p0.ap, "R_eq");
+"""
+    setup += "".join(SETUP[stage] for stage in stages)
+    setup = setup.replace("{name}", name)
+    distances = ""
+    if "J2" in stages or "J4" in stages:
+        distances += "        const double r = sqrt(r2);\n"
+    if "tides_primary" in stages:
+        distances += "        const double dvx = p.vx - p0.vx;\n        const double dvy = p.vy - p0.vy;\n        const double dvz = p.vz - p0.vz;\n"
+    body = "".join(BODY[stage] for stage in stages)
+    force_type = "REBX_FORCE_VEL" if "tides_primary" in stages else "REBX_FORCE_POS"
+    return TEMPLATE.format(name=name, effects=", ".join(effects), args=" ".join(args), setup=setup, distances=distances, body=body, force_type=force_type)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Generates one force evaluating a fixed stack of effects around particles[0] in a single pass.")
+    parser.add_argument("name", help="Name of the fused force (and of the generated file)")
+    parser.add_argument("effects", nargs="+", help="Effects in the order they're evaluated: " + ", ".join(sorted(STAGES)))
+    parser.add_argument("-o", "--output", help="Output file. Defaults to name.c in the current directory")
+    args = parser.parse_args()
+    code = generate(args.name, args.effects, [args.name] + args.effects)
+    output = args.output if args.output else args.name + ".c"
+    with open(output, "w") as f:
+        f.write(code)
+    print("Wrote {0}".format(os.path.abspath(output)))
@@ -0,0 +1,258 @@
+/**
+ * @file    batch.c
+ * @brief   Evaluation of the forces of several simulations at once, laid out lane-wise
+ * @author  REBOUNDx developers
+ *
+ * @section     LICENSE
+ * Copyright (c) 2026 REBOUNDx developers
+ *
+ * This file is part of reboundx.
+ *
+ * reboundx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * reboundx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "core.h"
+#include "rebound.h"
+#include "reboundx.h"
+
+/* For systems of a few bodies, an effect only does a handful of flops per call, so evaluating it on each simulation is
+ * dominated by call and param lookup overhead. A batch kernel evaluates the same force for all K simulations of a batch in
+ * one call, with the loops over simulations innermost so they vectorize. Kernels must do the same arithmetic in the same
+ * order as update_accelerations, so results match evaluating each simulation on its own.*/
+
+#define REBX_BATCH_N_ARRAYS 11 // x, y, z, vx, vy, vz, m, r, ax, ay, az
+
+static double rebx_batch_walltime(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1.e-6*tv.tv_usec;
+}
+
+static int rebx_batch_count_forces(struct rebx_extras* const rebx){
+    int N_forces = 0;
+    for (struct rebx_node* node = rebx->additional_forces; node != NULL; node = node->next){
+        N_forces++;
+    }
+    return N_forces;
+}
+
+struct rebx_batch* rebx_batch_create(struct reb_simulation** const sims, const int K){
+    if (sims == NULL || K < 1 || sims[0] == NULL){
+        fprintf(stderr, "REBOUNDx Error: Need to pass at least one simulation to rebx_batch_create.\n");
+        return NULL;
+    }
+    struct reb_simulation* const sim0 = sims[0];
+    if (sim0->extras == NULL){
+        reb_error(sim0, "REBOUNDx Error: Simulations passed to rebx_batch_create need REBOUNDx attached.\n");
+        return NULL;
+    }
+    const int N = sim0->N - sim0->N_var;
+    const int N_forces = rebx_batch_count_forces(sim0->extras);
+    for (int k=1; k<K; k++){
+        struct reb_simulation* const sim = sims[k];
+        if (sim == NULL || sim->extras == NULL || sim->N - sim->N_var != N || rebx_batch_count_forces(sim->extras) != N_forces){
+            reb_error(sim0, "REBOUNDx Error: All simulations passed to rebx_batch_create need REBOUNDx attached, the same number of particles and the same forces.\n");
+            return NULL;
+        }
+    }
+
+    struct rebx_batch* batch = calloc(1, sizeof(*batch));
+    if (batch == NULL){
+        reb_error(sim0, "REBOUNDx Error: Could not allocate memory.\n");
+        return NULL;
+    }
+    batch->K = K;
+    batch->N = N;
+    batch->N_forces = N_forces;
+    batch->sims = malloc(K*sizeof(*batch->sims));
+    batch->forces = malloc((N_forces*K + 1)*sizeof(*batch->forces));
+    batch->kernels = malloc((N_forces + 1)*sizeof(*batch->kernels));
+    batch->G = malloc((REBX_BATCH_N_ARRAYS*N + 1)*K*sizeof(*batch->G));
+    if (batch->sims == NULL || batch->forces == NULL || batch->kernels == NULL || batch->G == NULL){
+        reb_error(sim0, "REBOUNDx Error: Could not allocate memory.\n");
+        rebx_batch_free(batch);
+        return NULL;
+    }
+    double** const arrays[REBX_BATCH_N_ARRAYS] = {&batch->x, &batch->y, &batch->z, &batch->vx, &batch->vy, &batch->vz, &batch->m, &batch->r, &batch->ax, &batch->ay, &batch->az};
+    for (int a=0; a<REBX_BATCH_N_ARRAYS; a++){
+        *arrays[a] = batch->G + (a*N + 1)*K;
+    }
+
+    // Forces are evaluated in the order of the additional_forces lists, like in rebx_additional_forces
+    for (int k=0; k<K; k++){
+        batch->sims[k] = sims[k];
+        struct rebx_extras* const rebx = sims[k]->extras;
+        int j = 0;
+        for (struct rebx_node* node = rebx->additional_forces; node != NULL; node = node->next){
+            batch->forces[j*K + k] = node->object;
+            j++;
+        }
+    }
+    for (int j=0; j<N_forces; j++){
+        const struct rebx_force* const force = batch->forces[j*K];
+        for (int k=1; k<K; k++){
+            if (batch->forces[j*K + k]->update_accelerations != force->update_accelerations){
+                reb_error(sim0, "REBOUNDx Error: All simulations passed to rebx_batch_create need the same forces, added in the same order.\n");
+                rebx_batch_free(batch);
+                return NULL;
+            }
+        }
+        // Only forces loaded from the registry have batch kernels. Forces with update_constants are evaluated on each simulation
+        const struct rebx_registered_effect* const effect = force->name ? rebx_get_registered_effect(force->name) : NULL;
+        if (effect != NULL && effect->update_accelerations == force->update_accelerations && force->update_constants == NULL){
+            batch->kernels[j] = effect->update_accelerations_batch;
+        }
+        else{
+            batch->kernels[j] = NULL;
+        }
+    }
+    return batch;
+}
+
+void rebx_batch_free(struct rebx_batch* const batch){
+    if (batch == NULL){
+        return;
+    }
+    free(batch->sims);
+    free(batch->forces);
+    free(batch->kernels);
+    free(batch->G);
+    free(batch->scratch);
+    free(batch);
+}
+
+double* rebx_batch_scratch(struct rebx_batch* const batch, const size_t N){
+    if (N > batch->N_scratch){
+        double* scratch = realloc(batch->scratch, N*sizeof(*scratch));
+        if (scratch == NULL){
+            reb_error(batch->sims[0], "REBOUNDx Error: Could not allocate memory.\n");
+            return NULL;
+        }
+        batch->scratch = scratch;
+        batch->N_scratch = N;
+    }
+    return batch->scratch;
+}
+
+// Rows are filled one at a time, so the writes are contiguous
+static void rebx_batch_gather(struct rebx_batch* const batch){
+    const int K = batch->K;
+    for (int k=0; k<K; k++){
+        batch->G[k] = batch->sims[k]->G;
+    }
+    for (int i=0; i<batch->N; i++){
+        for (int k=0; k<K; k++){
+            const struct reb_particle* const p = &batch->sims[k]->particles[i];
+            const int l = REBX_LANE(batch, i, k);
+            batch->x[l] = p->x;
+            batch->y[l] = p->y;
+            batch->z[l] = p->z;
+            batch->vx[l] = p->vx;
+            batch->vy[l] = p->vy;
+            batch->vz[l] = p->vz;
+            batch->m[l] = p->m;
+            batch->r[l] = p->r;
+        }
+    }
+}
+
+static void rebx_batch_gather_accelerations(struct rebx_batch* const batch){
+    for (int k=0; k<batch->K; k++){
+        const struct reb_particle* const particles = batch->sims[k]->particles;
+        for (int i=0; i<batch->N; i++){
+            const int l = REBX_LANE(batch, i, k);
+            batch->ax[l] = particles[i].ax;
+            batch->ay[l] = particles[i].ay;
+            batch->az[l] = particles[i].az;
+        }
+    }
+}
+
+static void rebx_batch_scatter_accelerations(struct rebx_batch* const batch){
+    for (int k=0; k<batch->K; k++){
+        struct reb_particle* const particles = batch->sims[k]->particles;
+        for (int i=0; i<batch->N; i++){
+            const int l = REBX_LANE(batch, i, k);
+            particles[i].ax = batch->ax[l];
+            particles[i].ay = batch->ay[l];
+            particles[i].az = batch->az[l];
+        }
+    }
+}
+
+void rebx_batch_additional_forces(struct rebx_batch* const batch){
+    const int K = batch->K;
+    const int N = batch->N;
+    for (int k=0; k<K; k++){
+        struct reb_simulation* const sim = batch->sims[k];
+        if (sim->N - sim->N_var != N){
+            reb_error(sim, "REBOUNDx Error: Number of particles changed since rebx_batch_create was called. Need to create a new batch.\n");
+            return;
+        }
+    }
+    for (int k=0; k<K; k++){
+        struct rebx_extras* const rebx = batch->sims[k]->extras;
+        rebx_sync_param_columns(rebx);
+        rebx->geometry_epoch++; // odd during the pass, like in rebx_additional_forces
+    }
+    rebx_batch_gather(batch);
+    rebx_batch_gather_accelerations(batch);
+
+    // Accelerations are only copied between particles and lanes when switching between batch kernels and forces evaluated on each simulation
+    int lanes_current = 1;
+    int particles_current = 1;
+    for (int j=0; j<batch->N_forces; j++){
+        if (batch->kernels[j] != NULL){
+            if (!lanes_current){
+                rebx_batch_gather_accelerations(batch);
+                lanes_current = 1;
+            }
+            struct rebx_extras* const rebx0 = batch->sims[0]->extras;
+            const double start = rebx0->profiling ? rebx_batch_walltime() : 0.;
+            batch->kernels[j](batch, j);
+            particles_current = 0;
+            if (rebx0->profiling){ // time is split evenly between the simulations
+                const double walltime = (rebx_batch_walltime() - start)/K;
+                for (int k=0; k<K; k++){
+                    struct rebx_force* const force = batch->forces[j*K + k];
+                    force->profile.calls++;
+                    force->profile.particles += N;
+                    force->profile.walltime += walltime;
+                }
+            }
+        }
+        else{
+            if (!particles_current){
+                rebx_batch_scatter_accelerations(batch);
+                particles_current = 1;
+            }
+            for (int k=0; k<K; k++){
+                struct reb_simulation* const sim = batch->sims[k];
+                rebx_update_force_accelerations(sim, batch->forces[j*K + k], sim->particles, N);
+            }
+            lanes_current = 0;
+        }
+    }
+    if (!particles_current){
+        rebx_batch_scatter_accelerations(batch);
+    }
+    for (int k=0; k<K; k++){
+        struct rebx_extras* const rebx = batch->sims[k]->extras;
+        rebx->geometry_epoch++;
+    }
+}
@@ -37,6 +37,7 @@
  * Adds a general central acceleration of the form a=Acentral*r^gammacentral, outward along the direction from a central particle to the body.
  * Effect is turned on by adding Acentral and gammacentral parameters to a particle, which will act as the central body for the effect,
  * and will act on all other particles.
+ * For integer gammacentral between -3 and 5, the acceleration is evaluated with multiplications and square roots rather than pow, which is much faster.
  *
  * **Effect Parameters**
  * 
@@ -59,19 +60,82 @@
 #include <float.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "rebxtools.h"
 
-static void rebx_calculate_central_force(struct reb_simulation* const sim, struct reb_particle* const particles, const int N, const double A, const double gamma, const int source_index){
+/* pow is much more expensive than the rest of the kernels. For integer gamma from -3 to 5, the exponents are multiples of 1/2
+ * and we can use multiplications, divisions and sqrt instead. Returns 2*exponent in this range, or 0 with *pow_needed set otherwise.*/
+static int rebx_central_force_half_exponent(const double exponent, int* const pow_needed){
+    const double twice_exponent = 2.*exponent;
+    *pow_needed = !(twice_exponent >= -4. && twice_exponent <= 4. && twice_exponent == (int)twice_exponent); // NaN uses pow
+    return *pow_needed ? 0 : (int)twice_exponent;
+}
+
+// x^exponent, with n = 2*exponent from rebx_central_force_half_exponent
+static inline double rebx_central_force_power(const double x, const double exponent, const int n, const int pow_needed){
+    if (pow_needed){
+        return pow(x, exponent);
+    }
+    switch(n){
+        case -4: return 1./(x*x);
+        case -3: return 1./(x*sqrt(x));
+        case -2: return 1./x;
+        case -1: return 1./sqrt(x);
+        case 0: return 1.;
+        case 1: return sqrt(x);
+        case 2: return x;
+        case 3: return x*sqrt(x);
+        default: return x*x;
+    }
+}
+
+// Loop over the packed r2 with the power chosen outside the loop, so each case has no branches and can be vectorized
+#define REBX_CENTRAL_FORCE_LANES(power) \
+    _Pragma("omp parallel for simd schedule(guided)") \
+    for (int i=0; i<N; i++){ \
+        const double x = r2[i]; \
+        prefacs[i] = A*(power); \
+    }
+
+static void rebx_central_force_prefactors(double* const prefacs, const double* const r2, const int N, const double A, const double gamma){
+    const double exponent = (gamma-1.)/2.;
+    int pow_needed;
+    const int n = rebx_central_force_half_exponent(exponent, &pow_needed);
+    // Literal n in each case, so rebx_central_force_power reduces to a single expression inside the loop
+    if (pow_needed){
+        REBX_CENTRAL_FORCE_LANES(pow(x, exponent));
+        return;
+    }
+    switch(n){
+        case -4: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, -4, 0)); break;
+        case -3: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, -3, 0)); break;
+        case -2: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, -2, 0)); break;
+        case -1: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, -1, 0)); break;
+        case 0: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, 0, 0)); break;
+        case 1: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, 1, 0)); break;
+        case 2: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, 2, 0)); break;
+        case 3: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, 3, 0)); break;
+        default: REBX_CENTRAL_FORCE_LANES(rebx_central_force_power(x, exponent, 4, 0)); break;
+    }
+}
+
+#undef REBX_CENTRAL_FORCE_LANES
+
+static void rebx_calculate_central_force(struct reb_simulation* const sim, double* const prefacs, struct reb_particle* const particles, const int N, const double A, const double gamma, const int source_index){
     const struct reb_particle source = particles[source_index];
+    const struct rebx_geometry* const g = rebx_get_geometry(sim->extras, particles, N, source_index);
+    if (g == NULL){
+        return;
+    }
+    rebx_central_force_prefactors(prefacs, g->r2, N, A, gamma); // The source's lane is unused
     for (int i=0; i<N; i++){
         if(i == source_index){
             continue;
         }
         const struct reb_particle p = particles[i];
-        const double dx = p.x - source.x;
-        const double dy = p.y - source.y;
-        const double dz = p.z - source.z;
-        const double r2 = dx*dx + dy*dy + dz*dz;
-        const double prefac = A*pow(r2, (gamma-1.)/2.);
+        const double dx = g->dx[i];
+        const double dy = g->dy[i];
+        const double dz = g->dz[i];
+        const double prefac = prefacs[i];
 
         particles[i].ax += prefac*dx;
         particles[i].ay += prefac*dy;
@@ -83,13 +147,20 @@ static void rebx_calculate_central_force(struct reb_simulation* const sim, struc
 }
 
 void rebx_central_force(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
-    for (int i=0; i<N; i++){
-        const double* const Acentral = rebx_get_param(sim->extras, particles[i].ap, "Acentral");
-        if (Acentral != NULL){
-            const double* const gammacentral = rebx_get_param(sim->extras, particles[i].ap, "gammacentral");
-            if (gammacentral != NULL){
-                rebx_calculate_central_force(sim, particles, N, *Acentral, *gammacentral, i); // only calculates force if a particle has both Acentral and gammacentral parameters set.
-            }
+    struct rebx_extras* const rebx = sim->extras;
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "Acentral"));
+    double* const prefacs = rebx_get_force_scratch(rebx, force, N*sizeof(*prefacs));
+    if (sources == NULL || prefacs == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for central_force.\n");
+        return;
+    }
+    const int id_gammacentral = rebx_intern(rebx, "gammacentral");
+    for (int k=0; k<sources->N_particles; k++){
+        const int i = sources->index[k];
+        const double* const Acentral = sources->values[k];
+        const double* const gammacentral = rebx_get_param_by_id(rebx, particles[i].ap, id_gammacentral);
+        if (gammacentral != NULL){
+            rebx_calculate_central_force(sim, prefacs, particles, N, *Acentral, *gammacentral, i); // only calculates force if a particle has both Acentral and gammacentral parameters set.
         }
     }
 }
@@ -98,6 +169,9 @@ static double rebx_calculate_central_force_potential(struct reb_simulation* cons
     const struct reb_particle* const particles = sim->particles;
 	const int _N_real = sim->N - sim->N_var;
     const struct reb_particle source = particles[source_index];
+    const double exponent = (gamma+1.)/2.;
+    int pow_needed;
+    const int n = rebx_central_force_half_exponent(exponent, &pow_needed);
     double H = 0.;
 	for (int i=0;i<_N_real;i++){
 		if(i == source_index){
@@ -113,7 +187,7 @@ static double rebx_calculate_central_force_potential(struct reb_simulation* cons
             H -= p.m*A*log(sqrt(r2));
         }
         else{
-            H -= p.m*A*pow(r2, (gamma+1.)/2.)/(gamma+1.);
+            H -= p.m*A*rebx_central_force_power(r2, exponent, n, pow_needed)/(gamma+1.);
         }
     }		
     return H;
@@ -128,13 +202,17 @@ double rebx_central_force_potential(struct rebx_extras* const rebx){
     const int N_real = sim->N - sim->N_var;
     struct reb_particle* const particles = sim->particles;
     double Htot = 0.;
-    for (int i=0; i<N_real; i++){
-        const double* const Acentral = rebx_get_param(rebx, particles[i].ap, "Acentral");
-        if (Acentral != NULL){
-            const double* const gammacentral = rebx_get_param(rebx, particles[i].ap, "gammacentral");
-            if (gammacentral != NULL){
-                Htot += rebx_calculate_central_force_potential(sim, *Acentral, *gammacentral, i);
-            }
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N_real, rebx_intern(rebx, "Acentral"));
+    if (sources == NULL){
+        return 0.;
+    }
+    const int id_gammacentral = rebx_intern(rebx, "gammacentral");
+    for (int k=0; k<sources->N_particles; k++){
+        const int i = sources->index[k];
+        const double* const Acentral = sources->values[k];
+        const double* const gammacentral = rebx_get_param_by_id(rebx, particles[i].ap, id_gammacentral);
+        if (gammacentral != NULL){
+            Htot += rebx_calculate_central_force_potential(sim, *Acentral, *gammacentral, i);
         }
     }
     return Htot;
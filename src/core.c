@@ -28,12 +28,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <sys/time.h>
 #include <string.h>
 #include <limits.h>
 #include <float.h>
 #include "core.h"
 #include "rebound.h"
 #include "linkedlist.h"
+#include "rebxtools.h"
 
 #define STRINGIFY(s) str(s)
 #define str(s) #s
@@ -48,85 +50,182 @@ const char* rebx_githash_str = STRINGIFY(REBXGITHASH);             // This line
  Initialization routines.
  ****************************/
 
+/* The built-in params are registered once per process in a table that all rebx_extras instances share (read only), so
+ * attaching is cheap. Params registered on an instance are looked up after these, and get ids after theirs. */
+static struct rebx_param rebx_default_params[] = {
+    {.name = "c",                             .type = REBX_TYPE_DOUBLE},
+    {.name = "gr_source",                     .type = REBX_TYPE_INT},
+    {.name = "tau_mass",                      .type = REBX_TYPE_DOUBLE},
+    {.name = "mm_com_interval",               .type = REBX_TYPE_INT},
+    {.name = "mm_com",                        .type = REBX_TYPE_POINTER},
+    {.name = "pd_bindings",                   .type = REBX_TYPE_POINTER},
+    {.name = "force",                         .type = REBX_TYPE_FORCE},
+    {.name = "particle",                      .type = REBX_TYPE_POINTER},
+    {.name = "Acentral",                      .type = REBX_TYPE_DOUBLE},
+    {.name = "gammacentral",                  .type = REBX_TYPE_DOUBLE},
+    {.name = "max_iterations",                .type = REBX_TYPE_INT},
+    {.name = "J2",                            .type = REBX_TYPE_DOUBLE},
+    {.name = "J4",                            .type = REBX_TYPE_DOUBLE},
+    {.name = "R_eq",                          .type = REBX_TYPE_DOUBLE},
+    {.name = "coordinates",                   .type = REBX_TYPE_INT},
+    {.name = "p",                             .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_a",                         .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_e",                         .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_inc",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_omega",                     .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_Omega",                     .type = REBX_TYPE_DOUBLE},
+    {.name = "em_tau_a",                      .type = REBX_TYPE_DOUBLE},
+    {.name = "em_aini",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "em_afin",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "primary",                       .type = REBX_TYPE_INT},
+    {.name = "radiation_source",              .type = REBX_TYPE_INT},
+    {.name = "kappa",                         .type = REBX_TYPE_DOUBLE},
+    {.name = "kappa_x",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "kappa_y",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "kappa_z",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_kappa",                     .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_kappa_x",                   .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_kappa_y",                   .type = REBX_TYPE_DOUBLE},
+    {.name = "tau_kappa_z",                   .type = REBX_TYPE_DOUBLE},
+    {.name = "stochastic_force_r",            .type = REBX_TYPE_DOUBLE},
+    {.name = "stochastic_force_phi",          .type = REBX_TYPE_DOUBLE},
+    {.name = "stochastic_force_x",            .type = REBX_TYPE_DOUBLE},
+    {.name = "stochastic_force_y",            .type = REBX_TYPE_DOUBLE},
+    {.name = "stochastic_force_z",            .type = REBX_TYPE_DOUBLE},
+    {.name = "stochastic_forces_cache",       .type = REBX_TYPE_POINTER},
+    {.name = "ts_cutoff",                     .type = REBX_TYPE_DOUBLE},
+    {.name = "ts_min_mass_ratio",             .type = REBX_TYPE_DOUBLE},
+    {.name = "ts_structured_only",            .type = REBX_TYPE_INT},
+    {.name = "ts_neighbor_interval",          .type = REBX_TYPE_INT},
+    {.name = "ts_neighbor_skin",              .type = REBX_TYPE_DOUBLE},
+    {.name = "ts_neighbor_list",              .type = REBX_TYPE_POINTER},
+    {.name = "ts_spin_index",                 .type = REBX_TYPE_POINTER},
+    {.name = "ts_spin_every",                 .type = REBX_TYPE_INT},
+    {.name = "ts_spin_window",                .type = REBX_TYPE_POINTER},
+    {.name = "beta",                          .type = REBX_TYPE_DOUBLE},
+    {.name = "tides_primary",                 .type = REBX_TYPE_INT},
+    {.name = "R_tides",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "tctl_k2",                       .type = REBX_TYPE_DOUBLE},
+    {.name = "tctl_tau",                      .type = REBX_TYPE_DOUBLE},
+    {.name = "integrator",                    .type = REBX_TYPE_INT},
+    {.name = "integrator_tolerance",          .type = REBX_TYPE_DOUBLE},
+    {.name = "free_arrays",                   .type = REBX_TYPE_POINTER},
+    {.name = "integrator_workspace",          .type = REBX_TYPE_POINTER},
+    {.name = "free_workspace",                .type = REBX_TYPE_POINTER},
+    {.name = "workspace_memory",              .type = REBX_TYPE_POINTER},
+    {.name = "ias15_keep_state",              .type = REBX_TYPE_INT},
+    {.name = "ias15_state",                   .type = REBX_TYPE_POINTER},
+    {.name = "composite_substeps",            .type = REBX_TYPE_POINTER},
+    {.name = "skip_variational",              .type = REBX_TYPE_INT},
+    {.name = "kick_reuse_accelerations",      .type = REBX_TYPE_INT},
+    {.name = "kick_state",                    .type = REBX_TYPE_POINTER},
+    {.name = "gr_full_workspace",             .type = REBX_TYPE_POINTER},
+    {.name = "gr_workspace",                  .type = REBX_TYPE_POINTER},
+    {.name = "gr_reuse_gravity",              .type = REBX_TYPE_INT},
+    {.name = "gr_warm_start",                 .type = REBX_TYPE_INT},
+    {.name = "gr_tolerance",                  .type = REBX_TYPE_DOUBLE},
+    {.name = "gr_full_opening_angle",         .type = REBX_TYPE_DOUBLE},
+    {.name = "force_scratch",                 .type = REBX_TYPE_POINTER},
+    {.name = "force_constants",               .type = REBX_TYPE_POINTER},
+    {.name = "cull_threshold",                .type = REBX_TYPE_DOUBLE},
+    {.name = "cull_every",                    .type = REBX_TYPE_INT},
+    {.name = "cull_state",                    .type = REBX_TYPE_POINTER},
+    {.name = "min_distance",                  .type = REBX_TYPE_DOUBLE},
+    {.name = "min_distance_from",             .type = REBX_TYPE_UINT32},
+    {.name = "min_distance_orbit",            .type = REBX_TYPE_ORBIT},
+    {.name = "min_distance_target",           .type = REBX_TYPE_INT},
+    {.name = "min_distance_closest",          .type = REBX_TYPE_UINT32},
+    {.name = "min_distance_skip_factor",      .type = REBX_TYPE_DOUBLE},
+    {.name = "min_distance_interpolate",      .type = REBX_TYPE_INT},
+    {.name = "tmd_cache",                     .type = REBX_TYPE_POINTER},
+    {.name = "luminosity",                    .type = REBX_TYPE_DOUBLE},
+    {.name = "ide_position",                  .type = REBX_TYPE_DOUBLE},
+    {.name = "ide_width",                     .type = REBX_TYPE_DOUBLE},
+    {.name = "tIm_flaring_index",             .type = REBX_TYPE_DOUBLE},
+    {.name = "tIm_table_N",                   .type = REBX_TYPE_INT},
+    {.name = "tIm_table_rmin",                .type = REBX_TYPE_DOUBLE},
+    {.name = "tIm_table_rmax",                .type = REBX_TYPE_DOUBLE},
+    {.name = "tIm_tables",                    .type = REBX_TYPE_POINTER},
+    {.name = "tIm_scale_height_1",            .type = REBX_TYPE_DOUBLE},
+    {.name = "tIm_surface_density_1",         .type = REBX_TYPE_DOUBLE},
+    {.name = "tIm_surface_density_exponent",  .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_c",                          .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_body_density",               .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_lstar",                      .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_flag",                       .type = REBX_TYPE_INT},
+    {.name = "ye_rotation_period",            .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_thermal_inertia",            .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_albedo",                     .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_emissivity",                 .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_k",                          .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_stef_boltz",                 .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_spin_axis_x",                .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_spin_axis_y",                .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_spin_axis_z",                .type = REBX_TYPE_DOUBLE},
+    {.name = "ye_index",                      .type = REBX_TYPE_POINTER},
+    {.name = "OmegaMag",                      .type = REBX_TYPE_VEC3D},
+    {.name = "Omega",                         .type = REBX_TYPE_VEC3D},
+    {.name = "k2",                            .type = REBX_TYPE_DOUBLE},
+    {.name = "I",                             .type = REBX_TYPE_DOUBLE},
+    {.name = "tau",                           .type = REBX_TYPE_DOUBLE},
+    {.name = "ode",                           .type = REBX_TYPE_ODE},
+};
+#define REBX_N_DEFAULT_PARAMS ((int)(sizeof(rebx_default_params)/sizeof(rebx_default_params[0])))
+#define REBX_DEFAULT_PARAM_TABLE_SIZE 256   // power of 2, at least twice REBX_N_DEFAULT_PARAMS
+static struct rebx_param* rebx_default_param_table[REBX_DEFAULT_PARAM_TABLE_SIZE];
+static int rebx_default_params_ready = 0;
+
+static void rebx_init_default_params(void){
+#pragma omp critical(rebx_default_params)
+    {
+        if (!rebx_default_params_ready){
+            const uint32_t mask = REBX_DEFAULT_PARAM_TABLE_SIZE - 1;
+            for (int i=0; i<REBX_N_DEFAULT_PARAMS; i++){
+                struct rebx_param* const param = &rebx_default_params[i];
+                param->id = i;
+                uint32_t slot = reb_hash(param->name) & mask;
+                while (rebx_default_param_table[slot] != NULL){
+                    slot = (slot + 1) & mask;
+                }
+                rebx_default_param_table[slot] = param;
+            }
+            rebx_default_params_ready = 1;
+        }
+    }
+}
+
+static struct rebx_param* rebx_get_default_param(const char* const name){
+    const uint32_t mask = REBX_DEFAULT_PARAM_TABLE_SIZE - 1;
+    uint32_t slot = reb_hash(name) & mask;
+    struct rebx_param* param;
+    while ((param = rebx_default_param_table[slot]) != NULL){
+        if (strcmp(param->name, name) == 0){
+            return param;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+struct rebx_param* rebx_get_default_params(struct rebx_extras* const rebx, int* const N){
+    if (!rebx->default_params){
+        *N = 0;
+        return NULL;
+    }
+    *N = REBX_N_DEFAULT_PARAMS;
+    return rebx_default_params;
+}
+
 void rebx_register_default_params(struct rebx_extras* rebx){
-    rebx_register_param(rebx, "c", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "gr_source", REBX_TYPE_INT);
-    rebx_register_param(rebx, "tau_mass", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "force", REBX_TYPE_FORCE);
-    rebx_register_param(rebx, "particle", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "Acentral", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "gammacentral", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "max_iterations", REBX_TYPE_INT);
-    rebx_register_param(rebx, "J2", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "J4", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "R_eq", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "coordinates", REBX_TYPE_INT);
-    rebx_register_param(rebx, "p", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_a", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_e", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_inc", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_omega", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_Omega", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "em_tau_a", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "em_aini", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "em_afin", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "primary", REBX_TYPE_INT);
-    rebx_register_param(rebx, "radiation_source", REBX_TYPE_INT);
-    rebx_register_param(rebx, "kappa", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "kappa_x", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "kappa_y", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "kappa_z", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_kappa", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_kappa_x", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_kappa_y", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau_kappa_z", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "stochastic_force_r", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "stochastic_force_phi", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "stochastic_force_x", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "stochastic_force_y", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "stochastic_force_z", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "beta", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tides_primary", REBX_TYPE_INT);
-    rebx_register_param(rebx, "R_tides", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tctl_k2", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tctl_tau", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "integrator", REBX_TYPE_INT);
-    rebx_register_param(rebx, "free_arrays", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "im_ps_final", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "im_ps_prev", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "im_ps_avg", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "rk2_k2", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "rk4_k2", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "rk4_k3", REBX_TYPE_POINTER);
-    rebx_register_param(rebx, "min_distance", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "min_distance_from", REBX_TYPE_UINT32);
-    rebx_register_param(rebx, "min_distance_orbit", REBX_TYPE_ORBIT);
-    rebx_register_param(rebx, "luminosity", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ide_position", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ide_width", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tIm_flaring_index", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tIm_scale_height_1", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tIm_surface_density_1", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tIm_surface_density_exponent", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_c", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_body_density", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_lstar", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_flag", REBX_TYPE_INT);
-    rebx_register_param(rebx, "ye_rotation_period", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_thermal_inertia", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_albedo", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_emissivity", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_k", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_stef_boltz", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_spin_axis_x", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_spin_axis_y", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ye_spin_axis_z", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "OmegaMag", REBX_TYPE_VEC3D);
-    rebx_register_param(rebx, "Omega", REBX_TYPE_VEC3D);
-    rebx_register_param(rebx, "k2", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "I", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "tau", REBX_TYPE_DOUBLE);
-    rebx_register_param(rebx, "ode", REBX_TYPE_ODE);
+    if (rebx->N_registered_params != 0){ // shared table only goes underneath an empty registry. Register one by one (duplicates give errors)
+        for (int i=0; i<REBX_N_DEFAULT_PARAMS; i++){
+            rebx_register_param(rebx, rebx_default_params[i].name, rebx_default_params[i].type);
+        }
+        return;
+    }
+    rebx_init_default_params();
+    rebx->default_params = 1;
+    rebx->N_registered_params = REBX_N_DEFAULT_PARAMS;
 }
 
 void rebx_register_param(struct rebx_extras* const rebx, const char* name, enum rebx_param_type type){
@@ -146,9 +245,9 @@ void rebx_register_param(struct rebx_extras* const rebx, const char* name, enum
     if (param == NULL){
         return;
     }
-    int success = rebx_add_param(rebx, &rebx->registered_params, param);
+    int success = rebx_add_registered_param(rebx, param);
     if(!success){
-        rebx_free_param(param);
+        rebx_free_param(rebx, param);
     }
 
     return;
@@ -193,12 +292,17 @@ void rebx_detach(struct reb_simulation* sim, struct rebx_extras* rebx){
 }
 
 
+static int rebx_init_registered_effects(void);
+
 void rebx_initialize(struct reb_simulation* sim, struct rebx_extras* rebx){
     rebx->sim = sim; // python checks for rebx->sim = NULL so set 1st
     if (rebx->sim == NULL){
         rebx_error(rebx, "");
         return;
     }
+    // Set up the tables shared by all instances now, so they're only read once the first instance exists (see rebx_clone)
+    rebx_init_default_params();
+    rebx_init_registered_effects();
     sim->extras = rebx;
     rebx->additional_forces = NULL;
     rebx->pre_timestep_modifications=NULL;
@@ -206,6 +310,27 @@ void rebx_initialize(struct reb_simulation* sim, struct rebx_extras* rebx){
     rebx->allocated_forces=NULL;
     rebx->allocated_operators=NULL;
     rebx->registered_params=NULL;
+    rebx->registered_param_table=NULL;
+    rebx->registered_param_table_size=0;
+    rebx->N_registered_params=0;
+    rebx->default_params=0;
+    rebx->param_columns=NULL;
+    rebx->param_columns_dirty=0;
+    rebx->geometries=NULL;
+    rebx->coordinates=NULL;
+    rebx->param_lists=NULL;
+    rebx->geometry_epoch=0;
+    rebx->param_generation=0;
+    rebx->archive_filename=NULL;
+    rebx->archive_auto_interval=0.;
+    rebx->archive_next=0.;
+    rebx->archive_auto_step=0;
+    rebx->archive_next_step=0;
+    rebx->archive_delta=NULL;
+    rebx->profiling=0;
+    rebx->force_names=(struct rebx_name_table){0};
+    rebx->operator_names=(struct rebx_name_table){0};
+    rebx_init_pools(rebx);
 
     sim->free_particle_ap = rebx_free_particle_ap;
     sim->extras_cleanup = rebx_extras_cleanup;
@@ -220,6 +345,209 @@ void rebx_free(struct rebx_extras* rebx){
     free(rebx);
 }
 
+/**********************************************
+ Name tables and the registry of effects
+ *********************************************/
+
+/* Name tables use open addressing (linear probing) keyed on the name, with a load factor <= 1/2. Removing an entry shifts
+ * later entries of its probe sequence back into the hole, so no tombstones are needed. Names are not copied.*/
+
+static struct rebx_name_entry* rebx_name_table_find(const struct rebx_name_table* const table, const char* const name){
+    if (table->size == 0){
+        return NULL;
+    }
+    const uint32_t mask = table->size - 1;
+    uint32_t slot = reb_hash(name) & mask;
+    while (table->entries[slot].name != NULL){ // table never full, so always terminates
+        if (strcmp(table->entries[slot].name, name) == 0){
+            return &table->entries[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+static void rebx_name_table_place(struct rebx_name_entry* const entries, const int size, const struct rebx_name_entry entry){
+    const uint32_t mask = size - 1;
+    uint32_t slot = reb_hash(entry.name) & mask;
+    while (entries[slot].name != NULL){
+        slot = (slot + 1) & mask;
+    }
+    entries[slot] = entry;
+}
+
+static void* rebx_name_table_get(const struct rebx_name_table* const table, const char* const name){
+    const struct rebx_name_entry* const entry = rebx_name_table_find(table, name);
+    return entry == NULL ? NULL : entry->object;
+}
+
+// Stores object under name, replacing any object already stored under it. Returns 0 if memory could not be allocated.
+static int rebx_name_table_set(struct rebx_name_table* const table, const char* const name, void* const object){
+    struct rebx_name_entry* const entry = rebx_name_table_find(table, name);
+    if (entry != NULL){
+        *entry = (struct rebx_name_entry){name, object}; // name has to point into the new object's memory
+        return 1;
+    }
+    if (2*(table->N + 1) > table->size){
+        const int size = table->size ? 2*table->size : 16;
+        struct rebx_name_entry* const entries = calloc(size, sizeof(*entries));
+        if (entries == NULL){
+            return 0;
+        }
+        for (int i=0; i<table->size; i++){
+            if (table->entries[i].name != NULL){
+                rebx_name_table_place(entries, size, table->entries[i]);
+            }
+        }
+        free(table->entries);
+        table->entries = entries;
+        table->size = size;
+    }
+    rebx_name_table_place(table->entries, table->size, (struct rebx_name_entry){name, object});
+    table->N++;
+    return 1;
+}
+
+static void rebx_name_table_remove(struct rebx_name_table* const table, const char* const name){
+    struct rebx_name_entry* const entry = rebx_name_table_find(table, name);
+    if (entry == NULL){
+        return;
+    }
+    const uint32_t mask = table->size - 1;
+    uint32_t hole = entry - table->entries;
+    uint32_t slot = hole;
+    while (table->entries[slot = (slot + 1) & mask].name != NULL){
+        // An entry can fill the hole if the hole lies between its home slot and its current slot
+        const uint32_t home = reb_hash(table->entries[slot].name) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)){
+            table->entries[hole] = table->entries[slot];
+            hole = slot;
+        }
+    }
+    table->entries[hole] = (struct rebx_name_entry){NULL, NULL};
+    table->N--;
+}
+
+static void rebx_name_table_free(struct rebx_name_table* const table){
+    free(table->entries);
+    *table = (struct rebx_name_table){0};
+}
+
+static const struct rebx_registered_effect rebx_builtin_effects[] = {
+    {.name = "gr",                      .update_accelerations = rebx_gr,                        .force_type = REBX_FORCE_VEL},
+    {.name = "central_force",           .update_accelerations = rebx_central_force,             .force_type = REBX_FORCE_POS},
+    {.name = "modify_orbits_forces",    .update_accelerations = rebx_modify_orbits_forces,      .force_type = REBX_FORCE_VEL},
+    {.name = "exponential_migration",   .update_accelerations = rebx_exponential_migration,     .force_type = REBX_FORCE_VEL,
+                                        .update_constants = rebx_exponential_migration_constants},
+    {.name = "gr_full",                 .update_accelerations = rebx_gr_full,                   .force_type = REBX_FORCE_VEL},
+    {.name = "gravitational_harmonics", .update_accelerations = rebx_gravitational_harmonics,   .force_type = REBX_FORCE_POS,
+                                        .update_accelerations_batch = rebx_gravitational_harmonics_batch},
+    {.name = "gr_potential",            .update_accelerations = rebx_gr_potential,              .force_type = REBX_FORCE_POS,
+                                        .update_accelerations_batch = rebx_gr_potential_batch},
+    {.name = "radiation_forces",        .update_accelerations = rebx_radiation_forces,          .force_type = REBX_FORCE_VEL},
+    {.name = "stochastic_forces",       .update_accelerations = rebx_stochastic_forces,         .force_type = REBX_FORCE_VEL},
+    {.name = "tides_constant_time_lag", .update_accelerations = rebx_tides_constant_time_lag,   .force_type = REBX_FORCE_VEL,
+                                        .update_accelerations_batch = rebx_tides_constant_time_lag_batch},
+    {.name = "type_I_migration",        .update_accelerations = rebx_modify_orbits_with_type_I_migration, .force_type = REBX_FORCE_VEL,
+                                        .update_constants = rebx_modify_orbits_with_type_I_migration_constants},
+    {.name = "tides_spin",              .update_accelerations = rebx_tides_spin,                .force_type = REBX_FORCE_VEL},
+    {.name = "yarkovsky_effect",        .update_accelerations = rebx_yarkovsky_effect,          .force_type = REBX_FORCE_VEL},
+    {.name = "modify_mass",             .step_function = rebx_modify_mass,          .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "integrate_force",         .step_function = rebx_integrate_force,      .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "drift",                   .step_function = rebx_drift_step,           .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "kick",                    .step_function = rebx_kick_step,            .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "kepler",                  .step_function = rebx_kepler_step,          .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "jump",                    .step_function = rebx_jump_step,            .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "interaction",             .step_function = rebx_interaction_step,     .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "ias15",                   .step_function = rebx_ias15_step,           .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "composite",               .step_function = rebx_composite_step,       .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "modify_orbits_direct",    .step_function = rebx_modify_orbits_direct, .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "tides_secular",           .step_function = rebx_tides_secular,        .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "param_driver",            .step_function = rebx_param_driver,         .operator_type = REBX_OPERATOR_UPDATER},
+    {.name = "track_min_distance",      .step_function = rebx_track_min_distance,   .operator_type = REBX_OPERATOR_RECORDER},
+};
+
+// Shared by all rebx_extras instances. Filled with the built-in effects on first use. Custom effects are never removed.
+static struct rebx_name_table rebx_effects;
+
+static int rebx_init_registered_effects(void){
+    int success = 1;
+#pragma omp critical(rebx_effects)
+    {
+        if (rebx_effects.size == 0){
+            for (size_t i=0; i<sizeof(rebx_builtin_effects)/sizeof(rebx_builtin_effects[0]); i++){
+                if (!rebx_name_table_set(&rebx_effects, rebx_builtin_effects[i].name, (void*)&rebx_builtin_effects[i])){
+                    rebx_name_table_free(&rebx_effects); // try again next time
+                    success = 0;
+                    break;
+                }
+            }
+        }
+    }
+    return success;
+}
+
+const struct rebx_registered_effect* rebx_get_registered_effect(const char* const name){
+    if (!rebx_init_registered_effects()){
+        return NULL;
+    }
+    return rebx_name_table_get(&rebx_effects, name);
+}
+
+int rebx_register_effect(struct rebx_extras* const rebx, const struct rebx_registered_effect* const effect){
+    if (effect == NULL || effect->name == NULL){
+        rebx_error(rebx, "REBOUNDx Error: Passed NULL effect or effect name to rebx_register_effect.\n");
+        return 0;
+    }
+    const int is_force = effect->update_accelerations != NULL && effect->force_type != REBX_FORCE_NONE;
+    const int is_operator = effect->step_function != NULL && effect->operator_type != REBX_OPERATOR_NONE;
+    if (is_force == is_operator){
+        char str[300];
+        sprintf(str, "REBOUNDx Error: Effect '%s' must either set update_accelerations and force_type (forces), or step_function and operator_type (operators).\n", effect->name);
+        rebx_error(rebx, str);
+        return 0;
+    }
+    if (rebx_get_registered_effect(effect->name) != NULL){
+        char str[300];
+        sprintf(str, "REBOUNDx Error: Effect '%s' is already registered.\n", effect->name);
+        rebx_error(rebx, str);
+        return 0;
+    }
+
+    if (rebx_effects.size == 0){ // built-in effects could not be registered
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        return 0;
+    }
+
+    struct rebx_registered_effect* const registered = rebx_malloc(rebx, sizeof(*registered));
+    char* const name = rebx_malloc(rebx, strlen(effect->name) + 1); // +1 for \0 at end
+    if (registered == NULL || name == NULL){
+        free(registered);
+        free(name);
+        return 0;
+    }
+    strcpy(name, effect->name);
+    *registered = *effect;
+    registered->name = name;
+    if (is_force){
+        registered->step_function = NULL;
+        registered->operator_type = REBX_OPERATOR_NONE;
+    }
+    else{
+        registered->update_accelerations = NULL;
+        registered->update_constants = NULL;
+        registered->update_accelerations_batch = NULL;
+        registered->force_type = REBX_FORCE_NONE;
+    }
+    if (!rebx_name_table_set(&rebx_effects, registered->name, registered)){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        free(registered);
+        free(name);
+        return 0;
+    }
+    return 1;
+}
+
 /**********************************************
  User Interface for adding forces and operators
  *********************************************/
@@ -237,6 +565,9 @@ struct rebx_force* rebx_create_force(struct rebx_extras* const rebx, const char*
     force->sim = rebx->sim;
     force->force_type = REBX_FORCE_NONE;
     force->update_accelerations = NULL;
+    force->update_constants = NULL;
+    force->profile = (struct rebx_profile){0};
+    force->skip = NULL;
     force->name = NULL;
     if(name != NULL)
     {
@@ -258,75 +589,30 @@ struct rebx_force* rebx_create_force(struct rebx_extras* const rebx, const char*
     }
     node->object = force;
     rebx_add_node(&rebx->allocated_forces, node);
+    if (force->name != NULL && !rebx_name_table_set(&rebx->force_names, force->name, force)){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        rebx_remove_force(rebx, force);
+        return NULL;
+    }
 
     return force;
 }
 
 struct rebx_force* rebx_load_force(struct rebx_extras* const rebx, const char* name){
-    struct rebx_force* force = rebx_create_force(rebx, name);
-    if (force == NULL){
-        return NULL;
-    }
-    if(strcmp(name, "gr") == 0){
-        force->update_accelerations = rebx_gr;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "central_force") == 0){
-        force->update_accelerations = rebx_central_force;
-        force->force_type = REBX_FORCE_POS;
-    }
-    else if (strcmp(name, "modify_orbits_forces") == 0){
-        force->update_accelerations = rebx_modify_orbits_forces;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "exponential_migration") == 0){
-        force->update_accelerations = rebx_exponential_migration;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "gr_full") == 0){
-        force->update_accelerations = rebx_gr_full;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "gravitational_harmonics") == 0){
-        force->update_accelerations = rebx_gravitational_harmonics;
-        force->force_type = REBX_FORCE_POS;
-    }
-    else if (strcmp(name, "gr_potential") == 0){
-        force->update_accelerations = rebx_gr_potential;
-        force->force_type = REBX_FORCE_POS;
-    }
-    else if (strcmp(name, "radiation_forces") == 0){
-        force->update_accelerations = rebx_radiation_forces;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "stochastic_forces") == 0){
-        force->update_accelerations = rebx_stochastic_forces;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "tides_constant_time_lag") == 0){
-        force->update_accelerations = rebx_tides_constant_time_lag;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "type_I_migration") == 0){
-        force->update_accelerations = rebx_modify_orbits_with_type_I_migration;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "tides_spin") == 0){
-        force->update_accelerations = rebx_tides_spin;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else if (strcmp(name, "yarkovsky_effect") == 0){
-        force->update_accelerations = rebx_yarkovsky_effect;
-        force->force_type = REBX_FORCE_VEL;
-    }
-    else{
+    const struct rebx_registered_effect* const effect = rebx_get_registered_effect(name);
+    if (effect == NULL || effect->update_accelerations == NULL){
         char str[300];
         sprintf(str, "REBOUNDx error: Force '%s' not found in REBOUNDx library.\n", name);
         rebx_error(rebx, str);
-        rebx_remove_force(rebx, force); // Not free_force. Must remove from allocated_forces
         return NULL;
     }
-
+    struct rebx_force* force = rebx_create_force(rebx, name);
+    if (force == NULL){
+        return NULL;
+    }
+    force->update_accelerations = effect->update_accelerations;
+    force->update_constants = effect->update_constants;
+    force->force_type = effect->force_type;
     return force;
 }
 
@@ -343,11 +629,12 @@ struct rebx_operator* rebx_create_operator(struct rebx_extras* const rebx, const
     operator->sim = rebx->sim;
     operator->operator_type = REBX_OPERATOR_NONE;
     operator->step_function = NULL;
+    operator->profile = (struct rebx_profile){0};
     operator->name = NULL;
     if(name != NULL){
         operator->name = rebx_malloc(rebx, strlen(name) + 1); // +1 for \0 at end
         if (operator->name == NULL){
-            rebx_free_operator(operator);
+            rebx_free_operator(rebx, operator);
             return NULL;
         }
         else{
@@ -358,67 +645,34 @@ struct rebx_operator* rebx_create_operator(struct rebx_extras* const rebx, const
     // Add operator to allocated_operators list for later freeing
     struct rebx_node* node = rebx_create_node(rebx);
     if (node == NULL){
-        rebx_free_operator(operator);
+        rebx_free_operator(rebx, operator);
         return NULL;
     }
     node->object = operator;
     rebx_add_node(&rebx->allocated_operators, node);
+    if (operator->name != NULL && !rebx_name_table_set(&rebx->operator_names, operator->name, operator)){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        rebx_remove_operator(rebx, operator);
+        return NULL;
+    }
 
     return operator;
 }
 
 struct rebx_operator* rebx_load_operator(struct rebx_extras* const rebx, const char* name){
-    struct rebx_operator* operator = rebx_create_operator(rebx, name);
-    if (operator == NULL){
-        return NULL;
-    }
-    if (strcmp(name, "modify_mass") == 0){
-        operator->step_function = rebx_modify_mass;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "integrate_force") == 0){
-        operator->step_function = rebx_integrate_force;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "drift") == 0){
-        operator->step_function = rebx_drift_step;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "kick") == 0){
-        operator->step_function = rebx_kick_step;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "kepler") == 0){
-        operator->step_function = rebx_kepler_step;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "jump") == 0){
-        operator->step_function = rebx_jump_step;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "interaction") == 0){
-        operator->step_function = rebx_interaction_step;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "ias15") == 0){
-        operator->step_function = rebx_ias15_step;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "modify_orbits_direct") == 0){
-        operator->step_function = rebx_modify_orbits_direct;
-        operator->operator_type = REBX_OPERATOR_UPDATER;
-    }
-    else if (strcmp(name, "track_min_distance") == 0){
-        operator->step_function = rebx_track_min_distance;
-        operator->operator_type = REBX_OPERATOR_RECORDER;
-    }
-    else{
+    const struct rebx_registered_effect* const effect = rebx_get_registered_effect(name);
+    if (effect == NULL || effect->step_function == NULL){
         char str[300];
         sprintf(str, "REBOUNDx error: Operator '%s' not found in REBOUNDx library.\n", name);
         rebx_error(rebx, str);
-        rebx_remove_operator(rebx, operator); // Not free_op. Must rm from allocated_forces
         return NULL;
     }
+    struct rebx_operator* operator = rebx_create_operator(rebx, name);
+    if (operator == NULL){
+        return NULL;
+    }
+    operator->step_function = effect->step_function;
+    operator->operator_type = effect->operator_type;
     return operator;
 }
 
@@ -463,6 +717,10 @@ int rebx_add_force(struct rebx_extras* rebx, struct rebx_force* force){
 }
 
 int rebx_add_operator_step(struct rebx_extras* rebx, struct rebx_operator* operator, const double dt_fraction, enum rebx_timing timing){
+    return rebx_add_operator_step_every(rebx, operator, dt_fraction, timing, 1, 0);
+}
+
+int rebx_add_operator_step_every(struct rebx_extras* rebx, struct rebx_operator* operator, const double dt_fraction, enum rebx_timing timing, const int every, const int phase){
     if (rebx->sim == NULL){
         rebx_error(rebx, ""); // rebx_error gives meaningful err
         return 0;
@@ -481,12 +739,19 @@ int rebx_add_operator_step(struct rebx_extras* rebx, struct rebx_operator* opera
         return 0;
     }
 
+    if (every < 1){
+        rebx_error(rebx, "REBOUNDx error: Operator steps must be applied every 1 or more timesteps.\n");
+        return 0;
+    }
+
     struct rebx_step* step = rebx_malloc(rebx, sizeof(*step));
     if(step == NULL){
         return 0;
     }
     step->operator = operator;
     step->dt_fraction = dt_fraction;
+    step->every = every;
+    step->phase = (phase % every + every) % every;
 
     struct rebx_node* node = rebx_create_node(rebx);
     if (node == NULL){
@@ -514,6 +779,10 @@ int rebx_add_operator_step(struct rebx_extras* rebx, struct rebx_operator* opera
 }
 
 int rebx_add_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
+    return rebx_add_operator_every(rebx, operator, 1, 0);
+}
+
+int rebx_add_operator_every(struct rebx_extras* rebx, struct rebx_operator* operator, const int every, const int phase){
     if (rebx->sim == NULL){
         rebx_error(rebx, ""); // rebx_error gives meaningful err
         return 0;
@@ -528,7 +797,7 @@ int rebx_add_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
     if (operator->operator_type == REBX_OPERATOR_RECORDER){
         // Doesn't alter state. Add once after timestep.
         dt_fraction = 1.;
-        int success = rebx_add_operator_step(rebx, operator, dt_fraction, REBX_TIMING_POST);
+        int success = rebx_add_operator_step_every(rebx, operator, dt_fraction, REBX_TIMING_POST, every, phase);
         return success;
     }
 
@@ -537,14 +806,14 @@ int rebx_add_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
         // don't add pre-timestep b/c don't know what IAS will choose as dt
         {
             dt_fraction = 1.;
-            int success = rebx_add_operator_step(rebx, operator, dt_fraction, REBX_TIMING_POST);
+            int success = rebx_add_operator_step_every(rebx, operator, dt_fraction, REBX_TIMING_POST, every, phase);
             return success;
         }
         case REB_INTEGRATOR_WHFAST: // half step pre and post
         {
             dt_fraction = 1./2.;
-            int success1 = rebx_add_operator_step(rebx, operator, dt_fraction, REBX_TIMING_PRE);
-            int success2 = rebx_add_operator_step(rebx, operator, dt_fraction, REBX_TIMING_POST);
+            int success1 = rebx_add_operator_step_every(rebx, operator, dt_fraction, REBX_TIMING_PRE, every, phase);
+            int success2 = rebx_add_operator_step_every(rebx, operator, dt_fraction, REBX_TIMING_POST, every, phase);
             return (success1 && success2);
         }
         case REB_INTEGRATOR_MERCURIUS: // half step pre and post
@@ -558,6 +827,773 @@ int rebx_add_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
     return 0; // didn't reach a successful outcome
 }
 
+/*****************************************************************
+ Cloning instances for ensembles
+ *****************************************************************/
+
+/* A clone shares no mutable state with its source or with other clones, so each can be integrated on its own thread.
+ * Param values are copied, and force params point to the clone's copy of the force. Pointers (workspaces, caches
+ * and user structs) aren't copied, like in binaries. Effects rebuild their workspaces the first time they're called.*/
+
+// Fills objects with the objects on a list in the order they were added (nodes are added at the head). Returns -1 if out of memory
+static int rebx_list_objects(struct rebx_node* const head, void*** const objects){
+    int N = 0;
+    for (struct rebx_node* node = head; node != NULL; node = node->next){
+        N++;
+    }
+    *objects = malloc(N*sizeof(**objects) + 1); // +1 so empty lists don't give NULL
+    if (*objects == NULL){
+        return -1;
+    }
+    int i = N;
+    for (struct rebx_node* node = head; node != NULL; node = node->next){
+        (*objects)[--i] = node->object;
+    }
+    return N;
+}
+
+static const char* rebx_registered_param_name(struct rebx_extras* const rebx, const int id){
+    if (rebx->default_params && id < REBX_N_DEFAULT_PARAMS){
+        return rebx_default_params[id].name;
+    }
+    for (struct rebx_node* node = rebx->registered_params; node != NULL; node = node->next){
+        struct rebx_param* const param = node->object;
+        if (param->id == id){
+            return param->name;
+        }
+    }
+    return NULL;
+}
+
+// forces[i] is the clone of source_forces[i]
+static int rebx_clone_ap(struct rebx_extras* const rebx, struct rebx_node** const apptr, struct rebx_node* const source_ap, void** const source_forces, struct rebx_force** const forces, const int N_forces){
+    void** params;
+    const int N = rebx_list_objects(source_ap, &params);
+    if (N < 0){
+        return 0;
+    }
+    for (int i=0; i<N; i++){ // in the order they were added, so lists match the source's
+        const struct rebx_param* const param = params[i];
+        if (param->value == NULL || rebx_get_registered_param(rebx, param->name) == NULL){ // unregistered names only come from binaries with custom params
+            continue;
+        }
+        switch(param->type){
+            case REBX_TYPE_DOUBLE:
+                rebx_set_param_double(rebx, apptr, param->name, *(double*)param->value);
+                break;
+            case REBX_TYPE_INT:
+                rebx_set_param_int(rebx, apptr, param->name, *(int*)param->value);
+                break;
+            case REBX_TYPE_UINT32:
+                rebx_set_param_uint32(rebx, apptr, param->name, *(uint32_t*)param->value);
+                break;
+            case REBX_TYPE_VEC3D:
+                rebx_set_param_vec3d(rebx, apptr, param->name, *(struct reb_vec3d*)param->value);
+                break;
+            case REBX_TYPE_FORCE:
+                for (int j=0; j<N_forces; j++){
+                    if (source_forces[j] == param->value){
+                        rebx_set_param_pointer(rebx, apptr, param->name, forces[j]);
+                        break;
+                    }
+                }
+                break;
+            default: // pointers are owned by the source
+                break;
+        }
+    }
+    free(params);
+    return 1;
+}
+
+static int rebx_clone_steps(struct rebx_extras* const rebx, struct rebx_node* const source_steps, const enum rebx_timing timing, void** const source_operators, struct rebx_operator** const operators, const int N_operators){
+    void** steps;
+    const int N = rebx_list_objects(source_steps, &steps);
+    if (N < 0){
+        return 0;
+    }
+    int success = 1;
+    for (int i=0; i<N && success; i++){
+        const struct rebx_step* const step = steps[i];
+        for (int j=0; j<N_operators; j++){
+            if (source_operators[j] == step->operator){
+                success = rebx_add_operator_step_every(rebx, operators[j], step->dt_fraction, timing, step->every, step->phase);
+                break;
+            }
+        }
+    }
+    free(steps);
+    return success;
+}
+
+static int rebx_clone_registered_params(struct rebx_extras* const rebx, struct rebx_extras* const source){
+    void** params;
+    const int N = rebx_list_objects(source->registered_params, &params);
+    if (N < 0){
+        return 0;
+    }
+    for (int i=0; i<N; i++){ // in the order they were registered, so ids match the source's
+        const struct rebx_param* const param = params[i];
+        if (rebx_get_type(rebx, param->name) == REBX_TYPE_NONE){
+            rebx_register_param(rebx, param->name, param->type);
+        }
+    }
+    free(params);
+    return 1;
+}
+
+// Creates all forces and operators before copying their params, since force params can point to any of them
+static int rebx_clone_effects(struct rebx_extras* const rebx, struct rebx_extras* const source, void** const source_forces, struct rebx_force** const forces, const int N_forces, void** const source_operators, struct rebx_operator** const operators, const int N_operators){
+    for (int i=0; i<N_forces; i++){
+        const struct rebx_force* const force = source_forces[i];
+        forces[i] = rebx_create_force(rebx, force->name);
+        if (forces[i] == NULL){
+            return 0;
+        }
+        forces[i]->force_type = force->force_type;
+        forces[i]->update_accelerations = force->update_accelerations;
+        forces[i]->update_constants = force->update_constants;
+    }
+    for (int i=0; i<N_operators; i++){
+        const struct rebx_operator* const operator = source_operators[i];
+        operators[i] = rebx_create_operator(rebx, operator->name);
+        if (operators[i] == NULL){
+            return 0;
+        }
+        operators[i]->operator_type = operator->operator_type;
+        operators[i]->step_function = operator->step_function;
+    }
+    for (int i=0; i<N_forces; i++){
+        if (!rebx_clone_ap(rebx, &forces[i]->ap, ((struct rebx_force*)source_forces[i])->ap, source_forces, forces, N_forces)){
+            return 0;
+        }
+    }
+    for (int i=0; i<N_operators; i++){
+        if (!rebx_clone_ap(rebx, &operators[i]->ap, ((struct rebx_operator*)source_operators[i])->ap, source_forces, forces, N_forces)){
+            return 0;
+        }
+        // The series of a param_driver belong to the operator, so the clone gets its own copies
+        const struct rebx_param_driver* const driver = rebx_get_param(source, ((struct rebx_operator*)source_operators[i])->ap, "pd_bindings");
+        for (int k=0; driver != NULL && k<driver->N; k++){
+            const struct rebx_param_driver_binding* const b = &driver->bindings[k];
+            if (b->force == NULL){
+                const int particle_index = rebx_param_driver_particle_index(source->sim, b);
+                if (particle_index < 0 || particle_index >= rebx->sim->N){ // skipped when stepping anyway
+                    continue;
+                }
+                if (!rebx_drive_particle_param(rebx, operators[i], particle_index, b->name, &b->interpolator, 0)){
+                    return 0;
+                }
+                continue;
+            }
+            for (int j=0; j<N_forces; j++){
+                if (source_forces[j] == b->force){
+                    if (!rebx_drive_force_param(rebx, operators[i], forces[j], b->name, &b->interpolator, 0)){
+                        return 0;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    void** added;
+    const int N_added = rebx_list_objects(source->additional_forces, &added);
+    if (N_added < 0){
+        return 0;
+    }
+    for (int i=0; i<N_added; i++){
+        for (int j=0; j<N_forces; j++){
+            if (source_forces[j] == added[i]){
+                rebx_add_force(rebx, forces[j]);
+                break;
+            }
+        }
+    }
+    free(added);
+    return rebx_clone_steps(rebx, source->pre_timestep_modifications, REBX_TIMING_PRE, source_operators, operators, N_operators)
+        && rebx_clone_steps(rebx, source->post_timestep_modifications, REBX_TIMING_POST, source_operators, operators, N_operators);
+}
+
+static int rebx_clone_particles(struct rebx_extras* const rebx, struct rebx_extras* const source, void** const source_forces, struct rebx_force** const forces, const int N_forces){
+    struct reb_simulation* const sim = rebx->sim;
+    // Particles copied from the source's simulation (e.g. with reb_add) still point to the source's params
+    for (int i=0; i<sim->N; i++){
+        sim->particles[i].ap = NULL;
+    }
+    const int N = sim->N < source->sim->N ? sim->N : source->sim->N;
+    for (int i=0; i<N; i++){
+        if (!rebx_clone_ap(rebx, (struct rebx_node**)&sim->particles[i].ap, source->sim->particles[i].ap, source_forces, forces, N_forces)){
+            return 0;
+        }
+    }
+    for (struct rebx_node* node = source->param_columns; node != NULL; node = node->next){
+        const struct rebx_param_column* const column = node->object;
+        const char* const name = rebx_registered_param_name(source, column->id);
+        if (name != NULL && !rebx_add_param_column(rebx, name)){
+            return 0;
+        }
+    }
+    // The spin ODE of tides_spin belongs to the simulation, so the clone needs its own
+    for (int i=0; i<N_forces; i++){
+        if (rebx_get_param(source, ((struct rebx_force*)source_forces[i])->ap, "ode") != NULL){
+            rebx_spin_initialize_ode(rebx, forces[i]);
+        }
+    }
+    return 1;
+}
+
+int rebx_init_extras_from_clone(struct rebx_extras* const rebx, struct rebx_extras* const source){
+    struct reb_simulation* const sim = rebx->sim;
+    if (sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return 0;
+    }
+    if (source->sim == NULL){
+        rebx_error(source, "");
+        return 0;
+    }
+    if (source->sim == sim){
+        reb_error(sim, "REBOUNDx Error: Can't clone a REBOUNDx extras instance onto the simulation it's attached to. Pass a different simulation to rebx_clone.\n");
+        return 0;
+    }
+    rebx_register_default_params(rebx);
+    rebx->profiling = source->profiling;
+
+    void** source_forces;
+    void** source_operators;
+    const int N_forces = rebx_list_objects(source->allocated_forces, &source_forces);
+    const int N_operators = rebx_list_objects(source->allocated_operators, &source_operators);
+    struct rebx_force** forces = N_forces >= 0 ? malloc(N_forces*sizeof(*forces) + 1) : NULL;
+    struct rebx_operator** operators = N_operators >= 0 ? malloc(N_operators*sizeof(*operators) + 1) : NULL;
+    int success = 0;
+    if (forces != NULL && operators != NULL){
+        success = rebx_clone_registered_params(rebx, source)
+               && rebx_clone_effects(rebx, source, source_forces, forces, N_forces, source_operators, operators, N_operators)
+               && rebx_clone_particles(rebx, source, source_forces, forces, N_forces);
+    }
+    free(source_forces); // NULL if rebx_list_objects failed
+    free(source_operators);
+    free(forces);
+    free(operators);
+    if (!success){
+        rebx_error(rebx, "REBOUNDx Error: Could not clone REBOUNDx extras instance.\n");
+    }
+    return success;
+}
+
+struct rebx_extras* rebx_clone(struct rebx_extras* const source, struct reb_simulation* const sim){
+    if (sim == NULL){
+        fprintf(stderr, "REBOUNDx Error: Simulation pointer passed to rebx_clone was NULL.\n");
+        return NULL;
+    }
+    if (sim == source->sim){ // check before attaching to sim, which would replace the source
+        reb_error(sim, "REBOUNDx Error: Can't clone a REBOUNDx extras instance onto the simulation it's attached to. Pass a different simulation to rebx_clone.\n");
+        return NULL;
+    }
+    struct rebx_extras* rebx = malloc(sizeof(*rebx));
+    if (rebx == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory.\n");
+        return NULL;
+    }
+    rebx_initialize(sim, rebx);
+    if (!rebx_init_extras_from_clone(rebx, source)){
+        rebx_free(rebx);
+        return NULL;
+    }
+    return rebx;
+}
+
+/*****************************************************************
+ Columnar storage for per-particle params
+ *****************************************************************/
+
+/* A column holds the values of one double param for all particles in a contiguous array indexed like sim->particles.
+ * The rebx_params on the particles' ap lists stay, but their value pointers point into the column (in_column=1).
+ * When the number of particles changes (or particles are removed, see rebx_free_particle_ap), the column is rebuilt
+ * by walking the particles' lists, so values follow their particles.*/
+
+static struct rebx_param_column* rebx_find_param_column(struct rebx_extras* const rebx, const int id){
+    struct rebx_node* current = rebx->param_columns;
+    while(current != NULL){
+        struct rebx_param_column* column = current->object;
+        if (column->id == id){
+            return column;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+static int rebx_build_param_column(struct rebx_extras* const rebx, struct rebx_param_column* const column){
+    struct reb_simulation* const sim = rebx->sim;
+    const int N = sim->N;
+    double* values = calloc(N+1, sizeof(*values)); // +1 so we never malloc 0 bytes
+    uint32_t* present = calloc(N/32+1, sizeof(*present));
+    if (values == NULL || present == NULL){
+        free(values);
+        free(present);
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        return 0;
+    }
+    for (int i=0; i<N; i++){
+        struct rebx_param* param = rebx_get_param_struct_by_id(rebx, sim->particles[i].ap, column->id);
+        if (param == NULL || param->value == NULL){
+            continue;
+        }
+        values[i] = *(double*)param->value;
+        param->value = &values[i];
+        param->in_column = 1;
+        present[i >> 5] |= UINT32_C(1) << (i & 31);
+    }
+    free(column->values);
+    free(column->present);
+    rebx->param_generation++; // values moved
+    column->values = values;
+    column->present = present;
+    column->N = N;
+    return 1;
+}
+
+void rebx_sync_param_columns(struct rebx_extras* const rebx){
+    if (rebx->sim == NULL){
+        return;
+    }
+    struct rebx_node* current = rebx->param_columns;
+    while(current != NULL){
+        struct rebx_param_column* column = current->object;
+        if (rebx->param_columns_dirty || column->N != rebx->sim->N){
+            rebx_build_param_column(rebx, column);
+        }
+        current = current->next;
+    }
+    rebx->param_columns_dirty = 0;
+}
+
+// Returns the column slot for param if apptr is the ap of a particle in the sim and param has a column. NULL otherwise.
+static double* rebx_param_column_slot(struct rebx_extras* const rebx, struct rebx_node** apptr, struct rebx_param* const param){
+    if (rebx->param_columns == NULL || rebx->sim == NULL || rebx->sim->N == 0){
+        return NULL;
+    }
+    struct rebx_param_column* column = rebx_find_param_column(rebx, param->id);
+    if (column == NULL){
+        return NULL;
+    }
+    struct reb_simulation* const sim = rebx->sim;
+    const uintptr_t offset = (uintptr_t)apptr - (uintptr_t)&sim->particles[0].ap; // wraps to huge value if apptr is below the array
+    const int i = offset/sizeof(struct reb_particle);
+    if (offset % sizeof(struct reb_particle) != 0 || offset/sizeof(struct reb_particle) >= (uintptr_t)sim->N){
+        return NULL; // not a particle's ap (e.g. a force or operator's)
+    }
+    rebx_sync_param_columns(rebx);
+    param->in_column = 1;
+    column->present[i >> 5] |= UINT32_C(1) << (i & 31);
+    return &column->values[i];
+}
+
+int rebx_add_param_column(struct rebx_extras* const rebx, const char* const param_name){
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return 0;
+    }
+    struct rebx_param* reg_param = rebx_get_registered_param(rebx, param_name);
+    if (reg_param == NULL || reg_param->type != REBX_TYPE_DOUBLE){
+        char str[300];
+        sprintf(str, "REBOUNDx Error: Parameter '%s' passed to rebx_add_param_column must be registered with type REBX_TYPE_DOUBLE.\n", param_name);
+        rebx_error(rebx, str);
+        return 0;
+    }
+    if (rebx_find_param_column(rebx, reg_param->id) != NULL){
+        return 1; // already stored as a column
+    }
+    struct rebx_param_column* column = rebx_malloc(rebx, sizeof(*column));
+    if (column == NULL){
+        return 0;
+    }
+    column->id = reg_param->id;
+    column->N = 0;
+    column->values = NULL;
+    column->present = NULL;
+    if (!rebx_build_param_column(rebx, column)){
+        free(column);
+        return 0;
+    }
+    struct rebx_node* node = rebx_create_node(rebx);
+    if (node == NULL){
+        free(column->values);
+        free(column->present);
+        free(column);
+        return 0;
+    }
+    node->object = column;
+    rebx_add_node(&rebx->param_columns, node);
+    return 1;
+}
+
+struct rebx_param_column* rebx_get_param_column(struct rebx_extras* const rebx, const int id){
+    struct rebx_param_column* column = rebx_find_param_column(rebx, id);
+    if (column != NULL){
+        rebx_sync_param_columns(rebx);
+    }
+    return column;
+}
+
+void rebx_free_param_columns(struct rebx_extras* const rebx){
+    struct rebx_node* current = rebx->param_columns;
+    struct rebx_node* next;
+    while (current != NULL){
+        next = current->next;
+        struct rebx_param_column* column = current->object;
+        free(column->values);
+        free(column->present);
+        free(column);
+        free(current);
+        current = next;
+    }
+    rebx->param_columns = NULL;
+}
+
+/*****************************************************************
+ Separations shared between forces
+ *****************************************************************/
+
+/* Forces only update accelerations, so within one call to rebx_additional_forces the separations from a given source
+ * are the same for every force. rebx->geometry_epoch is odd while rebx_additional_forces runs and is incremented before
+ * and after, so a geometry filled during the current pass for the same particle array is reused, and anything else is
+ * recalculated. */
+
+static int rebx_grow_geometry(struct rebx_geometry* const g, const int N){
+    double* block = malloc(9*(N+1)*sizeof(*block)); // +1 so we never malloc 0 bytes
+    if (block == NULL){
+        return 0;
+    }
+    free(g->dx);
+    g->dx = block;
+    g->dy = block + (N+1);
+    g->dz = block + 2*(N+1);
+    g->dvx = block + 3*(N+1);
+    g->dvy = block + 4*(N+1);
+    g->dvz = block + 5*(N+1);
+    g->r2 = block + 6*(N+1);
+    g->r = block + 7*(N+1);
+    g->rdot = block + 8*(N+1);
+    g->N_allocated = N;
+    return 1;
+}
+
+const struct rebx_geometry* rebx_get_geometry(struct rebx_extras* const rebx, const struct reb_particle* const particles, const int N, const int source_index){
+    struct rebx_geometry* g = NULL;
+    struct rebx_node* current = rebx->geometries;
+    while(current != NULL){
+        struct rebx_geometry* candidate = current->object;
+        if (candidate->source_index == source_index){
+            g = candidate;
+            break;
+        }
+        current = current->next;
+    }
+    if (g == NULL){
+        g = rebx_malloc(rebx, sizeof(*g));
+        if (g == NULL){
+            return NULL;
+        }
+        struct rebx_node* node = rebx_create_node(rebx);
+        if (node == NULL){
+            free(g);
+            return NULL;
+        }
+        g->source_index = source_index;
+        g->N = 0;
+        g->N_allocated = -1;
+        g->epoch = 0; // never odd, so never matches a pass
+        g->particles = NULL;
+        g->dx = NULL;
+        node->object = g;
+        rebx_add_node(&rebx->geometries, node);
+    }
+    else if ((rebx->geometry_epoch & 1) && g->epoch == rebx->geometry_epoch && g->particles == particles && g->N == N){
+        return g;
+    }
+
+    if (N > g->N_allocated && !rebx_grow_geometry(g, N)){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        return NULL;
+    }
+    const struct reb_particle source = particles[source_index];
+#pragma omp parallel for schedule(guided)
+    for (int i=0; i<N; i++){
+        const struct reb_particle p = particles[i];
+        const double dx = p.x - source.x;
+        const double dy = p.y - source.y;
+        const double dz = p.z - source.z;
+        const double dvx = p.vx - source.vx;
+        const double dvy = p.vy - source.vy;
+        const double dvz = p.vz - source.vz;
+        const double r2 = dx*dx + dy*dy + dz*dz;
+        const double r = sqrt(r2);
+        g->dx[i] = dx;
+        g->dy[i] = dy;
+        g->dz[i] = dz;
+        g->dvx[i] = dvx;
+        g->dvy[i] = dvy;
+        g->dvz[i] = dvz;
+        g->r2[i] = r2;
+        g->r[i] = r;
+        g->rdot[i] = (dx*dvx + dy*dvy + dz*dvz)/r;
+    }
+    g->N = N;
+    g->particles = particles;
+    g->epoch = rebx->geometry_epoch;
+    return g;
+}
+
+void rebx_free_geometries(struct rebx_extras* const rebx){
+    struct rebx_node* current = rebx->geometries;
+    struct rebx_node* next;
+    while (current != NULL){
+        next = current->next;
+        struct rebx_geometry* g = current->object;
+        free(g->dx);
+        free(g);
+        free(current);
+        current = next;
+    }
+    rebx->geometries = NULL;
+}
+
+/*****************************************************************
+ Coordinates shared between forces
+ *****************************************************************/
+
+/* Like geometries, coordinates filled during the current pass of rebx_additional_forces for the same particle array are
+ * reused, so forces working in Jacobi, barycentric or particle-centered coordinates don't each transform the particles.*/
+
+static int rebx_grow_coordinates(struct rebx_coordinates* const c, const int N){
+    struct reb_particle* ps = malloc(2*(N+1)*sizeof(*ps)); // +1 so we never malloc 0 bytes
+    double* m_j = malloc((N+1)*sizeof(*m_j));
+    if (ps == NULL || m_j == NULL){
+        free(ps);
+        free(m_j);
+        return 0;
+    }
+    free(c->ps);
+    free(c->m_j);
+    c->ps = ps;
+    c->coms = ps + (N+1);
+    c->m_j = m_j;
+    c->N_allocated = N;
+    return 1;
+}
+
+static void rebx_set_relative_posvel(struct reb_particle* const p, const struct reb_particle com){
+    p->x -= com.x;
+    p->y -= com.y;
+    p->z -= com.z;
+    p->vx -= com.vx;
+    p->vy -= com.vy;
+    p->vz -= com.vz;
+}
+
+const struct rebx_coordinates* rebx_get_coordinates(struct rebx_extras* const rebx, const struct reb_particle* const particles, const int N, const enum REBX_COORDINATES coordinates, const int reference_index){
+    int refindex = -1;
+    if (coordinates == REBX_COORDINATES_JACOBI){
+        refindex = 0;
+    }
+    else if (coordinates == REBX_COORDINATES_PARTICLE){
+        if (reference_index < 0 || reference_index >= N){
+            rebx_error(rebx, "REBOUNDx Error: Reference particle passed to rebx_get_coordinates is out of range.\n");
+            return NULL;
+        }
+        refindex = reference_index;
+    }
+
+    struct rebx_coordinates* c = NULL;
+    struct rebx_node* current = rebx->coordinates;
+    while(current != NULL){
+        struct rebx_coordinates* candidate = current->object;
+        if (candidate->coordinates == coordinates && candidate->reference_index == refindex){
+            c = candidate;
+            break;
+        }
+        current = current->next;
+    }
+    if (c == NULL){
+        c = rebx_malloc(rebx, sizeof(*c));
+        if (c == NULL){
+            return NULL;
+        }
+        struct rebx_node* node = rebx_create_node(rebx);
+        if (node == NULL){
+            free(c);
+            return NULL;
+        }
+        c->coordinates = coordinates;
+        c->reference_index = refindex;
+        c->N = 0;
+        c->N_allocated = -1;
+        c->epoch = 0; // never odd, so never matches a pass
+        c->particles = NULL;
+        c->ps = NULL;
+        c->coms = NULL;
+        c->m_j = NULL;
+        node->object = c;
+        rebx_add_node(&rebx->coordinates, node);
+    }
+    else if ((rebx->geometry_epoch & 1) && c->epoch == rebx->geometry_epoch && c->particles == particles && c->N == N){
+        return c;
+    }
+
+    if (N > c->N_allocated && !rebx_grow_coordinates(c, N)){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        return NULL;
+    }
+    struct reb_particle com = {0};
+    if (coordinates != REBX_COORDINATES_PARTICLE){
+        if (rebx->sim != NULL && particles == rebx->sim->particles){ // same as rebx_com_force and rebx_tools_com_ptm have always used
+            com = reb_get_com(rebx->sim);
+        }
+        else{
+            for (int i=0; i<N; i++){
+                com = reb_get_com_of_pair(com, particles[i]);
+            }
+        }
+    }
+    memcpy(c->ps, particles, N*sizeof(*c->ps));
+    switch(coordinates){
+        case REBX_COORDINATES_JACOBI:
+            // Run through backwards, removing each particle from the center of mass of the ones interior to it
+            for (int i=N-1; i>0; i--){
+                com = rebx_get_com_without_particle(com, particles[i]);
+                c->coms[i] = com;
+            }
+            if (N > 0){
+                c->coms[0] = (struct reb_particle){0};
+            }
+            rebx_calculate_jacobi_masses(particles, c->m_j, N);
+            reb_transformations_inertial_to_jacobi_posvel(particles, c->ps, particles, N, N);
+            break;
+        case REBX_COORDINATES_BARYCENTRIC:
+            for (int i=0; i<N; i++){
+                c->coms[i] = com;
+                rebx_set_relative_posvel(&c->ps[i], com);
+            }
+            break;
+        case REBX_COORDINATES_PARTICLE:
+            for (int i=0; i<N; i++){
+                c->coms[i] = particles[refindex];
+                rebx_set_relative_posvel(&c->ps[i], particles[refindex]);
+            }
+            break;
+    }
+    c->N = N;
+    c->particles = particles;
+    c->epoch = rebx->geometry_epoch;
+    return c;
+}
+
+void rebx_free_coordinates(struct rebx_extras* const rebx){
+    struct rebx_node* current = rebx->coordinates;
+    struct rebx_node* next;
+    while (current != NULL){
+        next = current->next;
+        struct rebx_coordinates* c = current->object;
+        free(c->ps);
+        free(c->m_j);
+        free(c);
+        free(current);
+        current = next;
+    }
+    rebx->coordinates = NULL;
+}
+
+/*****************************************************************
+ Lists of particles with a param set
+ *****************************************************************/
+
+/* Pointers to param values only change when params are added, freed or moved into columns, which all increment
+ * rebx->param_generation, so a list is valid as long as that and the particles it was built from are unchanged. */
+
+const struct rebx_param_list* rebx_get_param_list(struct rebx_extras* const rebx, const struct reb_particle* const particles, const int N, const int id){
+    rebx_sync_param_columns(rebx); // may move values, so do it before checking param_generation
+    struct rebx_param_list* list = NULL;
+    struct rebx_node* current = rebx->param_lists;
+    while(current != NULL){
+        struct rebx_param_list* candidate = current->object;
+        if (candidate->id == id){
+            list = candidate;
+            break;
+        }
+        current = current->next;
+    }
+    if (list == NULL){
+        list = rebx_malloc(rebx, sizeof(*list));
+        if (list == NULL){
+            return NULL;
+        }
+        struct rebx_node* node = rebx_create_node(rebx);
+        if (node == NULL){
+            free(list);
+            return NULL;
+        }
+        list->id = id;
+        list->N = -1; // never matches, so gets built below
+        list->particles = NULL;
+        list->N_allocated = 0;
+        list->index = NULL;
+        list->values = NULL;
+        node->object = list;
+        rebx_add_node(&rebx->param_lists, node);
+    }
+    else if (list->param_generation == rebx->param_generation && list->particles == particles && list->N == N){
+        return list;
+    }
+
+    if (N > list->N_allocated){
+        int* index = malloc(N*sizeof(*index));
+        void** values = malloc(N*sizeof(*values));
+        if (index == NULL || values == NULL){
+            free(index);
+            free(values);
+            rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+            return NULL;
+        }
+        free(list->index);
+        free(list->values);
+        list->index = index;
+        list->values = values;
+        list->N_allocated = N;
+    }
+    int N_particles = 0;
+    for (int i=0; i<N; i++){
+        void* value = rebx_get_param_by_id(rebx, particles[i].ap, id);
+        if (value != NULL){
+            list->index[N_particles] = i;
+            list->values[N_particles] = value;
+            N_particles++;
+        }
+    }
+    list->N_particles = N_particles;
+    list->N = N;
+    list->particles = particles;
+    list->param_generation = rebx->param_generation;
+    return list;
+}
+
+void rebx_free_param_lists(struct rebx_extras* const rebx){
+    struct rebx_node* current = rebx->param_lists;
+    struct rebx_node* next;
+    while (current != NULL){
+        next = current->next;
+        struct rebx_param_list* list = current->object;
+        free(list->index);
+        free(list->values);
+        free(list);
+        free(current);
+        current = next;
+    }
+    rebx->param_lists = NULL;
+}
+
 /*****************************************************************
  User interface for setting parameter values
  *****************************************************************/
@@ -569,24 +1605,30 @@ struct rebx_param* rebx_get_or_add_param(struct rebx_extras* const rebx, struct
         return NULL;
     }
 
+    struct rebx_param* reg_param = rebx_get_registered_param(rebx, param_name);
+    if (reg_param == NULL){
+        char str[300];
+        sprintf(str, "REBOUNDx Error: Need to register parameter name '%s' before using it. See examples.\n", param_name);
+        rebx_error(rebx, str);
+        return NULL;
+    }
+
     // Check whether it already exists in linked list
-    struct rebx_param* param = rebx_get_param_struct(rebx, *apptr, param_name);
+    struct rebx_param* param = rebx_get_param_struct_by_id(rebx, *apptr, reg_param->id);
 
-    if(param == NULL){
-        enum rebx_param_type type = rebx_get_type(rebx, param_name);
-        if (type == REBX_TYPE_NONE){
-            char str[300];
-            sprintf(str, "REBOUNDx Error: Need to register parameter name '%s' before using it. See examples.\n", param_name);
-            rebx_error(rebx, str);
-            return NULL;
-        }
-        param = rebx_create_param(rebx, param_name, type);
+    if(param == NULL){
+        param = rebx_pool_alloc(rebx, REBX_POOL_PARAM);
         if (param == NULL){ // adding new param failed
             return NULL;
         }
+        param->name = reg_param->name; // borrowed, the registry outlives the params on objects
+        param->type = reg_param->type;
+        param->value = NULL;
+        param->id = reg_param->id;
+        param->in_column = 0;
         int success = rebx_add_param(rebx, apptr, param);
         if(!success){
-            rebx_free_param(param);
+            rebx_free_param(rebx, param);
             return NULL;
         }
     }
@@ -598,6 +1640,9 @@ void rebx_set_param_pointer(struct rebx_extras* const rebx, struct rebx_node** a
     if (param == NULL){
         return;
     }
+    if (param->value != val){
+        rebx->param_generation++; // cached pointers to the old value are stale
+    }
     param->value = val;
     return;
 }
@@ -608,7 +1653,10 @@ void rebx_set_param_double(struct rebx_extras* const rebx, struct rebx_node** ap
         return;
     }
     if (param->value == NULL){ // new parameter, allocate
-        param->value = rebx_malloc(rebx, sizeof(double));
+        param->value = rebx_param_column_slot(rebx, apptr, param);
+        if (param->value == NULL){
+            param->value = rebx_param_storage(param);
+        }
     }
     // Update new or existing param value
     double* valptr = param->value;
@@ -623,7 +1671,7 @@ void rebx_set_param_int(struct rebx_extras* const rebx, struct rebx_node** apptr
         return;
     }
     if (param->value == NULL){ // new parameter, allocate
-        param->value = rebx_malloc(rebx, sizeof(int));
+        param->value = rebx_param_storage(param);
     }
     // Update new or existing param value
     int* valptr = param->value;
@@ -638,7 +1686,7 @@ void rebx_set_param_uint32(struct rebx_extras* const rebx, struct rebx_node** ap
         return;
     }
     if (param->value == NULL){ // new parameter, allocate
-        param->value = rebx_malloc(rebx, sizeof(uint32_t));
+        param->value = rebx_param_storage(param);
     }
     // Update new or existing param value
     uint32_t* valptr = param->value;
@@ -653,7 +1701,7 @@ void rebx_set_param_vec3d(struct rebx_extras* const rebx, struct rebx_node** app
         return;
     }
     if (param->value == NULL){ // new parameter, allocate
-        param->value = rebx_malloc(rebx, sizeof(struct reb_vec3d));
+        param->value = rebx_param_storage(param);
     }
     // Update new or existing param value
     struct reb_vec3d* valptr = param->value;
@@ -664,11 +1712,128 @@ void rebx_set_param_vec3d(struct rebx_extras* const rebx, struct rebx_node** app
     return;
 }
 
+/*****************************************************************
+ Bulk access to particle params
+ *****************************************************************/
+
+// Checks param_name can be set in bulk and indices are valid. Returns size of the param's values (0 if not)
+static size_t rebx_check_particle_params(struct rebx_extras* const rebx, const char* const param_name, const int* const indices, const int N, struct rebx_param** reg_param){
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return 0;
+    }
+    char str[300];
+    *reg_param = rebx_get_registered_param(rebx, param_name);
+    if (*reg_param == NULL){
+        sprintf(str, "REBOUNDx Error: Need to register parameter name '%s' before using it. See examples.\n", param_name);
+        rebx_error(rebx, str);
+        return 0;
+    }
+    switch((*reg_param)->type){
+        case REBX_TYPE_DOUBLE:
+        case REBX_TYPE_INT:
+        case REBX_TYPE_UINT32:
+        case REBX_TYPE_VEC3D:
+            break;
+        default:
+            sprintf(str, "REBOUNDx Error: Parameter '%s' can't be accessed in bulk. Must be of type double, int, uint32 or vec3d.\n", param_name);
+            rebx_error(rebx, str);
+            return 0;
+    }
+    const int Nmax = rebx->sim->N;
+    if (N < 0 || (indices == NULL && N > Nmax)){
+        rebx_error(rebx, "REBOUNDx Error: More values than particles in the simulation.\n");
+        return 0;
+    }
+    if (indices != NULL){
+        for (int i=0; i<N; i++){
+            if (indices[i] < 0 || indices[i] >= Nmax){
+                rebx_error(rebx, "REBOUNDx Error: Particle index out of range.\n");
+                return 0;
+            }
+        }
+    }
+    return rebx_sizeof(rebx, (*reg_param)->type);
+}
+
+int rebx_set_particle_params(struct rebx_extras* const rebx, const char* const param_name, const void* const values, const int* const indices, const int N){
+    struct rebx_param* reg_param;
+    const size_t size = rebx_check_particle_params(rebx, param_name, indices, N, &reg_param);
+    if (size == 0){
+        return 0;
+    }
+    struct reb_simulation* const sim = rebx->sim;
+    const char* const vals = values;
+    struct rebx_param_column* const column = (reg_param->type == REBX_TYPE_DOUBLE) ? rebx_get_param_column(rebx, reg_param->id) : NULL;
+    for (int i=0; i<N; i++){
+        const int index = indices ? indices[i] : i;
+        if (column != NULL && REBX_COLUMN_HAS(column, index)){
+            memcpy(&column->values[index], vals + i*size, size);
+            continue;
+        }
+        struct rebx_node** apptr = (struct rebx_node**)&sim->particles[index].ap;
+        struct rebx_param* param = rebx_get_param_struct_by_id(rebx, *apptr, reg_param->id);
+        if (param == NULL){
+            param = rebx_get_or_add_param(rebx, apptr, param_name);
+            if (param == NULL){
+                return 0;
+            }
+        }
+        if (param->value == NULL){ // new parameter, allocate like rebx_set_param_*
+            if (reg_param->type == REBX_TYPE_DOUBLE){
+                param->value = rebx_param_column_slot(rebx, apptr, param);
+            }
+            if (param->value == NULL){
+                param->value = rebx_param_storage(param);
+            }
+            if (param->value == NULL){
+                rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+                return 0;
+            }
+        }
+        memcpy(param->value, vals + i*size, size);
+    }
+    return 1;
+}
+
+int rebx_get_particle_params(struct rebx_extras* const rebx, const char* const param_name, void* const values, const int* const indices, const int N){
+    struct rebx_param* reg_param;
+    const size_t size = rebx_check_particle_params(rebx, param_name, indices, N, &reg_param);
+    if (size == 0){
+        return -1;
+    }
+    struct reb_simulation* const sim = rebx->sim;
+    char* const vals = values;
+    struct rebx_param_column* const column = (reg_param->type == REBX_TYPE_DOUBLE) ? rebx_get_param_column(rebx, reg_param->id) : NULL;
+    int Nfound = 0;
+    for (int i=0; i<N; i++){
+        const int index = indices ? indices[i] : i;
+        const void* value;
+        if (column != NULL){
+            value = REBX_COLUMN_HAS(column, index) ? &column->values[index] : NULL;
+        }
+        else{
+            value = rebx_get_param_by_id(rebx, sim->particles[index].ap, reg_param->id);
+        }
+        if (value != NULL){
+            memcpy(vals + i*size, value, size);
+            Nfound++;
+        }
+    }
+    return Nfound;
+}
+
 /*******************************************************************
  User interface for getting REBOUNDx objects and parameters
  *******************************************************************/
 
 struct rebx_param* rebx_get_param_struct(struct rebx_extras* const rebx, struct rebx_node* ap, const char* const param_name){
+    struct rebx_param* reg_param = rebx_get_registered_param(rebx, param_name);
+    if (reg_param != NULL){
+        return rebx_get_param_struct_by_id(rebx, ap, reg_param->id);
+    }
+
+    // Unregistered names can only be on the list if loaded from a binary with custom params. Fall back to string compares.
     struct rebx_node* current = ap;
     while(current != NULL){
         struct rebx_param* param = current->object;
@@ -681,6 +1846,44 @@ struct rebx_param* rebx_get_param_struct(struct rebx_extras* const rebx, struct
     return NULL;   // name not found. Don't want warnings for optional parameters so don't reb_error
 }
 
+// No per-object index: lists are short, and reads mustn't reorder them (e.g. move to front) since force loops look params up from OpenMP threads
+struct rebx_param* rebx_get_param_struct_by_id(struct rebx_extras* const rebx, struct rebx_node* ap, const int id){
+    if (id < 0){
+        return NULL;
+    }
+    struct rebx_node* current = ap;
+    while(current != NULL){
+        struct rebx_param* param = current->object;
+        if(param->id == id){
+            return param;
+        }
+        current = current->next;
+    }
+
+    return NULL;   // not found. Don't want warnings for optional parameters so don't reb_error
+}
+
+void* rebx_get_param_by_id(struct rebx_extras* const rebx, struct rebx_node* ap, const int id){
+    struct rebx_param* param = rebx_get_param_struct_by_id(rebx, ap, id);
+    if (param == NULL){
+        return NULL;
+    }
+    else{
+        return param->value;
+    }
+}
+
+int rebx_intern(struct rebx_extras* const rebx, const char* const param_name){
+    struct rebx_param* reg_param = rebx_get_registered_param(rebx, param_name);
+    if (reg_param == NULL){
+        char str[300];
+        sprintf(str, "REBOUNDx Error: Need to register parameter name '%s' before using it. See examples.\n", param_name);
+        rebx_error(rebx, str);
+        return -1;
+    }
+    return reg_param->id;
+}
+
 void* rebx_get_param(struct rebx_extras* const rebx, struct rebx_node* ap, const char* const param_name){
     struct rebx_param* param = rebx_get_param_struct(rebx, ap, param_name);
     if (param == NULL){
@@ -692,38 +1895,50 @@ void* rebx_get_param(struct rebx_extras* const rebx, struct rebx_node* ap, const
 }
 
 struct rebx_force* rebx_get_force(struct rebx_extras* const rebx, const char* const name){
-    struct rebx_node* current = rebx->allocated_forces;
-    while(current != NULL){
-        struct rebx_force* force = current->object;
-        if(strcmp(force->name, name) == 0){
-            return force;
-        }
-        current = current->next;
-    }
-
-    return NULL;
+    return rebx_name_table_get(&rebx->force_names, name);
 }
 
 struct rebx_operator* rebx_get_operator(struct rebx_extras* const rebx, const char* const name){
-    struct rebx_node* current = rebx->allocated_operators;
-    while(current != NULL){
-        struct rebx_operator* operator = current->object;
-        if(strcmp(operator->name, name) == 0){
-            return operator;
-        }
-        current = current->next;
-    }
-
-    return NULL;
+    return rebx_name_table_get(&rebx->operator_names, name);
 }
 
 /*******************************************************************
  User interface for removing REBOUNDx objects
  *******************************************************************/
 
+// rebx_get_force finds the most recently created force with a name, so when that one goes, the next one takes its place
+static void rebx_unindex_force(struct rebx_extras* rebx, struct rebx_force* force){
+    if (force->name == NULL || rebx_get_force(rebx, force->name) != force){
+        return;
+    }
+    rebx_name_table_remove(&rebx->force_names, force->name);
+    for (struct rebx_node* current = rebx->allocated_forces; current != NULL; current = current->next){
+        struct rebx_force* other = current->object;
+        if (other != force && other->name != NULL && strcmp(other->name, force->name) == 0){
+            rebx_name_table_set(&rebx->force_names, other->name, other); // can't fail, since an entry was just freed
+            return;
+        }
+    }
+}
+
+static void rebx_unindex_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
+    if (operator->name == NULL || rebx_get_operator(rebx, operator->name) != operator){
+        return;
+    }
+    rebx_name_table_remove(&rebx->operator_names, operator->name);
+    for (struct rebx_node* current = rebx->allocated_operators; current != NULL; current = current->next){
+        struct rebx_operator* other = current->object;
+        if (other != operator && other->name != NULL && strcmp(other->name, operator->name) == 0){
+            rebx_name_table_set(&rebx->operator_names, other->name, other);
+            return;
+        }
+    }
+}
+
 int rebx_remove_force(struct rebx_extras* rebx, struct rebx_force* force){
     int allocated = rebx_remove_node(&rebx->allocated_forces, force);
     if(allocated){
+        rebx_unindex_force(rebx, force);
         rebx_free_force(rebx, force);
     }
     // success only cares about removal from add_forces that affects sim
@@ -767,7 +1982,8 @@ static int rebx_remove_step_node(struct rebx_node** head, struct rebx_operator*
 int rebx_remove_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
     int allocated = rebx_remove_node(&rebx->allocated_operators, operator);
     if(allocated){
-        rebx_free_operator(operator);
+        rebx_unindex_operator(rebx, operator);
+        rebx_free_operator(rebx, operator);
 
     }
 
@@ -807,32 +2023,125 @@ void* rebx_malloc(struct rebx_extras* const rebx, size_t memsize){
     return ptr;
 }
 
-void rebx_free_param(struct rebx_param* param){
-    if(param->name){
-        free(param->name);
+/* Param lists are made of many tiny objects (a node and a param per parameter per particle, with fixed-size values stored in the param).
+ * Rather than a malloc for each, these come from per-rebx_extras pools of fixed-size objects carved out of large slabs.
+ * Freed objects go on a free list for reuse, and all slabs are released in one go by rebx_free_pointers.*/
+
+#define REBX_POOL_SLAB_SIZE 65536   // bytes per slab, including header
+
+union rebx_slab_header{             // keeps objects after the header aligned
+    void* next;
+    double d;
+    long double ld;
+};
+
+void rebx_init_pools(struct rebx_extras* const rebx){
+    const size_t sizes[REBX_POOL_N] = {
+        [REBX_POOL_NODE] = sizeof(struct rebx_node),
+        [REBX_POOL_PARAM] = sizeof(struct rebx_param),
+    };
+    for (int i=0; i<REBX_POOL_N; i++){
+        struct rebx_pool* const pool = &rebx->pools[i];
+        // objects need to hold the free list pointer and stay aligned for doubles and pointers
+        const size_t align = sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double);
+        pool->object_size = (sizes[i] + align - 1)/align*align;
+        pool->free_list = NULL;
+        pool->slabs = NULL;
+        pool->next = NULL;
+        pool->end = NULL;
+    }
+}
+
+void rebx_release_pools(struct rebx_extras* const rebx){
+    for (int i=0; i<REBX_POOL_N; i++){
+        struct rebx_pool* const pool = &rebx->pools[i];
+        union rebx_slab_header* slab = pool->slabs;
+        while (slab != NULL){
+            union rebx_slab_header* next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        pool->free_list = NULL;
+        pool->slabs = NULL;
+        pool->next = NULL;
+        pool->end = NULL;
+    }
+}
+
+void* rebx_pool_alloc(struct rebx_extras* const rebx, enum rebx_pool_type type){
+    struct rebx_pool* const pool = &rebx->pools[type];
+    if (pool->free_list != NULL){
+        void* ptr = pool->free_list;
+        pool->free_list = *(void**)ptr;
+        return ptr;
     }
-    // Don't free pointers to structs
-    if(param->type == REBX_TYPE_INT || param->type == REBX_TYPE_DOUBLE){
-        if(param->value){
-            free(param->value);
+    if (pool->next == NULL || pool->next + pool->object_size > pool->end){
+        union rebx_slab_header* slab = rebx_malloc(rebx, REBX_POOL_SLAB_SIZE);
+        if (slab == NULL){
+            return NULL;
         }
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->next = (char*)(slab + 1);
+        pool->end = (char*)slab + REBX_POOL_SLAB_SIZE;
+    }
+    void* ptr = pool->next;
+    pool->next += pool->object_size;
+    return ptr;
+}
+
+void rebx_pool_free(struct rebx_extras* const rebx, enum rebx_pool_type type, void* ptr){
+    if (ptr == NULL){
+        return;
+    }
+    struct rebx_pool* const pool = &rebx->pools[type];
+    *(void**)ptr = pool->free_list;
+    pool->free_list = ptr;
+}
+
+void* rebx_param_storage(struct rebx_param* const param){
+    switch(param->type){
+        case REBX_TYPE_DOUBLE:
+        case REBX_TYPE_INT:
+        case REBX_TYPE_UINT32:
+        case REBX_TYPE_VEC3D:
+            return &param->storage;
+        default:
+            return NULL;
     }
-    free(param);
 }
 
-void rebx_free_ap(struct rebx_node** ap){
+void rebx_free_param(struct rebx_extras* const rebx, struct rebx_param* param){
+    if(param->id < 0){ // registered names are borrowed from the registry, which frees them
+        free(param->name);
+    }
+    // Values are either stored in the param, in param columns, or pointers to structs the param doesn't own
+    rebx_pool_free(rebx, REBX_POOL_PARAM, param);
+}
+
+void rebx_free_ap(struct rebx_extras* const rebx, struct rebx_node** ap){
     struct rebx_node* current = *ap;
     struct rebx_node* next;
     while (current != NULL){
         next = current->next;
-        rebx_free_param(current->object);
-        free(current);
+        rebx_free_param(rebx, current->object);
+        rebx_pool_free(rebx, REBX_POOL_NODE, current);
         current = next;
     }
+    *ap = NULL;
+    rebx->param_generation++;
 }
 
 void rebx_free_particle_ap(struct reb_particle* p){
-    rebx_free_ap(&p->ap);
+    // Params come from the pools of the rebx_extras attached to the particle's sim
+    if (p->sim == NULL || p->sim->extras == NULL){
+        return;
+    }
+    struct rebx_extras* rebx = p->sim->extras;
+    // Called by REBOUND when particles are removed, which shifts particle indices. Invalidates caches of particle indices
+    rebx->param_columns_dirty = 1;
+    rebx->param_generation++;
+    rebx_free_ap(rebx, (struct rebx_node**)&p->ap);
 }
 
 void rebx_free_force(struct rebx_extras* rebx, struct rebx_force* force){
@@ -840,18 +2149,30 @@ void rebx_free_force(struct rebx_extras* rebx, struct rebx_force* force){
     if (free_arrays){
         free_arrays(rebx, force);
     }
+    // free_arrays is used by integrate_force's integrators, which store their buffers on the force they integrate.
+    // Effects that keep their own scratch space use free_workspace so the two don't overwrite one another.
+    void (*free_workspace)(struct rebx_extras* rebx, struct rebx_force* force) = rebx_get_param(rebx, force->ap, "free_workspace");
+    if (free_workspace){
+        free_workspace(rebx, force);
+    }
+    rebx_free_force_scratch(rebx, force);
+    rebx_free_cull_state(rebx, force);
     if(force->name){
         free(force->name);
     }
-    rebx_free_ap(&force->ap);
+    rebx_free_ap(rebx, &force->ap);
     free(force);
 }
 
-void rebx_free_operator(struct rebx_operator* operator){
+void rebx_free_operator(struct rebx_extras* rebx, struct rebx_operator* operator){
+    void (*free_workspace)(struct rebx_extras* rebx, struct rebx_operator* operator) = rebx_get_param(rebx, operator->ap, "free_workspace");
+    if (free_workspace){
+        free_workspace(rebx, operator);
+    }
     if(operator->name){
         free(operator->name);
     }
-    rebx_free_ap(&operator->ap);
+    rebx_free_ap(rebx, &operator->ap);
     free(operator);
 }
 
@@ -859,17 +2180,15 @@ void rebx_free_step(struct rebx_step* step){
     free(step);
 }
 
-void rebx_free_reg_param(struct rebx_param* param){
-    if(param->name){
-        free(param->name);
-    }
-    free(param);
-}
-
 void rebx_free_pointers(struct rebx_extras* rebx){
     if (rebx == NULL){
         return;
     }
+    struct reb_simulation* const sim = rebx->sim;
+    rebx_free_param_columns(rebx);
+    rebx_free_geometries(rebx);
+    rebx_free_coordinates(rebx);
+    rebx_free_param_lists(rebx);
     rebx_detach(rebx->sim, rebx);
     struct rebx_node* current;
     struct rebx_node* next;
@@ -885,7 +2204,7 @@ void rebx_free_pointers(struct rebx_extras* rebx){
     current = rebx->allocated_operators;
     while (current != NULL){
         next = current->next;
-        rebx_free_operator(current->object);
+        rebx_free_operator(rebx, current->object);
         free(current);
         current = next;
     }
@@ -914,13 +2233,40 @@ void rebx_free_pointers(struct rebx_extras* rebx){
         current = next;
     }
 
-    current = rebx->registered_params;
-    while (current != NULL){
-        next = current->next;
-        rebx_free_reg_param(current->object);
-        free(current);
-        current = next;
+    // The registry owns the names that params added to objects borrow
+    for (struct rebx_node* current = rebx->registered_params; current != NULL; current = current->next){
+        struct rebx_param* param = current->object;
+        free(param->name);
+        param->name = NULL;
+    }
+    rebx_free_ap(rebx, &rebx->registered_params);
+
+    // Particle params live in the pools, so they get released with them
+    if (sim != NULL){
+        for (int i=0; i<sim->N; i++){
+            struct rebx_node* ap = sim->particles[i].ap;
+            while (ap != NULL){
+                struct rebx_param* param = ap->object;
+                if (param->id < 0){ // names are not pooled, and registered ones are borrowed
+                    free(param->name);
+                }
+                ap = ap->next;
+            }
+            sim->particles[i].ap = NULL;
+        }
     }
+    rebx_release_pools(rebx);
+
+    free(rebx->registered_param_table);
+    rebx->registered_param_table = NULL;
+    rebx->registered_param_table_size = 0;
+    rebx->N_registered_params = 0;
+    rebx->default_params = 0;
+    free(rebx->archive_filename);
+    rebx->archive_filename = NULL;
+    rebx_free_archive_delta(rebx);
+    rebx_name_table_free(&rebx->force_names);
+    rebx_name_table_free(&rebx->operator_names);
 }
 
 /**********************************************
@@ -935,8 +2281,291 @@ void rebx_reset_accelerations(struct reb_particle* const ps, const int N){
     }
 }
 
+static double rebx_walltime(void){
+    struct timeval tim;
+    gettimeofday(&tim, NULL);
+    return tim.tv_sec + tim.tv_usec*1.e-6;
+}
+
+void rebx_free_cull_state(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_cull_state* const cull = rebx_get_param(rebx, force->ap, "cull_state");
+    if (cull == NULL){
+        return;
+    }
+    free(cull->culled);
+    free(cull->a);
+    free(cull);
+    rebx_set_param_pointer(rebx, &force->ap, "cull_state", NULL);
+}
+
+// Returns the state with room for N particles, or NULL if allocation fails (the force is then evaluated on all particles)
+static struct rebx_cull_state* rebx_get_cull_state(struct rebx_extras* const rebx, struct rebx_force* const force, const int N){
+    struct rebx_cull_state* cull = rebx_get_param(rebx, force->ap, "cull_state");
+    if (cull == NULL){
+        cull = calloc(1, sizeof(*cull));
+        if (cull == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, "cull_state", cull);
+    }
+    if (N > cull->N_allocated){
+        const int N_allocated = N > 2*cull->N_allocated ? N : 2*cull->N_allocated;
+        unsigned char* const culled = realloc(cull->culled, N_allocated*sizeof(*culled));
+        if (culled == NULL){
+            return NULL;
+        }
+        cull->culled = culled;
+        double* const a = realloc(cull->a, 3*N_allocated*sizeof(*a));
+        if (a == NULL){
+            return NULL;
+        }
+        cull->a = a;
+        cull->N_allocated = N_allocated;
+        cull->N = 0; // contents are stale, so estimate again
+    }
+    return cull;
+}
+
+// Flags the particles whose acceleration from the force was below threshold times the acceleration they had before it (gravity and the forces evaluated earlier)
+static void rebx_cull_estimate(struct rebx_extras* const rebx, struct rebx_cull_state* const cull, const struct reb_particle* const particles, const int N, const double threshold){
+    const double threshold2 = threshold*threshold;
+    int N_culled = 0;
+    for (int i=0; i<N; i++){
+        const double* const a = &cull->a[3*i];
+        const double dax = particles[i].ax - a[0];
+        const double day = particles[i].ay - a[1];
+        const double daz = particles[i].az - a[2];
+        const double da2 = dax*dax + day*day + daz*daz;
+        const double a2 = a[0]*a[0] + a[1]*a[1] + a[2]*a[2];
+        cull->culled[i] = da2 < threshold2*a2;
+        N_culled += cull->culled[i];
+    }
+    cull->N = N;
+    cull->N_culled = N_culled;
+    cull->steps_done = rebx->sim->steps_done;
+    cull->param_generation = rebx->param_generation;
+}
+
+void rebx_update_force_accelerations(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
+    struct rebx_extras* const rebx = sim->extras;
+    const double start = rebx->profiling ? rebx_walltime() : 0.;
+    if (force->update_constants != NULL){
+        force->update_constants(sim, force, particles, N);
+    }
+    // Culling only applies to sim->particles, since the estimate is indexed like them. Stage particles of operators like integrate_force are always evaluated in full
+    const double* const threshold = particles == sim->particles ? rebx_get_param(rebx, force->ap, "cull_threshold") : NULL;
+    struct rebx_cull_state* const cull = threshold != NULL && *threshold > 0. ? rebx_get_cull_state(rebx, force, N) : NULL;
+    int estimate = 0;
+    if (cull != NULL){
+        const int* const every_ptr = rebx_get_param(rebx, force->ap, "cull_every");
+        const int default_every = 100;
+        const unsigned long long every = every_ptr != NULL && *every_ptr > 0 ? *every_ptr : default_every;
+        // Also estimate again if particles were added or removed, or the simulation was reset to an earlier step
+        estimate = cull->N != N || cull->param_generation != rebx->param_generation
+            || sim->steps_done < cull->steps_done || sim->steps_done >= cull->steps_done + every;
+        if (estimate){
+            for (int i=0; i<N; i++){
+                cull->a[3*i] = particles[i].ax;
+                cull->a[3*i+1] = particles[i].ay;
+                cull->a[3*i+2] = particles[i].az;
+            }
+        }
+        else if (cull->N_culled > 0){
+            force->skip = cull->culled;
+        }
+    }
+    force->update_accelerations(sim, force, particles, N);
+    int N_skipped = 0;
+    if (estimate){
+        rebx_cull_estimate(rebx, cull, particles, N, *threshold);
+    }
+    else if (force->skip != NULL){
+        N_skipped = cull->N_culled;
+        force->skip = NULL;
+    }
+    if (rebx->profiling){
+        force->profile.calls++;
+        force->profile.particles += N;
+        force->profile.walltime += rebx_walltime() - start;
+        force->profile.culled += N_skipped;
+    }
+}
+
+// Pre-timestep steps are applied before the first timestep of each window of step->every timesteps, post-timestep steps after the last
+static void rebx_apply_step(struct reb_simulation* const sim, struct rebx_step* const step, const double dt, const enum rebx_timing timing){
+    if (step->every > 1){
+        const unsigned long long n = sim->steps_done + (timing == REBX_TIMING_POST); // steps_done is incremented after post_timestep_modifications
+        if (n % step->every != (unsigned long long)step->phase){
+            return;
+        }
+    }
+    struct rebx_extras* const rebx = sim->extras;
+    struct rebx_operator* const operator = step->operator;
+    const double start = rebx->profiling ? rebx_walltime() : 0.;
+    operator->step_function(sim, operator, dt*step->dt_fraction*step->every);
+    if (rebx->profiling){
+        operator->profile.calls++;
+        operator->profile.particles += sim->N - sim->N_var;
+        operator->profile.walltime += rebx_walltime() - start;
+    }
+}
+
+/*****************************************************************
+ Memory usage
+ *****************************************************************/
+
+// Only registry entries and unregistered params (from binaries with custom params) own their names
+static void rebx_memory_add_params(struct rebx_memory_usage* const usage, const struct rebx_node* ap, const int registry){
+    for (; ap != NULL; ap = ap->next){ // nodes, params and their values are in the pools
+        const struct rebx_param* const param = ap->object;
+        if (param->name != NULL && (registry || param->id < 0)){
+            rebx_memory_add(usage, REBX_MEMORY_PARAMS, param->name, strlen(param->name) + 1);
+        }
+    }
+}
+
+// Nodes of lists of objects are individually allocated, unlike those of param lists
+static void rebx_memory_add_nodes(struct rebx_memory_usage* const usage, const enum rebx_memory_category category, const struct rebx_node* node){
+    for (; node != NULL; node = node->next){
+        rebx_memory_add(usage, category, node, sizeof(*node));
+    }
+}
+
+static void rebx_memory_add_force(struct rebx_extras* const rebx, struct rebx_memory_usage* const usage, struct rebx_force* const force){
+    rebx_memory_add(usage, REBX_MEMORY_FORCES, force, sizeof(*force));
+    if (force->name != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_FORCES, force->name, strlen(force->name) + 1);
+    }
+    rebx_memory_add_params(usage, force->ap, 0);
+    rebx_force_scratch_memory(rebx, force, usage);
+    const struct rebx_integrator_workspace* const ws = rebx_get_param(rebx, force->ap, "integrator_workspace");
+    if (ws != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws, sizeof(*ws));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->ps, ws->N_allocated*sizeof(*ws->ps));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->v, 3*ws->N_allocated*ws->N_vectors*sizeof(*ws->v));
+    }
+    const struct rebx_cull_state* const cull = rebx_get_param(rebx, force->ap, "cull_state");
+    if (cull != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cull, sizeof(*cull));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cull->culled, cull->N_allocated*sizeof(*cull->culled));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cull->a, 3*cull->N_allocated*sizeof(*cull->a));
+    }
+    const struct reb_ode* const ode = rebx_get_param(rebx, force->ap, "ode"); // allocated by REBOUND, but only there for REBOUNDx
+    if (ode != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ode, sizeof(*ode));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ode->y, ode->allocated_N*sizeof(*ode->y)); // integrator arrays REBOUND keeps for the ODE aren't included
+    }
+    void (*workspace_memory)(struct rebx_extras* rebx, struct rebx_force* force, struct rebx_memory_usage* usage) = rebx_get_param(rebx, force->ap, "workspace_memory");
+    if (workspace_memory){
+        workspace_memory(rebx, force, usage);
+    }
+}
+
+static void rebx_memory_add_operator(struct rebx_extras* const rebx, struct rebx_memory_usage* const usage, struct rebx_operator* const operator){
+    rebx_memory_add(usage, REBX_MEMORY_OPERATORS, operator, sizeof(*operator));
+    if (operator->name != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_OPERATORS, operator->name, strlen(operator->name) + 1);
+    }
+    rebx_memory_add_params(usage, operator->ap, 0);
+    void (*workspace_memory)(struct rebx_extras* rebx, struct rebx_operator* operator, struct rebx_memory_usage* usage) = rebx_get_param(rebx, operator->ap, "workspace_memory");
+    if (workspace_memory){
+        workspace_memory(rebx, operator, usage);
+    }
+}
+
+void rebx_memory_usage(struct rebx_extras* const rebx, struct rebx_memory_usage* const usage){
+    memset(usage, 0, sizeof(*usage));
+    if (rebx == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, rebx, sizeof(*rebx));
+
+    // Params
+    for (int i=0; i<REBX_POOL_N; i++){
+        for (const union rebx_slab_header* slab = rebx->pools[i].slabs; slab != NULL; slab = slab->next){
+            rebx_memory_add(usage, REBX_MEMORY_PARAMS, slab, REBX_POOL_SLAB_SIZE);
+        }
+    }
+    struct reb_simulation* const sim = rebx->sim;
+    if (sim != NULL){
+        for (int i=0; i<sim->N; i++){
+            rebx_memory_add_params(usage, sim->particles[i].ap, 0);
+        }
+    }
+    rebx_memory_add_params(usage, rebx->registered_params, 1);
+    for (const struct rebx_node* current = rebx->param_columns; current != NULL; current = current->next){
+        const struct rebx_param_column* const column = current->object;
+        rebx_memory_add(usage, REBX_MEMORY_PARAMS, column, sizeof(*column));
+        rebx_memory_add(usage, REBX_MEMORY_PARAMS, column->values, (column->N+1)*sizeof(*column->values));
+        rebx_memory_add(usage, REBX_MEMORY_PARAMS, column->present, (column->N/32+1)*sizeof(*column->present));
+    }
+    rebx_memory_add_nodes(usage, REBX_MEMORY_PARAMS, rebx->param_columns);
+    for (const struct rebx_node* current = rebx->param_lists; current != NULL; current = current->next){
+        const struct rebx_param_list* const list = current->object;
+        rebx_memory_add(usage, REBX_MEMORY_PARAMS, list, sizeof(*list));
+        rebx_memory_add(usage, REBX_MEMORY_PARAMS, list->index, list->N_allocated*sizeof(*list->index));
+        rebx_memory_add(usage, REBX_MEMORY_PARAMS, list->values, list->N_allocated*sizeof(*list->values));
+    }
+    rebx_memory_add_nodes(usage, REBX_MEMORY_PARAMS, rebx->param_lists);
+
+    // Forces and operators
+    for (const struct rebx_node* current = rebx->allocated_forces; current != NULL; current = current->next){
+        rebx_memory_add_force(rebx, usage, current->object);
+    }
+    rebx_memory_add_nodes(usage, REBX_MEMORY_FORCES, rebx->allocated_forces);
+    rebx_memory_add_nodes(usage, REBX_MEMORY_FORCES, rebx->additional_forces);
+    for (const struct rebx_node* current = rebx->allocated_operators; current != NULL; current = current->next){
+        rebx_memory_add_operator(rebx, usage, current->object);
+    }
+    rebx_memory_add_nodes(usage, REBX_MEMORY_OPERATORS, rebx->allocated_operators);
+    const struct rebx_node* const steps[2] = {rebx->pre_timestep_modifications, rebx->post_timestep_modifications};
+    for (int k=0; k<2; k++){
+        for (const struct rebx_node* current = steps[k]; current != NULL; current = current->next){
+            rebx_memory_add(usage, REBX_MEMORY_OPERATORS, current->object, sizeof(struct rebx_step));
+        }
+        rebx_memory_add_nodes(usage, REBX_MEMORY_OPERATORS, steps[k]);
+    }
+
+    // Caches shared between forces
+    for (const struct rebx_node* current = rebx->geometries; current != NULL; current = current->next){
+        const struct rebx_geometry* const g = current->object;
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, g, sizeof(*g));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, g->dx, 9*(g->N_allocated+1)*sizeof(*g->dx));
+    }
+    rebx_memory_add_nodes(usage, REBX_MEMORY_WORKSPACES, rebx->geometries);
+    for (const struct rebx_node* current = rebx->coordinates; current != NULL; current = current->next){
+        const struct rebx_coordinates* const c = current->object;
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, c, sizeof(*c));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, c->ps, 2*(c->N_allocated+1)*sizeof(*c->ps)); // coms are in the same block
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, c->m_j, (c->N_allocated+1)*sizeof(*c->m_j));
+    }
+    rebx_memory_add_nodes(usage, REBX_MEMORY_WORKSPACES, rebx->coordinates);
+
+    // Tables and archive state
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, rebx->registered_param_table, rebx->registered_param_table_size*sizeof(*rebx->registered_param_table));
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, rebx->force_names.entries, rebx->force_names.size*sizeof(*rebx->force_names.entries));
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, rebx->operator_names.entries, rebx->operator_names.size*sizeof(*rebx->operator_names.entries));
+    if (rebx->archive_filename != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_OTHER, rebx->archive_filename, strlen(rebx->archive_filename) + 1);
+    }
+    rebx_archive_delta_memory(rebx, usage);
+}
+
+void rebx_profile_reset(struct rebx_extras* const rebx){
+    for (struct rebx_node* current = rebx->allocated_forces; current != NULL; current = current->next){
+        struct rebx_force* force = current->object;
+        force->profile = (struct rebx_profile){0};
+    }
+    for (struct rebx_node* current = rebx->allocated_operators; current != NULL; current = current->next){
+        struct rebx_operator* operator = current->object;
+        operator->profile = (struct rebx_profile){0};
+    }
+}
+
 void rebx_additional_forces(struct reb_simulation* sim){
     struct rebx_extras* rebx = sim->extras;
+    rebx_sync_param_columns(rebx);
+    rebx->geometry_epoch++; // odd during the pass, so forces can share rebx_get_geometry results
     struct rebx_node* current = rebx->additional_forces;
     while(current != NULL){
         /*if(sim->force_is_velocity_dependent && sim->integrator==REB_INTEGRATOR_WHFAST){
@@ -944,13 +2573,15 @@ void rebx_additional_forces(struct reb_simulation* sim){
          }*/
         struct rebx_force* force = current->object;
         const double N = sim->N - sim->N_var;
-        force->update_accelerations(sim, force, sim->particles, N);
+        rebx_update_force_accelerations(sim, force, sim->particles, N);
         current = current->next;
     }
+    rebx->geometry_epoch++;
 }
 
 void rebx_pre_timestep_modifications(struct reb_simulation* sim){
     struct rebx_extras* rebx = sim->extras;
+    rebx_sync_param_columns(rebx);
     struct rebx_node* current = rebx->pre_timestep_modifications;
     const double dt = sim->dt;
 
@@ -960,13 +2591,14 @@ void rebx_pre_timestep_modifications(struct reb_simulation* sim){
         if(sim->integrator==REB_INTEGRATOR_IAS15 && sim->ri_ias15.epsilon != 0 && operator->operator_type == REBX_OPERATOR_UPDATER){
             reb_warning(sim, "REBOUNDx: Operators that affect particle trajectories with adaptive timesteps can give spurious results. Use sim.ri_ias15.epsilon=0 for fixed timestep with IAS, or use a different integrator.");
         }
-        operator->step_function(sim, operator, dt*step->dt_fraction);
+        rebx_apply_step(sim, step, dt, REBX_TIMING_PRE);
         current = current->next;
     }
 }
 
 void rebx_post_timestep_modifications(struct reb_simulation* sim){
     struct rebx_extras* rebx = sim->extras;
+    rebx_sync_param_columns(rebx);
     struct rebx_node* current = rebx->post_timestep_modifications;
     const double dt = sim->dt;
 
@@ -976,9 +2608,10 @@ void rebx_post_timestep_modifications(struct reb_simulation* sim){
         if(sim->integrator==REB_INTEGRATOR_IAS15 && sim->ri_ias15.epsilon != 0 && operator->operator_type == REBX_OPERATOR_UPDATER){
             reb_warning(sim, "REBOUNDx: Operators that affect particle trajectories with adaptive timesteps can give spurious results. Use sim.ri_ias15.epsilon=0 for fixed timestep with IAS, or use a different integrator.");
         }
-        operator->step_function(sim, operator, dt*step->dt_fraction);
+        rebx_apply_step(sim, step, dt, REBX_TIMING_POST);
         current = current->next;
     }
+    rebx_output_binary_archive_heartbeat(rebx);
 }
 
 /****************************************************************
@@ -997,14 +2630,17 @@ struct rebx_node* rebx_create_node(struct rebx_extras* rebx){
 
 struct rebx_param* rebx_create_param(struct rebx_extras* rebx, const char* name, enum rebx_param_type type){
     // Allocate and initialize new param struct
-    struct rebx_param* param = rebx_malloc(rebx, sizeof(*param));
+    struct rebx_param* param = rebx_pool_alloc(rebx, REBX_POOL_PARAM);
     if (param == NULL){
         return NULL;
     }
     param->type = type;
     param->value = NULL;
+    param->id = -1;       // set when registered or added to an object
+    param->in_column = 0;
     param->name = rebx_malloc(rebx, strlen(name) + 1); // +1 for \0 at end
     if (param->name == NULL){
+        rebx_pool_free(rebx, REBX_POOL_PARAM, param);
         return NULL;
     }
     else{
@@ -1015,18 +2651,90 @@ struct rebx_param* rebx_create_param(struct rebx_extras* rebx, const char* name,
 }
 
 int rebx_add_param(struct rebx_extras* const rebx, struct rebx_node** apptr, struct rebx_param* param){
-    struct rebx_node* node = rebx_create_node(rebx);
+    struct rebx_node* node = rebx_pool_alloc(rebx, REBX_POOL_NODE);
     if (node == NULL){
         return 0;
     }
     node->object = param;
     rebx_add_node(apptr, node);
+    rebx->param_generation++;
+    return 1;
+}
+
+/* Registered params are also kept in an open addressing hash table (linear probing) keyed on name, so lookups by name
+ * are O(1). Registered params are never removed individually, so no tombstones are needed. Each registered param gets
+ * an integer id, which is copied to every param with that name added to an object. Lookups by id then only compare ints.*/
+
+static int rebx_resize_registered_param_table(struct rebx_extras* const rebx, const int size){
+    struct rebx_param** table = calloc(size, sizeof(*table));
+    if (table == NULL){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory.\n");
+        return 0;
+    }
+    const uint32_t mask = size - 1;
+    for (int i=0; i<rebx->registered_param_table_size; i++){
+        struct rebx_param* param = rebx->registered_param_table[i];
+        if (param != NULL){
+            uint32_t slot = reb_hash(param->name) & mask;
+            while (table[slot] != NULL){
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = param;
+        }
+    }
+    free(rebx->registered_param_table);
+    rebx->registered_param_table = table;
+    rebx->registered_param_table_size = size;
+    return 1;
+}
+
+struct rebx_param* rebx_get_registered_param(struct rebx_extras* const rebx, const char* const name){
+    if (rebx->default_params){
+        struct rebx_param* const param = rebx_get_default_param(name);
+        if (param != NULL){
+            return param;
+        }
+    }
+    if (rebx->registered_param_table_size == 0){
+        return NULL;
+    }
+    const uint32_t mask = rebx->registered_param_table_size - 1;
+    uint32_t slot = reb_hash(name) & mask;
+    struct rebx_param* param;
+    while ((param = rebx->registered_param_table[slot]) != NULL){ // table never full, so always terminates
+        if (strcmp(param->name, name) == 0){
+            return param;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+int rebx_add_registered_param(struct rebx_extras* const rebx, struct rebx_param* param){
+    // Keep load factor <= 1/2 so probe sequences stay short. Size is always a power of 2. The shared default params aren't in the table
+    const int N_table = rebx->N_registered_params - (rebx->default_params ? REBX_N_DEFAULT_PARAMS : 0);
+    if (2*(N_table + 1) > rebx->registered_param_table_size){
+        const int size = rebx->registered_param_table_size ? 2*rebx->registered_param_table_size : 16;
+        if (!rebx_resize_registered_param_table(rebx, size)){
+            return 0;
+        }
+    }
+    if (!rebx_add_param(rebx, &rebx->registered_params, param)){
+        return 0;
+    }
+    param->id = rebx->N_registered_params++;
+    const uint32_t mask = rebx->registered_param_table_size - 1;
+    uint32_t slot = reb_hash(param->name) & mask;
+    while (rebx->registered_param_table[slot] != NULL){
+        slot = (slot + 1) & mask;
+    }
+    rebx->registered_param_table[slot] = param;
     return 1;
 }
 
 // needed from Python
 enum rebx_param_type rebx_get_type(struct rebx_extras* rebx, const char* name){
-    struct rebx_param* param = rebx_get_param_struct(rebx, rebx->registered_params, name);
+    struct rebx_param* param = rebx_get_registered_param(rebx, name);
 
     if (param == NULL){ // param not found
         return REBX_TYPE_NONE;
@@ -1044,6 +2752,10 @@ size_t rebx_sizeof(struct rebx_extras* rebx, enum rebx_param_type type){
         {
             return sizeof(int);
         }
+        case REBX_TYPE_UINT32:
+        {
+            return sizeof(uint32_t);
+        }
         case REBX_TYPE_FORCE:
         {
             return sizeof(struct rebx_force);
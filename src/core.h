@@ -44,12 +44,16 @@ struct rebx_node;
 
 void rebx_initialize(struct reb_simulation* sim, struct rebx_extras* rebx); // Initializes all pointers and values.
 void rebx_register_default_params(struct rebx_extras* rebx); // Registers default params
+struct rebx_param* rebx_get_default_params(struct rebx_extras* const rebx, int* const N); // Shared default params the instance uses, in registration order (NULL and N=0 if none)
 void rebx_init_interpolator(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const double* times, const double* values, enum rebx_interpolation_type interpolation);
+void rebx_init_interpolator_borrowed(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation);
+void rebx_init_interpolator_channels(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation);
 
 /**********************************************
  Functions executing forces & ptm each timestep
  *********************************************/
 
+void rebx_update_force_accelerations(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N); // Calls update_constants (if set), then update_accelerations
 void rebx_additional_forces(struct reb_simulation* sim);                       // Calls all the forces that have been added to the simulation.
 void rebx_pre_timestep_modifications(struct reb_simulation* sim);   // Calls all the pre-timestep modifications that have been added to the simulation.
 void rebx_post_timestep_modifications(struct reb_simulation* sim);  // Calls all the post-timestep modifications that have been added to the simulation.
@@ -71,19 +75,30 @@ void rebx_radiation_forces(struct reb_simulation* const sim, struct rebx_force*
 void rebx_stochastic_forces(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_modify_orbits_forces(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_exponential_migration(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
+void rebx_exponential_migration_constants(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_tides_constant_time_lag(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_central_force(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_gravitational_harmonics(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_modify_orbits_with_type_I_migration(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
+void rebx_modify_orbits_with_type_I_migration_constants(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_tides_spin(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 void rebx_yarkovsky_effect(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);
 
+/****************************************
+ Batch kernel prototypes (see rebx_batch_create)
+ *****************************************/
+void rebx_gr_potential_batch(struct rebx_batch* const batch, const int j);
+void rebx_gravitational_harmonics_batch(struct rebx_batch* const batch, const int j);
+void rebx_tides_constant_time_lag_batch(struct rebx_batch* const batch, const int j);
+
 /****************************************
  Operator prototypes
  *****************************************/
 void rebx_modify_mass(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
 void rebx_integrate_force(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
 void rebx_modify_orbits_direct(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
+void rebx_tides_secular(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
+void rebx_param_driver(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
 void rebx_track_min_distance(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
 
 /****************************************
@@ -94,21 +109,98 @@ void rebx_integrator_euler_integrate(struct reb_simulation* const sim, const dou
 void rebx_integrator_rk2_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force);
 void rebx_integrator_rk4_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force);
 void rebx_integrator_implicit_midpoint_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force);
+void rebx_integrator_rk45_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force, const double tolerance);
+
+// Stage buffers shared by the integrators above. Stored on the integrated force and released through its free_arrays hook.
+struct rebx_integrator_workspace{
+    int N_allocated;            // Capacity of the arrays below (particles)
+    int N_vectors;              // Number of 3*N_allocated blocks in v
+    struct reb_particle* ps;    // Stage particles the force is evaluated on
+    double* v;                  // N_vectors blocks of 3*N_allocated doubles (velocities or accelerations)
+    double dt_substep;          // Last accepted substep of the adaptive integrator (0 if none yet)
+};
+
+struct rebx_integrator_workspace* rebx_get_integrator_workspace(struct rebx_extras* const rebx, struct rebx_force* const force, const int N, const int N_vectors); // Grows geometrically past N_allocated. NULL if allocation fails
+void rebx_free_integrator_workspace(struct rebx_extras* rebx, struct rebx_force* force);
+
+// Estimate of which particles a force with a cull_threshold param skips. Stored as its cull_state param
+struct rebx_cull_state{
+    int N;                              // Number of particles at the last estimate (0 if none yet)
+    int N_allocated;                    // Capacity of the arrays below (particles)
+    int N_culled;                       // Number of particles flagged in culled
+    unsigned long long steps_done;      // sim->steps_done at the last estimate
+    unsigned int param_generation;      // rebx_extras.param_generation at the last estimate, which changes when particles are removed
+    unsigned char* culled;              // 1 for particles whose acceleration from the force was below the threshold at the last estimate
+    double* a;                          // Accelerations of the particles before the force, during the estimate
+};
+
+void rebx_free_cull_state(struct rebx_extras* const rebx, struct rebx_force* const force);
 
 void* rebx_malloc(struct rebx_extras* const rebx, size_t memsize);
-void rebx_free_ap(struct rebx_node** ap);
+void rebx_free_ap(struct rebx_extras* const rebx, struct rebx_node** ap);
 void rebx_free_particle_ap(struct reb_particle* p);
 void rebx_free_force(struct rebx_extras* rebx, struct rebx_force* force);
-void rebx_free_operator(struct rebx_operator* operator);
+void rebx_free_operator(struct rebx_extras* rebx, struct rebx_operator* operator);
 void rebx_free_step(struct rebx_step* step);
 void rebx_free_pointers(struct rebx_extras* rebx);
-void rebx_free_param(struct rebx_param* param);
+void rebx_free_param(struct rebx_extras* const rebx, struct rebx_param* param);
+void rebx_init_pools(struct rebx_extras* const rebx);
+void rebx_release_pools(struct rebx_extras* const rebx); // Releases all pooled objects at once
+void* rebx_pool_alloc(struct rebx_extras* const rebx, enum rebx_pool_type type); // Like rebx_malloc, but for objects in the given pool
+void rebx_pool_free(struct rebx_extras* const rebx, enum rebx_pool_type type, void* ptr); // Returns object obtained from rebx_pool_alloc
+void* rebx_param_storage(struct rebx_param* const param); // Storage inside param for values REBOUNDx owns (double, int, uint32 and vec3d). NULL for other types
 void rebx_free_interpolator_pointers(struct rebx_interpolator* const interpolator);
+void rebx_interpolator_memory(const struct rebx_interpolator* const interpolator, struct rebx_memory_usage* const usage); // Adds the arrays the interpolator owns to usage
+
+// Index entry for each snapshot in a binary file, stored at its end
+struct rebx_binary_snapshot{
+    double t;                       // sim->t when the snapshot was written
+    unsigned long long steps_done;  // sim->steps_done when the snapshot was written
+    long offset;                    // File position of the snapshot's SNAPSHOT field
+};
+
+// Parameter set by a param_driver operator. Stored in binaries by output.c
+struct rebx_param_driver_binding{
+    char* name;                             // Parameter name
+    int field;                              // REBX_DRIVER_FIELD_* for particles' m and r, REBX_DRIVER_FIELD_PARAM otherwise
+    int particle_index;                     // -1 for force parameters. Last known index, see rebx_param_driver_particle_index
+    uint32_t hash;                          // Hash of the particle when bound, 0 if it had none (then only particle_index is used)
+    struct rebx_force* force;               // NULL for particle parameters
+    struct rebx_interpolator interpolator;  // Own single channel copy of the series
+};
+
+enum{
+    REBX_DRIVER_FIELD_PARAM,
+    REBX_DRIVER_FIELD_MASS,
+    REBX_DRIVER_FIELD_RADIUS,
+};
+
+// Stored as the pd_bindings param of the operator
+struct rebx_param_driver{
+    int N;
+    int N_allocated;
+    struct rebx_param_driver_binding* bindings;
+};
+
+int rebx_param_driver_particle_index(struct reb_simulation* const sim, const struct rebx_param_driver_binding* const b); // Current index of the particle of a particle binding, -1 if it was removed
+
+struct rebx_binary_snapshot* rebx_input_read_snapshot_index(FILE* inf, long* Nsnapshots, long* pos_end, enum rebx_input_binary_messages* warnings); // inf must be positioned after the header. Falls back to scanning files without an index. pos_end is where the last snapshot ends. Caller frees
+void rebx_output_binary_archive_heartbeat(struct rebx_extras* const rebx); // Appends a snapshot if one is due
+void rebx_free_archive_delta(struct rebx_extras* const rebx);
+void rebx_archive_delta_memory(struct rebx_extras* const rebx, struct rebx_memory_usage* const usage); // Adds the state kept for rebx_output_binary_append_delta to usage
 
 enum rebx_param_type rebx_get_type(struct rebx_extras* rebx, const char* name);
 
-struct rebx_param* rebx_create_param(struct rebx_extras* rebx, const char* name, enum rebx_param_type type);
+struct rebx_param* rebx_create_param(struct rebx_extras* rebx, const char* name, enum rebx_param_type type); // Copies name. For registry entries, params on objects borrow their name from them
 int rebx_add_param(struct rebx_extras* const rebx, struct rebx_node** apptr, struct rebx_param* param);
+int rebx_add_registered_param(struct rebx_extras* const rebx, struct rebx_param* param); // Adds to registered_params and hash table, and assigns id
+struct rebx_param* rebx_get_registered_param(struct rebx_extras* const rebx, const char* const name); // Hash table lookup. NULL if not registered
+void rebx_sync_param_columns(struct rebx_extras* const rebx); // Rebuilds param columns if particles were added or removed
+void rebx_free_param_columns(struct rebx_extras* const rebx);
+void rebx_free_geometries(struct rebx_extras* const rebx);
+void rebx_free_coordinates(struct rebx_extras* const rebx);
+void rebx_free_param_lists(struct rebx_extras* const rebx);
 struct rebx_node* rebx_create_node(struct rebx_extras* rebx);
+const struct rebx_registered_effect* rebx_get_registered_effect(const char* const name); // NULL if no effect is registered with name
 
 #endif
@@ -58,17 +58,58 @@
 #include "reboundx.h"
 #include "rebxtools.h"
 
-static struct  reb_vec3d rebx_calculate_modify_orbits_forces_new(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* p,  struct reb_particle* source){
-
-   struct reb_orbit o = reb_tools_particle_to_orbit(sim->G, *p, *source);
+// Per-particle factors (em_afin - em_aini)/(2 em_tau_a)*exp(-t/em_tau_a), which only depend on time. Zero for particles without em_tau_a
+struct rebx_em_constants{
+    const struct reb_particle* particles;   // Array the factors were computed for
+    int N;
+    double t;
+    double fac[];
+};
 
-    double em_tau_a = INFINITY;
-    double em_aini = 24.;
-    double em_afin = 30.;    
+void rebx_exponential_migration_constants(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
+    struct rebx_extras* const rebx = sim->extras;
+    struct rebx_em_constants* const c = rebx_get_force_constants(rebx, force, sizeof(*c) + N*sizeof(double));
+    if (c == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for exponential_migration.\n");
+        return;
+    }
+    const int id_em_aini = rebx_intern(rebx, "em_aini");
+    const int id_em_afin = rebx_intern(rebx, "em_afin");
+    const struct rebx_param_list* const taus = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "em_tau_a"));
+    if (taus == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for exponential_migration.\n");
+        return;
+    }
+    for (int i=0; i<N; i++){
+        c->fac[i] = 0.;
+    }
+    for (int j=0; j<taus->N_particles; j++){
+        const int i = taus->index[j];
+        const double em_tau_a = *(const double*)taus->values[j];
+        double em_aini = 24.;
+        double em_afin = 30.;
+        const double* const em_ainipoint = rebx_get_param_by_id(rebx, particles[i].ap, id_em_aini);
+        const double* const em_afinpoint = rebx_get_param_by_id(rebx, particles[i].ap, id_em_afin);
+        if(em_ainipoint != NULL){
+            em_aini = *em_ainipoint;
+        }
+        if(em_afinpoint != NULL){
+            em_afin = *em_afinpoint;
+        }
+        c->fac[i] = (em_afin - em_aini)/(2.*em_tau_a)*exp(-(sim->t) / em_tau_a);
+    }
+    c->particles = particles;
+    c->N = N;
+    c->t = sim->t;
+}
 
-    const double* const em_tau_a_ptr = rebx_get_param(sim->extras, p->ap, "em_tau_a");
-    const double* const em_ainipoint = rebx_get_param(sim->extras, p->ap, "em_aini");
-    const double* const em_afinpoint = rebx_get_param(sim->extras, p->ap, "em_afin");
+static struct  reb_vec3d rebx_calculate_modify_orbits_forces_new(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* p,  struct reb_particle* source){
+    const struct rebx_em_constants* const c = rebx_get_force_constants(sim->extras, force, 0); // already sized by rebx_exponential_migration
+    struct reb_vec3d a = {0};
+    const double fac = c->fac[p - c->particles];
+    if (fac == 0.){
+        return a;
+    }
 
     const double dvx = p->vx - source->vx;
     const double dvy = p->vy - source->vy;
@@ -76,25 +117,14 @@ static struct  reb_vec3d rebx_calculate_modify_orbits_forces_new(struct reb_simu
     const double dx = p->x-source->x;
     const double dy = p->y-source->y;
     const double dz = p->z-source->z;
-    const double r2 = dx*dx + dy*dy + dz*dz;
-    
-    if(em_tau_a_ptr != NULL){
-        em_tau_a = *em_tau_a_ptr;
-    }
-    if(em_ainipoint != NULL){
-        em_aini = *em_ainipoint;
-    }
-    if(em_afinpoint != NULL){
-        em_afin = *em_afinpoint;
-    }
-    
-    
-    struct reb_vec3d a = {0};
-
-    a.x =  (dvx/(2.*em_tau_a))*((em_afin - em_aini)/(o.a))*exp(-(sim->t) / em_tau_a);
-    a.y =  (dvy/(2.*em_tau_a))*((em_afin - em_aini)/(o.a))*exp(-(sim->t) / em_tau_a);
-    a.z =  (dvz/(2.*em_tau_a))*((em_afin - em_aini)/(o.a))*exp(-(sim->t) / em_tau_a);
+    const double d = sqrt(dx*dx + dy*dy + dz*dz);
+    const double v2 = dvx*dvx + dvy*dvy + dvz*dvz;
+    const double mu = sim->G*(p->m + source->m);
+    const double inv_a = (2.*mu/d - v2)/mu; // vis-viva, same as the semimajor axis from reb_tools_particle_to_orbit
 
+    a.x = dvx*fac*inv_a;
+    a.y = dvy*fac*inv_a;
+    a.z = dvz*fac*inv_a;
 
     return a;
 }
@@ -106,6 +136,14 @@ void rebx_exponential_migration(struct reb_simulation* const sim, struct rebx_fo
     if (ptr != NULL){
         coordinates = *ptr;
     }
+    const struct rebx_em_constants* const c = rebx_get_force_constants(sim->extras, force, sizeof(*c) + N*sizeof(double));
+    if (c == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for exponential_migration.\n");
+        return;
+    }
+    if (c->particles != particles || c->N != N || c->t != sim->t){ // update_accelerations was called without update_constants
+        rebx_exponential_migration_constants(sim, force, particles, N);
+    }
     const int back_reactions_inclusive = 1;
     const char* reference_name = "primary";
     rebx_com_force(sim, force, coordinates, back_reactions_inclusive, reference_name, rebx_calculate_modify_orbits_forces_new, particles, N);
@@ -46,8 +46,18 @@
  * Field (C type)               Required    Description
  * ============================ =========== ==================================================================
  * c (double)                   Yes         Speed of light in the units used for the simulation.
+ * gr_reuse_gravity (int)       No          If nonzero, take the Newtonian accelerations from REBOUND's gravity calculation (see below).
+ * gr_warm_start (int)          No          If nonzero, start each body's velocity iteration from its solution at the previous call (see below).
+ * gr_tolerance (double)        No          Relative change in the velocities at which their iteration stops. Default machine epsilon.
  * ============================ =========== ==================================================================
  *
+ * The Newtonian accelerations of all bodies are needed in Jacobi coordinates, which costs an extra O(N^2) pass.
+ * With gr_reuse_gravity set, the accelerations REBOUND has just calculated are used instead, as long as gr is the first force added,
+ * and REBOUND is not ignoring any gravity terms (as WHFast and Mercurius do). This is only equivalent for unsoftened gravity with
+ * massless test particles (testparticle_type=0).
+ *
+ * Each call solves for the bodies' velocities iteratively. With gr_warm_start, the iteration for each body starts from the solution
+ * found at the previous call, which together with a looser gr_tolerance typically converges in a single iteration.
  * 
  */
 
@@ -61,43 +71,116 @@
 #include "reboundx.h"
 #include "rebxtools.h"
 
-static void rebx_calculate_gr(struct reb_simulation* const sim, struct reb_particle* const particles, const int N, const double C2, const double G, const int max_iterations){
-    
-    struct reb_particle* const ps = malloc(N*sizeof(*ps));
-    struct reb_particle* const ps_j = malloc(N*sizeof(*ps_j));
-    memcpy(ps, particles, N*sizeof(*ps));
-    
-    // Calculate Newtonian accelerations 
-    for(int i=0; i<N; i++){
-        ps[i].ax = 0.;
-        ps[i].ay = 0.;
-        ps[i].az = 0.;
+// Scratch arrays reused across calls (stored on the force as "gr_workspace"). Grown when N increases.
+struct rebx_gr_workspace{
+    int N_allocated;
+    struct reb_particle* ps;    // N. Inertial copy of the particles with their Newtonian accelerations
+    struct reb_particle* ps_j;  // N. Jacobi coordinates, with the Jacobi accelerations
+    double* A;                  // N. Converged velocity factors from the last call, for gr_warm_start: vi = v/(1-A[i])
+    int N_warm;                 // Number of bodies A was calculated for. 0 if not valid
+};
+
+static void rebx_gr_free_workspace(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_gr_workspace* ws = rebx_get_param(rebx, force->ap, "gr_workspace");
+    if (ws == NULL){
+        return;
     }
+    free(ws->ps);
+    free(ws->ps_j);
+    free(ws->A);
+    free(ws);
+    rebx_set_param_pointer(rebx, &force->ap, "gr_workspace", NULL);
+}
 
-    for(int i=0; i<N; i++){
-        const struct reb_particle pi = ps[i];
-        for(int j=i+1; j<N; j++){
-            const struct reb_particle pj = ps[j];
-            const double dx = pi.x - pj.x;
-            const double dy = pi.y - pj.y;
-            const double dz = pi.z - pj.z;
-            const double r2 = dx*dx + dy*dy + dz*dz;
-            const double r = sqrt(r2);
-            const double prefac = G/(r2*r);
-            ps[i].ax -= prefac*pj.m*dx;
-            ps[i].ay -= prefac*pj.m*dy;
-            ps[i].az -= prefac*pj.m*dz;
-            ps[j].ax += prefac*pi.m*dx;
-            ps[j].ay += prefac*pi.m*dy;
-            ps[j].az += prefac*pi.m*dz;
+static void rebx_gr_workspace_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const struct rebx_gr_workspace* const ws = rebx_get_param(rebx, force->ap, "gr_workspace");
+    if (ws == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws, sizeof(*ws));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->ps, ws->N_allocated*sizeof(*ws->ps));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->ps_j, ws->N_allocated*sizeof(*ws->ps_j));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->A, ws->N_allocated*sizeof(*ws->A));
+}
+
+static struct rebx_gr_workspace* rebx_gr_get_workspace(struct rebx_extras* const rebx, struct rebx_force* const force, const int N){
+    struct rebx_gr_workspace* ws = rebx_get_param(rebx, force->ap, "gr_workspace");
+    if (ws == NULL){
+        ws = calloc(1, sizeof(*ws));
+        if (ws == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, "gr_workspace", ws);
+        rebx_set_param_pointer(rebx, &force->ap, "free_workspace", rebx_gr_free_workspace);
+        rebx_set_param_pointer(rebx, &force->ap, "workspace_memory", rebx_gr_workspace_memory);
+    }
+    if (N > ws->N_allocated){
+        free(ws->ps);
+        free(ws->ps_j);
+        free(ws->A);
+        ws->ps = malloc(N*sizeof(*ws->ps));
+        ws->ps_j = malloc(N*sizeof(*ws->ps_j));
+        ws->A = malloc(N*sizeof(*ws->A));
+        ws->N_allocated = N;
+        ws->N_warm = 0;
+        if (!ws->ps || !ws->ps_j || !ws->A){
+            rebx_gr_free_workspace(rebx, force);
+            return NULL;
         }
     }
+    return ws;
+}
+
+static void rebx_calculate_gr(struct reb_simulation* const sim, struct rebx_gr_workspace* const ws, struct reb_particle* const particles, const int N, const double C2, const double G, const int max_iterations, const int reuse_gravity, const double tolerance, const int warm_start){
+    
+    struct reb_particle* const ps = ws->ps;
+    struct reb_particle* const ps_j = ws->ps_j;
+    memcpy(ps, particles, N*sizeof(*ps)); // with reuse_gravity, this also copies REBOUND's Newtonian accelerations
+
+    // Calculate Newtonian accelerations. Kept serial so the pairwise sums are added in the same order for any number of threads
+    if (!reuse_gravity){
+        for(int i=0; i<N; i++){
+            ps[i].ax = 0.;
+            ps[i].ay = 0.;
+            ps[i].az = 0.;
+        }
+
+        for(int i=0; i<N; i++){
+            const struct reb_particle pi = ps[i];
+            for(int j=i+1; j<N; j++){
+                const struct reb_particle pj = ps[j];
+                const double dx = pi.x - pj.x;
+                const double dy = pi.y - pj.y;
+                const double dz = pi.z - pj.z;
+                const double r2 = dx*dx + dy*dy + dz*dz;
+                const double r = sqrt(r2);
+                const double prefac = G/(r2*r);
+                ps[i].ax -= prefac*pj.m*dx;
+                ps[i].ay -= prefac*pj.m*dy;
+                ps[i].az -= prefac*pj.m*dz;
+                ps[j].ax += prefac*pi.m*dx;
+                ps[j].ay += prefac*pi.m*dy;
+                ps[j].az += prefac*pi.m*dz;
+            }
+        }
    
-    // Transform to Jacobi coordinates
+    }
+   
+    // Transform to Jacobi coordinates. Positions and velocities are shared with other forces during the pass, only the accelerations are ours
     const struct reb_particle source = ps[0];
 	const double mu = G*source.m;
-    reb_transformations_inertial_to_jacobi_posvelacc(ps, ps_j, ps, N, N);
+    const struct rebx_coordinates* const jacobi = rebx_get_coordinates(sim->extras, particles, N, REBX_COORDINATES_JACOBI, 0);
+    if (jacobi == NULL){
+        return;
+    }
+    memcpy(ps_j, jacobi->ps, N*sizeof(*ps_j));
+    reb_transformations_inertial_to_jacobi_acc(ps, ps_j, ps, N, N);
     
+    const double tolerance2 = tolerance*tolerance;
+    double* const A_warm = ws->A;
+    const int warm = warm_start && ws->N_warm == N; // bodies keep their Jacobi index as long as N doesn't change
+    int N_unconverged = 0; // reb_warning is not thread safe, so only warn once after the loop
+#pragma omp parallel for schedule(guided) reduction(+:N_unconverged)
     for (int i=1; i<N; i++){
         struct reb_particle p = ps_j[i];
         struct reb_vec3d vi;
@@ -108,6 +191,13 @@ static void rebx_calculate_gr(struct reb_simulation* const sim, struct reb_parti
         const double ri = sqrt(p.x*p.x + p.y*p.y + p.z*p.z);
         int q = 0;
         double A = (0.5*vi2 + 3.*mu/ri)/C2;
+        if (warm){ // start from the last solution, so the first iteration already compares against a good guess
+            vi.x = p.vx/(1.-A_warm[i]);
+            vi.y = p.vy/(1.-A_warm[i]);
+            vi.z = p.vz/(1.-A_warm[i]);
+            vi2 = vi.x*vi.x + vi.y*vi.y + vi.z*vi.z;
+            A = (0.5*vi2 + 3.*mu/ri)/C2;
+        }
         struct reb_vec3d old_v;
         for(q=0; q<max_iterations; q++){
             old_v.x = vi.x;
@@ -121,13 +211,14 @@ static void rebx_calculate_gr(struct reb_simulation* const sim, struct reb_parti
             const double dvx = vi.x - old_v.x;
             const double dvy = vi.y - old_v.y;
             const double dvz = vi.z - old_v.z;
-            if ((dvx*dvx + dvy*dvy + dvz*dvz)/vi2 < DBL_EPSILON*DBL_EPSILON){
+            if ((dvx*dvx + dvy*dvy + dvz*dvz)/vi2 < tolerance2){
                 break;
             }
         }
+        A_warm[i] = A;
         const int default_max_iterations = 10;
         if(q==default_max_iterations){
-            reb_warning(sim, "REBOUNDx Warning: 10 iterations in gr.c failed to converge. This is typically because the perturbation is too strong for the current implementation.");
+            N_unconverged++;
         }
   
         const double B = (mu/ri - 1.5*vi2)*mu/(ri*ri*ri)/C2;
@@ -146,19 +237,23 @@ static void rebx_calculate_gr(struct reb_simulation* const sim, struct reb_parti
         ps_j[i].az = B*(1.-A)*p.z - A*p.az - D*vi.z;
     }
     
+    if (N_unconverged > 0){
+        reb_warning(sim, "REBOUNDx Warning: 10 iterations in gr.c failed to converge. This is typically because the perturbation is too strong for the current implementation.");
+    }
+    
+    ws->N_warm = warm_start ? N : 0;
+
     ps_j[0].ax = 0.;
     ps_j[0].ay = 0.;
     ps_j[0].az = 0.;
 
     reb_transformations_jacobi_to_inertial_acc(ps, ps_j, ps, N, N);
+#pragma omp parallel for schedule(guided)
     for (int i=0; i<N; i++){
         particles[i].ax += ps[i].ax;
         particles[i].ay += ps[i].ay;
         particles[i].az += ps[i].az;
     }
-    
-    free(ps);
-    free(ps_j);
 }
 
 void rebx_gr(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
@@ -167,22 +262,37 @@ void rebx_gr(struct reb_simulation* const sim, struct rebx_force* const force, s
         reb_error(sim, "REBOUNDx Error: Need to set speed of light in gr effect.  See examples in documentation.\n");
         return;
     }
+    struct rebx_extras* const rebx = sim->extras;
+    struct rebx_gr_workspace* const ws = rebx_gr_get_workspace(rebx, force, N);
+    if (ws == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for gr.\n");
+        return;
+    }
     const double C2 = (*c)*(*c);
-    int* max_iterations = rebx_get_param(sim->extras, force->ap, "max_iterations");
+    // particles only hold REBOUND's gravity if we are the first force in rebx_additional_forces (geometry_epoch odd during the pass)
+    const int* const reuse_gravity_ptr = rebx_get_param(rebx, force->ap, "gr_reuse_gravity");
+    const int reuse_gravity = reuse_gravity_ptr != NULL && *reuse_gravity_ptr
+        && (rebx->geometry_epoch & 1) && particles == sim->particles && sim->gravity_ignore_terms == 0
+        && rebx->additional_forces != NULL && rebx->additional_forces->object == force;
+    const int* const warm_start = rebx_get_param(rebx, force->ap, "gr_warm_start");
+    const double* const tolerance = rebx_get_param(rebx, force->ap, "gr_tolerance");
+    const double tol = tolerance != NULL ? *tolerance : DBL_EPSILON;
+    const int warm = warm_start != NULL && *warm_start;
+    int* max_iterations = rebx_get_param(rebx, force->ap, "max_iterations");
     if(max_iterations != NULL){
-        rebx_calculate_gr(sim, particles, N, C2, sim->G, *max_iterations);
+        rebx_calculate_gr(sim, ws, particles, N, C2, sim->G, *max_iterations, reuse_gravity, tol, warm);
     }
     else{
         const int default_max_iterations = 10;
-        rebx_calculate_gr(sim, particles, N, C2, sim->G, default_max_iterations);
+        rebx_calculate_gr(sim, ws, particles, N, C2, sim->G, default_max_iterations, reuse_gravity, tol, warm);
     }
 }
 
-static double rebx_calculate_gr_hamiltonian(struct rebx_extras* const rebx, struct reb_simulation* const sim, const double C2){
+static double rebx_calculate_gr_hamiltonian(struct rebx_extras* const rebx, struct reb_simulation* const sim, const struct rebx_coordinates* const jacobi, const double C2){
     const int N = sim->N - sim->N_var;
     const double G = sim->G;
 
-    struct reb_particle* const ps_j = malloc(N*sizeof(*ps_j));
+    const struct reb_particle* const ps_j = jacobi->ps;
     struct reb_particle* const ps = sim->particles; 
     // Calculate Newtonian potentials
 
@@ -200,12 +310,10 @@ static double rebx_calculate_gr_hamiltonian(struct rebx_extras* const rebx, stru
         }
     }
    
-    // Transform to Jacobi coordinates
+    // Jacobi coordinates
     const struct reb_particle source = ps[0];
 	const double mu = G*source.m;
-    double* const m_j = malloc(N*sizeof(*m_j));
-    rebx_calculate_jacobi_masses(ps, m_j, N);
-    reb_transformations_inertial_to_jacobi_posvel(ps, ps_j, ps, N, N);
+    const double* const m_j = jacobi->m_j;
 
     double T = 0.5*m_j[0]*(ps_j[0].vx*ps_j[0].vx + ps_j[0].vy*ps_j[0].vy + ps_j[0].vz*ps_j[0].vz);
     double V_PN = 0.;
@@ -230,14 +338,11 @@ static double rebx_calculate_gr_hamiltonian(struct rebx_extras* const rebx, stru
     }
     V_PN /= C2;
     
-    free(ps_j);
-    free(m_j);
-    
 	return T + V_newt + V_PN;
 }
 
 double rebx_gr_hamiltonian(struct rebx_extras* const rebx, const struct rebx_force* const gr){
-    double* c = rebx_get_param(rebx, gr->ap, "c");
+    double* c = rebx_get_param_by_id(rebx, gr->ap, rebx_intern(rebx, "c"));
     if (c == NULL){
         rebx_error(rebx, "Need to set speed of light in gr effect.  See examples in documentation.\n");
         return 0;
@@ -247,6 +352,11 @@ double rebx_gr_hamiltonian(struct rebx_extras* const rebx, const struct rebx_for
         rebx_error(rebx, ""); // rebx_error gives meaningful err
         return 0;
     }
-    return rebx_calculate_gr_hamiltonian(rebx, rebx->sim, C2);
+    const int N = rebx->sim->N - rebx->sim->N_var;
+    const struct rebx_coordinates* const jacobi = rebx_get_coordinates(rebx, rebx->sim->particles, N, REBX_COORDINATES_JACOBI, 0);
+    if (jacobi == NULL){
+        return 0;
+    }
+    return rebx_calculate_gr_hamiltonian(rebx, rebx->sim, jacobi, C2);
 }
 
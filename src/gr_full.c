@@ -37,13 +37,21 @@
  * 
  * This algorithm incorporates the first-order post-newtonian effects from all bodies in the system, and is necessary for multiple massive bodies like stellar binaries.
  *
+ * As for REBOUND's gravity, particles beyond sim->N_active are test particles that don't act on one another, and only act on the active particles
+ * if sim->testparticle_type is 1. The interactions are summed over all pairs of bodies that act on each other, so the cost grows as N*N_active.
+ * For large N (e.g. stars in a nuclear star cluster), setting gr_full_opening_angle sums the interactions with distant groups of bodies through an octree (Barnes & Hut 1986),
+ * treating each group as a single body at its center of mass that carries the (mass-weighted) sums of the velocities, potentials and accelerations entering the corrections.
+ * Groups are opened down to individual bodies when their width over their distance exceeds the opening angle, so interactions between nearby bodies are kept exact.
+ * The relative errors in the corrections scale roughly with the opening angle, and the approximation becomes exact as it goes to zero.
+ *
  * **Effect Parameters**
  * 
- * ============================ =========== ==================================================================
- * Field (C type)               Required    Description
- * ============================ =========== ==================================================================
- * c (double)                   Yes         Speed of light in the units used for the simulation.
- * ============================ =========== ==================================================================
+ * ================================ =========== ==================================================================
+ * Field (C type)                   Required    Description
+ * ================================ =========== ==================================================================
+ * c (double)                       Yes         Speed of light in the units used for the simulation.
+ * gr_full_opening_angle (double)   No          If set and positive, opening angle for approximating distant interactions with an octree (e.g. 0.5). Exact if not set.
+ * ================================ =========== ==================================================================
  * 
  * **Particle Parameters**
  * 
@@ -57,14 +65,220 @@
 #include <string.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "rebxtools.h"
+
+// Octree cell for gr_full_opening_angle. Distant cells act like a single body at their center of mass, carrying the mass-weighted
+// sums of the quantities the pair terms need from the other body
+struct rebx_gr_full_cell{
+    double cx, cy, cz;      // Geometric center
+    double w;               // Width
+    double m;               // Total mass
+    double x, y, z;         // Center of mass (geometric center if massless)
+    double mpot1;           // sum m_j pot1[j]
+    double mv2;             // sum m_j v_j^2
+    double mv[3];           // sum m_j v_j
+    double mvv[6];          // sum m_j v_j v_j (xx, xy, xz, yy, yz, zz)
+    double mA[3];           // sum m_j (a_newton[j] + a_old[j]). Updated on every substitution
+    int oct[8];             // Child cells (-1 if empty)
+    int first;              // First body in a leaf (further ones chained through next). -1 for internal cells
+};
+
+#define REBX_GR_FULL_MAX_DEPTH 64 // Bodies closer than the root width/2^64 (e.g. at the same position) share a leaf
+
+// Scratch arrays reused across calls (stored on the force as "gr_full_workspace"). Grown when N increases.
+struct rebx_gr_full_workspace{
+    int N_allocated;
+    double* a_const;        // 3N. Constant terms
+    double* a_newton;       // 3N. Newtonian terms
+    double* a_new;          // 3N. Newly calculated terms
+    double* a_old;          // 3N. Previously calculated terms
+    double* pot4;           // N. (4/c^2) sum_k G m_k/r_ik (a1 term)
+    double* pot1;           // N. (1/c^2) sum_k G m_k/r_ik (a2 term)
+    // Only used with gr_full_opening_angle
+    struct rebx_gr_full_cell* cells;
+    int N_cells;
+    int N_cells_allocated;
+    int* next;              // N. Next body in the same leaf (-1 if last)
+    size_t* offsets;        // N+1. Interactions of body i are interactions[offsets[i]] to interactions[offsets[i+1]-1]
+    int* interactions;      // Cells c >= 0 summed through their moments, and bodies j summed exactly stored as -(j+1)
+    size_t N_interactions_allocated;
+};
+
+static void rebx_gr_full_free_workspace(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_gr_full_workspace* ws = rebx_get_param(rebx, force->ap, "gr_full_workspace");
+    if (ws == NULL){
+        return;
+    }
+    free(ws->a_const);
+    free(ws->a_newton);
+    free(ws->a_new);
+    free(ws->a_old);
+    free(ws->pot4);
+    free(ws->pot1);
+    free(ws->cells);
+    free(ws->next);
+    free(ws->offsets);
+    free(ws->interactions);
+    free(ws);
+    rebx_set_param_pointer(rebx, &force->ap, "gr_full_workspace", NULL);
+}
+
+static void rebx_gr_full_workspace_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const struct rebx_gr_full_workspace* const ws = rebx_get_param(rebx, force->ap, "gr_full_workspace");
+    if (ws == NULL){
+        return;
+    }
+    const size_t N = ws->N_allocated;
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws, sizeof(*ws));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->a_const, 3*N*sizeof(double));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->a_newton, 3*N*sizeof(double));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->a_new, 3*N*sizeof(double));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->a_old, 3*N*sizeof(double));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->pot4, N*sizeof(double));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->pot1, N*sizeof(double));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->next, N*sizeof(int));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->offsets, (N+1)*sizeof(size_t));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->cells, ws->N_cells_allocated*sizeof(*ws->cells));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, ws->interactions, ws->N_interactions_allocated*sizeof(*ws->interactions));
+}
+
+static struct rebx_gr_full_workspace* rebx_gr_full_get_workspace(struct rebx_extras* const rebx, struct rebx_force* const force, const int N){
+    struct rebx_gr_full_workspace* ws = rebx_get_param(rebx, force->ap, "gr_full_workspace");
+    if (ws == NULL){
+        ws = calloc(1, sizeof(*ws));
+        if (ws == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, "gr_full_workspace", ws);
+        rebx_set_param_pointer(rebx, &force->ap, "free_workspace", rebx_gr_full_free_workspace);
+        rebx_set_param_pointer(rebx, &force->ap, "workspace_memory", rebx_gr_full_workspace_memory);
+    }
+    if (N > ws->N_allocated){
+        free(ws->a_const);
+        free(ws->a_newton);
+        free(ws->a_new);
+        free(ws->a_old);
+        free(ws->pot4);
+        free(ws->pot1);
+        free(ws->next);
+        free(ws->offsets);
+        ws->a_const = malloc(3*N*sizeof(double));
+        ws->a_newton = malloc(3*N*sizeof(double));
+        ws->a_new = malloc(3*N*sizeof(double));
+        ws->a_old = malloc(3*N*sizeof(double));
+        ws->pot4 = malloc(N*sizeof(double));
+        ws->pot1 = malloc(N*sizeof(double));
+        ws->next = malloc(N*sizeof(int));
+        ws->offsets = malloc((N+1)*sizeof(size_t));
+        ws->N_allocated = N;
+        if (!ws->a_const || !ws->a_newton || !ws->a_new || !ws->a_old || !ws->pot4 || !ws->pot1 || !ws->next || !ws->offsets){
+            rebx_gr_full_free_workspace(rebx, force);
+            return NULL;
+        }
+    }
+    return ws;
+}
+
+// Constant terms on body i from body j, with a1 = pot4[i] and a2 = pot1[j]
+static inline void rebx_gr_full_add_const_pair(const struct reb_particle* const pi, const struct reb_particle* const pj, const double a1, const double a2, const double C2, const double G, double* const a_constx, double* const a_consty, double* const a_constz){
+    const double dxij = pi->x - pj->x;
+    const double dyij = pi->y - pj->y;
+    const double dzij = pi->z - pj->z;
+    const double rij = sqrt(dxij*dxij + dyij*dyij + dzij*dzij);
+    const double rij2 = rij*rij;
+    const double rij3 = rij2*rij;
+    const double vi2 = pi->vx*pi->vx + pi->vy*pi->vy + pi->vz*pi->vz;
+    const double a3 = -vi2/(C2);
+
+    double a4;
+    double vj2 = pj->vx*pj->vx + pj->vy*pj->vy + pj->vz*pj->vz;
+    a4 = -2.*vj2/(C2);
+
+    double a5;
+    a5 = (4./(C2)) * (pi->vx*pj->vx + pi->vy*pj->vy + pi->vz*pj->vz); 
+    
+    double a6;
+    double a6_0 = dxij*pj->vx + dyij*pj->vy + dzij*pj->vz;
+    a6 = (3./(2.*C2)) * a6_0*a6_0/rij2;
+    
+    double factor1 = a1 + a2 + a3 + a4 + a5 + a6;
+     
+    *a_constx += G*pj->m*dxij*factor1/rij3;
+    *a_consty += G*pj->m*dyij*factor1/rij3;
+    *a_constz += G*pj->m*dzij*factor1/rij3;
+
+    // 2nd constant part
+    
+    const double dvxij = pi->vx - pj->vx;
+    const double dvyij = pi->vy - pj->vy;
+    const double dvzij = pi->vz - pj->vz;
+        
+    double factor2 = dxij*(4.*pi->vx-3.*pj->vx)+dyij*(4.*pi->vy-3.*pj->vy)+dzij*(4.*pi->vz-3.*pj->vz);
 
-static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct reb_particle* const particles, const int N, const double C2, const double G, const int max_iterations, const int gravity_ignore_10){
+    *a_constx += G*pj->m*factor2*dvxij/rij3/(C2);
+    *a_consty += G*pj->m*factor2*dvyij/rij3/(C2);
+    *a_constz += G*pj->m*factor2*dvzij/rij3/(C2);
+}
+
+// Non-constant terms on body i from body j, with A = a_newton[j] + a_old[j]
+static inline void rebx_gr_full_add_non_const_pair(const struct reb_particle* const pi, const struct reb_particle* const pj, const double* const a_newtonj, const double* const a_oldj, const double C2, const double G, double* const non_constx, double* const non_consty, double* const non_constz){
+    const double dxij = pi->x - pj->x;
+    const double dyij = pi->y - pj->y;
+    const double dzij = pi->z - pj->z;
+    const double rij = sqrt(dxij*dxij + dyij*dyij + dzij*dzij);
+    const double rij3 = rij*rij*rij;
+    *non_constx += (G*pj->m*dxij/rij3)*(dxij*(a_newtonj[0]+a_oldj[0])+dyij*(a_newtonj[1]+a_oldj[1])+\
+                dzij*(a_newtonj[2]+a_oldj[2]))/(2.*C2) + (7./(2.*C2))*G*pj->m*(a_newtonj[0]+a_oldj[0])/rij;
+    *non_consty += (G*pj->m*dyij/rij3)*(dxij*(a_newtonj[0]+a_oldj[0])+dyij*(a_newtonj[1]+a_oldj[1])+\
+                dzij*(a_newtonj[2]+a_oldj[2]))/(2.*C2) + (7./(2.*C2))*G*pj->m*(a_newtonj[1]+a_oldj[1])/rij;
+    *non_constz += (G*pj->m*dzij/rij3)*(dxij*(a_newtonj[0]+a_oldj[0])+dyij*(a_newtonj[1]+a_oldj[1])+\
+                dzij*(a_newtonj[2]+a_oldj[2]))/(2.*C2) + (7./(2.*C2))*G*pj->m*(a_newtonj[2]+a_oldj[2])/rij;
+}
+
+static void rebx_gr_full_newton_ignore_10(const struct reb_particle* const particles, double (*const a_newton)[3], const double G){
+    const double dx01 = particles[0].x - particles[1].x;
+    const double dy01 = particles[0].y - particles[1].y;
+    const double dz01 = particles[0].z - particles[1].z;
+    const double r01 = sqrt(dx01*dx01 + dy01*dy01 + dz01*dz01);
+    const double prefact = -G/(r01*r01*r01);
+    const double prefact0 = prefact*particles[0].m;
+    const double prefact1 = prefact*particles[1].m;
+    a_newton[0][0] += prefact1*dx01;
+    a_newton[0][1] += prefact1*dy01;
+    a_newton[0][2] += prefact1*dz01;
+    a_newton[1][0] -= prefact0*dx01;
+    a_newton[1][1] -= prefact0*dy01;
+    a_newton[1][2] -= prefact0*dz01;
+}
+
+// Largest relative change in the components of a_new
+static double rebx_gr_full_maxdev(double (*const a_new)[3], double (*const a_old)[3], const int N){
+    double maxdev = 0.;
+    double dx, dy, dz;
+    for (int i = 0; i < N; i++){
+        dx = (fabs(a_new[i][0]) < 1.e-30) ? 0. : fabs(a_new[i][0] - a_old[i][0])/a_new[i][0];
+        dy = (fabs(a_new[i][1]) < 1.e-30) ? 0. : fabs(a_new[i][1] - a_old[i][1])/a_new[i][1];
+        dz = (fabs(a_new[i][2]) < 1.e-30) ? 0. : fabs(a_new[i][2] - a_old[i][2])/a_new[i][2];
+        
+        if (dx > maxdev) { maxdev = dx; }
+        if (dy > maxdev) { maxdev = dy; }
+        if (dz > maxdev) { maxdev = dz; }
+    }
+    return maxdev;
+}
+
+/* The potential sums in the constant terms only depend on one body, so they are computed once per body (O(N^2) total)
+ * rather than inside the pair loop. Pairwise separations are recomputed where needed instead of stored in N x N arrays,
+ * so memory is O(N). Terms are evaluated in the same order as before so results are unchanged bit for bit.*/
+static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct rebx_gr_full_workspace* const ws, struct reb_particle* const particles, const int N, const double C2, const double G, const int max_iterations, const int gravity_ignore_10){
     
-    double a_const[N][3]; // array that stores the value of the constant term
-    double a_newton[N][3]; // stores the Newtonian term
-    double a_new[N][3]; // stores the newly calculated term
-    double rs[N][N];
-    double drs[N][N][3];
+    double (*const a_const)[3] = (double (*)[3])ws->a_const; // array that stores the value of the constant term
+    double (*const a_newton)[3] = (double (*)[3])ws->a_newton; // stores the Newtonian term
+    double (*const a_new)[3] = (double (*)[3])ws->a_new; // stores the newly calculated term
+    double (*const a_old)[3] = (double (*)[3])ws->a_old; // stores the previously calculated term
+    double* const pot4 = ws->pot4;
+    double* const pot1 = ws->pot1;
+    const int N_active = rebx_get_N_active(sim, N);
 
     for (int i=0; i<N; i++){
         // compute the Newtonian term 
@@ -75,30 +289,26 @@ static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct reb_
         a_new[i][1] = 0.;
         a_new[i][2] = 0.;
 
-        for(int j=i+1; j<N; j++){
-            if (j!=i){
-                drs[i][j][0] = particles[i].x - particles[j].x;
-                drs[i][j][1] = particles[i].y - particles[j].y;
-                drs[i][j][2] = particles[i].z - particles[j].z;
-                drs[j][i][0] = -drs[i][j][0];
-                drs[j][i][1] = -drs[i][j][1];
-                drs[j][i][2] = -drs[i][j][2];
-                rs[i][j] = sqrt(drs[i][j][0]*drs[i][j][0] + drs[i][j][1]*drs[i][j][1] + drs[i][j][2]*drs[i][j][2]);
-                rs[j][i] = rs[i][j];
+        // potential sums for the a1 and a2 terms below
+        double a1 = 0.;
+        double a2 = 0.;
+        const int N_sources = rebx_get_N_sources(sim, N_active, N, i);
+        for (int k=0; k<N_sources; k++){
+            if (k != i){
+                const double dx = particles[i].x - particles[k].x;
+                const double dy = particles[i].y - particles[k].y;
+                const double dz = particles[i].z - particles[k].z;
+                const double rik = sqrt(dx*dx + dy*dy + dz*dz);
+                a1 += (4./(C2)) * G*particles[k].m/rik;
+                a2 += (1./(C2)) * G*particles[k].m/rik;
             }
         }
+        pot4[i] = a1;
+        pot1[i] = a2;
     }
 
-    if (gravity_ignore_10){
-        const double prefact = -G/(rs[0][1]*rs[0][1]*rs[0][1]);
-        const double prefact0 = prefact*particles[0].m;
-        const double prefact1 = prefact*particles[1].m;
-        a_newton[0][0] += prefact1*drs[0][1][0];
-        a_newton[0][1] += prefact1*drs[0][1][1];
-        a_newton[0][2] += prefact1*drs[0][1][2];
-        a_newton[1][0] -= prefact0*drs[0][1][0];
-        a_newton[1][1] -= prefact0*drs[0][1][1];
-        a_newton[1][2] -= prefact0*drs[0][1][2];
+    if (gravity_ignore_10 && N > 1){
+        rebx_gr_full_newton_ignore_10(particles, a_newton, G);
     }
 
     for (int i=0; i<N; i++){
@@ -106,61 +316,11 @@ static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct reb_
         double a_constx = 0.;
         double a_consty = 0.;
         double a_constz = 0.;
-        // 1st constant part
-        for (int j = 0; j< N; j++){
+        // 1st and 2nd constant parts
+        const int N_sources = rebx_get_N_sources(sim, N_active, N, i);
+        for (int j = 0; j< N_sources; j++){
             if (j != i){
-                const double dxij = drs[i][j][0];
-                const double dyij = drs[i][j][1];
-                const double dzij = drs[i][j][2];
-                const double rij2 = rs[i][j]*rs[i][j];
-                const double rij3 = rij2*rs[i][j];
-                
-                double a1 = 0.;
-                for (int k = 0; k< N; k++){
-                    if (k != i){
-                        a1 += (4./(C2)) * G*particles[k].m/rs[i][k];
-                    }
-                }
-
-                double a2 = 0.;
-                for (int l = 0; l< N; l++){
-                    if (l != j){
-                        a2 += (1./(C2)) * G*particles[l].m/rs[l][j];
-                    }
-                }
-
-                double a3;
-                double vi2 = particles[i].vx*particles[i].vx + particles[i].vy*particles[i].vy + particles[i].vz*particles[i].vz;
-                a3 = -vi2/(C2);
-
-                double a4;
-                double vj2 = particles[j].vx*particles[j].vx + particles[j].vy*particles[j].vy + particles[j].vz*particles[j].vz;
-                a4 = -2.*vj2/(C2);
-
-                double a5;
-                a5 = (4./(C2)) * (particles[i].vx*particles[j].vx + particles[i].vy*particles[j].vy + particles[i].vz*particles[j].vz); 
-                
-                double a6;
-                double a6_0 = dxij*particles[j].vx + dyij*particles[j].vy + dzij*particles[j].vz;
-                a6 = (3./(2.*C2)) * a6_0*a6_0/rij2;
-                
-                double factor1 = a1 + a2 + a3 + a4 + a5 + a6;
-                 
-                a_constx += G*particles[j].m*dxij*factor1/rij3;
-                a_consty += G*particles[j].m*dyij*factor1/rij3;
-                a_constz += G*particles[j].m*dzij*factor1/rij3;
-        
-                // 2nd constant part
-                
-                const double dvxij = particles[i].vx - particles[j].vx;
-                const double dvyij = particles[i].vy - particles[j].vy;
-                const double dvzij = particles[i].vz - particles[j].vz;
-                    
-                double factor2 = dxij*(4.*particles[i].vx-3.*particles[j].vx)+dyij*(4.*particles[i].vy-3.*particles[j].vy)+dzij*(4.*particles[i].vz-3.*particles[j].vz);
-
-                a_constx += G*particles[j].m*factor2*dvxij/rij3/(C2);
-                a_consty += G*particles[j].m*factor2*dvyij/rij3/(C2);
-                a_constz += G*particles[j].m*factor2*dvzij/rij3/(C2);
+                rebx_gr_full_add_const_pair(&particles[i], &particles[j], pot4[i], pot1[j], C2, G, &a_constx, &a_consty, &a_constz);
             }
         }  
 
@@ -171,7 +331,6 @@ static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct reb_
 
     // Now running the substitution again and again through the loop below
     for (int k=0; k<10; k++){ // you can set k as how many substitution you want to make
-        double a_old[N][3]; // initialize an arry that stores the information of previousu calculated accleration
         for (int i =0; i <N; i++){
             a_old[i][0] = a_new[i][0]; // when k = 0, a_new is the Newtownian term which calculated before
             a_old[i][1] = a_new[i][1];
@@ -182,19 +341,10 @@ static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct reb_
             double non_constx = 0.;
             double non_consty = 0.;
             double non_constz = 0.;
-            for (int j = 0; j < N; j++){
+            const int N_sources = rebx_get_N_sources(sim, N_active, N, i);
+            for (int j = 0; j < N_sources; j++){
                 if (j != i){
-                    const double dxij = drs[i][j][0];
-                    const double dyij = drs[i][j][1];
-                    const double dzij = drs[i][j][2];
-                    const double rij = rs[i][j];
-                    const double rij3 = rij*rij*rij;
-                    non_constx += (G*particles[j].m*dxij/rij3)*(dxij*(a_newton[j][0]+a_old[j][0])+dyij*(a_newton[j][1]+a_old[j][1])+\
-                                dzij*(a_newton[j][2]+a_old[j][2]))/(2.*C2) + (7./(2.*C2))*G*particles[j].m*(a_newton[j][0]+a_old[j][0])/rij;
-                    non_consty += (G*particles[j].m*dyij/rij3)*(dxij*(a_newton[j][0]+a_old[j][0])+dyij*(a_newton[j][1]+a_old[j][1])+\
-                                dzij*(a_newton[j][2]+a_old[j][2]))/(2.*C2) + (7./(2.*C2))*G*particles[j].m*(a_newton[j][1]+a_old[j][1])/rij;
-                    non_constz += (G*particles[j].m*dzij/rij3)*(dxij*(a_newton[j][0]+a_old[j][0])+dyij*(a_newton[j][1]+a_old[j][1])+\
-                                dzij*(a_newton[j][2]+a_old[j][2]))/(2.*C2) + (7./(2.*C2))*G*particles[j].m*(a_newton[j][2]+a_old[j][2])/rij;
+                    rebx_gr_full_add_non_const_pair(&particles[i], &particles[j], a_newton[j], a_old[j], C2, G, &non_constx, &non_consty, &non_constz);
                 }
             }
             a_new[i][0] = (a_const[i][0] + non_constx);
@@ -203,26 +353,453 @@ static void rebx_calculate_gr_full(struct reb_simulation* const sim, struct reb_
         }
         
         // break out loop if a_new is converging
-        double maxdev = 0.;
-        double dx, dy, dz;
+        if (rebx_gr_full_maxdev(a_new, a_old, N) < 1.e-30){
+            break;
+        }
+        if (k==9){
+            reb_warning(sim, "10 loops in rebx_gr_full did not converge.\n");
+        }
+    }
+    // update acceleration in particles
+    for (int i = 0; i <N;i++){
+        particles[i].ax += a_new[i][0];
+        particles[i].ay += a_new[i][1];
+        particles[i].az += a_new[i][2];
+    }
+}
+
+/*****************************************************************
+ Octree approximation (gr_full_opening_angle)
+ *****************************************************************/
+
+// Returns the index of the new cell, or -1 if memory could not be allocated
+static int rebx_gr_full_new_cell(struct rebx_gr_full_workspace* const ws, const double cx, const double cy, const double cz, const double w, const int first){
+    if (ws->N_cells == ws->N_cells_allocated){
+        const int N_cells_allocated = ws->N_cells_allocated ? 2*ws->N_cells_allocated : 64;
+        struct rebx_gr_full_cell* const cells = realloc(ws->cells, N_cells_allocated*sizeof(*cells));
+        if (cells == NULL){
+            return -1;
+        }
+        ws->cells = cells;
+        ws->N_cells_allocated = N_cells_allocated;
+    }
+    struct rebx_gr_full_cell* const cell = &ws->cells[ws->N_cells];
+    cell->cx = cx;
+    cell->cy = cy;
+    cell->cz = cz;
+    cell->w = w;
+    for (int o=0; o<8; o++){
+        cell->oct[o] = -1;
+    }
+    cell->first = first;
+    return ws->N_cells++;
+}
+
+static inline int rebx_gr_full_octant(const struct rebx_gr_full_cell* const cell, const struct reb_particle* const p){
+    return (p->x > cell->cx) | ((p->y > cell->cy) << 1) | ((p->z > cell->cz) << 2);
+}
+
+// Child cell in octant o of cell c, holding body first. Returns -1 if memory could not be allocated
+static int rebx_gr_full_new_child(struct rebx_gr_full_workspace* const ws, const int c, const int o, const int first){
+    const struct rebx_gr_full_cell cell = ws->cells[c]; // copy, since adding a cell can move the array
+    const double w = cell.w/2.;
+    const int child = rebx_gr_full_new_cell(ws, cell.cx + ((o & 1) ? w/2. : -w/2.), cell.cy + ((o & 2) ? w/2. : -w/2.), cell.cz + ((o & 4) ? w/2. : -w/2.), w, first);
+    if (child >= 0){
+        ws->cells[c].oct[o] = child;
+    }
+    return child;
+}
+
+// Builds the tree of the first N bodies (the active ones). Returns 0 if memory could not be allocated
+static int rebx_gr_full_build_tree(struct rebx_gr_full_workspace* const ws, const struct reb_particle* const particles, const int N){
+    double min[3] = {particles[0].x, particles[0].y, particles[0].z};
+    double max[3] = {particles[0].x, particles[0].y, particles[0].z};
+    for (int i=1; i<N; i++){
+        const double x[3] = {particles[i].x, particles[i].y, particles[i].z};
+        for (int d=0; d<3; d++){
+            min[d] = x[d] < min[d] ? x[d] : min[d];
+            max[d] = x[d] > max[d] ? x[d] : max[d];
+        }
+    }
+    double w = 0.;
+    for (int d=0; d<3; d++){
+        w = max[d] - min[d] > w ? max[d] - min[d] : w;
+    }
+    w = w > 0. ? 1.001*w : 1.;
+
+    ws->N_cells = 0;
+    if (rebx_gr_full_new_cell(ws, (min[0]+max[0])/2., (min[1]+max[1])/2., (min[2]+max[2])/2., w, -1) < 0){
+        return 0;
+    }
+    for (int i=0; i<N; i++){
+        ws->next[i] = -1;
+        int c = 0;
+        int depth = 0;
+        while (1){
+            const int first = ws->cells[c].first;
+            if (first >= 0){ // Leaf, which holds a single body above the maximum depth
+                if (depth >= REBX_GR_FULL_MAX_DEPTH){
+                    ws->next[i] = first;
+                    ws->cells[c].first = i;
+                    break;
+                }
+                ws->cells[c].first = -1; // Move its body down to a child and insert i into the now internal cell
+                if (rebx_gr_full_new_child(ws, c, rebx_gr_full_octant(&ws->cells[c], &particles[first]), first) < 0){
+                    return 0;
+                }
+                continue;
+            }
+            const int o = rebx_gr_full_octant(&ws->cells[c], &particles[i]);
+            const int child = ws->cells[c].oct[o];
+            if (child < 0){
+                if (rebx_gr_full_new_child(ws, c, o, i) < 0){
+                    return 0;
+                }
+                break;
+            }
+            c = child;
+            depth++;
+        }
+    }
+    return 1;
+}
+
+// Children are always added after their parents, so cells are summed in reverse order
+static void rebx_gr_full_tree_moments(struct rebx_gr_full_workspace* const ws, const struct reb_particle* const particles){
+    for (int c=ws->N_cells-1; c>=0; c--){
+        struct rebx_gr_full_cell* const cell = &ws->cells[c];
+        double m = 0.;
+        double mx[3] = {0.};
+        double mv2 = 0.;
+        double mv[3] = {0.};
+        double mvv[6] = {0.};
+        if (cell->first >= 0){
+            for (int j=cell->first; j>=0; j=ws->next[j]){
+                const struct reb_particle pj = particles[j];
+                m += pj.m;
+                mx[0] += pj.m*pj.x;
+                mx[1] += pj.m*pj.y;
+                mx[2] += pj.m*pj.z;
+                mv2 += pj.m*(pj.vx*pj.vx + pj.vy*pj.vy + pj.vz*pj.vz);
+                mv[0] += pj.m*pj.vx;
+                mv[1] += pj.m*pj.vy;
+                mv[2] += pj.m*pj.vz;
+                mvv[0] += pj.m*pj.vx*pj.vx;
+                mvv[1] += pj.m*pj.vx*pj.vy;
+                mvv[2] += pj.m*pj.vx*pj.vz;
+                mvv[3] += pj.m*pj.vy*pj.vy;
+                mvv[4] += pj.m*pj.vy*pj.vz;
+                mvv[5] += pj.m*pj.vz*pj.vz;
+            }
+        }
+        else{
+            for (int o=0; o<8; o++){
+                if (cell->oct[o] < 0){
+                    continue;
+                }
+                const struct rebx_gr_full_cell* const child = &ws->cells[cell->oct[o]];
+                m += child->m;
+                mx[0] += child->m*child->x;
+                mx[1] += child->m*child->y;
+                mx[2] += child->m*child->z;
+                mv2 += child->mv2;
+                for (int d=0; d<3; d++){
+                    mv[d] += child->mv[d];
+                }
+                for (int d=0; d<6; d++){
+                    mvv[d] += child->mvv[d];
+                }
+            }
+        }
+        cell->m = m;
+        cell->x = m > 0. ? mx[0]/m : cell->cx;
+        cell->y = m > 0. ? mx[1]/m : cell->cy;
+        cell->z = m > 0. ? mx[2]/m : cell->cz;
+        cell->mv2 = mv2;
+        for (int d=0; d<3; d++){
+            cell->mv[d] = mv[d];
+        }
+        for (int d=0; d<6; d++){
+            cell->mvv[d] = mvv[d];
+        }
+    }
+}
+
+static void rebx_gr_full_tree_potentials(struct rebx_gr_full_workspace* const ws, const struct reb_particle* const particles, const double* const pot1){
+    for (int c=ws->N_cells-1; c>=0; c--){
+        struct rebx_gr_full_cell* const cell = &ws->cells[c];
+        double mpot1 = 0.;
+        if (cell->first >= 0){
+            for (int j=cell->first; j>=0; j=ws->next[j]){
+                mpot1 += particles[j].m*pot1[j];
+            }
+        }
+        else{
+            for (int o=0; o<8; o++){
+                if (cell->oct[o] >= 0){
+                    mpot1 += ws->cells[cell->oct[o]].mpot1;
+                }
+            }
+        }
+        cell->mpot1 = mpot1;
+    }
+}
+
+static void rebx_gr_full_tree_accelerations(struct rebx_gr_full_workspace* const ws, const struct reb_particle* const particles, double (*const a_newton)[3], double (*const a_old)[3]){
+    for (int c=ws->N_cells-1; c>=0; c--){
+        struct rebx_gr_full_cell* const cell = &ws->cells[c];
+        double mA[3] = {0.};
+        if (cell->first >= 0){
+            for (int j=cell->first; j>=0; j=ws->next[j]){
+                for (int d=0; d<3; d++){
+                    mA[d] += particles[j].m*(a_newton[j][d] + a_old[j][d]);
+                }
+            }
+        }
+        else{
+            for (int o=0; o<8; o++){
+                if (cell->oct[o] >= 0){
+                    for (int d=0; d<3; d++){
+                        mA[d] += ws->cells[cell->oct[o]].mA[d];
+                    }
+                }
+            }
+        }
+        for (int d=0; d<3; d++){
+            cell->mA[d] = mA[d];
+        }
+    }
+}
+
+static int rebx_gr_full_add_interaction(struct rebx_gr_full_workspace* const ws, size_t* const n, const int interaction, const int N){
+    if (*n == ws->N_interactions_allocated){
+        const size_t N_allocated = ws->N_interactions_allocated ? 2*ws->N_interactions_allocated : 16*(size_t)N;
+        int* const interactions = realloc(ws->interactions, N_allocated*sizeof(*interactions));
+        if (interactions == NULL){
+            return 0;
+        }
+        ws->interactions = interactions;
+        ws->N_interactions_allocated = N_allocated;
+    }
+    ws->interactions[(*n)++] = interaction;
+    return 1;
+}
+
+/* Walks the tree once per body, and stores what it interacts with, so the substitutions below don't walk it again.
+ * Cells are summed through their moments if they're narrower than theta times their distance and don't contain the body.
+ * Otherwise they're opened, down to the bodies in the leaves, which are summed exactly. Massless bodies and cells don't contribute.
+ * Test particles acting on active bodies (testparticle_type 1) are not in the tree, and are summed exactly.*/
+static int rebx_gr_full_build_interactions(const struct reb_simulation* const sim, struct rebx_gr_full_workspace* const ws, const struct reb_particle* const particles, const int N, const int N_active, const double theta){
+    const double theta2 = theta*theta;
+    int stack[7*REBX_GR_FULL_MAX_DEPTH + 8]; // depth-first, so each level leaves at most 7 siblings
+    size_t n = 0;
+    for (int i=0; i<N; i++){
+        const struct reb_particle pi = particles[i];
+        ws->offsets[i] = n;
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0){
+            const struct rebx_gr_full_cell* const cell = &ws->cells[stack[--top]];
+            if (cell->m == 0.){
+                continue;
+            }
+            if (cell->first >= 0){
+                for (int j=cell->first; j>=0; j=ws->next[j]){
+                    if (j != i && particles[j].m != 0. && !rebx_gr_full_add_interaction(ws, &n, -(j+1), N)){
+                        return 0;
+                    }
+                }
+                continue;
+            }
+            const double dx = pi.x - cell->x;
+            const double dy = pi.y - cell->y;
+            const double dz = pi.z - cell->z;
+            const double r2 = dx*dx + dy*dy + dz*dz;
+            const int inside = fabs(pi.x - cell->cx) <= cell->w/2. && fabs(pi.y - cell->cy) <= cell->w/2. && fabs(pi.z - cell->cz) <= cell->w/2.;
+            if (!inside && cell->w*cell->w < theta2*r2){
+                if (!rebx_gr_full_add_interaction(ws, &n, (int)(cell - ws->cells), N)){
+                    return 0;
+                }
+                continue;
+            }
+            for (int o=0; o<8; o++){
+                if (cell->oct[o] >= 0){
+                    stack[top++] = cell->oct[o];
+                }
+            }
+        }
+        const int N_sources = rebx_get_N_sources(sim, N_active, N, i);
+        for (int j=N_active; j<N_sources; j++){
+            if (j != i && particles[j].m != 0. && !rebx_gr_full_add_interaction(ws, &n, -(j+1), N)){
+                return 0;
+            }
+        }
+    }
+    ws->offsets[N] = n;
+    return 1;
+}
+
+// Sum of the constant terms in rebx_gr_full_add_const_pair on body i from the bodies in cell, taken at its center of mass
+static inline void rebx_gr_full_add_const_cell(const struct reb_particle* const pi, const struct rebx_gr_full_cell* const cell, const double a1, const double C2, const double G, double* const a_constx, double* const a_consty, double* const a_constz){
+    const double dx = pi->x - cell->x;
+    const double dy = pi->y - cell->y;
+    const double dz = pi->z - cell->z;
+    const double r2 = dx*dx + dy*dy + dz*dz;
+    const double r = sqrt(r2);
+    const double r3 = r2*r;
+    const double vi2 = pi->vx*pi->vx + pi->vy*pi->vy + pi->vz*pi->vz;
+    const double a3 = -vi2/(C2);
+    const double* const mv = cell->mv;
+    const double* const mvv = cell->mvv;
+    const double vimv = pi->vx*mv[0] + pi->vy*mv[1] + pi->vz*mv[2];
+    const double mvvdx = mvv[0]*dx + mvv[1]*dy + mvv[2]*dz;
+    const double mvvdy = mvv[1]*dx + mvv[3]*dy + mvv[4]*dz;
+    const double mvvdz = mvv[2]*dx + mvv[4]*dy + mvv[5]*dz;
+    const double dmvvd = dx*mvvdx + dy*mvvdy + dz*mvvdz;
+
+    // sum of m_j*factor1
+    const double mfactor1 = cell->m*(a1 + a3) + cell->mpot1 - 2.*cell->mv2/(C2) + (4./(C2))*vimv + (3./(2.*C2))*dmvvd/r2;
+    *a_constx += G*dx*mfactor1/r3;
+    *a_consty += G*dy*mfactor1/r3;
+    *a_constz += G*dz*mfactor1/r3;
+
+    // sum of m_j*factor2*(v_i - v_j), with factor2 = d.(4 v_i - 3 v_j)
+    const double dvi = dx*pi->vx + dy*pi->vy + dz*pi->vz;
+    const double dmv = dx*mv[0] + dy*mv[1] + dz*mv[2];
+    *a_constx += G*(4.*dvi*(cell->m*pi->vx - mv[0]) - 3.*dmv*pi->vx + 3.*mvvdx)/r3/(C2);
+    *a_consty += G*(4.*dvi*(cell->m*pi->vy - mv[1]) - 3.*dmv*pi->vy + 3.*mvvdy)/r3/(C2);
+    *a_constz += G*(4.*dvi*(cell->m*pi->vz - mv[2]) - 3.*dmv*pi->vz + 3.*mvvdz)/r3/(C2);
+}
+
+// Sum of the non-constant terms in rebx_gr_full_add_non_const_pair on body i from the bodies in cell, taken at its center of mass
+static inline void rebx_gr_full_add_non_const_cell(const struct reb_particle* const pi, const struct rebx_gr_full_cell* const cell, const double C2, const double G, double* const non_constx, double* const non_consty, double* const non_constz){
+    const double dx = pi->x - cell->x;
+    const double dy = pi->y - cell->y;
+    const double dz = pi->z - cell->z;
+    const double r = sqrt(dx*dx + dy*dy + dz*dz);
+    const double r3 = r*r*r;
+    const double* const mA = cell->mA;
+    const double dmA = dx*mA[0] + dy*mA[1] + dz*mA[2];
+    *non_constx += (G*dx/r3)*dmA/(2.*C2) + (7./(2.*C2))*G*mA[0]/r;
+    *non_consty += (G*dy/r3)*dmA/(2.*C2) + (7./(2.*C2))*G*mA[1]/r;
+    *non_constz += (G*dz/r3)*dmA/(2.*C2) + (7./(2.*C2))*G*mA[2]/r;
+}
+
+// Same as rebx_calculate_gr_full, with the sums over bodies replaced by sums over the interactions of each body. O(N log N) per substitution
+static void rebx_calculate_gr_full_tree(struct reb_simulation* const sim, struct rebx_gr_full_workspace* const ws, struct reb_particle* const particles, const int N, const double C2, const double G, const double theta, const int gravity_ignore_10){
+    double (*const a_const)[3] = (double (*)[3])ws->a_const;
+    double (*const a_newton)[3] = (double (*)[3])ws->a_newton;
+    double (*const a_new)[3] = (double (*)[3])ws->a_new;
+    double (*const a_old)[3] = (double (*)[3])ws->a_old;
+    double* const pot4 = ws->pot4;
+    double* const pot1 = ws->pot1;
+
+    const int N_active = rebx_get_N_active(sim, N);
+    if (N_active < 1){
+        return;
+    }
+    if (!rebx_gr_full_build_tree(ws, particles, N_active)){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for gr_full.\n");
+        return;
+    }
+    rebx_gr_full_tree_moments(ws, particles);
+    if (!rebx_gr_full_build_interactions(sim, ws, particles, N, N_active, theta)){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for gr_full.\n");
+        return;
+    }
+    const struct rebx_gr_full_cell* const cells = ws->cells;
+    const int* const interactions = ws->interactions;
+    const size_t* const offsets = ws->offsets;
+
+    for (int i=0; i<N; i++){
+        a_newton[i][0] = particles[i].ax;
+        a_newton[i][1] = particles[i].ay;
+        a_newton[i][2] = particles[i].az;
+        a_new[i][0] = 0.;
+        a_new[i][1] = 0.;
+        a_new[i][2] = 0.;
+
+        double a1 = 0.;
+        double a2 = 0.;
+        for (size_t l=offsets[i]; l<offsets[i+1]; l++){
+            double dx, dy, dz, m;
+            if (interactions[l] < 0){
+                const struct reb_particle* const pk = &particles[-interactions[l]-1];
+                dx = particles[i].x - pk->x;
+                dy = particles[i].y - pk->y;
+                dz = particles[i].z - pk->z;
+                m = pk->m;
+            }
+            else{
+                const struct rebx_gr_full_cell* const cell = &cells[interactions[l]];
+                dx = particles[i].x - cell->x;
+                dy = particles[i].y - cell->y;
+                dz = particles[i].z - cell->z;
+                m = cell->m;
+            }
+            const double rik = sqrt(dx*dx + dy*dy + dz*dz);
+            a1 += (4./(C2)) * G*m/rik;
+            a2 += (1./(C2)) * G*m/rik;
+        }
+        pot4[i] = a1;
+        pot1[i] = a2;
+    }
+
+    if (gravity_ignore_10 && N > 1){
+        rebx_gr_full_newton_ignore_10(particles, a_newton, G);
+    }
+
+    rebx_gr_full_tree_potentials(ws, particles, pot1);
+    for (int i=0; i<N; i++){
+        double a_constx = 0.;
+        double a_consty = 0.;
+        double a_constz = 0.;
+        for (size_t l=offsets[i]; l<offsets[i+1]; l++){
+            if (interactions[l] < 0){
+                const int j = -interactions[l]-1;
+                rebx_gr_full_add_const_pair(&particles[i], &particles[j], pot4[i], pot1[j], C2, G, &a_constx, &a_consty, &a_constz);
+            }
+            else{
+                rebx_gr_full_add_const_cell(&particles[i], &cells[interactions[l]], pot4[i], C2, G, &a_constx, &a_consty, &a_constz);
+            }
+        }
+        a_const[i][0] = a_constx;
+        a_const[i][1] = a_consty;
+        a_const[i][2] = a_constz;
+    }
+
+    for (int k=0; k<10; k++){
+        for (int i =0; i <N; i++){
+            a_old[i][0] = a_new[i][0];
+            a_old[i][1] = a_new[i][1];
+            a_old[i][2] = a_new[i][2];
+        }
+        rebx_gr_full_tree_accelerations(ws, particles, a_newton, a_old);
         for (int i = 0; i < N; i++){
-            dx = (fabs(a_new[i][0]) < 1.e-30) ? 0. : fabs(a_new[i][0] - a_old[i][0])/a_new[i][0];
-            dy = (fabs(a_new[i][1]) < 1.e-30) ? 0. : fabs(a_new[i][1] - a_old[i][1])/a_new[i][1];
-            dz = (fabs(a_new[i][2]) < 1.e-30) ? 0. : fabs(a_new[i][2] - a_old[i][2])/a_new[i][2];
-            
-            if (dx > maxdev) { maxdev = dx; }
-            if (dy > maxdev) { maxdev = dy; }
-            if (dz > maxdev) { maxdev = dz; }
+            double non_constx = 0.;
+            double non_consty = 0.;
+            double non_constz = 0.;
+            for (size_t l=offsets[i]; l<offsets[i+1]; l++){
+                if (interactions[l] < 0){
+                    const int j = -interactions[l]-1;
+                    rebx_gr_full_add_non_const_pair(&particles[i], &particles[j], a_newton[j], a_old[j], C2, G, &non_constx, &non_consty, &non_constz);
+                }
+                else{
+                    rebx_gr_full_add_non_const_cell(&particles[i], &cells[interactions[l]], C2, G, &non_constx, &non_consty, &non_constz);
+                }
+            }
+            a_new[i][0] = (a_const[i][0] + non_constx);
+            a_new[i][1] = (a_const[i][1] + non_consty);
+            a_new[i][2] = (a_const[i][2] + non_constz);
         }
-        
-        if (maxdev < 1.e-30){
+
+        if (rebx_gr_full_maxdev(a_new, a_old, N) < 1.e-30){
             break;
         }
         if (k==9){
             reb_warning(sim, "10 loops in rebx_gr_full did not converge.\n");
         }
     }
-    // update acceleration in particles
     for (int i = 0; i <N;i++){
         particles[i].ax += a_new[i][0];
         particles[i].ay += a_new[i][1];
@@ -236,15 +813,25 @@ void rebx_gr_full(struct reb_simulation* const sim, struct rebx_force* const gr_
         reb_error(sim, "REBOUNDx Error: Need to set speed of light in gr effect.  See examples in documentation.\n");
         return;
     }
+    struct rebx_gr_full_workspace* ws = rebx_gr_full_get_workspace(sim->extras, gr_full, N);
+    if (ws == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for gr_full.\n");
+        return;
+    }
     const double C2 = (*c)*(*c);
     const unsigned int gravity_ignore_10 = sim->gravity_ignore_terms==1;
+    const double* const opening_angle = rebx_get_param(sim->extras, gr_full->ap, "gr_full_opening_angle");
+    if (opening_angle != NULL && *opening_angle > 0.){
+        rebx_calculate_gr_full_tree(sim, ws, particles, N, C2, sim->G, *opening_angle, gravity_ignore_10);
+        return;
+    }
     int* max_iterations = rebx_get_param(sim->extras, gr_full->ap, "max_iterations");
     if(max_iterations != NULL){
-        rebx_calculate_gr_full(sim, particles, N, C2, sim->G, *max_iterations, gravity_ignore_10);
+        rebx_calculate_gr_full(sim, ws, particles, N, C2, sim->G, *max_iterations, gravity_ignore_10);
     }
     else{
         const int default_max_iterations = 10;
-        rebx_calculate_gr_full(sim, particles, N, C2, sim->G, default_max_iterations, gravity_ignore_10);
+        rebx_calculate_gr_full(sim, ws, particles, N, C2, sim->G, default_max_iterations, gravity_ignore_10);
     }
 }
 
@@ -254,9 +841,10 @@ double rebx_gr_full_hamiltonian(struct rebx_extras* const rebx, const struct reb
         return 0;
     }
     struct reb_simulation* sim = rebx->sim;
-    double* c = rebx_get_param(rebx, force->ap, "c");
+    double* c = rebx_get_param_by_id(rebx, force->ap, rebx_intern(rebx, "c"));
     if (c == NULL){
         reb_error(sim, "Need to set speed of light in gr effect.  See examples in documentation.\n");
+        return 0;
     }
     const double C2 = (*c)*(*c);
     const int N = sim->N - sim->N_var;
@@ -267,33 +855,25 @@ double rebx_gr_full_hamiltonian(struct rebx_extras* const rebx, const struct reb
 	double e_pot = 0.;
 	double e_pn  = 0.;
 	
-    struct reb_vec3d* vtilde = malloc(N*sizeof(*vtilde));
-    struct reb_vec3d* vtilde_old = malloc(N*sizeof(*vtilde_old));
+    struct rebx_gr_full_workspace* const ws = rebx_gr_full_get_workspace(rebx, (struct rebx_force*)force, N); // the workspace is a cache, so we don't treat it as modifying force
+    if (ws == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for gr_full.\n");
+        return 0;
+    }
+    double* const vtilde = ws->a_new; // 3N. Iterated velocities, x, y and z of each body in turn
     for (int j=0; j<N;j++){
-        vtilde[j].x = particles[j].vx;
-        vtilde[j].y = particles[j].vy;
-        vtilde[j].z = particles[j].vz;
+        vtilde[3*j] = particles[j].vx;
+        vtilde[3*j+1] = particles[j].vy;
+        vtilde[3*j+2] = particles[j].vz;
     }
     
     for (int q=0; q<10;q++){
         for (int i=0;i<N;i++){
             struct reb_particle pi = particles[i];
             
-            double vtildei2 = vtilde[i].x*vtilde[i].x + vtilde[i].y*vtilde[i].y + vtilde[i].z*vtilde[i].z;
+            double vtildei2 = vtilde[3*i]*vtilde[3*i] + vtilde[3*i+1]*vtilde[3*i+1] + vtilde[3*i+2]*vtilde[3*i+2];
             double A = (1. - 0.5*vtildei2/C2);
             
-            double sumk = 0.;
-            for (int k=0;k<N;k++){
-                if (k!=i){
-                    struct reb_particle pk = particles[k];
-                    double xik = pk.x - pi.x;
-                    double yik = pk.y - pi.y;
-                    double zik = pk.z - pi.z;
-                    double rik = sqrt(xik*xik + yik*yik + zik*zik);
-                    sumk -= 2.*G*pk.m/rik;
-                }
-            }
-            
             struct reb_vec3d dv_pn = {0.};
             for (int j=0;j<N;j++){
                 if (j != i){
@@ -303,12 +883,12 @@ double rebx_gr_full_hamiltonian(struct rebx_extras* const rebx, const struct reb
                     double zij = pj.z - pi.z;
                     double rij2 = xij*xij + yij*yij + zij*zij;
                     double rij = sqrt(rij2);
-                    double rijdotvj = vtilde[j].x*xij + vtilde[j].y*yij + vtilde[j].z*zij;
+                    double rijdotvj = vtilde[3*j]*xij + vtilde[3*j+1]*yij + vtilde[3*j+2]*zij;
                     double pfac = pj.m/rij;
 
-                    dv_pn.x += pfac*(6.*vtilde[i].x - 7.*vtilde[j].x - rijdotvj*xij/rij2);
-                    dv_pn.y += pfac*(6.*vtilde[i].y - 7.*vtilde[j].y - rijdotvj*yij/rij2);
-                    dv_pn.z += pfac*(6.*vtilde[i].z - 7.*vtilde[j].z - rijdotvj*zij/rij2);
+                    dv_pn.x += pfac*(6.*vtilde[3*i] - 7.*vtilde[3*j] - rijdotvj*xij/rij2);
+                    dv_pn.y += pfac*(6.*vtilde[3*i+1] - 7.*vtilde[3*j+1] - rijdotvj*yij/rij2);
+                    dv_pn.z += pfac*(6.*vtilde[3*i+2] - 7.*vtilde[3*j+2] - rijdotvj*zij/rij2);
                 }
             }
 
@@ -316,15 +896,15 @@ double rebx_gr_full_hamiltonian(struct rebx_extras* const rebx, const struct reb
             dv_pn.y *= G/(2.*C2);
             dv_pn.z *= G/(2.*C2);
 
-            vtilde[i].x = (pi.vx + dv_pn.x)/A;
-            vtilde[i].y = (pi.vy + dv_pn.y)/A;
-            vtilde[i].z = (pi.vz + dv_pn.z)/A;
+            vtilde[3*i] = (pi.vx + dv_pn.x)/A;
+            vtilde[3*i+1] = (pi.vy + dv_pn.y)/A;
+            vtilde[3*i+2] = (pi.vz + dv_pn.z)/A;
         }
     }
     
     for (int i=0; i<N; i++){
         struct reb_particle p = particles[i];
-        double vtildei2 = vtilde[i].x*vtilde[i].x + vtilde[i].y*vtilde[i].y + vtilde[i].z*vtilde[i].z;
+        double vtildei2 = vtilde[3*i]*vtilde[3*i] + vtilde[3*i+1]*vtilde[3*i+1] + vtilde[3*i+2]*vtilde[3*i+2];
         e_kin += 0.5*p.m*vtildei2;
     }
 
@@ -342,7 +922,7 @@ double rebx_gr_full_hamiltonian(struct rebx_extras* const rebx, const struct reb
             }
         }
         
-        double vtildei2 = vtilde[i].x*vtilde[i].x + vtilde[i].y*vtilde[i].y + vtilde[i].z*vtilde[i].z;
+        double vtildei2 = vtilde[3*i]*vtilde[3*i] + vtilde[3*i+1]*vtilde[3*i+1] + vtilde[3*i+2]*vtilde[3*i+2];
 
         for (int j=0;j<N;j++){
             if (j != i){
@@ -352,9 +932,9 @@ double rebx_gr_full_hamiltonian(struct rebx_extras* const rebx, const struct reb
                 double zij = pj.z - pi.z;
                 double rij2 = xij*xij + yij*yij + zij*zij;
                 double rij = sqrt(rij2);
-                double rijdotvj = vtilde[j].x*xij + vtilde[j].y*yij + vtilde[j].z*zij;
-                double rijdotvi = vtilde[i].x*xij + vtilde[i].y*yij + vtilde[i].z*zij;
-                double vidotvj = vtilde[i].x*vtilde[j].x + vtilde[i].y*vtilde[j].y + vtilde[i].z*vtilde[j].z;
+                double rijdotvj = vtilde[3*j]*xij + vtilde[3*j+1]*yij + vtilde[3*j+2]*zij;
+                double rijdotvi = vtilde[3*i]*xij + vtilde[3*i+1]*yij + vtilde[3*i+2]*zij;
+                double vidotvj = vtilde[3*i]*vtilde[3*j] + vtilde[3*i+1]*vtilde[3*j+1] + vtilde[3*i+2]*vtilde[3*j+2];
                 
                 e_pn -= G/(4.*C2)*pi.m*pj.m/rij*(6.*vtildei2 - 7*vidotvj - rijdotvi*rijdotvj/rij2 + sumk);
             }
@@ -57,15 +57,22 @@
 #include "rebound.h"
 #include "reboundx.h"
 
-static void rebx_calculate_gr_potential(struct reb_particle* const particles, const int N, const double C2, const double G){
+static void rebx_calculate_gr_potential(struct rebx_extras* const rebx, struct reb_particle* const particles, const int N, const double C2, const double G, const unsigned char* const skip){
     const struct reb_particle source = particles[0];
     const double prefac1 = 6.*(G*source.m)*(G*source.m)/C2;
+    const struct rebx_geometry* const g = rebx_get_geometry(rebx, particles, N, 0);
+    if (g == NULL){
+        return;
+    }
     for (int i=1; i<N; i++){
+        if (skip != NULL && skip[i]){
+            continue;
+        }
         const struct reb_particle p = particles[i];
-        const double dx = p.x - source.x;
-        const double dy = p.y - source.y;
-        const double dz = p.z - source.z;
-        const double r2 = dx*dx + dy*dy + dz*dz;
+        const double dx = g->dx[i];
+        const double dy = g->dy[i];
+        const double dz = g->dz[i];
+        const double r2 = g->r2[i];
         const double prefac = prefac1/(r2*r2);
         
         particles[i].ax -= prefac*dx;
@@ -84,7 +91,66 @@ void rebx_gr_potential(struct reb_simulation* const sim, struct rebx_force* cons
     }
     else{
         const double C2 = (*c)*(*c);
-        rebx_calculate_gr_potential(particles, N, C2, sim->G);
+        rebx_calculate_gr_potential(sim->extras, particles, N, C2, sim->G, gr_potential->skip);
+    }
+}
+
+// Same as rebx_gr_potential on each simulation of the batch, with the loop over simulations innermost
+void rebx_gr_potential_batch(struct rebx_batch* const batch, const int j){
+    const int K = batch->K;
+    const int N = batch->N;
+    double* restrict const prefac1 = rebx_batch_scratch(batch, 2*K);
+    if (prefac1 == NULL){
+        return;
+    }
+    double* restrict const on = prefac1 + K; // 0 for simulations where c isn't set, which are skipped
+    const int id_c = rebx_intern(batch->sims[0]->extras, "c"); // default params have the same id in all instances
+    for (int k=0; k<K; k++){
+        struct reb_simulation* const sim = batch->sims[k];
+        const double* const c = rebx_get_param_by_id(sim->extras, batch->forces[j*K + k]->ap, id_c);
+        if (c == NULL){
+            reb_error(sim, "REBOUNDx Error: Need to set speed of light in gr effect.  See examples in documentation.\n");
+            prefac1[k] = 0.;
+            on[k] = 0.;
+        }
+        else{
+            const double C2 = (*c)*(*c);
+            const double G = batch->G[k];
+            prefac1[k] = 6.*(G*batch->m[k])*(G*batch->m[k])/C2;
+            on[k] = 1.;
+        }
+    }
+    // Rows of the source (particles[0]) and of particle i never overlap, so the loop over simulations vectorizes
+    const double* restrict const x0 = batch->x;
+    const double* restrict const y0 = batch->y;
+    const double* restrict const z0 = batch->z;
+    const double* restrict const m0 = batch->m;
+    double* restrict const ax0 = batch->ax;
+    double* restrict const ay0 = batch->ay;
+    double* restrict const az0 = batch->az;
+    for (int i=1; i<N; i++){
+        const double* restrict const x = batch->x + i*K;
+        const double* restrict const y = batch->y + i*K;
+        const double* restrict const z = batch->z + i*K;
+        const double* restrict const m = batch->m + i*K;
+        double* restrict const ax = batch->ax + i*K;
+        double* restrict const ay = batch->ay + i*K;
+        double* restrict const az = batch->az + i*K;
+#pragma omp simd
+        for (int k=0; k<K; k++){
+            const double dx = x[k] - x0[k];
+            const double dy = y[k] - y0[k];
+            const double dz = z[k] - z0[k];
+            const double r2 = dx*dx + dy*dy + dz*dz;
+            const double prefac = prefac1[k]/(r2*r2);
+
+            ax[k] -= on[k] != 0. ? prefac*dx : 0.;
+            ay[k] -= on[k] != 0. ? prefac*dy : 0.;
+            az[k] -= on[k] != 0. ? prefac*dz : 0.;
+            ax0[k] += on[k] != 0. ? m[k]/m0[k]*prefac*dx : 0.;
+            ay0[k] += on[k] != 0. ? m[k]/m0[k]*prefac*dy : 0.;
+            az0[k] += on[k] != 0. ? m[k]/m0[k]*prefac*dz : 0.;
+        }
     }
 }
 
@@ -110,9 +176,10 @@ static double rebx_calculate_gr_potential_potential(struct reb_simulation* const
 }
 
 double rebx_gr_potential_potential(struct rebx_extras* const rebx, const struct rebx_force* const gr_potential){
-    double* c = rebx_get_param(rebx, gr_potential->ap, "c");
+    double* c = rebx_get_param_by_id(rebx, gr_potential->ap, rebx_intern(rebx, "c"));
     if (c == NULL){
         rebx_error(rebx, "Need to set speed of light in gr effect.  See examples in documentation.\n");
+        return 0;
     }
     const double C2 = (*c)*(*c);
     if (rebx->sim == NULL){
@@ -58,86 +58,306 @@
 #include <float.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "rebxtools.h"
 
-static void rebx_calculate_J2_force(struct reb_simulation* const sim, struct reb_particle* const particles, const int N, const double J2, const double R_eq, const int source_index){
+// Per-particle factors of the J2 and J4 forces, in packed arrays of length N
+struct rebx_harmonics_lanes{
+    double* prefac;
+    double* fac;
+    double* costheta2;
+};
+
+static void rebx_calculate_J2_force(struct reb_simulation* const sim, const struct rebx_harmonics_lanes lanes, struct reb_particle* const particles, const int N, const double J2, const double R_eq, const int source_index, const unsigned char* const skip){
     const struct reb_particle source = particles[source_index];
     const double G = sim->G;
+    const struct rebx_geometry* const g = rebx_get_geometry(sim->extras, particles, N, source_index);
+    if (g == NULL){
+        return;
+    }
+    // The divisions only read the packed separations and have no branches, so the compiler can vectorize them. The source's lane is unused
+    const double* const dz = g->dz;
+    const double* const r2 = g->r2;
+    const double* const r = g->r;
+#pragma omp parallel for simd schedule(guided)
     for (int i=0; i<N; i++){
-        if(i == source_index){
+        const double costheta2 = dz[i]*dz[i]/r2[i];
+        lanes.prefac[i] = 3.*J2*R_eq*R_eq/r2[i]/r2[i]/r[i]/2.;
+        lanes.fac[i] = 5.*costheta2-1.;
+    }
+    // Back reactions on the source are summed in particle order, so results don't depend on the number of threads
+    for (int i=0; i<N; i++){
+        if(i == source_index || (skip != NULL && skip[i])){
             continue;
         }
         const struct reb_particle p = particles[i];
-        const double dx = p.x - source.x;
-        const double dy = p.y - source.y;
-        const double dz = p.z - source.z;
-        const double r2 = dx*dx + dy*dy + dz*dz;
-        const double r = sqrt(r2);
-        const double costheta2 = dz*dz/r2;
-        const double prefac = 3.*J2*R_eq*R_eq/r2/r2/r/2.;
-        const double fac = 5.*costheta2-1.;
+        const double dx = g->dx[i];
+        const double dy = g->dy[i];
+        const double prefac = lanes.prefac[i];
+        const double fac = lanes.fac[i];
 
         particles[i].ax += G*source.m*prefac*fac*dx;
         particles[i].ay += G*source.m*prefac*fac*dy;
-        particles[i].az += G*source.m*prefac*(fac-2.)*dz;
+        particles[i].az += G*source.m*prefac*(fac-2.)*dz[i];
         particles[source_index].ax -= G*p.m*prefac*fac*dx;
         particles[source_index].ay -= G*p.m*prefac*fac*dy;
-        particles[source_index].az -= G*p.m*prefac*(fac-2.)*dz;
+        particles[source_index].az -= G*p.m*prefac*(fac-2.)*dz[i];
     }
 }
 
-static void rebx_J2(struct rebx_extras* const rebx, struct reb_simulation* const sim, struct rebx_force* const gh, struct reb_particle* const particles, const int N){
-    for (int i=0; i<N; i++){
-        const double* const J2 = rebx_get_param(rebx, particles[i].ap, "J2");
-        if (J2 != NULL){
-            const double* const R_eq = rebx_get_param(rebx, particles[i].ap, "R_eq");
-            if (R_eq != NULL){
-                rebx_calculate_J2_force(sim, particles, N, *J2, *R_eq,i); 
-            }
+static void rebx_J2(struct rebx_extras* const rebx, struct reb_simulation* const sim, struct rebx_force* const gh, const struct rebx_harmonics_lanes lanes, struct reb_particle* const particles, const int N){
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "J2"));
+    if (sources == NULL){
+        return;
+    }
+    const int id_R_eq = rebx_intern(rebx, "R_eq");
+    for (int k=0; k<sources->N_particles; k++){
+        const int i = sources->index[k];
+        const double* const J2 = sources->values[k];
+        const double* const R_eq = rebx_get_param_by_id(rebx, particles[i].ap, id_R_eq);
+        if (R_eq != NULL){
+            rebx_calculate_J2_force(sim, lanes, particles, N, *J2, *R_eq, i, gh->skip);
         }
     }
 }
 
-static void rebx_calculate_J4_force(struct reb_simulation* const sim, struct reb_particle* const particles, const int N, const double J4, const double R_eq, const int source_index){
+static void rebx_calculate_J4_force(struct reb_simulation* const sim, const struct rebx_harmonics_lanes lanes, struct reb_particle* const particles, const int N, const double J4, const double R_eq, const int source_index, const unsigned char* const skip){
     const struct reb_particle source = particles[source_index];
     const double G = sim->G;
+    const struct rebx_geometry* const g = rebx_get_geometry(sim->extras, particles, N, source_index);
+    if (g == NULL){
+        return;
+    }
+    // The divisions only read the packed separations and have no branches, so the compiler can vectorize them. The source's lane is unused
+    const double* const dz = g->dz;
+    const double* const r2 = g->r2;
+    const double* const r = g->r;
+#pragma omp parallel for simd schedule(guided)
+    for (int i=0; i<N; i++){
+        const double costheta2 = dz[i]*dz[i]/r2[i];
+        lanes.prefac[i] = 5.*J4*R_eq*R_eq*R_eq*R_eq/r2[i]/r2[i]/r2[i]/r[i]/8.;
+        lanes.fac[i] = 63.*costheta2*costheta2-42.*costheta2 + 3.;
+        lanes.costheta2[i] = costheta2;
+    }
+    // Back reactions on the source are summed in particle order, so results don't depend on the number of threads
     for (int i=0; i<N; i++){
-        if(i == source_index){
+        if(i == source_index || (skip != NULL && skip[i])){
             continue;
         }
         const struct reb_particle p = particles[i];
-        const double dx = p.x - source.x;
-        const double dy = p.y - source.y;
-        const double dz = p.z - source.z;
-        const double r2 = dx*dx + dy*dy + dz*dz;
-        const double r = sqrt(r2);
-        const double costheta2 = dz*dz/r2;
-        const double prefac = 5.*J4*R_eq*R_eq*R_eq*R_eq/r2/r2/r2/r/8.;
-        const double fac = 63.*costheta2*costheta2-42.*costheta2 + 3.;
+        const double dx = g->dx[i];
+        const double dy = g->dy[i];
+        const double prefac = lanes.prefac[i];
+        const double fac = lanes.fac[i];
+        const double costheta2 = lanes.costheta2[i];
 
         particles[i].ax += G*source.m*prefac*fac*dx;
         particles[i].ay += G*source.m*prefac*fac*dy;
-        particles[i].az += G*source.m*prefac*(fac+12.-28.*costheta2)*dz;
+        particles[i].az += G*source.m*prefac*(fac+12.-28.*costheta2)*dz[i];
         particles[source_index].ax -= G*p.m*prefac*fac*dx;
         particles[source_index].ay -= G*p.m*prefac*fac*dy;
-        particles[source_index].az -= G*p.m*prefac*(fac+12.-28.*costheta2)*dz;
+        particles[source_index].az -= G*p.m*prefac*(fac+12.-28.*costheta2)*dz[i];
     }
 }
 
-static void rebx_J4(struct rebx_extras* const rebx, struct reb_simulation* const sim, struct rebx_force* const gh, struct reb_particle* const particles, const int N){
-    for (int i=0; i<N; i++){
-        const double* const J4 = rebx_get_param(rebx, particles[i].ap, "J4");
-        if (J4 != NULL){
-            const double* const R_eq = rebx_get_param(rebx, particles[i].ap, "R_eq");
+static void rebx_J4(struct rebx_extras* const rebx, struct reb_simulation* const sim, struct rebx_force* const gh, const struct rebx_harmonics_lanes lanes, struct reb_particle* const particles, const int N){
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "J4"));
+    if (sources == NULL){
+        return;
+    }
+    const int id_R_eq = rebx_intern(rebx, "R_eq");
+    for (int k=0; k<sources->N_particles; k++){
+        const int i = sources->index[k];
+        const double* const J4 = sources->values[k];
+        const double* const R_eq = rebx_get_param_by_id(rebx, particles[i].ap, id_R_eq);
+        if (R_eq != NULL){
+            rebx_calculate_J4_force(sim, lanes, particles, N, *J4, *R_eq, i, gh->skip);
+        }
+    }
+}
+
+void rebx_gravitational_harmonics(struct reb_simulation* const sim, struct rebx_force* const gh, struct reb_particle* const particles, const int N){
+    double* const block = rebx_get_force_scratch(sim->extras, gh, 3*N*sizeof(*block));
+    if (block == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for gravitational_harmonics.\n");
+        return;
+    }
+    const struct rebx_harmonics_lanes lanes = {.prefac = block, .fac = block + N, .costheta2 = block + 2*N};
+    rebx_J2(sim->extras, sim, gh, lanes, particles, N);
+    rebx_J4(sim->extras, sim, gh, lanes, particles, N);
+}
+
+// Dense lanes of the batch: Jn and R_eq of each source, and on, which is 1 if the particle is a source in that simulation
+struct rebx_harmonics_batch_lanes{
+    double* Jn;
+    double* R_eq;
+    double* on;
+};
+
+// Fills the lanes for the sources of Jn. Returns 1 if any simulation has a source
+static int rebx_harmonics_batch_sources(struct rebx_batch* const batch, const struct rebx_harmonics_batch_lanes lanes, const char* const Jn_name){
+    const int K = batch->K;
+    const int N = batch->N;
+    int any = 0;
+    for (int l=0; l<N*K; l++){
+        lanes.Jn[l] = 0.;
+        lanes.R_eq[l] = 0.;
+        lanes.on[l] = 0.;
+    }
+    // default params have the same id in all instances
+    struct rebx_extras* const rebx0 = batch->sims[0]->extras;
+    const int id_Jn = rebx_intern(rebx0, Jn_name);
+    const int id_R_eq = rebx_intern(rebx0, "R_eq");
+    for (int k=0; k<K; k++){
+        struct rebx_extras* const rebx = batch->sims[k]->extras;
+        struct reb_particle* const particles = batch->sims[k]->particles;
+        const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N, id_Jn);
+        if (sources == NULL){
+            continue;
+        }
+        for (int s=0; s<sources->N_particles; s++){
+            const int i = sources->index[s];
+            const double* const Jn = sources->values[s];
+            const double* const R_eq = rebx_get_param_by_id(rebx, particles[i].ap, id_R_eq);
             if (R_eq != NULL){
-                rebx_calculate_J4_force(sim, particles, N, *J4, *R_eq,i); 
+                const int l = REBX_LANE(batch, i, k);
+                lanes.Jn[l] = *Jn;
+                lanes.R_eq[l] = *R_eq;
+                lanes.on[l] = 1.;
+                any = 1;
             }
         }
     }
+    return any;
 }
 
-void rebx_gravitational_harmonics(struct reb_simulation* const sim, struct rebx_force* const gh, struct reb_particle* const particles, const int N){
-    rebx_J2(sim->extras, sim, gh, particles, N);
-    rebx_J4(sim->extras, sim, gh, particles, N);
+static int rebx_harmonics_batch_is_source(const struct rebx_batch* const batch, const struct rebx_harmonics_batch_lanes lanes, const int source_index){
+    for (int k=0; k<batch->K; k++){
+        if (lanes.on[REBX_LANE(batch, source_index, k)] != 0.){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void rebx_J2_batch(struct rebx_batch* const batch, const struct rebx_harmonics_batch_lanes lanes){
+    const int K = batch->K;
+    const int N = batch->N;
+    if (!rebx_harmonics_batch_sources(batch, lanes, "J2")){
+        return;
+    }
+    const double* restrict const G = batch->G;
+    // Sources in ascending index, and particles in ascending index for each source, in the same order as rebx_J2
+    for (int source_index=0; source_index<N; source_index++){
+        if (!rebx_harmonics_batch_is_source(batch, lanes, source_index)){
+            continue;
+        }
+        const double* restrict const J2 = lanes.Jn + source_index*K;
+        const double* restrict const R_eq = lanes.R_eq + source_index*K;
+        const double* restrict const on = lanes.on + source_index*K;
+        const double* restrict const xs = batch->x + source_index*K;
+        const double* restrict const ys = batch->y + source_index*K;
+        const double* restrict const zs = batch->z + source_index*K;
+        const double* restrict const ms = batch->m + source_index*K;
+        double* restrict const axs = batch->ax + source_index*K;
+        double* restrict const ays = batch->ay + source_index*K;
+        double* restrict const azs = batch->az + source_index*K;
+        for (int i=0; i<N; i++){
+            if(i == source_index){
+                continue;
+            }
+            const double* restrict const x = batch->x + i*K;
+            const double* restrict const y = batch->y + i*K;
+            const double* restrict const z = batch->z + i*K;
+            const double* restrict const m = batch->m + i*K;
+            double* restrict const ax = batch->ax + i*K;
+            double* restrict const ay = batch->ay + i*K;
+            double* restrict const az = batch->az + i*K;
+#pragma omp simd
+            for (int k=0; k<K; k++){
+                const double dx = x[k] - xs[k];
+                const double dy = y[k] - ys[k];
+                const double dz = z[k] - zs[k];
+                const double r2 = dx*dx + dy*dy + dz*dz;
+                const double r = sqrt(r2);
+                const double costheta2 = dz*dz/r2;
+                const double prefac = 3.*J2[k]*R_eq[k]*R_eq[k]/r2/r2/r/2.;
+                const double fac = 5.*costheta2-1.;
+
+                ax[k] += on[k] != 0. ? G[k]*ms[k]*prefac*fac*dx : 0.;
+                ay[k] += on[k] != 0. ? G[k]*ms[k]*prefac*fac*dy : 0.;
+                az[k] += on[k] != 0. ? G[k]*ms[k]*prefac*(fac-2.)*dz : 0.;
+                axs[k] -= on[k] != 0. ? G[k]*m[k]*prefac*fac*dx : 0.;
+                ays[k] -= on[k] != 0. ? G[k]*m[k]*prefac*fac*dy : 0.;
+                azs[k] -= on[k] != 0. ? G[k]*m[k]*prefac*(fac-2.)*dz : 0.;
+            }
+        }
+    }
+}
+
+static void rebx_J4_batch(struct rebx_batch* const batch, const struct rebx_harmonics_batch_lanes lanes){
+    const int K = batch->K;
+    const int N = batch->N;
+    if (!rebx_harmonics_batch_sources(batch, lanes, "J4")){
+        return;
+    }
+    const double* restrict const G = batch->G;
+    for (int source_index=0; source_index<N; source_index++){
+        if (!rebx_harmonics_batch_is_source(batch, lanes, source_index)){
+            continue;
+        }
+        const double* restrict const J4 = lanes.Jn + source_index*K;
+        const double* restrict const R_eq = lanes.R_eq + source_index*K;
+        const double* restrict const on = lanes.on + source_index*K;
+        const double* restrict const xs = batch->x + source_index*K;
+        const double* restrict const ys = batch->y + source_index*K;
+        const double* restrict const zs = batch->z + source_index*K;
+        const double* restrict const ms = batch->m + source_index*K;
+        double* restrict const axs = batch->ax + source_index*K;
+        double* restrict const ays = batch->ay + source_index*K;
+        double* restrict const azs = batch->az + source_index*K;
+        for (int i=0; i<N; i++){
+            if(i == source_index){
+                continue;
+            }
+            const double* restrict const x = batch->x + i*K;
+            const double* restrict const y = batch->y + i*K;
+            const double* restrict const z = batch->z + i*K;
+            const double* restrict const m = batch->m + i*K;
+            double* restrict const ax = batch->ax + i*K;
+            double* restrict const ay = batch->ay + i*K;
+            double* restrict const az = batch->az + i*K;
+#pragma omp simd
+            for (int k=0; k<K; k++){
+                const double dx = x[k] - xs[k];
+                const double dy = y[k] - ys[k];
+                const double dz = z[k] - zs[k];
+                const double r2 = dx*dx + dy*dy + dz*dz;
+                const double r = sqrt(r2);
+                const double costheta2 = dz*dz/r2;
+                const double prefac = 5.*J4[k]*R_eq[k]*R_eq[k]*R_eq[k]*R_eq[k]/r2/r2/r2/r/8.;
+                const double fac = 63.*costheta2*costheta2-42.*costheta2 + 3.;
+
+                ax[k] += on[k] != 0. ? G[k]*ms[k]*prefac*fac*dx : 0.;
+                ay[k] += on[k] != 0. ? G[k]*ms[k]*prefac*fac*dy : 0.;
+                az[k] += on[k] != 0. ? G[k]*ms[k]*prefac*(fac+12.-28.*costheta2)*dz : 0.;
+                axs[k] -= on[k] != 0. ? G[k]*m[k]*prefac*fac*dx : 0.;
+                ays[k] -= on[k] != 0. ? G[k]*m[k]*prefac*fac*dy : 0.;
+                azs[k] -= on[k] != 0. ? G[k]*m[k]*prefac*(fac+12.-28.*costheta2)*dz : 0.;
+            }
+        }
+    }
+}
+
+// Same as rebx_gravitational_harmonics on each simulation of the batch, with the loop over simulations innermost
+void rebx_gravitational_harmonics_batch(struct rebx_batch* const batch, const int j){
+    const int NK = batch->N*batch->K;
+    double* const block = rebx_batch_scratch(batch, 3*NK);
+    if (block == NULL){
+        return;
+    }
+    const struct rebx_harmonics_batch_lanes lanes = {.Jn = block, .R_eq = block + NK, .on = block + 2*NK};
+    rebx_J2_batch(batch, lanes);
+    rebx_J4_batch(batch, lanes);
 }
 
 static double rebx_calculate_J2_potential(struct reb_simulation* const sim, const double J2, const double R_eq, const int source_index){
@@ -168,13 +388,17 @@ static double rebx_J2_potential(struct rebx_extras* const rebx, struct reb_simul
     const int N_real = sim->N - sim->N_var;
     struct reb_particle* const particles = sim->particles;
     double Htot = 0.;
-    for (int i=0; i<N_real; i++){
-        const double* const J2 = rebx_get_param(rebx, particles[i].ap, "J2");
-        if (J2 != NULL){
-            const double* const R_eq = rebx_get_param(rebx, particles[i].ap, "R_eq");
-            if (R_eq != NULL){
-                Htot += rebx_calculate_J2_potential(sim, *J2, *R_eq, i);
-            }
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N_real, rebx_intern(rebx, "J2"));
+    if (sources == NULL){
+        return 0.;
+    }
+    const int id_R_eq = rebx_intern(rebx, "R_eq");
+    for (int k=0; k<sources->N_particles; k++){
+        const int i = sources->index[k];
+        const double* const J2 = sources->values[k];
+        const double* const R_eq = rebx_get_param_by_id(rebx, particles[i].ap, id_R_eq);
+        if (R_eq != NULL){
+            Htot += rebx_calculate_J2_potential(sim, *J2, *R_eq, i);
         }
     }
     return Htot;
@@ -209,13 +433,17 @@ static double rebx_J4_potential(struct rebx_extras* const rebx, struct reb_simul
     const int N_real = sim->N - sim->N_var;
     struct reb_particle* const particles = sim->particles;
     double Htot = 0.;
-    for (int i=0; i<N_real; i++){
-        const double* const J4 = rebx_get_param(rebx, particles[i].ap, "J4");
-        if (J4 != NULL){
-            const double* const R_eq = rebx_get_param(rebx, particles[i].ap, "R_eq");
-            if (R_eq != NULL){
-                Htot += rebx_calculate_J4_potential(sim, *J4, *R_eq, i);
-            }
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N_real, rebx_intern(rebx, "J4"));
+    if (sources == NULL){
+        return 0.;
+    }
+    const int id_R_eq = rebx_intern(rebx, "R_eq");
+    for (int k=0; k<sources->N_particles; k++){
+        const int i = sources->index[k];
+        const double* const J4 = sources->values[k];
+        const double* const R_eq = rebx_get_param_by_id(rebx, particles[i].ap, id_R_eq);
+        if (R_eq != NULL){
+            Htot += rebx_calculate_J4_potential(sim, *J4, *R_eq, i);
         }
     }
     return Htot;
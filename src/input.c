@@ -27,30 +27,33 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
 #include "rebound.h"
 #include "reboundx.h"
 #include "core.h"
 
+// Snapshots are parsed in place from memory. A file is read into memory one snapshot at a time, and a buffer
+// passed with rebx_init_extras_from_buffer() is parsed directly, without copying.
+struct rebx_binary_source{
+    FILE* file;                 // NULL if the binary is in memory
+    const char* data;           // Binary in memory (NULL if reading from a file)
+    long size;                  // Size of the binary in bytes
+};
+
+// Region of a binary being parsed (a single snapshot)
+struct rebx_binary_reader{
+    const char* data;
+    long size;
+    long pos;                   // Offset of the next field in data
+    char* owned;                // Copy of the region read from a file. NULL if data points into the caller's buffer
+};
+
 // Macro to read a single field from a binary file.
 #define CASE(typename, valueref) case REBX_BINARY_FIELD_TYPE_##typename: \
 {\
-if(!fread(valueref, field.size, 1, inf)){\
+if(field.size != sizeof(*(valueref)) || !rebx_read(inf, valueref, field.size)){\
 *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;\
-}\
-break;\
-}\
-
-#define CASE_MALLOC(typename, valueref) case REBX_BINARY_FIELD_TYPE_##typename: \
-{\
-valueref = malloc(field.size);\
-if(valueref == NULL){\
-*warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;\
-}\
-else{\
-if(!fread(valueref, field.size, 1, inf)){\
-*warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;\
-free(valueref);\
-}\
+rebx_skip(inf, field.size);\
 }\
 break;\
 }\
@@ -59,11 +62,88 @@ void rebx_input_skip_binary_field(FILE* inf, long field_size){
     fseek(inf, field_size, SEEK_CUR);
 }
 
-static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type expected_type, struct rebx_node** ap, FILE* inf, enum rebx_input_binary_messages* warnings);
+// Copies size bytes at position pos of the binary into dst. Returns 0 if they're not all there
+static int rebx_source_read(const struct rebx_binary_source* src, const long pos, void* dst, const long size){
+    if (pos < 0 || size < 0 || size > src->size - pos){
+        return 0;
+    }
+    if (src->file){
+        return !fseek(src->file, pos, SEEK_SET) && (size == 0 || fread(dst, size, 1, src->file));
+    }
+    memcpy(dst, src->data + pos, size);
+    return 1;
+}
+
+// Sets up a reader for the field (and everything nested in it) starting at offset
+static int rebx_reader_open(const struct rebx_binary_source* src, const long offset, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
+    struct rebx_binary_field field;
+    inf->data = NULL;
+    inf->size = 0;
+    inf->pos = 0;
+    inf->owned = NULL;
+    if (!rebx_source_read(src, offset, &field, sizeof(field)) || field.size < 0 || field.size > src->size - offset - (long)sizeof(field)){
+        *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+        return 0;
+    }
+    inf->size = sizeof(field) + field.size;
+    if (src->file == NULL){
+        inf->data = src->data + offset;
+        return 1;
+    }
+    inf->owned = malloc(inf->size);
+    if (inf->owned == NULL){
+        *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
+        return 0;
+    }
+    if (!rebx_source_read(src, offset, inf->owned, inf->size)){
+        *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+        free(inf->owned);
+        inf->owned = NULL;
+        return 0;
+    }
+    inf->data = inf->owned;
+    return 1;
+}
+
+static void rebx_reader_close(struct rebx_binary_reader* inf){
+    free(inf->owned);
+    inf->owned = NULL;
+    inf->data = NULL;
+}
+
+static int rebx_read(struct rebx_binary_reader* inf, void* dst, const long size){
+    if (size < 0 || size > inf->size - inf->pos){
+        return 0;
+    }
+    memcpy(dst, inf->data + inf->pos, size);
+    inf->pos += size;
+    return 1;
+}
+
+static void rebx_skip(struct rebx_binary_reader* inf, const long size){
+    if (size < 0 || size > inf->size - inf->pos){
+        inf->pos = inf->size; // anything read after this fails
+    }
+    else{
+        inf->pos += size;
+    }
+}
+
+// Returns a pointer to the next size bytes without copying them. NULL if they're not all there
+static const char* rebx_read_in_place(struct rebx_binary_reader* inf, const long size){
+    if (size < 0 || size > inf->size - inf->pos){
+        return NULL;
+    }
+    const char* data = inf->data + inf->pos;
+    inf->pos += size;
+    return data;
+}
+
+static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type expected_type, struct rebx_node** ap, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings);
 
-static struct rebx_param* rebx_read_param(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static struct rebx_param* rebx_read_param(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     
-    struct rebx_param* param = malloc(sizeof(*param));
+    struct rebx_param* param = rebx_pool_alloc(rebx, REBX_POOL_PARAM);
     if (param == NULL){
         *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
         return NULL;
@@ -71,24 +151,51 @@ static struct rebx_param* rebx_read_param(struct rebx_extras* rebx, FILE* inf, e
     param->value = NULL;
     param->name = NULL;
     param->type = REBX_TYPE_NONE;
+    param->id = -1;
+    param->in_column = 0;
+    const char* value = NULL;   // points into the binary until the type is known
+    long size_value = 0;
     
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){ // means we didn't reach an END field. Corrupt
+        if (!rebx_read(inf, &field, sizeof(field))){ // means we didn't reach an END field. Corrupt
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             break;
         }
         switch (field.type){
             CASE(PARAM_TYPE,                  &param->type);
-            CASE_MALLOC(NAME,                 param->name);
-            CASE_MALLOC(PARAM_VALUE,          param->value);
+            case REBX_BINARY_FIELD_TYPE_NAME:
+            {
+                const char* name = rebx_read_in_place(inf, field.size);
+                if (name == NULL || field.size == 0 || name[field.size-1] != '\0' || param->name != NULL){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                    break;
+                }
+                param->name = malloc(field.size); // swapped for the registered name in rebx_load_param if there is one
+                if (param->name == NULL){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
+                    break;
+                }
+                memcpy(param->name, name, field.size);
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_PARAM_VALUE:
+            {
+                value = rebx_read_in_place(inf, field.size);
+                size_value = field.size;
+                if (value == NULL){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                }
+                break;
+            }
             case REBX_BINARY_FIELD_TYPE_END:
                 reading_fields=0;
                 break;
             default: // Might have added new fields, saved with new version and loaded with old version
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -96,13 +203,33 @@ static struct rebx_param* rebx_read_param(struct rebx_extras* rebx, FILE* inf, e
     // Check type and name after param has been loaded. Check value later (registered params should have value=NULL)
     if (param->type == REBX_TYPE_NONE || param->name == NULL){
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-        rebx_free_param(param);
+        rebx_free_param(rebx, param);
         return NULL;
     }
+    if (value != NULL){
+        // Values REBOUNDx owns are copied straight into the param, like params set through the API
+        param->value = rebx_param_storage(param);
+        if (param->value != NULL){
+            if (size_value != (long)rebx_sizeof(rebx, param->type)){
+                *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                rebx_free_param(rebx, param);
+                return NULL;
+            }
+        }
+        else{
+            param->value = malloc(size_value + 1);
+            if (param->value == NULL){
+                *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
+                rebx_free_param(rebx, param);
+                return NULL;
+            }
+        }
+        memcpy(param->value, value, size_value);
+    }
     return param;
 }
 
-static int rebx_load_param(struct rebx_extras* rebx, struct rebx_node** ap, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_param(struct rebx_extras* rebx, struct rebx_node** ap, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct rebx_param* param = rebx_read_param(rebx, inf, warnings);
     
     if(param == NULL){
@@ -111,18 +238,26 @@ static int rebx_load_param(struct rebx_extras* rebx, struct rebx_node** ap, FILE
     
     if(param->value == NULL){
         *warnings |= REBX_INPUT_BINARY_WARNING_PARAM_VALUE_NULL;
-        rebx_free_param(param);
+        rebx_free_param(rebx, param);
         return 0;
     }
     
     if(param->type == REBX_TYPE_FORCE){
         struct rebx_force* force = rebx_get_force(rebx, param->value);
+        free(param->value); // force name
+        param->value = force;
         if (force == NULL){
             *warnings |= REBX_INPUT_BINARY_WARNING_FORCE_PARAM_NOT_LOADED;
-            rebx_free_param(param);
+            rebx_free_param(rebx, param);
             return 0;
         }
-        param->value = force;
+    }
+    // Registered params are loaded first, so we can pick up the interned id for fast lookups
+    struct rebx_param* reg_param = rebx_get_registered_param(rebx, param->name);
+    if (reg_param != NULL){
+        free(param->name); // borrow the registry's copy, as when set through the API
+        param->name = reg_param->name;
+        param->id = reg_param->id;
     }
     int success = rebx_add_param(rebx, ap, param);
     if(!success){
@@ -132,23 +267,24 @@ static int rebx_load_param(struct rebx_extras* rebx, struct rebx_node** ap, FILE
     
 }
 
-static int rebx_load_registered_param(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_registered_param(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct rebx_param* param = rebx_read_param(rebx, inf, warnings);
     
     if(param == NULL){
         return 0;
     }
     
-    int success = rebx_add_param(rebx, &rebx->registered_params, param);
+    int success = rebx_add_registered_param(rebx, param);
     if(!success){
         return 0;
     }
     return 1;
 }
 
-static char* rebx_load_name(FILE* inf, enum rebx_input_binary_messages* warnings){
+// Names of forces and operators are only used for lookups, so they're read in place (valid while inf is open)
+static const char* rebx_load_name(struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct rebx_binary_field field;
-    if (!fread(&field, sizeof(field), 1, inf)){
+    if (!rebx_read(inf, &field, sizeof(field))){
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
         return NULL;
     }
@@ -156,28 +292,22 @@ static char* rebx_load_name(FILE* inf, enum rebx_input_binary_messages* warnings
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
         return NULL;
     }
-    char* name = malloc(field.size);
-    if (name == NULL){
-        *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
-        return NULL;
-    }
-    if (!fread(name, field.size, 1, inf)){
+    const char* name = rebx_read_in_place(inf, field.size);
+    if (name == NULL || field.size == 0 || name[field.size-1] != '\0'){
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-        free(name);
         return NULL;
     }
     return name;
 }
 
-static int rebx_load_force_field(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_force_field(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     
     // Name of force always comes first so that we can load it
-    char* name = rebx_load_name(inf, warnings);
+    const char* name = rebx_load_name(inf, warnings);
     if(name == NULL){
         return 0;
     }
     struct rebx_force* force = rebx_load_force(rebx, name);
-    free(name);
     if(force == NULL){
         *warnings |= REBX_INPUT_BINARY_WARNING_FORCE_NOT_LOADED;
         return 0;
@@ -186,7 +316,7 @@ static int rebx_load_force_field(struct rebx_extras* rebx, FILE* inf, enum rebx_
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             return 0;
         }
@@ -206,7 +336,7 @@ static int rebx_load_force_field(struct rebx_extras* rebx, FILE* inf, enum rebx_
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
-                rebx_input_skip_binary_field(inf, field.size);
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -216,14 +346,13 @@ static int rebx_load_force_field(struct rebx_extras* rebx, FILE* inf, enum rebx_
 }
 
 // Force is already loaded in allocated_forces. Need to get from that list and add to sim
-static int rebx_load_additional_force_field(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_additional_force_field(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     
-    char* name = rebx_load_name(inf, warnings);
+    const char* name = rebx_load_name(inf, warnings);
     if(name == NULL){
         return 0;
     }
     struct rebx_force* force = rebx_get_force(rebx, name);
-    free(name);
     if(force == NULL){
         return 0;
     }
@@ -232,7 +361,7 @@ static int rebx_load_additional_force_field(struct rebx_extras* rebx, FILE* inf,
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             return 0;
         }
@@ -245,7 +374,7 @@ static int rebx_load_additional_force_field(struct rebx_extras* rebx, FILE* inf,
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
-                rebx_input_skip_binary_field(inf, field.size);
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -255,14 +384,136 @@ static int rebx_load_additional_force_field(struct rebx_extras* rebx, FILE* inf,
     return success;
 }
 
-static int rebx_load_operator_field(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+// Reads one binding of a param_driver and adds it to operator. Returns 0 if the binary is corrupt
+static int rebx_load_param_driver_binding(struct rebx_extras* rebx, struct rebx_operator* operator, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
+    const char* name = rebx_load_name(inf, warnings);
+    if(name == NULL){
+        return 0;
+    }
+    const char* force_name = NULL;
+    int particle_index = -1;
+    enum rebx_interpolation_type interpolation = REBX_INTERPOLATION_NONE;
+    int Nvalues = -1;
+    const char* times = NULL;
+    const char* values = NULL;
+    struct rebx_binary_field field;
+    int reading_fields = 1;
+    while (reading_fields){
+        if (!rebx_read(inf, &field, sizeof(field))){
+            *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+            return 0;
+        }
+        switch (field.type){
+            CASE(PARTICLE_INDEX,                   &particle_index);
+            CASE(INTERPOLATION_TYPE,               &interpolation);
+            case REBX_BINARY_FIELD_TYPE_PARAM_DRIVER_FORCE:
+            {
+                force_name = rebx_read_in_place(inf, field.size);
+                if (force_name == NULL || field.size == 0 || force_name[field.size-1] != '\0'){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                    return 0;
+                }
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_INTERPOLATOR_TIMES:
+            case REBX_BINARY_FIELD_TYPE_INTERPOLATOR_VALUES:
+            {
+                const char* const data = rebx_read_in_place(inf, field.size);
+                if (data == NULL || field.size % sizeof(double) != 0 || (Nvalues >= 0 && field.size != Nvalues*(long)sizeof(double))){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                    return 0;
+                }
+                Nvalues = field.size/sizeof(double);
+                if (field.type == REBX_BINARY_FIELD_TYPE_INTERPOLATOR_TIMES){
+                    times = data;
+                }
+                else{
+                    values = data;
+                }
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_END:
+            {
+                reading_fields=0;
+                break;
+            }
+            default:
+            {
+                *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
+                rebx_skip(inf, field.size);
+                break;
+            }
+        }
+    }
+    if (times == NULL || values == NULL){
+        *warnings |= REBX_INPUT_BINARY_WARNING_PARAM_NOT_LOADED;
+        return 1;
+    }
+    // The series may not be aligned in the binary, so copy them out before setting up the interpolator
+    double* const series = malloc(2*Nvalues*sizeof(*series));
+    if (series == NULL){
+        *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
+        return 0;
+    }
+    memcpy(series, times, Nvalues*sizeof(*series));
+    memcpy(series + Nvalues, values, Nvalues*sizeof(*series));
+    struct rebx_interpolator interp;
+    rebx_init_interpolator_borrowed(rebx, &interp, Nvalues, 1, series, series + Nvalues, interpolation);
+    int success;
+    if (force_name != NULL){
+        struct rebx_force* const force = rebx_get_force(rebx, force_name);
+        success = force != NULL && rebx_drive_force_param(rebx, operator, force, name, &interp, 0);
+    }
+    else{
+        success = rebx_drive_particle_param(rebx, operator, particle_index, name, &interp, 0);
+    }
+    if (!success){
+        *warnings |= REBX_INPUT_BINARY_WARNING_PARAM_NOT_LOADED;
+    }
+    rebx_free_interpolator_pointers(&interp);
+    free(series);
+    return 1;
+}
+
+static int rebx_load_param_driver(struct rebx_extras* rebx, struct rebx_operator* operator, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
+    struct rebx_binary_field field;
+    int reading_fields = 1;
+    while (reading_fields){
+        if (!rebx_read(inf, &field, sizeof(field))){
+            *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+            return 0;
+        }
+        switch (field.type){
+            case REBX_BINARY_FIELD_TYPE_PARAM_DRIVER_BINDING:
+            {
+                if (!rebx_load_param_driver_binding(rebx, operator, inf, warnings)){
+                    return 0;
+                }
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_END:
+            {
+                reading_fields=0;
+                break;
+            }
+            default:
+            {
+                *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
+                rebx_skip(inf, field.size);
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+static int rebx_load_operator_field(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     // Name of force always comes first so that we can load it
-    char* name = rebx_load_name(inf, warnings);
+    const char* name = rebx_load_name(inf, warnings);
     if(name == NULL){
         return 0;
     }
     struct rebx_operator* operator = rebx_load_operator(rebx, name);
-    free(name);
     if(operator == NULL){
         *warnings |= REBX_INPUT_BINARY_WARNING_OPERATOR_NOT_LOADED;
         return 0;
@@ -271,7 +522,7 @@ static int rebx_load_operator_field(struct rebx_extras* rebx, FILE* inf, enum re
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             break;
         }
@@ -283,6 +534,13 @@ static int rebx_load_operator_field(struct rebx_extras* rebx, FILE* inf, enum re
                 }
                 break;
             }
+            case REBX_BINARY_FIELD_TYPE_PARAM_DRIVER:
+            {
+                if (!rebx_load_param_driver(rebx, operator, inf, warnings)){
+                    return 0;
+                }
+                break;
+            }
             case REBX_BINARY_FIELD_TYPE_END:
             {
                 reading_fields=0;
@@ -291,7 +549,7 @@ static int rebx_load_operator_field(struct rebx_extras* rebx, FILE* inf, enum re
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
-                rebx_input_skip_binary_field(inf, field.size);
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -300,34 +558,38 @@ static int rebx_load_operator_field(struct rebx_extras* rebx, FILE* inf, enum re
     return 1;
 }
 
-static int rebx_load_step_field(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings, struct rebx_node** ap){
-    char* name = rebx_load_name(inf, warnings);
+static int rebx_load_step_field(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings, struct rebx_node** ap){
+    const char* name = rebx_load_name(inf, warnings);
     if(name == NULL){
         return 0;
     }
     struct rebx_operator* operator = rebx_get_operator(rebx, name);
-    free(name);
     if(operator == NULL){
         *warnings |= REBX_INPUT_BINARY_WARNING_OPERATOR_NOT_LOADED;
         return 0;
     }
     
     double dt_fraction = 0.;
+    int every = 1;
+    int phase = 0;
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             break;
         }
         switch (field.type){
             CASE(STEP_DT_FRACTION,                 &dt_fraction);
+            CASE(STEP_EVERY,                       &every);
+            CASE(STEP_PHASE,                       &phase);
             case REBX_BINARY_FIELD_TYPE_END:
                 reading_fields=0;
                 break;
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -339,18 +601,18 @@ static int rebx_load_step_field(struct rebx_extras* rebx, FILE* inf, enum rebx_i
     
     int success = 0;
     if (ap == &rebx->pre_timestep_modifications) {
-        success = rebx_add_operator_step(rebx, operator, dt_fraction, REBX_TIMING_PRE);
+        success = rebx_add_operator_step_every(rebx, operator, dt_fraction, REBX_TIMING_PRE, every, phase);
     }
     if (ap == &rebx->post_timestep_modifications) {
-        success = rebx_add_operator_step(rebx, operator, dt_fraction, REBX_TIMING_POST);
+        success = rebx_add_operator_step_every(rebx, operator, dt_fraction, REBX_TIMING_POST, every, phase);
     }
     return success;
 }
 
-static int rebx_load_particle(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_particle(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct reb_particle* p = NULL;
     struct rebx_binary_field field;
-    if (!fread(&field, sizeof(field), 1, inf)){
+    if (!rebx_read(inf, &field, sizeof(field))){
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
         return 0;
     }
@@ -360,16 +622,19 @@ static int rebx_load_particle(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
         return 0;
     }
     int index;
-    if(!fread(&index, field.size, 1, inf)){
+    if(field.size != sizeof(index) || !rebx_read(inf, &index, sizeof(index))){
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
         return 0;
     }
+    if(index < 0 || index >= rebx->sim->N){
+        return 0;
+    }
     
     p = &rebx->sim->particles[index]; // checked sim is valid in init_from_binary
     
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             return 0;
         }
@@ -389,7 +654,7 @@ static int rebx_load_particle(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
-                rebx_input_skip_binary_field(inf, field.size);
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -397,11 +662,11 @@ static int rebx_load_particle(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
     return 1;
 }
 
-static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_rebx(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             break;
         }
@@ -415,7 +680,7 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_REGISTERED_PARAM, &rebx->registered_params, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -423,7 +688,7 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_FORCE, NULL, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -431,7 +696,7 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_OPERATOR, NULL, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -439,7 +704,7 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_ADDITIONAL_FORCE, NULL, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -447,7 +712,7 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_STEP, &rebx->pre_timestep_modifications, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -455,14 +720,14 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_STEP, &rebx->post_timestep_modifications, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
-                rebx_input_skip_binary_field(inf, field.size);
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -470,9 +735,9 @@ static int rebx_load_rebx(struct rebx_extras* rebx, FILE* inf, enum rebx_input_b
     return 1;
 }
 
-static int rebx_load_snapshot(struct rebx_extras* rebx, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_snapshot(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct rebx_binary_field field;
-    if (!fread(&field, sizeof(field), 1, inf)){
+    if (!rebx_read(inf, &field, sizeof(field))){
         *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
         return 0;
     }
@@ -483,7 +748,7 @@ static int rebx_load_snapshot(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
 
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
             break;
         }
@@ -492,7 +757,7 @@ static int rebx_load_snapshot(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
             {
                 if (!rebx_load_rebx(rebx, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_REBX_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -500,10 +765,17 @@ static int rebx_load_snapshot(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
             {
                 if (!rebx_load_list(rebx, REBX_BINARY_FIELD_TYPE_PARTICLE, NULL, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
+            case REBX_BINARY_FIELD_TYPE_SNAPSHOT_TIME:
+            case REBX_BINARY_FIELD_TYPE_SNAPSHOT_STEPS_DONE:
+            {
+                // Only used for finding snapshots. Time and steps_done are loaded with the REBOUND simulation
+                rebx_skip(inf, field.size);
+                break;
+            }
             case REBX_BINARY_FIELD_TYPE_END:
             {
                 reading_fields=0;
@@ -512,7 +784,7 @@ static int rebx_load_snapshot(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
             default:
             {
                 *warnings |= REBX_INPUT_BINARY_WARNING_LIST_UNKNOWN;
-                rebx_input_skip_binary_field(inf, field.size);
+                rebx_skip(inf, field.size);
                 break;
             }
         }
@@ -521,12 +793,163 @@ static int rebx_load_snapshot(struct rebx_extras* rebx, FILE* inf, enum rebx_inp
     return 1;
 }
 
+// Copies the values in a column of a delta snapshot into the params of the listed particles. Reads everything in place
+static int rebx_load_delta_column(struct rebx_extras* rebx, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
+    struct reb_simulation* const sim = rebx->sim;
+    const char* name = NULL;
+    enum rebx_param_type type = REBX_TYPE_NONE;
+    const char* particles = NULL;
+    const char* values = NULL;
+    long size_name = 0;
+    long size_particles = 0;
+    long size_values = 0;
+    
+    struct rebx_binary_field field;
+    int reading_fields = 1;
+    while (reading_fields){
+        if (!rebx_read(inf, &field, sizeof(field))){
+            *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+            break;
+        }
+        switch (field.type){
+            CASE(PARAM_TYPE, &type);
+            case REBX_BINARY_FIELD_TYPE_NAME:
+            {
+                size_name = field.size;
+                name = rebx_read_in_place(inf, field.size);
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_PARTICLE_INDEX:
+            {
+                size_particles = field.size;
+                particles = rebx_read_in_place(inf, field.size);
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_PARAM_VALUE:
+            {
+                size_values = field.size;
+                values = rebx_read_in_place(inf, field.size);
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_END:
+            {
+                reading_fields=0;
+                break;
+            }
+            default:
+            {
+                *warnings |= REBX_INPUT_BINARY_WARNING_FIELD_UNKNOWN;
+                rebx_skip(inf, field.size);
+                break;
+            }
+        }
+    }
+    
+    if (name == NULL || particles == NULL || values == NULL || size_name == 0 || name[size_name-1] != '\0'){
+        *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+        return 0;
+    }
+    int success = 0;
+    const size_t size = (type == REBX_TYPE_NONE) ? 0 : rebx_sizeof(rebx, type);
+    if (size > 0 && size_particles % sizeof(int) == 0){
+        const long N = size_particles/sizeof(int);
+        if (size_values == N*(long)size && rebx_get_type(rebx, name) == type){
+            const int id = rebx_intern(rebx, name);
+            success = 1;
+            for (long i=0; i<N; i++){
+                int index;
+                memcpy(&index, particles + i*sizeof(index), sizeof(index)); // binary has no alignment guarantees
+                void* value = NULL;
+                if (index >= 0 && index < sim->N){
+                    value = rebx_get_param_by_id(rebx, sim->particles[index].ap, id);
+                }
+                if (value == NULL){ // Param is always in the full snapshot the delta is relative to
+                    success = 0;
+                    continue;
+                }
+                memcpy(value, values + i*size, size);
+            }
+        }
+    }
+    return success;
+}
+
+// Loads the full snapshot a delta snapshot is relative to, then applies the delta
+static int rebx_load_snapshot_delta(struct rebx_extras* rebx, const struct rebx_binary_source* src, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
+    struct rebx_binary_field field;
+    if (!rebx_read(inf, &field, sizeof(field)) || field.type != REBX_BINARY_FIELD_TYPE_SNAPSHOT_DELTA){
+        *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+        return 0;
+    }
+    
+    int loaded_base = 0;
+    int reading_fields = 1;
+    while (reading_fields){
+        if (!rebx_read(inf, &field, sizeof(field))){
+            *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+            break;
+        }
+        switch (field.type){
+            case REBX_BINARY_FIELD_TYPE_DELTA_BASE:
+            {
+                long base;
+                if (field.size != sizeof(base) || !rebx_read(inf, &base, sizeof(base))){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                    return 0;
+                }
+                struct rebx_binary_reader base_inf;
+                if (!rebx_reader_open(src, base, &base_inf, warnings)){
+                    return 0;
+                }
+                loaded_base = rebx_load_snapshot(rebx, &base_inf, warnings);
+                rebx_reader_close(&base_inf);
+                if (!loaded_base){
+                    return 0;
+                }
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_DELTA_COLUMN:
+            {
+                if (!loaded_base){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                    return 0;
+                }
+                const long pos_next = inf->pos + field.size;
+                if (!rebx_load_delta_column(rebx, inf, warnings)){
+                    *warnings |= REBX_INPUT_BINARY_WARNING_PARTICLE_PARAMS_NOT_LOADED;
+                    inf->pos = (field.size < 0 || pos_next > inf->size) ? inf->size : pos_next;
+                }
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_SNAPSHOT_TIME:
+            case REBX_BINARY_FIELD_TYPE_SNAPSHOT_STEPS_DONE:
+            {
+                rebx_skip(inf, field.size);
+                break;
+            }
+            case REBX_BINARY_FIELD_TYPE_END:
+            {
+                reading_fields=0;
+                break;
+            }
+            default:
+            {
+                *warnings |= REBX_INPUT_BINARY_WARNING_LIST_UNKNOWN;
+                rebx_skip(inf, field.size);
+                break;
+            }
+        }
+    }
+    
+    return loaded_base;
+}
+
 // Only fails (returns 0) if binary is in wrong format
-static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type expected_type, struct rebx_node** ap, FILE* inf, enum rebx_input_binary_messages* warnings){
+static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type expected_type, struct rebx_node** ap, struct rebx_binary_reader* inf, enum rebx_input_binary_messages* warnings){
     struct rebx_binary_field field;
     int reading_fields = 1;
     while (reading_fields){
-        if (!fread(&field, sizeof(field), 1, inf)){
+        if (!rebx_read(inf, &field, sizeof(field))){
             return 0;
         }
         
@@ -545,7 +968,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if(!rebx_load_param(rebx, ap, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_WARNING_PARAM_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -553,7 +976,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if(!rebx_load_registered_param(rebx, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_ERROR_REGISTERED_PARAM_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -561,7 +984,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if (!rebx_load_force_field(rebx, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_WARNING_FORCE_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -569,7 +992,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if (!rebx_load_additional_force_field(rebx, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_WARNING_ADDITIONAL_FORCE_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -577,7 +1000,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if (!rebx_load_operator_field(rebx, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_WARNING_OPERATOR_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -585,7 +1008,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if (!rebx_load_step_field(rebx, inf, warnings, ap)){
                     *warnings |= REBX_INPUT_BINARY_WARNING_STEP_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -593,7 +1016,7 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
             {
                 if (!rebx_load_particle(rebx, inf, warnings)){
                     *warnings |= REBX_INPUT_BINARY_WARNING_PARTICLE_PARAMS_NOT_LOADED;
-                    rebx_input_skip_binary_field(inf, field.size);
+                    rebx_skip(inf, field.size);
                 }
                 break;
             }
@@ -607,24 +1030,157 @@ static int rebx_load_list(struct rebx_extras* rebx, enum rebx_binary_field_type
     return 1;
 }
 
-static void rebx_input_read_header(FILE* inf, enum rebx_input_binary_messages* warnings){
-    long objects = 0;
-    // Input header.
+static void rebx_input_check_header(const char* readbuf, enum rebx_input_binary_messages* warnings){
     const char str[] = "REBOUNDx Binary File. Version: ";
     const char zero = '\0';
-    char readbuf[65], curvbuf[65];
+    char curvbuf[65];
     sprintf(curvbuf,"%s%s",str,rebx_version_str);
     memcpy(curvbuf+strlen(curvbuf)+1,rebx_githash_str,sizeof(char)*(62-strlen(curvbuf)));
     curvbuf[63] = zero;
     
-    objects += fread(readbuf,sizeof(*str),64,inf);
     // Note: following compares version, but ignores githash.
     if(strcmp(readbuf,curvbuf)!=0){
         *warnings |= REBX_INPUT_BINARY_WARNING_VERSION;
     }
 }
 
-void rebx_init_extras_from_binary(struct rebx_extras* rebx, const char* const filename, enum rebx_input_binary_messages* warnings){
+static void rebx_input_read_header(FILE* inf, enum rebx_input_binary_messages* warnings){
+    // Input header.
+    char readbuf[65] = {0};
+    if (!fread(readbuf,sizeof(*readbuf),64,inf)){
+        *warnings |= REBX_INPUT_BINARY_WARNING_VERSION;
+        return;
+    }
+    rebx_input_check_header(readbuf, warnings);
+}
+
+// Header is 64 bytes, followed by the snapshots
+#define REBX_BINARY_HEADER_SIZE 64
+
+static struct rebx_binary_snapshot* rebx_read_snapshot_index(const struct rebx_binary_source* src, const long pos_start, long* Nsnapshots, long* pos_end, enum rebx_input_binary_messages* warnings){
+    struct rebx_binary_snapshot* index = NULL;
+    struct rebx_binary_field field;
+    const long pos_eof = src->size;
+    *Nsnapshots = 0;
+    *pos_end = pos_start;
+    
+    // Files with an index end with a copy of its header field
+    if (pos_eof - pos_start >= 2*(long)sizeof(field)){
+        if (rebx_source_read(src, pos_eof - sizeof(field), &field, sizeof(field)) && field.type == REBX_BINARY_FIELD_TYPE_SNAPSHOT_INDEX && field.size > 0 && field.size % sizeof(*index) == 0){
+            const long pos_index = pos_eof - 2*(long)sizeof(field) - field.size;
+            struct rebx_binary_field header;
+            if (pos_index >= pos_start && rebx_source_read(src, pos_index, &header, sizeof(header)) && header.type == field.type && header.size == field.size){
+                index = malloc(field.size);
+                if (index == NULL){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
+                    return NULL;
+                }
+                if (!rebx_source_read(src, pos_index + sizeof(header), index, field.size)){
+                    *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+                    free(index);
+                    return NULL;
+                }
+                *Nsnapshots = field.size/sizeof(*index);
+                *pos_end = pos_index;
+                return index;
+            }
+        }
+    }
+    
+    // No index (binaries from earlier versions, or a write that was interrupted). Scan the snapshots
+    long N_allocated = 0;
+    long pos = pos_start;
+    while (rebx_source_read(src, pos, &field, sizeof(field)) && (field.type == REBX_BINARY_FIELD_TYPE_SNAPSHOT || field.type == REBX_BINARY_FIELD_TYPE_SNAPSHOT_DELTA)){
+        const long pos_snapshot = pos;
+        pos += sizeof(field);
+        if (field.size < (long)sizeof(field) || field.size > pos_eof - pos){ // incomplete snapshot
+            break;
+        }
+        const long pos_next = pos + field.size;
+        if (*Nsnapshots == N_allocated){
+            N_allocated = N_allocated ? 2*N_allocated : 16;
+            struct rebx_binary_snapshot* new_index = realloc(index, N_allocated*sizeof(*index));
+            if (new_index == NULL){
+                *warnings |= REBX_INPUT_BINARY_ERROR_NO_MEMORY;
+                free(index);
+                *Nsnapshots = 0;
+                return NULL;
+            }
+            index = new_index;
+        }
+        struct rebx_binary_snapshot* snapshot = &index[*Nsnapshots];
+        snapshot->t = 0.;
+        snapshot->steps_done = 0;
+        snapshot->offset = pos_snapshot;
+        
+        // Time stamps come first in the snapshot (if present)
+        struct rebx_binary_field stamp;
+        while (rebx_source_read(src, pos, &stamp, sizeof(stamp))){
+            pos += sizeof(stamp);
+            if (stamp.type == REBX_BINARY_FIELD_TYPE_SNAPSHOT_TIME && stamp.size == sizeof(snapshot->t)){
+                if (!rebx_source_read(src, pos, &snapshot->t, sizeof(snapshot->t))){
+                    break;
+                }
+            }
+            else if (stamp.type == REBX_BINARY_FIELD_TYPE_SNAPSHOT_STEPS_DONE && stamp.size == sizeof(snapshot->steps_done)){
+                if (!rebx_source_read(src, pos, &snapshot->steps_done, sizeof(snapshot->steps_done))){
+                    break;
+                }
+            }
+            else{
+                break;
+            }
+            pos += stamp.size;
+        }
+        pos = pos_next;
+        *pos_end = pos_next;
+        (*Nsnapshots)++;
+    }
+    return index;
+}
+
+struct rebx_binary_snapshot* rebx_input_read_snapshot_index(FILE* inf, long* Nsnapshots, long* pos_end, enum rebx_input_binary_messages* warnings){
+    const long pos_start = ftell(inf);
+    fseek(inf, 0, SEEK_END);
+    struct rebx_binary_source src = {.file = inf, .data = NULL, .size = ftell(inf)};
+    return rebx_read_snapshot_index(&src, pos_start, Nsnapshots, pos_end, warnings);
+}
+
+static void rebx_init_extras_from_source(struct rebx_extras* rebx, const struct rebx_binary_source* src, long snapshot, enum rebx_input_binary_messages* warnings){
+    char readbuf[65] = {0};
+    if (rebx_source_read(src, 0, readbuf, REBX_BINARY_HEADER_SIZE)){
+        rebx_input_check_header(readbuf, warnings);
+    }
+    else{
+        *warnings |= REBX_INPUT_BINARY_WARNING_VERSION;
+    }
+    long Nsnapshots = 0;
+    long pos_end = 0;
+    struct rebx_binary_snapshot* index = rebx_read_snapshot_index(src, REBX_BINARY_HEADER_SIZE, &Nsnapshots, &pos_end, warnings);
+    if (snapshot < 0){
+        snapshot += Nsnapshots;
+    }
+    if (index != NULL && snapshot >= 0 && snapshot < Nsnapshots){
+        struct rebx_binary_reader inf;
+        if (rebx_reader_open(src, index[snapshot].offset, &inf, warnings)){
+            struct rebx_binary_field field;
+            memcpy(&field, inf.data, sizeof(field));
+            if (field.type == REBX_BINARY_FIELD_TYPE_SNAPSHOT_DELTA){
+                rebx_load_snapshot_delta(rebx, src, &inf, warnings);
+            }
+            else{
+                rebx_load_snapshot(rebx, &inf, warnings);
+            }
+            rebx_reader_close(&inf);
+        }
+    }
+    else if (!(*warnings & REBX_INPUT_BINARY_ERROR_NO_MEMORY)){
+        *warnings |= REBX_INPUT_BINARY_ERROR_SNAPSHOT_NOT_FOUND;
+    }
+    free(index);
+}
+
+void rebx_init_extras_from_binary_snapshot(struct rebx_extras* rebx, const char* const filename, long snapshot, enum rebx_input_binary_messages* warnings){
     if (rebx->sim == NULL){
         rebx_error(rebx, ""); // rebx_error gives meaningful err
         return;
@@ -634,25 +1190,73 @@ void rebx_init_extras_from_binary(struct rebx_extras* rebx, const char* const fi
         *warnings |= REBX_INPUT_BINARY_ERROR_NOFILE;
         return;
     }
-    
-    rebx_input_read_header(inf, warnings);
-    rebx_load_snapshot(rebx, inf, warnings);
-    
+    fseek(inf, 0, SEEK_END);
+    struct rebx_binary_source src = {.file = inf, .data = NULL, .size = ftell(inf)};
+    rebx_init_extras_from_source(rebx, &src, snapshot, warnings);
     fclose(inf);
     return;
 }
 
-struct rebx_extras* rebx_create_extras_from_binary(struct reb_simulation* sim, const char* const filename){
-    if (sim == NULL){
-        fprintf(stderr, "REBOUNDx Error: Simulation pointer passed to rebx_create_extras_from_binary was NULL.\n");
-        return NULL;
+void rebx_init_extras_from_binary(struct rebx_extras* rebx, const char* const filename, enum rebx_input_binary_messages* warnings){
+    rebx_init_extras_from_binary_snapshot(rebx, filename, -1, warnings);
+}
+
+void rebx_init_extras_from_buffer(struct rebx_extras* rebx, const char* const buf, const size_t size, long snapshot, enum rebx_input_binary_messages* warnings){
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return;
+    }
+    if (buf == NULL){
+        *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+        return;
+    }
+    struct rebx_binary_source src = {.file = NULL, .data = buf, .size = size};
+    rebx_init_extras_from_source(rebx, &src, snapshot, warnings);
+}
+
+static long rebx_find_snapshot(const struct rebx_binary_source* src, const double t, enum rebx_input_binary_messages* warnings){
+    long Nsnapshots = 0;
+    long pos_end = 0;
+    struct rebx_binary_snapshot* index = rebx_read_snapshot_index(src, REBX_BINARY_HEADER_SIZE, &Nsnapshots, &pos_end, warnings);
+    long closest = -1;
+    for (long i=0; i<Nsnapshots; i++){
+        if (closest < 0 || fabs(index[i].t - t) <= fabs(index[closest].t - t)){
+            closest = i;
+        }
+    }
+    free(index);
+    return closest;
+}
+
+long rebx_input_find_snapshot(const char* const filename, const double t, enum rebx_input_binary_messages* warnings){
+    FILE* inf = fopen(filename,"rb");
+    if (!inf){
+        *warnings |= REBX_INPUT_BINARY_ERROR_NOFILE;
+        return -1;
     }
-    enum rebx_input_binary_messages warnings = REBX_INPUT_BINARY_WARNING_NONE;
-    // create manually so that default registered parameters not loaded
-    struct rebx_extras* rebx = malloc(sizeof(*rebx));
-    rebx_initialize(sim, rebx);
-    rebx_init_extras_from_binary(rebx, filename, &warnings);
     
+    rebx_input_read_header(inf, warnings);
+    fseek(inf, 0, SEEK_END);
+    struct rebx_binary_source src = {.file = inf, .data = NULL, .size = ftell(inf)};
+    const long closest = rebx_find_snapshot(&src, t, warnings);
+    fclose(inf);
+    return closest;
+}
+
+long rebx_input_find_snapshot_in_buffer(const char* const buf, const size_t size, const double t, enum rebx_input_binary_messages* warnings){
+    if (buf == NULL){
+        *warnings |= REBX_INPUT_BINARY_ERROR_CORRUPT;
+        return -1;
+    }
+    struct rebx_binary_source src = {.file = NULL, .data = buf, .size = size};
+    return rebx_find_snapshot(&src, t, warnings);
+}
+
+struct rebx_extras* rebx_create_extras_from_binary(struct reb_simulation* sim, const char* const filename){
+    return rebx_create_extras_from_binary_snapshot(sim, filename, -1);
+}
+
+static void rebx_input_report_messages(struct reb_simulation* sim, const enum rebx_input_binary_messages warnings){
     if (warnings & REBX_INPUT_BINARY_ERROR_NOFILE){
         reb_error(sim,"REBOUNDx: Cannot open binary file. Check filename.");
     }
@@ -665,6 +1269,9 @@ struct rebx_extras* rebx_create_extras_from_binary(struct reb_simulation* sim, c
     if (warnings & REBX_INPUT_BINARY_ERROR_REBX_NOT_LOADED){
         reb_error(sim,"REBOUNDx: REBOUNDx structure couldn't be loaded.");
     }
+    if (warnings & REBX_INPUT_BINARY_ERROR_SNAPSHOT_NOT_FOUND){
+        reb_error(sim,"REBOUNDx: Requested snapshot is not in the binary file.");
+    }
     if (warnings & REBX_INPUT_BINARY_ERROR_REGISTERED_PARAM_NOT_LOADED){
         reb_error(sim,"REBOUNDx: At least one registered parameter was not loaded. This typically indicates the binary is corrupt or was saved with an incompatible version to the current one being used.");
     }
@@ -701,6 +1308,32 @@ struct rebx_extras* rebx_create_extras_from_binary(struct reb_simulation* sim, c
     if (warnings & REBX_INPUT_BINARY_WARNING_FORCE_PARAM_NOT_LOADED){
         reb_warning(sim,"REBOUNDx: A force parameter failed to load from the list of REBOUNDx implemented forces. Custom forces can't be saved to a REBOUNDx binary, and function points must be reset when a simulation is reloaded.");
     }
+}
+
+struct rebx_extras* rebx_create_extras_from_binary_snapshot(struct reb_simulation* sim, const char* const filename, long snapshot){
+    if (sim == NULL){
+        fprintf(stderr, "REBOUNDx Error: Simulation pointer passed to rebx_create_extras_from_binary was NULL.\n");
+        return NULL;
+    }
+    enum rebx_input_binary_messages warnings = REBX_INPUT_BINARY_WARNING_NONE;
+    // create manually so that default registered parameters not loaded
+    struct rebx_extras* rebx = malloc(sizeof(*rebx));
+    rebx_initialize(sim, rebx);
+    rebx_init_extras_from_binary_snapshot(rebx, filename, snapshot, &warnings);
+    rebx_input_report_messages(sim, warnings);
+    return rebx;
+}
+
+struct rebx_extras* rebx_create_extras_from_buffer(struct reb_simulation* sim, const char* const buf, const size_t size, long snapshot){
+    if (sim == NULL){
+        fprintf(stderr, "REBOUNDx Error: Simulation pointer passed to rebx_create_extras_from_buffer was NULL.\n");
+        return NULL;
+    }
+    enum rebx_input_binary_messages warnings = REBX_INPUT_BINARY_WARNING_NONE;
+    struct rebx_extras* rebx = malloc(sizeof(*rebx));
+    rebx_initialize(sim, rebx);
+    rebx_init_extras_from_buffer(rebx, buf, size, snapshot, &warnings);
+    rebx_input_report_messages(sim, warnings);
     return rebx;
 }
 
@@ -31,6 +31,54 @@
 #include "core.h"
 #include "rebxtools.h"
 
+struct rebx_integrator_workspace* rebx_get_integrator_workspace(struct rebx_extras* const rebx, struct rebx_force* const force, const int N, const int N_vectors){
+    struct rebx_integrator_workspace* ws = rebx_get_param(rebx, force->ap, "integrator_workspace");
+    if (ws == NULL){
+        ws = calloc(1, sizeof(*ws));
+        if (ws == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, "integrator_workspace", ws);
+        rebx_set_param_pointer(rebx, &force->ap, "free_arrays", rebx_free_integrator_workspace);
+    }
+    if (N > ws->N_allocated || ws->ps == NULL){
+        int N_new = 2*ws->N_allocated; // grow geometrically so that adding particles one at a time does not realloc every step
+        if (N_new < N){
+            N_new = N;
+        }
+        if (N_new < 1){
+            N_new = 1;
+        }
+        struct reb_particle* const ps = realloc(ws->ps, N_new*sizeof(*ps));
+        if (ps == NULL){
+            return NULL;
+        }
+        ws->ps = ps;
+        ws->N_allocated = N_new;
+        ws->N_vectors = 0; // v is resized below for the new N_allocated
+    }
+    if (N_vectors > ws->N_vectors){
+        double* const v = realloc(ws->v, 3*ws->N_allocated*N_vectors*sizeof(*v));
+        if (v == NULL){
+            return NULL;
+        }
+        ws->v = v;
+        ws->N_vectors = N_vectors;
+    }
+    return ws;
+}
+
+void rebx_free_integrator_workspace(struct rebx_extras* rebx, struct rebx_force* force){
+    struct rebx_integrator_workspace* const ws = rebx_get_param(rebx, force->ap, "integrator_workspace");
+    if (ws == NULL){
+        return;
+    }
+    free(ws->ps);
+    free(ws->v);
+    free(ws);
+    rebx_set_param_pointer(rebx, &force->ap, "integrator_workspace", NULL);
+}
+
 void rebx_integrate_force(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
     struct rebx_extras* rebx = sim->extras;
     struct rebx_force* force = rebx_get_param(rebx, operator->ap, "force");
@@ -56,6 +104,16 @@ void rebx_integrate_force(struct reb_simulation* const sim, struct rebx_operator
             rebx_integrator_rk2_integrate(sim, dt, force);
             break;
         }
+        case REBX_INTEGRATOR_RK45:
+        {
+            double tolerance = 1.e-10; // default
+            const double* const toleranceparam = rebx_get_param(rebx, operator->ap, "integrator_tolerance");
+            if (toleranceparam != NULL){
+                tolerance = *toleranceparam;
+            }
+            rebx_integrator_rk45_integrate(sim, dt, force, tolerance);
+            break;
+        }
         case REBX_INTEGRATOR_RK4:
         {
             rebx_integrator_rk4_integrate(sim, dt, force);
@@ -28,11 +28,12 @@
 #include <stdio.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "core.h"
 #include "rebxtools.h"
 
 void rebx_integrator_euler_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force){
     const int N = sim->N - sim->N_var;
-    force->update_accelerations(sim, force, sim->particles, N);
+    rebx_update_force_accelerations(sim, force, sim->particles, N);
     for(int i=0; i<N; i++){
         sim->particles[i].vx += dt*sim->particles[i].ax;
         sim->particles[i].vy += dt*sim->particles[i].ay;
@@ -29,31 +29,29 @@
 #include <float.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "core.h"
 
-static void avg_particles(struct reb_particle* const ps_avg, struct reb_particle* const ps1, struct reb_particle* const ps2, int N){
+// Only the velocities of the midpoint change between iterations (positions and masses are those of ps_orig throughout)
+static void avg_particles(struct reb_particle* const ps_avg, struct reb_particle* const ps1, double* const v2, int N){
     for(int i=0; i<N; i++){
-        ps_avg[i].x = 0.5*(ps1[i].x + ps2[i].x);
-        ps_avg[i].y = 0.5*(ps1[i].y + ps2[i].y);
-        ps_avg[i].z = 0.5*(ps1[i].z + ps2[i].z);
-        ps_avg[i].vx = 0.5*(ps1[i].vx + ps2[i].vx);
-        ps_avg[i].vy = 0.5*(ps1[i].vy + ps2[i].vy);
-        ps_avg[i].vz = 0.5*(ps1[i].vz + ps2[i].vz);
+        ps_avg[i].vx = 0.5*(ps1[i].vx + v2[3*i]);
+        ps_avg[i].vy = 0.5*(ps1[i].vy + v2[3*i+1]);
+        ps_avg[i].vz = 0.5*(ps1[i].vz + v2[3*i+2]);
         ps_avg[i].ax = 0.;
         ps_avg[i].ay = 0.;
         ps_avg[i].az = 0.;
-        ps_avg[i].m = 0.5*(ps1[i].m + ps2[i].m);
     }
 }
 
-static int compare(struct reb_particle* ps1, struct reb_particle* ps2, int N){
+static int compare(double* v1, double* v2, int N){
     double tot2 = 0.;
     double deltatot2 = 0.;
     for(int i=0; i<N; i++){
-        const double dvx = ps1[i].vx - ps2[i].vx;
-        const double dvy = ps1[i].vy - ps2[i].vy;
-        const double dvz = ps1[i].vz - ps2[i].vz;
+        const double dvx = v1[3*i] - v2[3*i];
+        const double dvy = v1[3*i+1] - v2[3*i+1];
+        const double dvz = v1[3*i+2] - v2[3*i+2];
         deltatot2 += dvx*dvx + dvy*dvy + dvz*dvz;
-        tot2 += ps1[i].vx*ps1[i].vx + ps1[i].vy*ps1[i].vy + ps1[i].vz*ps1[i].vz;
+        tot2 += v1[3*i]*v1[3*i] + v1[3*i+1]*v1[3*i+1] + v1[3*i+2]*v1[3*i+2];
     }
     if (deltatot2/tot2 < DBL_EPSILON*DBL_EPSILON){
         return 1;
@@ -63,62 +61,49 @@ static int compare(struct reb_particle* ps1, struct reb_particle* ps2, int N){
     }
 }
 
-void rebx_im_free_arrays(struct rebx_extras* rebx, struct rebx_force* force){
-    struct reb_particle* const ps_final = rebx_get_param(rebx, force->ap, "ps_final");
-    free(ps_final);
-    struct reb_particle* const ps_prev = rebx_get_param(rebx, force->ap, "ps_prev");
-    free(ps_prev);
-    struct reb_particle* const ps_avg = rebx_get_param(rebx, force->ap, "ps_avg");
-    free(ps_avg);
-}
-
-static struct reb_particle* setup(struct rebx_extras* rebx, struct rebx_force* force, const int N){
-    rebx_set_param_pointer(rebx, &force->ap, "free_arrays", rebx_im_free_arrays);
-    struct reb_particle* const ps_final = malloc(N*sizeof(*ps_final));
-    rebx_set_param_pointer(rebx, &force->ap, "im_ps_final", ps_final);
-    struct reb_particle* const ps_prev = malloc(N*sizeof(*ps_prev));
-    rebx_set_param_pointer(rebx, &force->ap, "im_ps_prev", ps_prev);
-    struct reb_particle* const ps_avg = malloc(N*sizeof(*ps_avg));
-    rebx_set_param_pointer(rebx, &force->ap, "im_ps_avg", ps_avg);
-    
-    return ps_final;
-}
-
+// v_final and v_prev only store velocities (3N doubles). ps_avg is a full particle array, since forces are evaluated on it.
 void rebx_integrator_implicit_midpoint_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force){
     struct rebx_extras* rebx = sim->extras;
     const int N = sim->N - sim->N_var;
-    struct reb_particle* ps_final = rebx_get_param(rebx, force->ap, "im_ps_final");
-    if (ps_final == NULL){
-        ps_final = setup(rebx, force, N);
+    struct rebx_integrator_workspace* const ws = rebx_get_integrator_workspace(rebx, force, N, 2);
+    if (ws == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for stage buffers in integrator_implicit_midpoint.c.\n");
+        return;
     }
-    // These should not fail since we check above and setup if not there
-    struct reb_particle* const ps_prev = rebx_get_param(rebx, force->ap, "im_ps_prev");
-    struct reb_particle* const ps_avg = rebx_get_param(rebx, force->ap, "im_ps_avg");
+    double* v_final = ws->v;
+    double* v_prev = ws->v + 3*ws->N_allocated;
+    struct reb_particle* const ps_avg = ws->ps;
     struct reb_particle* const ps_orig = sim->particles;
-    memcpy(ps_final, sim->particles, N*sizeof(*ps_final));
+    for(int i=0; i<N; i++){
+        v_final[3*i] = ps_orig[i].vx;
+        v_final[3*i+1] = ps_orig[i].vy;
+        v_final[3*i+2] = ps_orig[i].vz;
+    }
     memcpy(ps_avg, sim->particles, N*sizeof(*ps_orig));
     int n, converged;
     for(n=0;n<10;n++){
-        memcpy(ps_prev, ps_final, N*sizeof(*ps_prev));
-        force->update_accelerations(sim, force, ps_avg, N);
+        double* const tmp = v_prev; // swap instead of copying the previous iterate
+        v_prev = v_final;
+        v_final = tmp;
+        rebx_update_force_accelerations(sim, force, ps_avg, N);
         for(int i=0; i<N; i++){
-            ps_final[i].vx = ps_orig[i].vx + dt*ps_avg[i].ax;
-            ps_final[i].vy = ps_orig[i].vy + dt*ps_avg[i].ay;
-            ps_final[i].vz = ps_orig[i].vz + dt*ps_avg[i].az;
+            v_final[3*i] = ps_orig[i].vx + dt*ps_avg[i].ax;
+            v_final[3*i+1] = ps_orig[i].vy + dt*ps_avg[i].ay;
+            v_final[3*i+2] = ps_orig[i].vz + dt*ps_avg[i].az;
         }
-        converged = compare(ps_final, ps_prev, N);
+        converged = compare(v_final, v_prev, N);
         if (converged){
             break;
         }
-        avg_particles(ps_avg, ps_orig, ps_final, N);
+        avg_particles(ps_avg, ps_orig, v_final, N);
     }
     const int default_max_iterations = 10;
     if(n==default_max_iterations){
         reb_warning(sim, "REBOUNDx: 10 iterations in integrator_implicit_midpoint.c failed to converge. This is typically because the perturbation is too strong for the current implementation.");
     }
     for(int i=0; i<N; i++){
-        sim->particles[i].vx = ps_final[i].vx;
-        sim->particles[i].vy = ps_final[i].vy;
-        sim->particles[i].vz = ps_final[i].vz;
+        sim->particles[i].vx = v_final[3*i];
+        sim->particles[i].vy = v_final[3*i+1];
+        sim->particles[i].vz = v_final[3*i+2];
     }
 }
@@ -30,24 +30,18 @@
 #include "reboundx.h"
 #include "core.h"
 
-void rebx_rk2_free_arrays(struct rebx_extras* rebx, struct rebx_force* force){
-    struct reb_particle* const k2 = rebx_get_param(rebx, force->ap, "rk2_k2");
-    free(k2);
-}
-
 void rebx_integrator_rk2_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force){
     struct rebx_extras* rebx = sim->extras;
     const int N = sim->N - sim->N_var;
-    struct reb_particle* k2 = rebx_get_param(rebx, force->ap, "rk2_k2");
-    if (k2 == NULL){
-        k2 = malloc(N*sizeof(*k2));
-        rebx_set_param_pointer(rebx, &force->ap, "rk2_k2", k2);
-        rebx_set_param_pointer(rebx, &force->ap, "free_arrays", rebx_rk2_free_arrays);
-        
+    struct rebx_integrator_workspace* const ws = rebx_get_integrator_workspace(rebx, force, N, 0);
+    if (ws == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for stage buffers in integrator_rk2.c.\n");
+        return;
     }
+    struct reb_particle* const k2 = ws->ps;
     memcpy(k2, sim->particles, N*sizeof(*k2));
 
-    force->update_accelerations(sim, force, sim->particles, N);
+    rebx_update_force_accelerations(sim, force, sim->particles, N);
     const double a21 = 2.*dt/3.;
     for(int i=0; i<N; i++){
         k2[i].vx = sim->particles[i].vx + a21*sim->particles[i].ax;
@@ -55,7 +49,7 @@ void rebx_integrator_rk2_integrate(struct reb_simulation* const sim, const doubl
         k2[i].vz = sim->particles[i].vz + a21*sim->particles[i].az;
     }
 
-    force->update_accelerations(sim, force, k2, N);
+    rebx_update_force_accelerations(sim, force, k2, N);
 
     const double b1 = dt/4.;
     const double b2 = 3.*dt/4.;
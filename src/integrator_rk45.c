@@ -0,0 +1,158 @@
+/**
+ * @file    integrator_rk45.c
+ * @brief   Adaptive 5(4) Runge Kutta method (Dormand-Prince) with substeps
+ * @author  REBOUNDx developers
+ *
+ * @section LICENSE
+ * Copyright (c) 2026 REBOUNDx developers
+ *
+ * This file is part of reboundx.
+ *
+ * reboundx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * reboundx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+#include "core.h"
+
+// Like the other integrate_force integrators, positions are held fixed and only velocities are integrated across dt.
+// Substeps are adapted so that the embedded 4th order error estimate stays below tolerance (relative to the total velocity,
+// measured in the same way as the implicit midpoint convergence check). The last accepted substep is kept on the workspace
+// and reused as the first guess in the next call.
+
+#define REBX_RK45_STAGES 7
+
+static const double rebx_rk45_a[REBX_RK45_STAGES][REBX_RK45_STAGES-1] = {
+    {0.},
+    {1./5.},
+    {3./40., 9./40.},
+    {44./45., -56./15., 32./9.},
+    {19372./6561., -25360./2187., 64448./6561., -212./729.},
+    {9017./3168., -355./33., 46732./5247., 49./176., -5103./18656.},
+    {35./384., 0., 500./1113., 125./192., -2187./6784., 11./84.},    // 5th order weights (first same as last)
+};
+
+static const double rebx_rk45_e[REBX_RK45_STAGES] = {71./57600., 0., -71./16695., 71./1920., -17253./339200., 22./525., -1./40.}; // 5th - 4th order weights
+
+// Sets stage velocities v + h*sum_j a_sj k_j on ps and stores the resulting accelerations in k[s]
+static void rebx_rk45_stage(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const ps, double* const k[REBX_RK45_STAGES], const int s, const double h, const int N){
+    const double* const a = rebx_rk45_a[s];
+    for(int i=0; i<N; i++){
+        double dv[3] = {0.};
+        for(int j=0; j<s; j++){
+            dv[0] += a[j]*k[j][3*i];
+            dv[1] += a[j]*k[j][3*i+1];
+            dv[2] += a[j]*k[j][3*i+2];
+        }
+        ps[i].vx = sim->particles[i].vx + h*dv[0];
+        ps[i].vy = sim->particles[i].vy + h*dv[1];
+        ps[i].vz = sim->particles[i].vz + h*dv[2];
+    }
+    rebx_reset_accelerations(ps, N);
+    rebx_update_force_accelerations(sim, force, ps, N);
+    for(int i=0; i<N; i++){
+        k[s][3*i] = ps[i].ax;
+        k[s][3*i+1] = ps[i].ay;
+        k[s][3*i+2] = ps[i].az;
+    }
+}
+
+void rebx_integrator_rk45_integrate(struct reb_simulation* const sim, const double dt, struct rebx_force* const force, const double tolerance){
+    struct rebx_extras* rebx = sim->extras;
+    const int N = sim->N - sim->N_var;
+    struct rebx_integrator_workspace* const ws = rebx_get_integrator_workspace(rebx, force, N, REBX_RK45_STAGES);
+    if (ws == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for stage buffers in integrator_rk45.c.\n");
+        return;
+    }
+    if (dt == 0. || N == 0){
+        return;
+    }
+    struct reb_particle* const ps = ws->ps;
+    double* k[REBX_RK45_STAGES];
+    for(int s=0; s<REBX_RK45_STAGES; s++){
+        k[s] = ws->v + 3*s*ws->N_allocated;
+    }
+    memcpy(ps, sim->particles, N*sizeof(*ps));
+    rebx_reset_accelerations(ps, N);
+    rebx_update_force_accelerations(sim, force, ps, N);
+    for(int i=0; i<N; i++){
+        k[0][3*i] = ps[i].ax;
+        k[0][3*i+1] = ps[i].ay;
+        k[0][3*i+2] = ps[i].az;
+    }
+
+    double h = ws->dt_substep;
+    if (h == 0. || (h > 0.) != (dt > 0.) || fabs(h) > fabs(dt)){
+        h = dt;
+    }
+    const int max_substeps = 1000;
+    double t = 0.;
+    int forced = 0;
+    for(int n=0; n<max_substeps; n++){
+        const double remaining = dt - t;
+        forced = (n == max_substeps-1);
+        const int last = forced || fabs(h) >= fabs(remaining);
+        const double h_step = last ? remaining : h;
+        for(int s=1; s<REBX_RK45_STAGES; s++){
+            rebx_rk45_stage(sim, force, ps, k, s, h_step, N);
+        }
+        // ps now holds the 5th order velocities, and k[6] the accelerations there
+        double tot2 = 0.;
+        double err2 = 0.;
+        for(int i=0; i<N; i++){
+            for(int c=0; c<3; c++){
+                double err = 0.;
+                for(int s=0; s<REBX_RK45_STAGES; s++){
+                    err += rebx_rk45_e[s]*k[s][3*i+c];
+                }
+                err *= h_step;
+                err2 += err*err;
+            }
+            tot2 += ps[i].vx*ps[i].vx + ps[i].vy*ps[i].vy + ps[i].vz*ps[i].vz;
+        }
+        const double ratio = tot2 > 0. ? sqrt(err2/tot2)/tolerance : 0.;
+        double fac = ratio > 0. ? 0.9*pow(ratio, -0.2) : 5.;
+        if (fac > 5.){
+            fac = 5.;
+        }
+        if (fac < 0.2){
+            fac = 0.2;
+        }
+        const double h_next = h_step*fac;
+        if (ratio <= 1. || forced){
+            for(int i=0; i<N; i++){
+                sim->particles[i].vx = ps[i].vx;
+                sim->particles[i].vy = ps[i].vy;
+                sim->particles[i].vz = ps[i].vz;
+            }
+            if (last){
+                // A substep shortened to land on dt says little about the next call, so keep the larger guess
+                ws->dt_substep = (fabs(h_next) < fabs(h) && h_step != h) ? h : h_next;
+                break;
+            }
+            memcpy(k[0], k[REBX_RK45_STAGES-1], 3*N*sizeof(*k[0])); // first same as last
+            t += h_step;
+        }
+        h = h_next;
+    }
+    if (forced){
+        reb_warning(sim, "REBOUNDx: integrator_rk45.c reached 1000 substeps without meeting the tolerance. The last substep was accepted anyway.");
+    }
+}
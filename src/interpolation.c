@@ -51,6 +51,7 @@
 #include "rebound.h"
 #include "reboundx.h"
 #include "core.h"
+#include "rebxtools.h"
 
 /**
  * Given a monotonic array x[0..(n-1)] and any array y[0..(n-1)],
@@ -58,11 +59,12 @@
  * interpolating function at the tabulated points x[i].
  * This routine assumes a "natural" spline, i.e. boundary
  * conditions with zero second derivatives at y2[0] and y2[(n-1)]. 
+ * u[0..(n-1)] is scratch space (on the heap, since tracks can be long).
  * 
  * Adapted from "Numerical Recipes for C," 2nd Ed., §3.3, p. 115.
  */
-static void rebx_spline(const double* x, const double* y, const int n, double* y2) {
-    double p, qn, sig, un, u[n];
+static void rebx_spline(const double* x, const double* y, const int n, double* y2, double* u) {
+    double p, qn, sig, un;
 
     y2[0] = 0.;
     u[0] = 0.0; // lower boundary condition is set to "natural"
@@ -82,75 +84,224 @@ static void rebx_spline(const double* x, const double* y, const int n, double* y
         y2[k] = y2[k] * y2[k+1] + u[k];
 }
 
+/**
+ * Sets d[0..(n-1)] with the derivatives of the monotone piecewise cubic Hermite
+ * interpolant through x[i], y[i], which doesn't overshoot between the tabulated points.
+ * 
+ * Fritsch and Carlson, 1980, SIAM J. Numer. Anal. 17, 238 (with weighted harmonic means in the interior
+ * and the shape-preserving three-point formula at the ends, as in Fritsch and Butland, 1984).
+ */
+static void rebx_hermite_slopes(const double* x, const double* y, const int n, double* d) {
+    if (n == 2) {
+        d[0] = d[1] = (y[1] - y[0]) / (x[1] - x[0]);
+        return;
+    }
+    for (int i=1; i<n-1; i++) {
+        const double h0 = x[i] - x[i-1];
+        const double h1 = x[i+1] - x[i];
+        const double delta0 = (y[i] - y[i-1]) / h0;
+        const double delta1 = (y[i+1] - y[i]) / h1;
+        if (delta0*delta1 <= 0.) { // local extremum
+            d[i] = 0.;
+        }
+        else {
+            const double w0 = 2.*h1 + h0;
+            const double w1 = h1 + 2.*h0;
+            d[i] = (w0 + w1) / (w0/delta0 + w1/delta1);
+        }
+    }
+    for (int end=0; end<2; end++) {
+        const int i = end ? n-1 : 0;
+        const int s = end ? -1 : 1; // direction into the table
+        const double h0 = fabs(x[i+s] - x[i]);
+        const double h1 = fabs(x[i+2*s] - x[i+s]);
+        const double delta0 = (y[i+s] - y[i]) / (x[i+s] - x[i]);
+        const double delta1 = (y[i+2*s] - y[i+s]) / (x[i+2*s] - x[i+s]);
+        double di = ((2.*h0 + h1)*delta0 - h0*delta1) / (h0 + h1);
+        if (di*delta0 <= 0.) {
+            di = 0.;
+        }
+        else if (delta0*delta1 < 0. && fabs(di) > 3.*fabs(delta0)) {
+            di = 3.*delta0;
+        }
+        d[i] = di;
+    }
+}
+
+/**
+ * Updates *klo so that xa[*klo] <= x < xa[*klo+1], clamped to the first and last intervals for
+ * x outside the tabulated range. Since calls are generally sequential, first checks the current and
+ * next interval, and otherwise falls back to a binary search.
+ */
+static void rebx_locate(const double* xa, const double x, int* klo, const int n) {
+    int lo = *klo;
+    if (lo < 0 || lo > n-2) {
+        lo = 0;
+    }
+    if (xa[lo] <= x && (x < xa[lo+1] || lo == n-2)) {
+        return;
+    }
+    if (lo+1 < n-1 && xa[lo+1] <= x && (x < xa[lo+2] || lo+1 == n-2)) {
+        *klo = lo+1;
+        return;
+    }
+    lo = 0;
+    int hi = n-1;
+    while (hi - lo > 1) { // invariant: xa[lo] <= x < xa[hi], or we are clamping at one of the ends
+        const int mid = (lo + hi)/2;
+        if (xa[mid] <= x) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    *klo = lo;
+}
+
 /**
  * Given a monotonic array xa[0..(n-1)], any array ya[0..(n-1)], an array of
  * second derivatives y2a[0..(n-1)] outputted from spline() above, and a value
- * of x, this returns a cubic-spline interpolated value y.
+ * of x, this returns a cubic-spline interpolated value y, in the interval klo
+ * found with rebx_locate.
  * "Splint" comes from spl(ine)-int(erpolation).
  * 
  * Adapted from "Numerical Recipes for C," 2nd Ed., §3.3, p. 116
  */
-static double rebx_splint(struct rebx_extras* const rebx, const double* xa, const double* ya, const double* y2a, const double x, int* klo, const int n) {
+static double rebx_splint(struct rebx_extras* const rebx, const double* xa, const double* ya, const double* y2a, const double x, const int klo) {
     double h, b, a;
 
-    // since calls are generally sequential, find and update place for current
-    // and future calls
-    if (xa[*klo] > x) { // backward case
-        while (xa[*klo-1] > x) {
-            *klo = *klo-1;
-        }
-        if (xa[*klo-1] <= x) {
-            *klo = *klo-1; // back one more
-        }
-    }
-    else { // forward case
-        while (xa[*klo+1] <= x && *klo+1 != n-1) {
-            *klo = *klo+1;
-        }
-    }
-    h = xa[*klo+1] - xa[*klo];
+    h = xa[klo+1] - xa[klo];
     if (h == 0.0) { // xa's must be distinct
         rebx_error(rebx, "Cubic spline run-time error...\n");
         rebx_error(rebx, "Bad xa input to routine splint\n");
         rebx_error(rebx, "...now exiting to system...\n");
         return 0;
     }
-    a = (xa[*klo+1]-x) / h;
-    b = (x - xa[*klo]) / h;
+    a = (xa[klo+1]-x) / h;
+    b = (x - xa[klo]) / h;
     // evaluate cubic spline
-    return a*ya[*klo] + b*ya[*klo+1] + ((a*a*a-a)*y2a[*klo] + (b*b*b-b)*y2a[*klo+1])*(h*h)/6.;
+    return a*ya[klo] + b*ya[klo+1] + ((a*a*a-a)*y2a[klo] + (b*b*b-b)*y2a[klo+1])*(h*h)/6.;
+}
+
+// Value of channel in the interval klo found with rebx_locate
+static double rebx_interpolate_channel(struct rebx_extras* const rebx, const struct rebx_interpolator* const interpolator, const int channel, const double x, const int klo) {
+    const int Nvalues = interpolator->Nvalues;
+    const double* const xa = interpolator->times;
+    const double* const ya = &interpolator->values[(size_t)channel*Nvalues];
+    switch (interpolator->interpolation){
+        case REBX_INTERPOLATION_NONE:
+        {
+            return x >= xa[klo+1] ? ya[klo+1] : ya[klo]; // hold the value tabulated last before x
+        }
+        case REBX_INTERPOLATION_SPLINE:
+        {
+            return rebx_splint(rebx, xa, ya, &interpolator->y2[(size_t)channel*Nvalues], x, klo);
+        }
+        case REBX_INTERPOLATION_LINEAR:
+        {
+            const double h = xa[klo+1] - xa[klo];
+            const double b = (x - xa[klo]) / h;
+            return ya[klo] + b*(ya[klo+1] - ya[klo]);
+        }
+        case REBX_INTERPOLATION_HERMITE:
+        {
+            const double* const d = &interpolator->y2[(size_t)channel*Nvalues];
+            const double h = xa[klo+1] - xa[klo];
+            const double t = (x - xa[klo]) / h;
+            const double t1 = 1. - t;
+            return (1. + 2.*t)*t1*t1*ya[klo] + t*t1*t1*h*d[klo] + t*t*(3. - 2.*t)*ya[klo+1] - t*t*t1*h*d[klo+1];
+        }
+        default:
+        {
+            rebx_error(rebx, "REBOUNDx Error: Interpolation option not supported\n");
+            return 0;
+        }
+    }
 }
 
 struct rebx_interpolator* rebx_create_interpolator(struct rebx_extras* const rebx, const int Nvalues, const double* times, const double* values, enum rebx_interpolation_type interpolation){
+    return rebx_create_interpolator_channels(rebx, Nvalues, 1, times, values, interpolation);
+}
+
+struct rebx_interpolator* rebx_create_interpolator_channels(struct rebx_extras* const rebx, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation){
     struct rebx_interpolator* interp = rebx_malloc(rebx, sizeof(*interp));
-    rebx_init_interpolator(rebx, interp, Nvalues, times, values, interpolation);
+    rebx_init_interpolator_channels(rebx, interp, Nvalues, Nchannels, times, values, interpolation);
+    return interp;
+}
+
+struct rebx_interpolator* rebx_create_interpolator_borrowed(struct rebx_extras* const rebx, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation){
+    struct rebx_interpolator* interp = rebx_malloc(rebx, sizeof(*interp));
+    rebx_init_interpolator_borrowed(rebx, interp, Nvalues, Nchannels, times, values, interpolation);
     return interp;
 }
 
 void rebx_init_interpolator(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const double* times, const double* values, enum rebx_interpolation_type interpolation){
+    rebx_init_interpolator_channels(rebx, interp, Nvalues, 1, times, values, interpolation);
+}
+
+// Sets up everything but times and values
+static void rebx_init_interpolator_tables(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const int Nchannels, enum rebx_interpolation_type interpolation){
     interp->Nvalues = Nvalues;
+    interp->Nchannels = Nchannels;
     interp->interpolation = interpolation;
-    interp->times = calloc(Nvalues, sizeof(*interp->times));
-    interp->values = calloc(Nvalues, sizeof(*interp->values));
-    memcpy(interp->times, times, Nvalues*sizeof(*interp->times));
-    memcpy(interp->values, values, Nvalues*sizeof(*interp->values));
     interp->y2 = NULL;
     interp->klo = 0;
-    if (interpolation == REBX_INTERPOLATION_SPLINE){
-        interp->y2 = rebx_malloc(rebx, Nvalues*sizeof(*interp->y2));
-        rebx_spline(interp->times, interp->values, interp->Nvalues, interp->y2);
+    if (interpolation == REBX_INTERPOLATION_SPLINE || interpolation == REBX_INTERPOLATION_HERMITE){
+        interp->y2 = rebx_malloc(rebx, (size_t)Nvalues*Nchannels*sizeof(*interp->y2));
+        double* const u = interpolation == REBX_INTERPOLATION_SPLINE ? malloc(Nvalues*sizeof(*u)) : NULL;
+        for (int c=0; c<Nchannels; c++){
+            const double* const y = &interp->values[(size_t)c*Nvalues];
+            double* const y2 = &interp->y2[(size_t)c*Nvalues];
+            if (interpolation == REBX_INTERPOLATION_SPLINE){
+                rebx_spline(interp->times, y, Nvalues, y2, u);
+            }
+            else{
+                rebx_hermite_slopes(interp->times, y, Nvalues, y2);
+            }
+        }
+        free(u);
     }
+}
+
+void rebx_init_interpolator_channels(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation){
+    interp->times = calloc(Nvalues, sizeof(*interp->times));
+    interp->values = calloc((size_t)Nvalues*Nchannels, sizeof(*interp->values));
+    memcpy(interp->times, times, Nvalues*sizeof(*interp->times));
+    memcpy(interp->values, values, (size_t)Nvalues*Nchannels*sizeof(*interp->values));
+    interp->owns_data = 1;
+    rebx_init_interpolator_tables(rebx, interp, Nvalues, Nchannels, interpolation);
+    return;
+}
+
+void rebx_init_interpolator_borrowed(struct rebx_extras* const rebx, struct rebx_interpolator* const interp, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation){
+    // Never written to; the pointers are only non-const because owned arrays share the same fields
+    interp->times = (double*)times;
+    interp->values = (double*)values;
+    interp->owns_data = 0;
+    rebx_init_interpolator_tables(rebx, interp, Nvalues, Nchannels, interpolation);
     return;
 }
 
 void rebx_free_interpolator_pointers(struct rebx_interpolator* const interpolator){
-    free(interpolator->times); 
-    free(interpolator->values);
+    if (interpolator->owns_data){
+        free(interpolator->times); 
+        free(interpolator->values);
+    }
     if (interpolator->y2 != NULL){
         free(interpolator->y2);
     }
     return;
 }
+void rebx_interpolator_memory(const struct rebx_interpolator* const interpolator, struct rebx_memory_usage* const usage){
+    const size_t size = (size_t)interpolator->Nvalues*interpolator->Nchannels*sizeof(double);
+    if (interpolator->owns_data){
+        rebx_memory_add(usage, REBX_MEMORY_INTERPOLATORS, interpolator->times, interpolator->Nvalues*sizeof(*interpolator->times));
+        rebx_memory_add(usage, REBX_MEMORY_INTERPOLATORS, interpolator->values, size);
+    }
+    rebx_memory_add(usage, REBX_MEMORY_INTERPOLATORS, interpolator->y2, size);
+}
+
 void rebx_free_interpolator(struct rebx_interpolator* const interpolator){
     rebx_free_interpolator_pointers(interpolator);
     free(interpolator);
@@ -158,21 +309,19 @@ void rebx_free_interpolator(struct rebx_interpolator* const interpolator){
 }
    
 // Assumes all passed pointers are not NULL
-// Interp value at t=time from an array of times and values
+// Interp value at t=time from an array of times and values (of the first channel for multi-channel interpolators)
 double rebx_interpolate(struct rebx_extras* const rebx, struct rebx_interpolator* const interpolator, const double time){
-    switch (interpolator->interpolation){
-        case REBX_INTERPOLATION_NONE:
-        {
-            return 0; // UPDATE
-        }
-        case REBX_INTERPOLATION_SPLINE:
-        {
-            return rebx_splint(rebx, interpolator->times, interpolator->values, interpolator->y2, time, &interpolator->klo, interpolator->Nvalues); // interpolate at passed time
-        }
-        default:
-        {
-            rebx_error(rebx, "REBOUNDx Error: Interpolation option not supported\n");
-            return 0;
+    rebx_locate(interpolator->times, time, &interpolator->klo, interpolator->Nvalues);
+    return rebx_interpolate_channel(rebx, interpolator, 0, time, interpolator->klo); // interpolate at passed time
+}
+
+// Interpolates all channels at each of the N passed times. out[i*Nchannels + c] is channel c at times[i]
+void rebx_interpolate_many(struct rebx_extras* const rebx, struct rebx_interpolator* const interpolator, const double* times, double* out, const int N){
+    const int Nchannels = interpolator->Nchannels;
+    for (int i=0; i<N; i++){
+        rebx_locate(interpolator->times, times[i], &interpolator->klo, interpolator->Nvalues);
+        for (int c=0; c<Nchannels; c++){
+            out[(size_t)i*Nchannels + c] = rebx_interpolate_channel(rebx, interpolator, c, times[i], interpolator->klo);
         }
     }
 }
@@ -38,9 +38,18 @@
  * This adds exponential mass growth/loss to individual particles every timestep.
  * Set particles' ``tau_mass`` parameter to a negative value for mass loss, positive for mass growth.
  * 
+ * By default the simulation is moved to the center of mass frame after every step, which costs a pass over all particles.
+ * Setting ``mm_com_interval`` instead tracks the drift of the center of mass caused by the mass changes, which only involves the
+ * particles with ``tau_mass`` set, and shifts all particles to remove it every ``mm_com_interval`` steps.
+ * This assumes the simulation starts in the center of mass frame, which is enforced on the first step, and that nothing else moves it.
+ * 
  * **Effect Parameters**
  * 
- * *None*
+ * ============================ =========== =======================================================
+ * Name (C type)                Required    Description
+ * ============================ =========== =======================================================
+ * mm_com_interval (int)        No          If set, number of steps between center of mass corrections (see above)
+ * ============================ =========== =======================================================
  * 
  * **Particle Parameters**
  * 
@@ -59,16 +68,150 @@
 #include <math.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "rebxtools.h"
+
+// Drift of the center of mass since the last correction, for mm_com_interval
+struct rebx_mm_com{
+    int N;                      // Number of particles when the total mass was last summed
+    double M;                   // Total mass
+    double x, y, z;             // Center of mass offset
+    double vx, vy, vz;
+    double t;                   // Time the offset refers to
+    int steps;                  // Steps since the last correction
+};
+
+static void rebx_mm_free_workspace(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_mm_com* const com = rebx_get_param(rebx, operator->ap, "mm_com");
+    free(com);
+    rebx_set_param_pointer(rebx, &operator->ap, "mm_com", NULL);
+}
+
+static void rebx_mm_workspace_memory(struct rebx_extras* const rebx, struct rebx_operator* const operator, struct rebx_memory_usage* const usage){
+    const struct rebx_mm_com* const com = rebx_get_param(rebx, operator->ap, "mm_com");
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, com, sizeof(*com));
+}
+
+// Shifts the real particles by the tracked offset, and resums the total mass in the same pass
+static void rebx_mm_apply_com(struct reb_simulation* const sim, struct rebx_mm_com* const com, const int _N_real){
+    struct reb_particle* const particles = sim->particles;
+    double M = 0.;
+    for (int i=0; i<_N_real; i++){
+        particles[i].x -= com->x;
+        particles[i].y -= com->y;
+        particles[i].z -= com->z;
+        particles[i].vx -= com->vx;
+        particles[i].vy -= com->vy;
+        particles[i].vz -= com->vz;
+        M += particles[i].m;
+    }
+    com->M = M;
+    com->x = 0.; com->y = 0.; com->z = 0.;
+    com->vx = 0.; com->vy = 0.; com->vz = 0.;
+    com->steps = 0;
+}
+
+// Incremental alternative to reb_move_to_com. Particles whose mass changes by dm move the center of mass by dm*r/M, so only
+// they need to be visited until the accumulated offset is removed.
+static void rebx_modify_mass_incremental(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt, const int interval){
+    struct rebx_extras* const rebx = sim->extras;
+    const int _N_real = sim->N - sim->N_var;
+    struct rebx_mm_com* com = rebx_get_param(rebx, operator->ap, "mm_com");
+    if (com == NULL){
+        com = calloc(1, sizeof(*com));
+        if (com == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for modify_mass.\n");
+            return;
+        }
+        com->N = -1;
+        rebx_set_param_pointer(rebx, &operator->ap, "mm_com", com);
+        rebx_set_param_pointer(rebx, &operator->ap, "free_workspace", rebx_mm_free_workspace);
+        rebx_set_param_pointer(rebx, &operator->ap, "workspace_memory", rebx_mm_workspace_memory);
+    }
+    const struct rebx_param_list* const tau_masses = rebx_get_param_list(rebx, sim->particles, _N_real, rebx_intern(rebx, "tau_mass"));
+    if (tau_masses == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for modify_mass.\n");
+        return;
+    }
+
+    const double ddt = sim->t - com->t; // the offset drifts with the center of mass velocity
+    com->x += com->vx*ddt;
+    com->y += com->vy*ddt;
+    com->z += com->vz*ddt;
+    com->t = sim->t;
+
+    double Mx = com->M*com->x;
+    double My = com->M*com->y;
+    double Mz = com->M*com->z;
+    double Mvx = com->M*com->vx;
+    double Mvy = com->M*com->vy;
+    double Mvz = com->M*com->vz;
+    double M = com->M;
+    for (int j=0; j<tau_masses->N_particles; j++){
+        struct reb_particle* const p = &sim->particles[tau_masses->index[j]];
+        const double dm = p->m*dt/(*(const double*)tau_masses->values[j]);
+        p->m += dm;
+        M += dm;
+        Mx += dm*p->x;
+        My += dm*p->y;
+        Mz += dm*p->z;
+        Mvx += dm*p->vx;
+        Mvy += dm*p->vy;
+        Mvz += dm*p->vz;
+    }
+
+    if (com->N != _N_real){ // first step, or particles were added or removed. Start over from the center of mass frame
+        reb_move_to_com(sim);
+        *com = (struct rebx_mm_com){.N = _N_real, .t = sim->t};
+        for (int i=0; i<_N_real; i++){
+            com->M += sim->particles[i].m;
+        }
+        return;
+    }
+
+    com->M = M;
+    if (M != 0.){
+        com->x = Mx/M;
+        com->y = My/M;
+        com->z = Mz/M;
+        com->vx = Mvx/M;
+        com->vy = Mvy/M;
+        com->vz = Mvz/M;
+    }
+    com->steps++;
+    if (com->steps >= interval){
+        rebx_mm_apply_com(sim, com, _N_real);
+    }
+}
 
 void rebx_modify_mass(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
+    struct rebx_extras* const rebx = sim->extras;
     const int _N_real = sim->N - sim->N_var;
-	for(int i=0; i<_N_real; i++){
-		struct reb_particle* const p = &sim->particles[i];
-        const double* const tau_mass = rebx_get_param(sim->extras, p->ap, "tau_mass");
-        if (tau_mass != NULL){
-		    p->m += p->m*dt/(*tau_mass);
+    const int* const com_interval = rebx_get_param(rebx, operator->ap, "mm_com_interval");
+    if (com_interval != NULL && *com_interval > 0){
+        rebx_modify_mass_incremental(sim, operator, dt, *com_interval);
+        return;
+    }
+    const int id_tau_mass = rebx_intern(rebx, "tau_mass");
+    const struct rebx_param_column* const tau_mass_column = rebx_get_param_column(rebx, id_tau_mass);
+    if (tau_mass_column != NULL){ // tau_mass stored contiguously, stream through it
+        const double* const tau_mass = tau_mass_column->values;
+        for(int i=0; i<_N_real; i++){
+            if (REBX_COLUMN_HAS(tau_mass_column, i)){
+                sim->particles[i].m += sim->particles[i].m*dt/tau_mass[i];
+            }
         }
-	}
+        reb_move_to_com(sim);
+        return;
+    }
+    const struct rebx_param_list* const tau_masses = rebx_get_param_list(rebx, sim->particles, _N_real, id_tau_mass);
+    if (tau_masses == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for modify_mass.\n");
+        return;
+    }
+    for (int j=0; j<tau_masses->N_particles; j++){
+        struct reb_particle* const p = &sim->particles[tau_masses->index[j]];
+        p->m += p->m*dt/(*(const double*)tau_masses->values[j]);
+    }
     reb_move_to_com(sim);
 }
 
@@ -82,18 +82,21 @@
 
 static struct reb_particle rebx_calculate_modify_orbits_direct(struct reb_simulation* const sim, struct rebx_operator* const operator, struct reb_particle* p, struct reb_particle* primary, const double dt){
     struct rebx_extras* const rebx = sim->extras;
+    const double* const tau_a_ptr = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "tau_a"));
+    const double* const tau_e = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "tau_e"));
+    const double* const tau_inc = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "tau_inc"));
+    const double* const tau_omega = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "tau_omega"));
+    const double* const tau_Omega = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "tau_Omega"));
+    if (tau_a_ptr == NULL && tau_e == NULL && tau_inc == NULL && tau_omega == NULL && tau_Omega == NULL){
+        return *p; // nothing to modify, so skip converting to orbital elements and back
+    }
+
     int err=0;
     struct reb_orbit o = reb_tools_particle_to_orbit_err(sim->G, *p, *primary, &err);
     if(err){        // mass of primary was 0 or p = primary.  Return same particle without doing anything.
         return *p;
     } 
 
-    const double* const tau_a_ptr = rebx_get_param(rebx, p->ap, "tau_a");
-    const double* const tau_e = rebx_get_param(rebx, p->ap, "tau_e");
-    const double* const tau_inc = rebx_get_param(rebx, p->ap, "tau_inc");
-    const double* const tau_omega = rebx_get_param(rebx, p->ap, "tau_omega");
-    const double* const tau_Omega = rebx_get_param(rebx, p->ap, "tau_Omega");
-
     //Implement the planet trap
     double invtau_a = 0.0;   
     const double* const dedge = rebx_get_param(sim->extras, operator->ap, "ide_position");
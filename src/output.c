@@ -24,24 +24,31 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include "reboundx.h"
 #include "core.h"
 #include "linkedlist.h"
+#include "rebxtools.h"
 
 /* Binary format is meant to allow for future structure modifications and backwards compatibility.
  
  It is a nested series of rebx_binary_field structs, with a binary_field_type enum that tells you how to handle what comes next, and a size so that you can skip this object if you don't recognize it (perhaps it's an older version of REBOUNDx reading a newer binary).
  
- At the outermost level you read in REBX_BINARY_FIELD_SNAPSHOT objects. Currently each binary only has one, but this allows us to later make it possible to append more snapshots if needed.
+ At the outermost level you read in REBX_BINARY_FIELD_SNAPSHOT objects. rebx_output_binary writes a single one, and rebx_output_binary_append adds more to an existing file.
  
- Each snapshot currently holds the rebx structure and a list of particles, for which we store all  the params attached to them. So each of them would have a rebx_binary_field identifying them and telling you how large they are in case you need to skip it.
+ Each snapshot holds its time and steps_done stamps, the rebx structure and a list of particles, for which we store all  the params attached to them. So each of them would have a rebx_binary_field identifying them and telling you how large they are in case you need to skip it.
  
  In principle, the input.c file would have a different function for reading in each of these different types of objects. Each object can have its own set of objects in this nested fashion. Eventually you reach a basic type, whose data we want to read. In that case we use the size_to_skip as the size_to_read for fread, which is the same. These unambiguous blocks don't have an REBX_FIELD_TYPE_END field struct, only the abstract objects whose length is arbitrary (user could add different number of forces, or we could add fields to various structs with code updates).
  
  Clearest in an example,
  
  SNAPSHOT {type=SNAPSHOT, size=skip_to_next_snapshot}
+    SNAPSHOT_TIME {type=SNAPSHOT_TIME, size=size_to_read}
+    DOUBLE
+    SNAPSHOT_STEPS_DONE {type=SNAPSHOT_STEPS_DONE, size=size_to_read}
+    UNSIGNED LONG LONG
     REBX {type=REBX_STRUCT, size=skip_to_particles}
         ...
     END (REBX)
@@ -76,12 +83,105 @@
     END (PARTICLES)
  END (SNAPSHOT)
  
- // not implemented yet
  SNAPSHOT {type=SNAPSHOT, size=skip_to_next_snapshot}
  ...
  END (SNAPSHOT)
+ SNAPSHOT_INDEX {type=SNAPSHOT_INDEX, size=Nsnapshots*sizeof(struct rebx_binary_snapshot)}
+ STRUCT REBX_BINARY_SNAPSHOT[Nsnapshots]
+ SNAPSHOT_INDEX {type=SNAPSHOT_INDEX, size=Nsnapshots*sizeof(struct rebx_binary_snapshot)}
+ 
+ Operators loaded as param_driver also hold the series they set parameters from
+ 
+ OPERATOR {type=OPERATOR, size=skip_to_next_operator}
+    NAME {type=NAME, size=size_to_read}
+    STRING
+    PARAM_LIST {type=PARAM_LIST, size=skip_to_PARAM_DRIVER}
+    ...
+    END (PARAM_LIST)
+    PARAM_DRIVER {type=PARAM_DRIVER, size=skip_to_END(OPERATOR)}
+        PARAM_DRIVER_BINDING {type=PARAM_DRIVER_BINDING, size=skip_to_next_binding}
+            NAME {type=NAME, size=size_to_read}
+            STRING
+            PARTICLE_INDEX {type=PARTICLE_INDEX, size=size_to_read} (or PARAM_DRIVER_FORCE with the force's name for force params)
+            INT
+            INTERPOLATION_TYPE {type=INTERPOLATION_TYPE, size=size_to_read}
+            ENUM
+            INTERPOLATOR_TIMES {type=INTERPOLATOR_TIMES, size=Nvalues*sizeof(double)}
+            DOUBLE[Nvalues]
+            INTERPOLATOR_VALUES {type=INTERPOLATOR_VALUES, size=Nvalues*sizeof(double)}
+            DOUBLE[Nvalues]
+        END (PARAM_DRIVER_BINDING)
+        ...
+    END (PARAM_DRIVER)
+ END (OPERATOR)
+ 
+ rebx_output_binary_append_delta can instead append delta snapshots, which only hold the particle params that changed since a full snapshot
+ 
+ SNAPSHOT_DELTA {type=SNAPSHOT_DELTA, size=skip_to_next_snapshot}
+    SNAPSHOT_TIME {type=SNAPSHOT_TIME, size=size_to_read}
+    DOUBLE
+    SNAPSHOT_STEPS_DONE {type=SNAPSHOT_STEPS_DONE, size=size_to_read}
+    UNSIGNED LONG LONG
+    DELTA_BASE {type=DELTA_BASE, size=size_to_read}
+    LONG (file position of the full SNAPSHOT this delta is relative to)
+    DELTA_COLUMN {type=DELTA_COLUMN, size=skip_to_next_column}
+        NAME {type=NAME, size=size_to_read}
+        STRING
+        PARAM_TYPE {type=PARAM_TYPE, size=size_to_read}
+        ENUM
+        PARTICLE_INDEX {type=PARTICLE_INDEX, size=Nchanged*sizeof(int)}
+        INT[Nchanged]
+        PARAM_VALUE {type=PARAM_VALUE, size=Nchanged*value_size}
+        VALUE[Nchanged]
+    END (DELTA_COLUMN)
+    ...
+ END (SNAPSHOT_DELTA)
+ 
+ The index at the end holds the time stamps and file positions of all snapshots. The last field repeats its header with no data, so readers can find the index by seeking to the last field in the file. Appending overwrites the old index with the new snapshot and writes the updated index after it.
 */
 
+/************************************************************
+In-memory buffer the binary is serialized into, so that object sizes can be patched in without seeking in the file.
+The whole buffer is then written with a single fwrite.
+*************************************************************/
+
+struct rebx_binary_buffer{
+    char* data;
+    size_t size;            // Bytes written
+    size_t allocated;
+    int failed;             // Set if growing the buffer failed. Nothing more is written
+};
+
+static void rebx_buffer_write(struct rebx_binary_buffer* const buf, const void* const src, const size_t size){
+    if (buf->failed || size == 0){
+        return;
+    }
+    if (buf->size + size > buf->allocated){
+        size_t allocated = buf->allocated ? buf->allocated : 4096;
+        while (buf->size + size > allocated){
+            allocated *= 2;
+        }
+        char* data = realloc(buf->data, allocated);
+        if (data == NULL){
+            buf->failed = 1;
+            return;
+        }
+        buf->data = data;
+        buf->allocated = allocated;
+    }
+    memcpy(buf->data + buf->size, src, size);
+    buf->size += size;
+}
+
+// Field structs are zeroed first so that padding bytes don't make identical binaries differ
+static void rebx_buffer_write_field(struct rebx_binary_buffer* const buf, const enum rebx_binary_field_type type, const long size){
+    struct rebx_binary_field field;
+    memset(&field, 0, sizeof(field));
+    field.type = type;
+    field.size = size;
+    rebx_buffer_write(buf, &field, sizeof(field));
+}
+
 /************************************************************
 Macros to remove repetition in writing fields.
 *************************************************************/
@@ -89,40 +189,37 @@ Macros to remove repetition in writing fields.
 // Write a data field of binary_field_type typename with size typesize
 // valueptr is a pointer to the memory to write
 #define REBX_WRITE_DATA_FIELD(typename, valueptr, typesize) {\
-struct rebx_binary_field field = {.type = REBX_BINARY_FIELD_TYPE_##typename, .size=typesize};\
-fwrite(&field, sizeof(field), 1, of);\
-fwrite(valueptr,typesize,1,of);\
+rebx_buffer_write_field(buf, REBX_BINARY_FIELD_TYPE_##typename, typesize);\
+rebx_buffer_write(buf, valueptr, typesize);\
 }
 
-/*  For the arbitrary objects, we write a preliminary field struct without a size (since we don't know it yet), and cache the file position to measure how large the object is later.*/
+/*  For the arbitrary objects, we write a preliminary field struct without a size (since we don't know it yet), and cache the buffer position to measure how large the object is later.*/
 #define REBX_START_OBJECT_FIELD(name, typename)\
-long pos_start_header_##name = ftell(of);\
-struct rebx_binary_field header_##name = {.type = REBX_BINARY_FIELD_TYPE_##typename, .size=0};\
-fwrite(&header_##name, sizeof(header_##name), 1, of);\
-long pos_start_##name = ftell(of);\
+size_t pos_start_header_##name = buf->size;\
+rebx_buffer_write_field(buf, REBX_BINARY_FIELD_TYPE_##typename, 0);\
+size_t pos_start_##name = buf->size;\
 
-/*  After we write all the data we need for the particular object, we calculate how long this segment is, and update the field struct with this size so we have option of skipping the whole object when reading.*/
+/*  After we write all the data we need for the particular object, we calculate how long this segment is, and update the field struct in the buffer with this size so we have option of skipping the whole object when reading.*/
 
 #define REBX_END_OBJECT_FIELD(name) {\
 REBX_WRITE_DATA_FIELD(END,        NULL,             0);\
-long pos_end_##name = ftell(of);\
-header_##name.size = pos_end_##name - pos_start_##name;\
-fseek(of, pos_start_header_##name, SEEK_SET);\
-fwrite(&header_##name, sizeof(header_##name), 1, of);\
-fseek(of, 0, SEEK_END);\
+if (!buf->failed){\
+long size_##name = buf->size - pos_start_##name;\
+memcpy(buf->data + pos_start_header_##name + offsetof(struct rebx_binary_field, size), &size_##name, sizeof(size_##name));\
+}\
 }
 
 /*  Write a list of listtype (e.g., ALLOCATED_FORCES) with nodes of type nodetype (e.g. ALLOCATED_FORCE), to the passed linkedlist (e.g. rebx->allocated_forces)*/
 
 #define REBX_WRITE_LIST_FIELD(listtype, nodetype, linkedlist) {\
 REBX_START_OBJECT_FIELD(list, listtype);\
-rebx_write_list(rebx, REBX_BINARY_FIELD_TYPE_##nodetype, linkedlist, of);\
+rebx_write_list(rebx, REBX_BINARY_FIELD_TYPE_##nodetype, linkedlist, buf);\
 REBX_END_OBJECT_FIELD(list);\
 }
 
-static void rebx_write_list(struct rebx_extras* rebx, enum rebx_binary_field_type list_type, struct rebx_node* list, FILE* of);
+static void rebx_write_list(struct rebx_extras* rebx, enum rebx_binary_field_type list_type, struct rebx_node* list, struct rebx_binary_buffer* buf);
 
-static void rebx_write_force_param(struct rebx_extras* rebx, struct rebx_param* param, FILE* of){
+static void rebx_write_force_param(struct rebx_extras* rebx, struct rebx_param* param, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(force_param, PARAM);
     REBX_WRITE_DATA_FIELD(PARAM_TYPE, &param->type,     sizeof(param->type));
     REBX_WRITE_DATA_FIELD(NAME,       param->name,      strlen(param->name) + 1);
@@ -131,13 +228,13 @@ static void rebx_write_force_param(struct rebx_extras* rebx, struct rebx_param*
     REBX_END_OBJECT_FIELD(force_param);
 }
 
-static void rebx_write_param(struct rebx_extras* rebx, struct rebx_param* param, FILE* of){
+static void rebx_write_param(struct rebx_extras* rebx, struct rebx_param* param, struct rebx_binary_buffer* buf){
     if (param->type == REBX_TYPE_POINTER){ // Don't write pointers because we won't know how to load them when we read binary. Need to add type to store in binaries.
         return;
     }
     
     if (param->type == REBX_TYPE_FORCE){ // Force already written to allocated_force list. For parce PARAMETERS we agree to store force name in param->value so that the reallocated force can be linked up when we read binary
-        rebx_write_force_param(rebx, param, of);
+        rebx_write_force_param(rebx, param, buf);
         return;
     }
     REBX_START_OBJECT_FIELD(param, PARAM);
@@ -147,14 +244,14 @@ static void rebx_write_param(struct rebx_extras* rebx, struct rebx_param* param,
     REBX_END_OBJECT_FIELD(param);
 }
 
-static void rebx_write_registered_param(struct rebx_extras* rebx, struct rebx_param* param, FILE* of){
+static void rebx_write_registered_param(struct rebx_extras* rebx, struct rebx_param* param, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(registered_param, REGISTERED_PARAM);
     REBX_WRITE_DATA_FIELD(PARAM_TYPE, &param->type,     sizeof(param->type));
     REBX_WRITE_DATA_FIELD(NAME,       param->name,      strlen(param->name) + 1);
     REBX_END_OBJECT_FIELD(registered_param);
 }
 
-static void rebx_write_force(struct rebx_extras* rebx, struct rebx_force* force, FILE* of){
+static void rebx_write_force(struct rebx_extras* rebx, struct rebx_force* force, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(force, FORCE);
     // must write name first so that force can be loaded on read
     REBX_WRITE_DATA_FIELD(NAME, force->name, strlen(force->name) + 1);
@@ -163,37 +260,83 @@ static void rebx_write_force(struct rebx_extras* rebx, struct rebx_force* force,
 }
 
 // Same as force, but only holds the name for later loading, rather than the whole parameter list
-static void rebx_write_additional_force(struct rebx_extras* rebx, struct rebx_force* force, FILE* of){
+static void rebx_write_additional_force(struct rebx_extras* rebx, struct rebx_force* force, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(additional_force, ADDITIONAL_FORCE);
     REBX_WRITE_DATA_FIELD(NAME, force->name, strlen(force->name) + 1);
     REBX_END_OBJECT_FIELD(additional_force);
 }
 
-static void rebx_write_operator(struct rebx_extras* rebx, struct rebx_operator* operator, FILE* of){
+// Bindings of a param_driver operator, with their series. Particles are identified by index and forces by name, like in the rest of the binary
+static void rebx_write_param_driver(struct rebx_extras* rebx, const struct rebx_param_driver* driver, struct rebx_binary_buffer* buf){
+    REBX_START_OBJECT_FIELD(param_driver, PARAM_DRIVER);
+    for (int k=0; k<driver->N; k++){
+        const struct rebx_param_driver_binding* const b = &driver->bindings[k];
+        const struct rebx_interpolator* const interp = &b->interpolator;
+        const int particle_index = b->force == NULL ? rebx_param_driver_particle_index(rebx->sim, b) : -1;
+        if (b->force == NULL && particle_index < 0){ // particle was removed
+            continue;
+        }
+        REBX_START_OBJECT_FIELD(binding, PARAM_DRIVER_BINDING);
+        REBX_WRITE_DATA_FIELD(NAME,                 b->name,                strlen(b->name) + 1);
+        if (b->force != NULL){
+            REBX_WRITE_DATA_FIELD(PARAM_DRIVER_FORCE,   b->force->name,     strlen(b->force->name) + 1);
+        }
+        else{
+            REBX_WRITE_DATA_FIELD(PARTICLE_INDEX,       &particle_index,    sizeof(particle_index));
+        }
+        REBX_WRITE_DATA_FIELD(INTERPOLATION_TYPE,   &interp->interpolation, sizeof(interp->interpolation));
+        REBX_WRITE_DATA_FIELD(INTERPOLATOR_TIMES,   interp->times,          interp->Nvalues*sizeof(*interp->times));
+        REBX_WRITE_DATA_FIELD(INTERPOLATOR_VALUES,  interp->values,         interp->Nvalues*sizeof(*interp->values));
+        REBX_END_OBJECT_FIELD(binding);
+    }
+    REBX_END_OBJECT_FIELD(param_driver);
+}
+
+static void rebx_write_operator(struct rebx_extras* rebx, struct rebx_operator* operator, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(operator, OPERATOR);
     REBX_WRITE_DATA_FIELD(NAME, operator->name, strlen(operator->name) + 1);
     REBX_WRITE_LIST_FIELD(PARAM_LIST, PARAM, operator->ap);
+    const struct rebx_param_driver* const driver = rebx_get_param(rebx, operator->ap, "pd_bindings");
+    if (driver != NULL){ // not in the param list, since pointers aren't written
+        rebx_write_param_driver(rebx, driver, buf);
+    }
     REBX_END_OBJECT_FIELD(operator);
 }
 
-static void rebx_write_step(struct rebx_extras* rebx, struct rebx_step* step, FILE* of){
+static void rebx_write_step(struct rebx_extras* rebx, struct rebx_step* step, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(step, STEP);
     // Need operator name to load it from source when reading it back in
     REBX_WRITE_DATA_FIELD(NAME, step->operator->name,   strlen(step->operator->name) + 1);
     REBX_WRITE_DATA_FIELD(STEP_DT_FRACTION,   &step->dt_fraction,     sizeof(step->dt_fraction));
+    if (step->every != 1){ // so files with the default cadence still load without warnings in older versions
+        REBX_WRITE_DATA_FIELD(STEP_EVERY,     &step->every,           sizeof(step->every));
+        REBX_WRITE_DATA_FIELD(STEP_PHASE,     &step->phase,           sizeof(step->phase));
+    }
     REBX_END_OBJECT_FIELD(step);
 }
 
-static void rebx_write_particle(struct rebx_extras* rebx, struct reb_particle* particle, int index, FILE* of){
+static void rebx_write_particle(struct rebx_extras* rebx, struct reb_particle* particle, int index, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(particle, PARTICLE);
     REBX_WRITE_DATA_FIELD(PARTICLE_INDEX,    &index, sizeof(index));
     REBX_WRITE_LIST_FIELD(PARAM_LIST, PARAM, particle->ap);
     REBX_END_OBJECT_FIELD(particle);
 }
 
-static void rebx_write_rebx(struct rebx_extras* rebx, FILE* of){
+// The shared default params come first, so they're written in registration order like the rest of the list
+static void rebx_write_registered_params(struct rebx_extras* rebx, struct rebx_binary_buffer* buf){
+    REBX_START_OBJECT_FIELD(registered_params, REGISTERED_PARAMETERS);
+    int N_default;
+    struct rebx_param* const default_params = rebx_get_default_params(rebx, &N_default);
+    for (int i=0; i<N_default; i++){
+        rebx_write_registered_param(rebx, &default_params[i], buf);
+    }
+    rebx_write_list(rebx, REBX_BINARY_FIELD_TYPE_REGISTERED_PARAM, rebx->registered_params, buf);
+    REBX_END_OBJECT_FIELD(registered_params);
+}
+
+static void rebx_write_rebx(struct rebx_extras* rebx, struct rebx_binary_buffer* buf){
     REBX_START_OBJECT_FIELD(rebx_structure, REBX_STRUCTURE);
-    REBX_WRITE_LIST_FIELD(REGISTERED_PARAMETERS, REGISTERED_PARAM, rebx->registered_params);
+    rebx_write_registered_params(rebx, buf);
     REBX_WRITE_LIST_FIELD(ALLOCATED_FORCES, FORCE, rebx->allocated_forces);
     REBX_WRITE_LIST_FIELD(ALLOCATED_OPERATORS, OPERATOR, rebx->allocated_operators);
     REBX_WRITE_LIST_FIELD(ADDITIONAL_FORCES, ADDITIONAL_FORCE, rebx->additional_forces);
@@ -203,17 +346,17 @@ static void rebx_write_rebx(struct rebx_extras* rebx, FILE* of){
 }
 
 // Write a particle field for each particle with a list of its parameters
-static void rebx_write_particles(struct rebx_extras* rebx, FILE* of){
+static void rebx_write_particles(struct rebx_extras* rebx, struct rebx_binary_buffer* buf){
     struct reb_simulation* sim = rebx->sim; // checked sim valid in output_binray
     
     REBX_START_OBJECT_FIELD(particle_list, PARTICLES);
     for (int i=0; i<sim->N; i++){
-        rebx_write_particle(rebx, &sim->particles[i], i, of);
+        rebx_write_particle(rebx, &sim->particles[i], i, buf);
     }
     REBX_END_OBJECT_FIELD(particle_list);
 }
 
-static void rebx_write_list(struct rebx_extras* rebx, enum rebx_binary_field_type list_type, struct rebx_node* list, FILE* of){
+static void rebx_write_list(struct rebx_extras* rebx, enum rebx_binary_field_type list_type, struct rebx_node* list, struct rebx_binary_buffer* buf){
     
     int N = rebx_len(list);
     while (N > 0){
@@ -224,32 +367,32 @@ static void rebx_write_list(struct rebx_extras* rebx, enum rebx_binary_field_typ
         switch(list_type){
             case REBX_BINARY_FIELD_TYPE_REGISTERED_PARAM:
             {
-                rebx_write_registered_param(rebx, current->object, of);
+                rebx_write_registered_param(rebx, current->object, buf);
                 break;
             }
             case REBX_BINARY_FIELD_TYPE_FORCE:
             {
-                rebx_write_force(rebx, current->object, of);
+                rebx_write_force(rebx, current->object, buf);
                 break;
             }
             case REBX_BINARY_FIELD_TYPE_ADDITIONAL_FORCE:
             {
-                rebx_write_additional_force(rebx, current->object, of);
+                rebx_write_additional_force(rebx, current->object, buf);
                 break;
             }
             case REBX_BINARY_FIELD_TYPE_OPERATOR:
             {
-                rebx_write_operator(rebx, current->object, of);
+                rebx_write_operator(rebx, current->object, buf);
                 break;
             }
             case REBX_BINARY_FIELD_TYPE_PARAM:
             {
-                rebx_write_param(rebx, current->object, of);
+                rebx_write_param(rebx, current->object, buf);
                 break;
             }
             case REBX_BINARY_FIELD_TYPE_STEP:
             {
-                rebx_write_step(rebx, current->object, of);
+                rebx_write_step(rebx, current->object, buf);
                 break;
             }
         }
@@ -257,33 +400,462 @@ static void rebx_write_list(struct rebx_extras* rebx, enum rebx_binary_field_typ
     }
 }
 
-// Could be extended to include time or steps_done to make an archive
-static void rebx_write_snapshot(struct rebx_extras* rebx, FILE* of){
+static void rebx_write_snapshot(struct rebx_extras* rebx, struct rebx_binary_buffer* buf){
+    struct reb_simulation* sim = rebx->sim;
     REBX_START_OBJECT_FIELD(snapshot, SNAPSHOT);
-    rebx_write_rebx(rebx, of);
-    rebx_write_particles(rebx, of);
+    REBX_WRITE_DATA_FIELD(SNAPSHOT_TIME,        &sim->t,            sizeof(sim->t));
+    REBX_WRITE_DATA_FIELD(SNAPSHOT_STEPS_DONE,  &sim->steps_done,   sizeof(sim->steps_done));
+    rebx_write_rebx(rebx, buf);
+    rebx_write_particles(rebx, buf);
     REBX_END_OBJECT_FIELD(snapshot);
 }
 
+static void rebx_write_header(struct rebx_binary_buffer* buf){
+    const char str[] = "REBOUNDx Binary File. Version: ";
+    char zero = '\0';
+    size_t lenheader = strlen(str)+strlen(rebx_version_str);
+    rebx_buffer_write(buf, str, strlen(str));
+    rebx_buffer_write(buf, rebx_version_str, strlen(rebx_version_str));
+    rebx_buffer_write(buf, &zero, 1);
+    rebx_buffer_write(buf, rebx_githash_str, 62-lenheader);
+    rebx_buffer_write(buf, &zero, 1);
+}
+
+/* Delta snapshots. After writing a full snapshot, rebx_output_binary_append_delta copies the values of all params it can
+ store into archive_delta, with particle params sorted by name so that each name gets one column. Pointers to the params stay
+ valid as long as rebx->param_generation doesn't change.*/
+
+struct rebx_archive_value{
+    struct rebx_param* param;
+    int particle;                   // Index of the particle the param is attached to. -1 for force and operator params
+    size_t offset;                  // Offset of the value in rebx_archive_delta.values
+};
+
+struct rebx_archive_delta{
+    char* filename;                 // Binary holding the full snapshot
+    long base;                      // File position of the full snapshot
+    int N;                          // sim->N at the full snapshot
+    unsigned int param_generation;  // rebx->param_generation at the full snapshot
+    int N_registered_params;
+    int N_lists[5];                 // Lengths of the allocated_forces, allocated_operators, additional_forces, pre_ and post_timestep_modifications lists
+    long N_values;
+    long N_particle_values;         // Particle params come first in values, then effect params
+    struct rebx_archive_value* values;
+    char* bytes;                    // Param values at the full snapshot
+    int* changed_particles;         // Scratch for writing columns
+    char* changed_bytes;
+};
+
+void rebx_free_archive_delta(struct rebx_extras* const rebx){
+    struct rebx_archive_delta* const delta = rebx->archive_delta;
+    if (delta == NULL){
+        return;
+    }
+    free(delta->filename);
+    free(delta->values);
+    free(delta->bytes);
+    free(delta->changed_particles);
+    free(delta->changed_bytes);
+    free(delta);
+    rebx->archive_delta = NULL;
+}
+
+void rebx_archive_delta_memory(struct rebx_extras* const rebx, struct rebx_memory_usage* const usage){
+    const struct rebx_archive_delta* const delta = rebx->archive_delta;
+    if (delta == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, delta, sizeof(*delta));
+    if (delta->filename != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_OTHER, delta->filename, strlen(delta->filename) + 1);
+    }
+    size_t size = 0;
+    if (delta->N_values > 0){
+        const struct rebx_archive_value* const last = &delta->values[delta->N_values-1];
+        size = last->offset + rebx_sizeof(rebx, last->param->type);
+    }
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, delta->values, (size_t)delta->N_values*sizeof(*delta->values) + 1);
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, delta->changed_particles, (size_t)delta->N_particle_values*sizeof(*delta->changed_particles) + 1);
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, delta->bytes, size + 1);
+    rebx_memory_add(usage, REBX_MEMORY_OTHER, delta->changed_bytes, size + 1);
+}
+
+static void rebx_archive_lists(struct rebx_extras* const rebx, int* N_lists){
+    N_lists[0] = rebx_len(rebx->allocated_forces);
+    N_lists[1] = rebx_len(rebx->allocated_operators);
+    N_lists[2] = rebx_len(rebx->additional_forces);
+    N_lists[3] = rebx_len(rebx->pre_timestep_modifications);
+    N_lists[4] = rebx_len(rebx->post_timestep_modifications);
+}
+
+// Same params that rebx_write_param stores with their values
+static int rebx_archive_tracks(const struct rebx_param* const param){
+    return param->type != REBX_TYPE_POINTER && param->type != REBX_TYPE_FORCE && param->value != NULL;
+}
+
+static int rebx_archive_compare_values(const void* a, const void* b){
+    const struct rebx_archive_value* va = a;
+    const struct rebx_archive_value* vb = b;
+    int cmp = strcmp(va->param->name, vb->param->name);
+    if (cmp != 0){
+        return cmp;
+    }
+    return (va->particle > vb->particle) - (va->particle < vb->particle);
+}
+
+static long rebx_archive_count(struct rebx_node* ap){
+    long N = 0;
+    for (struct rebx_node* node = ap; node != NULL; node = node->next){
+        N += rebx_archive_tracks(node->object);
+    }
+    return N;
+}
+
+static long rebx_archive_add_values(struct rebx_archive_value* values, long N, struct rebx_node* ap, const int particle){
+    for (struct rebx_node* node = ap; node != NULL; node = node->next){
+        struct rebx_param* param = node->object;
+        if (rebx_archive_tracks(param)){
+            values[N].param = param;
+            values[N].particle = particle;
+            N++;
+        }
+    }
+    return N;
+}
+
+// Copies the current param values after a full snapshot at file position base. On failure deltas are just not used
+static void rebx_archive_delta_init(struct rebx_extras* const rebx, const char* const filename, const long base){
+    struct reb_simulation* const sim = rebx->sim;
+    rebx_free_archive_delta(rebx);
+    struct rebx_archive_delta* delta = calloc(1, sizeof(*delta));
+    if (delta == NULL){
+        return;
+    }
+    rebx->archive_delta = delta;
+    delta->filename = malloc(strlen(filename) + 1);
+    
+    long N_values = 0;
+    for (int i=0; i<sim->N; i++){
+        N_values += rebx_archive_count(sim->particles[i].ap);
+    }
+    const long N_particle_values = N_values;
+    for (struct rebx_node* node = rebx->allocated_forces; node != NULL; node = node->next){
+        N_values += rebx_archive_count(((struct rebx_force*)node->object)->ap);
+    }
+    for (struct rebx_node* node = rebx->allocated_operators; node != NULL; node = node->next){
+        N_values += rebx_archive_count(((struct rebx_operator*)node->object)->ap);
+    }
+    
+    delta->values = malloc((size_t)N_values*sizeof(*delta->values) + 1);
+    delta->changed_particles = malloc((size_t)N_particle_values*sizeof(*delta->changed_particles) + 1);
+    if (delta->filename == NULL || delta->values == NULL || delta->changed_particles == NULL){
+        rebx_free_archive_delta(rebx);
+        return;
+    }
+    
+    long N = 0;
+    for (int i=0; i<sim->N; i++){
+        N = rebx_archive_add_values(delta->values, N, sim->particles[i].ap, i);
+    }
+    for (struct rebx_node* node = rebx->allocated_forces; node != NULL; node = node->next){
+        N = rebx_archive_add_values(delta->values, N, ((struct rebx_force*)node->object)->ap, -1);
+    }
+    for (struct rebx_node* node = rebx->allocated_operators; node != NULL; node = node->next){
+        N = rebx_archive_add_values(delta->values, N, ((struct rebx_operator*)node->object)->ap, -1);
+    }
+    qsort(delta->values, (size_t)N_particle_values, sizeof(*delta->values), rebx_archive_compare_values);
+    
+    size_t size = 0;
+    for (long k=0; k<N_values; k++){
+        delta->values[k].offset = size;
+        size += rebx_sizeof(rebx, delta->values[k].param->type);
+    }
+    delta->bytes = malloc(size + 1);
+    delta->changed_bytes = malloc(size + 1);
+    if (delta->bytes == NULL || delta->changed_bytes == NULL){
+        rebx_free_archive_delta(rebx);
+        return;
+    }
+    for (long k=0; k<N_values; k++){
+        struct rebx_param* param = delta->values[k].param;
+        memcpy(delta->bytes + delta->values[k].offset, param->value, rebx_sizeof(rebx, param->type));
+    }
+    
+    strcpy(delta->filename, filename);
+    delta->base = base;
+    delta->N = sim->N;
+    delta->param_generation = rebx->param_generation;
+    delta->N_registered_params = rebx->N_registered_params;
+    rebx_archive_lists(rebx, delta->N_lists);
+    delta->N_values = N_values;
+    delta->N_particle_values = N_particle_values;
+}
+
+// Whether a delta relative to the stored full snapshot can represent the current state
+static int rebx_archive_delta_valid(struct rebx_extras* const rebx, const char* const filename){
+    struct reb_simulation* const sim = rebx->sim;
+    struct rebx_archive_delta* const delta = rebx->archive_delta;
+    if (delta == NULL || strcmp(delta->filename, filename) != 0 || delta->N != sim->N || delta->param_generation != rebx->param_generation || delta->N_registered_params != rebx->N_registered_params){
+        return 0;
+    }
+    int N_lists[5];
+    rebx_archive_lists(rebx, N_lists);
+    if (memcmp(N_lists, delta->N_lists, sizeof(N_lists)) != 0){
+        return 0;
+    }
+    for (long k=delta->N_particle_values; k<delta->N_values; k++){ // effect params aren't stored in deltas
+        struct rebx_param* param = delta->values[k].param;
+        if (memcmp(param->value, delta->bytes + delta->values[k].offset, rebx_sizeof(rebx, param->type)) != 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void rebx_write_delta_columns(struct rebx_extras* const rebx, struct rebx_binary_buffer* buf){
+    struct rebx_archive_delta* const delta = rebx->archive_delta;
+    long k = 0;
+    while (k < delta->N_particle_values){
+        struct rebx_param* const first = delta->values[k].param;
+        const size_t size = rebx_sizeof(rebx, first->type);
+        int Nchanged = 0;
+        for (; k < delta->N_particle_values && strcmp(delta->values[k].param->name, first->name) == 0; k++){
+            const struct rebx_archive_value* const value = &delta->values[k];
+            if (memcmp(value->param->value, delta->bytes + value->offset, size) != 0){
+                delta->changed_particles[Nchanged] = value->particle;
+                memcpy(delta->changed_bytes + Nchanged*size, value->param->value, size);
+                Nchanged++;
+            }
+        }
+        if (Nchanged == 0){
+            continue;
+        }
+        REBX_START_OBJECT_FIELD(column, DELTA_COLUMN);
+        REBX_WRITE_DATA_FIELD(NAME,             first->name,                strlen(first->name) + 1);
+        REBX_WRITE_DATA_FIELD(PARAM_TYPE,       &first->type,               sizeof(first->type));
+        REBX_WRITE_DATA_FIELD(PARTICLE_INDEX,   delta->changed_particles,   Nchanged*sizeof(*delta->changed_particles));
+        REBX_WRITE_DATA_FIELD(PARAM_VALUE,      delta->changed_bytes,       Nchanged*size);
+        REBX_END_OBJECT_FIELD(column);
+    }
+}
+
+static void rebx_write_snapshot_delta(struct rebx_extras* rebx, struct rebx_binary_buffer* buf){
+    struct reb_simulation* sim = rebx->sim;
+    REBX_START_OBJECT_FIELD(snapshot_delta, SNAPSHOT_DELTA);
+    REBX_WRITE_DATA_FIELD(SNAPSHOT_TIME,        &sim->t,                    sizeof(sim->t));
+    REBX_WRITE_DATA_FIELD(SNAPSHOT_STEPS_DONE,  &sim->steps_done,           sizeof(sim->steps_done));
+    REBX_WRITE_DATA_FIELD(DELTA_BASE,           &rebx->archive_delta->base, sizeof(rebx->archive_delta->base));
+    rebx_write_delta_columns(rebx, buf);
+    REBX_END_OBJECT_FIELD(snapshot_delta);
+}
+
+// Serializes the snapshot (a delta snapshot if delta is nonzero), followed by the index with an entry for it appended. pos is the file position buf will be written at
+static void rebx_write_snapshot_and_index(struct rebx_extras* rebx, struct rebx_binary_snapshot* index, long Nsnapshots, struct rebx_binary_buffer* buf, const long pos, const int delta){
+    struct reb_simulation* sim = rebx->sim;
+    index[Nsnapshots].t = sim->t;
+    index[Nsnapshots].steps_done = sim->steps_done;
+    index[Nsnapshots].offset = pos + buf->size;
+    if (delta){
+        rebx_write_snapshot_delta(rebx, buf);
+    }
+    else{
+        rebx_write_snapshot(rebx, buf);
+    }
+    
+    long size = (Nsnapshots+1)*sizeof(*index);
+    REBX_WRITE_DATA_FIELD(SNAPSHOT_INDEX,   index,  size);
+    rebx_buffer_write_field(buf, REBX_BINARY_FIELD_TYPE_SNAPSHOT_INDEX, size); // header repeated without data
+}
+
+// Writes buf with a single fwrite and frees it. Returns 0 (and raises an error) on failure
+static int rebx_buffer_flush(struct rebx_extras* rebx, struct rebx_binary_buffer* buf, FILE* of){
+    int success = 0;
+    if (buf->failed){
+        rebx_error(rebx, "REBOUNDx error: Ran out of memory writing binary.");
+    }
+    else if (fwrite(buf->data, buf->size, 1, of) != 1){
+        rebx_error(rebx, "REBOUNDx error: Could not write binary file.");
+    }
+    else{
+        success = 1;
+    }
+    free(buf->data);
+    buf->data = NULL;
+    return success;
+}
+
+void rebx_output_binary_to_buffer(struct rebx_extras* rebx, char** bufp, size_t* sizep){
+    *bufp = NULL;
+    *sizep = 0;
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return;
+    }
+    struct rebx_binary_buffer buf = {0};
+    rebx_write_header(&buf);
+    struct rebx_binary_snapshot index;
+    rebx_write_snapshot_and_index(rebx, &index, 0, &buf, 0, 0);
+    if (buf.failed){
+        free(buf.data);
+        rebx_error(rebx, "REBOUNDx error: Ran out of memory writing binary.");
+        return;
+    }
+    *bufp = buf.data;
+    *sizep = buf.size;
+}
+
 void rebx_output_binary(struct rebx_extras* rebx, char* filename){
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return;
+    }
     FILE* of = fopen(filename,"wb");
     if (of==NULL){
         rebx_error(rebx, "REBOUNDx error: Can not open file passed to rebx_output_binary.");
+        return;
+    }
+    rebx_free_archive_delta(rebx); // file might have held the snapshot deltas were relative to
+    struct rebx_binary_buffer buf = {0};
+    rebx_write_header(&buf);
+    struct rebx_binary_snapshot index;
+    rebx_write_snapshot_and_index(rebx, &index, 0, &buf, 0, 0);
+    rebx_buffer_flush(rebx, &buf, of);
+    fclose(of);
+}
+
+// Appends a snapshot and returns its file position (-1 if it couldn't be written)
+static long rebx_append(struct rebx_extras* rebx, char* filename, const int delta){
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return -1;
     }
+    struct rebx_binary_buffer buf = {0};
+    FILE* of = fopen(filename,"r+b");
+    if (of==NULL){ // New file. Always starts with a full snapshot
+        rebx_free_archive_delta(rebx);
+        of = fopen(filename,"wb");
+        if (of==NULL){
+            rebx_error(rebx, "REBOUNDx error: Can not open file passed to rebx_output_binary_append.");
+            return -1;
+        }
+        rebx_write_header(&buf);
+        struct rebx_binary_snapshot index;
+        rebx_write_snapshot_and_index(rebx, &index, 0, &buf, 0, 0);
+        int success = rebx_buffer_flush(rebx, &buf, of);
+        fclose(of);
+        return success ? index.offset : -1;
+    }
+    
+    enum rebx_input_binary_messages warnings = REBX_INPUT_BINARY_WARNING_NONE;
+    char readbuf[64];
+    if (fread(readbuf, sizeof(char), 64, of) != 64 || strncmp(readbuf, "REBOUNDx Binary File.", 21) != 0){
+        fclose(of);
+        rebx_error(rebx, "REBOUNDx error: File passed to rebx_output_binary_append is not a REBOUNDx binary.");
+        return -1;
+    }
+    long Nsnapshots = 0;
+    long pos_end = 0;
+    struct rebx_binary_snapshot* index = rebx_input_read_snapshot_index(of, &Nsnapshots, &pos_end, &warnings);
+    if (warnings & (REBX_INPUT_BINARY_ERROR_CORRUPT | REBX_INPUT_BINARY_ERROR_NO_MEMORY)){
+        free(index);
+        fclose(of);
+        rebx_error(rebx, "REBOUNDx error: Could not read the snapshots already in the file passed to rebx_output_binary_append.");
+        return -1;
+    }
+    struct rebx_binary_snapshot* new_index = realloc(index, (Nsnapshots+1)*sizeof(*index));
+    if (new_index == NULL){
+        free(index);
+        fclose(of);
+        rebx_error(rebx, "REBOUNDx error: Ran out of memory in rebx_output_binary_append.");
+        return -1;
+    }
+    
+    // The snapshot and the larger index are always longer than the old index, so the file still ends with the new index
+    rebx_write_snapshot_and_index(rebx, new_index, Nsnapshots, &buf, pos_end, delta);
+    free(new_index);
+    fseek(of, pos_end, SEEK_SET);
+    int success = rebx_buffer_flush(rebx, &buf, of);
+    fclose(of);
+    return success ? pos_end : -1;
+}
+
+void rebx_output_binary_append(struct rebx_extras* rebx, char* filename){
+    rebx_append(rebx, filename, 0);
+}
+
+void rebx_output_binary_append_delta(struct rebx_extras* rebx, char* filename){
     if (rebx->sim == NULL){
         rebx_error(rebx, ""); // rebx_error gives meaningful err
         return;
     }
-    // Write header.
-    const char str[] = "REBOUNDx Binary File. Version: ";
-    char zero = '\0';
-    size_t lenheader = strlen(str)+strlen(rebx_version_str);
-    fwrite(str,sizeof(char),strlen(str),of);
-    fwrite(rebx_version_str,sizeof(char), strlen(rebx_version_str),of);
-    fwrite(&zero,sizeof(char),1,of);
-    fwrite(rebx_githash_str,sizeof(char),62-lenheader,of);
-    fwrite(&zero,sizeof(char),1,of);
+    const int delta = rebx_archive_delta_valid(rebx, filename);
+    if (!delta){
+        rebx_free_archive_delta(rebx);
+    }
+    long pos = rebx_append(rebx, filename, delta);
+    if (pos >= 0 && rebx->archive_delta == NULL){ // full snapshot, which later deltas will be relative to
+        rebx_archive_delta_init(rebx, filename, pos);
+    }
+}
 
-    rebx_write_snapshot(rebx, of);
-    fclose(of);
+void rebx_output_binary_archive_heartbeat(struct rebx_extras* const rebx){
+    struct reb_simulation* const sim = rebx->sim;
+    if (rebx->archive_filename == NULL){
+        return;
+    }
+    if (rebx->archive_auto_interval != 0. && rebx->archive_next <= sim->t){
+        rebx->archive_next += rebx->archive_auto_interval;
+        rebx_output_binary_append_delta(rebx, rebx->archive_filename);
+    }
+    if (rebx->archive_auto_step != 0 && rebx->archive_next_step <= sim->steps_done){
+        rebx->archive_next_step += rebx->archive_auto_step;
+        rebx_output_binary_append_delta(rebx, rebx->archive_filename);
+    }
+}
+
+static int rebx_archive_automate(struct rebx_extras* rebx, const char* const filename){
+    struct reb_simulation* const sim = rebx->sim;
+    if (sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return 0;
+    }
+    if (filename == NULL){
+        rebx_error(rebx, "REBOUNDx error: Filename passed to automate the REBOUNDx archive was NULL.");
+        return 0;
+    }
+    free(rebx->archive_filename);
+    rebx_free_archive_delta(rebx); // new archive starts with a full snapshot
+    rebx->archive_filename = malloc(strlen(filename) + 1);
+    if (rebx->archive_filename == NULL){
+        rebx_error(rebx, "REBOUNDx error: Ran out of memory automating the REBOUNDx archive.");
+        return 0;
+    }
+    strcpy(rebx->archive_filename, filename);
+    
+    // Snapshots get written after every timestep, so piggyback on post_timestep_modifications
+    if (sim->post_timestep_modifications != NULL && sim->post_timestep_modifications != rebx_post_timestep_modifications){
+        reb_warning(sim, "REBOUNDx Warning: post_timestep_modifications was set in the simulation and is being overwritten by REBOUNDx. To incorporate both, you can add your own custom effects through REBOUNDx.  See https://github.com/dtamayo/reboundx/blob/master/ipython_examples/Custom_Effects.ipynb for a tutorial.\n");
+    }
+    sim->post_timestep_modifications = rebx_post_timestep_modifications;
+    return 1;
+}
+
+void rebx_output_binary_archive_automate_interval(struct rebx_extras* rebx, const char* const filename, double interval){
+    if (!rebx_archive_automate(rebx, filename)){
+        return;
+    }
+    rebx->archive_auto_interval = interval;
+    rebx->archive_auto_step = 0;
+    rebx->archive_next = rebx->sim->t;
+    rebx_output_binary_archive_heartbeat(rebx);
+}
+
+void rebx_output_binary_archive_automate_step(struct rebx_extras* rebx, const char* const filename, unsigned long long step){
+    if (!rebx_archive_automate(rebx, filename)){
+        return;
+    }
+    rebx->archive_auto_interval = 0.;
+    rebx->archive_auto_step = step;
+    rebx->archive_next_step = rebx->sim->steps_done;
+    rebx_output_binary_archive_heartbeat(rebx);
 }
@@ -0,0 +1,260 @@
+/**
+ * @file    param_driver.c
+ * @brief   Sets particle and force parameters from interpolated time series at the start of each step.
+ * @author  REBOUNDx developers
+ *
+ * @section     LICENSE
+ * Copyright (c) 2026 REBOUNDx developers
+ *
+ * This file is part of reboundx.
+ *
+ * reboundx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * reboundx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * The section after the dollar signs gets built into the documentation by a script.  All lines must start with space * space like below.
+ * Tables always must be preceded and followed by a blank line.  See http://docutils.sourceforge.net/docs/user/rst/quickstart.html for a primer on rst.
+ * $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+ *
+ * $Parameter Interpolation$       // Effect category (must be the first non-blank line after dollar signs and between dollar signs to be detected by script).
+ *
+ * ======================= ===============================================
+ * Authors                 REBOUNDx developers
+ * Implementation Paper    None
+ * Based on                None
+ * C Example               :ref:`c_example_param_driver`
+ * Python Example          None
+ * ======================= ===============================================
+ *
+ * This operator sets parameters to values interpolated from time series (e.g. a stellar evolution track) every time it's applied,
+ * so the values follow the series without stopping the integration to update them.
+ * Each parameter is bound to the operator with rebx_drive_particle_param or rebx_drive_force_param (rebx.drive_particle_param and rebx.drive_force_param in Python),
+ * passing a rebx_interpolator and, for interpolators with several series, which one to use.
+ * The parameters can be any registered double parameters of particles or forces (e.g. a force's ``ye_lstar`` or a particle's ``tau_a``), as well as the mass ``m``
+ * and radius ``r`` of particles. If any masses are set, the simulation is moved to the center of mass frame afterwards, like with modify_mass.
+ *
+ * Parameters are set to their values at the simulation time when the operator is applied. Added with rebx_add_operator, it is applied after each timestep,
+ * so each step uses the values at its start (values at the initial time have to be set by hand). With rebx_add_operator_every, they are only updated every few steps.
+ * The operator keeps its own copy of each series, which is stored in binaries, so the interpolators passed can be freed, and the bindings are restored when loading a binary or cloning.
+ * Particles are followed by their hash, so bindings stay with the right particle when others are removed, and bindings to removed particles are skipped.
+ * Particles without a hash are only tracked by their index, so for them removing a particle earlier in the array shifts the binding to the next particle.
+ *
+ * **Effect Parameters**
+ *
+ * None. Set with rebx_drive_particle_param and rebx_drive_force_param.
+ *
+ * **Particle Parameters**
+ *
+ * None.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rebound.h"
+#include "reboundx.h"
+#include "rebxtools.h"
+#include "core.h"
+
+static void rebx_param_driver_free_workspace(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_param_driver* const driver = rebx_get_param(rebx, operator->ap, "pd_bindings");
+    if (driver == NULL){
+        return;
+    }
+    for (int k=0; k<driver->N; k++){
+        free(driver->bindings[k].name);
+        rebx_free_interpolator_pointers(&driver->bindings[k].interpolator);
+    }
+    free(driver->bindings);
+    free(driver);
+    rebx_set_param_pointer(rebx, &operator->ap, "pd_bindings", NULL);
+}
+
+static void rebx_param_driver_workspace_memory(struct rebx_extras* const rebx, struct rebx_operator* const operator, struct rebx_memory_usage* const usage){
+    const struct rebx_param_driver* const driver = rebx_get_param(rebx, operator->ap, "pd_bindings");
+    if (driver == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_OPERATORS, driver, sizeof(*driver));
+    rebx_memory_add(usage, REBX_MEMORY_OPERATORS, driver->bindings, driver->N_allocated*sizeof(*driver->bindings));
+    for (int k=0; k<driver->N; k++){
+        const struct rebx_param_driver_binding* const b = &driver->bindings[k];
+        rebx_memory_add(usage, REBX_MEMORY_OPERATORS, b->name, strlen(b->name) + 1);
+        rebx_interpolator_memory(&b->interpolator, usage);
+    }
+}
+
+int rebx_param_driver_particle_index(struct reb_simulation* const sim, const struct rebx_param_driver_binding* const b){
+    const int _N_real = sim->N - sim->N_var;
+    const int index = b->particle_index;
+    if (b->hash == 0){
+        return index < _N_real ? index : -1;
+    }
+    if (index < _N_real && sim->particles[index].hash == b->hash){
+        return index;
+    }
+    struct reb_particle* const p = reb_get_particle_by_hash(sim, b->hash); // particles were removed or reordered
+    if (p == NULL){
+        return -1;
+    }
+    const int new_index = (int)(p - sim->particles);
+    return new_index < _N_real ? new_index : -1;
+}
+
+// Adds a binding, or replaces the series of an existing one with the same target and name
+static int rebx_add_driver_binding(struct rebx_extras* const rebx, struct rebx_operator* const operator, const int particle_index, struct rebx_force* const force, const char* const param_name, const struct rebx_interpolator* const interpolator, const int channel){
+    char str[300];
+    if (operator == NULL || operator->step_function != rebx_param_driver){
+        rebx_error(rebx, "REBOUNDx Error: Can only drive parameters with an operator loaded with rebx_load_operator(rebx, \"param_driver\").\n");
+        return 0;
+    }
+    if (param_name == NULL || interpolator == NULL){
+        rebx_error(rebx, "REBOUNDx Error: Passed NULL parameter name or interpolator to param_driver.\n");
+        return 0;
+    }
+    if (interpolator->Nvalues < 2){
+        rebx_error(rebx, "REBOUNDx Error: param_driver needs interpolators with at least two values.\n");
+        return 0;
+    }
+    if (channel < 0 || channel >= interpolator->Nchannels){
+        sprintf(str, "REBOUNDx Error: Channel %d passed to param_driver out of range. Interpolator has %d.\n", channel, interpolator->Nchannels);
+        rebx_error(rebx, str);
+        return 0;
+    }
+    int field = REBX_DRIVER_FIELD_PARAM;
+    if (force == NULL && strcmp(param_name, "m") == 0){
+        field = REBX_DRIVER_FIELD_MASS;
+    }
+    else if (force == NULL && strcmp(param_name, "r") == 0){
+        field = REBX_DRIVER_FIELD_RADIUS;
+    }
+    else{
+        const struct rebx_param* const reg_param = rebx_get_registered_param(rebx, param_name);
+        if (reg_param == NULL || reg_param->type != REBX_TYPE_DOUBLE){
+            sprintf(str, "REBOUNDx Error: Can't drive parameter '%s'. Must be a registered parameter of type double.\n", param_name);
+            rebx_error(rebx, str);
+            return 0;
+        }
+    }
+
+    struct rebx_param_driver* driver = rebx_get_param(rebx, operator->ap, "pd_bindings");
+    if (driver == NULL){
+        driver = calloc(1, sizeof(*driver));
+        if (driver == NULL){
+            rebx_error(rebx, "REBOUNDx Error: Could not allocate memory for param_driver.\n");
+            return 0;
+        }
+        rebx_set_param_pointer(rebx, &operator->ap, "pd_bindings", driver);
+        rebx_set_param_pointer(rebx, &operator->ap, "free_workspace", rebx_param_driver_free_workspace);
+        rebx_set_param_pointer(rebx, &operator->ap, "workspace_memory", rebx_param_driver_workspace_memory);
+    }
+    const uint32_t hash = force == NULL ? rebx->sim->particles[particle_index].hash : 0;
+    struct rebx_param_driver_binding* binding = NULL;
+    for (int k=0; k<driver->N; k++){
+        struct rebx_param_driver_binding* const b = &driver->bindings[k];
+        const int same_particle = hash != 0 ? b->hash == hash : (b->hash == 0 && b->particle_index == particle_index);
+        if (b->force == force && (force != NULL || same_particle) && strcmp(b->name, param_name) == 0){
+            rebx_free_interpolator_pointers(&b->interpolator);
+            binding = b;
+            break;
+        }
+    }
+    if (binding == NULL){
+        if (driver->N == driver->N_allocated){
+            const int N_allocated = driver->N_allocated ? 2*driver->N_allocated : 4;
+            struct rebx_param_driver_binding* const bindings = realloc(driver->bindings, N_allocated*sizeof(*bindings));
+            if (bindings == NULL){
+                rebx_error(rebx, "REBOUNDx Error: Could not allocate memory for param_driver.\n");
+                return 0;
+            }
+            driver->bindings = bindings;
+            driver->N_allocated = N_allocated;
+        }
+        binding = &driver->bindings[driver->N];
+        binding->name = malloc(strlen(param_name) + 1); // +1 for \0 at end
+        if (binding->name == NULL){
+            rebx_error(rebx, "REBOUNDx Error: Could not allocate memory for param_driver.\n");
+            return 0;
+        }
+        strcpy(binding->name, param_name);
+        binding->field = field;
+        binding->particle_index = particle_index;
+        binding->hash = hash;
+        binding->force = force;
+        driver->N++;
+    }
+    const int Nvalues = interpolator->Nvalues;
+    rebx_init_interpolator_channels(rebx, &binding->interpolator, Nvalues, 1, interpolator->times, &interpolator->values[(size_t)channel*Nvalues], interpolator->interpolation);
+    rebx->param_generation++; // so the next delta snapshot is written in full with the new bindings
+    return 1;
+}
+
+int rebx_drive_particle_param(struct rebx_extras* const rebx, struct rebx_operator* const driver, const int particle_index, const char* const param_name, const struct rebx_interpolator* const interpolator, const int channel){
+    if (rebx->sim == NULL){
+        rebx_error(rebx, ""); // rebx_error gives meaningful err
+        return 0;
+    }
+    if (particle_index < 0 || particle_index >= rebx->sim->N){
+        rebx_error(rebx, "REBOUNDx Error: Particle index passed to rebx_drive_particle_param out of range.\n");
+        return 0;
+    }
+    return rebx_add_driver_binding(rebx, driver, particle_index, NULL, param_name, interpolator, channel);
+}
+
+int rebx_drive_force_param(struct rebx_extras* const rebx, struct rebx_operator* const driver, struct rebx_force* const force, const char* const param_name, const struct rebx_interpolator* const interpolator, const int channel){
+    if (force == NULL){
+        rebx_error(rebx, "REBOUNDx Error: Passed NULL force to rebx_drive_force_param.\n");
+        return 0;
+    }
+    return rebx_add_driver_binding(rebx, driver, -1, force, param_name, interpolator, channel);
+}
+
+void rebx_param_driver(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
+    struct rebx_extras* const rebx = sim->extras;
+    const struct rebx_param_driver* const driver = rebx_get_param(rebx, operator->ap, "pd_bindings");
+    if (driver == NULL){
+        return;
+    }
+    int moved = 0;
+    for (int k=0; k<driver->N; k++){
+        struct rebx_param_driver_binding* const b = &driver->bindings[k];
+        if (b->force == NULL){
+            const int index = rebx_param_driver_particle_index(sim, b);
+            if (index < 0){
+                continue;
+            }
+            b->particle_index = index; // so the lookup by hash is only repeated once particles move again
+        }
+        const double value = rebx_interpolate(rebx, &b->interpolator, sim->t);
+        if (b->force != NULL){
+            rebx_set_param_double(rebx, &b->force->ap, b->name, value);
+            continue;
+        }
+        struct reb_particle* const p = &sim->particles[b->particle_index];
+        switch (b->field){
+            case REBX_DRIVER_FIELD_MASS:
+                p->m = value;
+                moved = 1;
+                break;
+            case REBX_DRIVER_FIELD_RADIUS:
+                p->r = value;
+                break;
+            default:
+                rebx_set_param_double(rebx, (struct rebx_node**)&p->ap, b->name, value);
+                break;
+        }
+    }
+    if (moved){
+        reb_move_to_com(sim); // changing masses moves the center of mass
+    }
+}
@@ -69,24 +69,27 @@
 static void rebx_calculate_radiation_forces(struct rebx_extras* const rebx, struct reb_simulation* const sim, const double c, const int source_index, struct reb_particle* const particles, const int N){
     const struct reb_particle source = particles[source_index];
     const double mu = sim->G*source.m;
+    const struct rebx_param_list* const betas = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "beta")); // only particles with beta set feel radiation forces
+    const struct rebx_geometry* const g = rebx_get_geometry(rebx, particles, N, source_index);
+    if (betas == NULL || g == NULL){
+        return;
+    }
 
-    for (int i=0;i<N;i++){
-        
+#pragma omp parallel for schedule(guided)
+    for (int k=0;k<betas->N_particles;k++){
+        const int i = betas->index[k];
         if(i == source_index) continue;
+        const double* const beta = betas->values[k];
         
-        const double* beta = rebx_get_param(rebx, particles[i].ap, "beta");
-        if(beta == NULL) continue; // only particles with beta set feel radiation forces
+        const double dx = g->dx[i]; 
+        const double dy = g->dy[i];
+        const double dz = g->dz[i];
+        const double dr = g->r[i]; // distance to star
         
-        const struct reb_particle p = particles[i];
-        const double dx = p.x - source.x; 
-        const double dy = p.y - source.y;
-        const double dz = p.z - source.z;
-        const double dr = sqrt(dx*dx + dy*dy + dz*dz); // distance to star
-        
-        const double dvx = p.vx - source.vx;
-        const double dvy = p.vy - source.vy;
-        const double dvz = p.vz - source.vz;
-        const double rdot = (dx*dvx + dy*dvy + dz*dvz)/dr; // radial velocity
+        const double dvx = g->dvx[i];
+        const double dvy = g->dvy[i];
+        const double dvz = g->dvz[i];
+        const double rdot = g->rdot[i]; // radial velocity
         const double a_rad = *beta*mu/(dr*dr);
 
         // Equation (5) of Burns, Lamy & Soter (1979)
@@ -105,14 +108,16 @@ void rebx_radiation_forces(struct reb_simulation* const sim, struct rebx_force*
         return;
     }
     
-    int source_found=0;
-    for (int i=0; i<N; i++){
-        if (rebx_get_param(rebx, particles[i].ap, "radiation_source") != NULL){
-            source_found = 1;
-            rebx_calculate_radiation_forces(rebx, sim, *c, i, particles, N);
-        }
+    const struct rebx_param_list* const sources = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "radiation_source"));
+    if (sources == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for radiation_forces.\n");
+        return;
+    }
+    const int N_sources = sources->N_particles;
+    for (int k=0; k<N_sources; k++){
+        rebx_calculate_radiation_forces(rebx, sim, *c, sources->index[k], particles, N);
     }
-    if (!source_found){
+    if (N_sources == 0){
         rebx_calculate_radiation_forces(rebx, sim, *c, 0, particles, N);    // default source to index 0 if "radiation_source" not found on any particle
     }
 }
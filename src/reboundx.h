@@ -126,6 +126,20 @@ enum rebx_binary_field_type{
     REBX_BINARY_FIELD_TYPE_PARTICLES=24,
     REBX_BINARY_FIELD_TYPE_FORCE=25,
     REBX_BINARY_FIELD_TYPE_SNAPSHOT=26,
+    REBX_BINARY_FIELD_TYPE_SNAPSHOT_TIME=27,
+    REBX_BINARY_FIELD_TYPE_SNAPSHOT_STEPS_DONE=28,
+    REBX_BINARY_FIELD_TYPE_SNAPSHOT_INDEX=29,
+    REBX_BINARY_FIELD_TYPE_SNAPSHOT_DELTA=30,
+    REBX_BINARY_FIELD_TYPE_DELTA_BASE=31,
+    REBX_BINARY_FIELD_TYPE_DELTA_COLUMN=32,
+    REBX_BINARY_FIELD_TYPE_STEP_EVERY=33,
+    REBX_BINARY_FIELD_TYPE_STEP_PHASE=34,
+    REBX_BINARY_FIELD_TYPE_PARAM_DRIVER=35,
+    REBX_BINARY_FIELD_TYPE_PARAM_DRIVER_BINDING=36,
+    REBX_BINARY_FIELD_TYPE_PARAM_DRIVER_FORCE=37,
+    REBX_BINARY_FIELD_TYPE_INTERPOLATION_TYPE=38,
+    REBX_BINARY_FIELD_TYPE_INTERPOLATOR_TIMES=39,
+    REBX_BINARY_FIELD_TYPE_INTERPOLATOR_VALUES=40,
 };
 
 /**
@@ -151,6 +165,7 @@ enum rebx_input_binary_messages {
     REBX_INPUT_BINARY_WARNING_PARAM_VALUE_NULL = 8192,
     REBX_INPUT_BINARY_WARNING_VERSION = 16384,
     REBX_INPUT_BINARY_WARNING_FORCE_PARAM_NOT_LOADED = 32768,
+    REBX_INPUT_BINARY_ERROR_SNAPSHOT_NOT_FOUND = 65536,
 };
 
 /**
@@ -162,14 +177,26 @@ enum rebx_integrator {
     REBX_INTEGRATOR_RK4 = 1,
     REBX_INTEGRATOR_EULER = 2,
     REBX_INTEGRATOR_RK2 = 3,
+    REBX_INTEGRATOR_RK45 = 4,           ///< Adaptive substeps to within the operator's integrator_tolerance (default 1e-10)
+};
+
+/**
+ * @brief Substeps of a composite operator (see rebx_composite_add_substep)
+ */
+enum rebx_substep_type {
+    REBX_SUBSTEP_KEPLER = 0,            ///< Kepler and center of mass drift, like rebx_kepler_step
+    REBX_SUBSTEP_JUMP = 1,              ///< Like rebx_jump_step
+    REBX_SUBSTEP_INTERACTION = 2,       ///< Like rebx_interaction_step
 };
 
 /**
  * @brief Different interpolation options
  */
 enum rebx_interpolation_type {
-    REBX_INTERPOLATION_NONE = 0,
-    REBX_INTERPOLATION_SPLINE = 1,
+    REBX_INTERPOLATION_NONE = 0,        ///< Holds the value tabulated last before the passed time
+    REBX_INTERPOLATION_SPLINE = 1,      ///< Natural cubic spline
+    REBX_INTERPOLATION_LINEAR = 2,
+    REBX_INTERPOLATION_HERMITE = 3,     ///< Monotone piecewise cubic Hermite (no overshoot between tabulated values)
 };
 
 /****************************************
@@ -190,9 +217,113 @@ struct rebx_node{
  */
 
 struct rebx_param{
-    char* name;                 ///< For searching linked lists and informative errors
+    char* name;                 ///< For searching linked lists and informative errors. Borrowed from the registry if id >= 0
     enum rebx_param_type type;  ///< Needed to cast value
     void* value;                ///< Pointer to parameter value
+    int id;                     ///< Interned id of the registered name (-1 if not registered). For fast lookups with rebx_get_param_by_id
+    int in_column;              ///< 1 if value points into a rebx_param_column (not into storage), 0 otherwise
+    union {
+        double d;
+        int i;
+        uint32_t u;
+        struct reb_vec3d v;
+    } storage;                  ///< Where value points for double, int, uint32 and vec3d params (unless in_column), so reading them doesn't leave the param's memory
+};
+
+/**
+ * @brief Contiguous (structure of arrays) storage for a per-particle double parameter.
+ * @details Created with rebx_add_param_column. Params set on particles point into values, so the usual rebx_set_param_* / rebx_get_param functions keep working. Kernels can instead loop over values directly.
+ */
+struct rebx_param_column{
+    int id;                     ///< Interned id of the param stored in this column
+    int N;                      ///< Number of particles the column is laid out for
+    double* values;             ///< values[i] is the value for sim->particles[i] (0 if not set)
+    uint32_t* present;          ///< Presence bitmap. Bit i is set if sim->particles[i] has the param. Use REBX_COLUMN_HAS
+};
+
+#define REBX_COLUMN_HAS(column, i) ((column)->present[(i) >> 5] & (UINT32_C(1) << ((i) & 31)))
+
+/**
+ * @brief Separations of all particles relative to one source particle, shared by the forces evaluated in one call to rebx_additional_forces.
+ * @details Obtained with rebx_get_geometry. Entry i is for particles[i] minus the source (so entries at source_index are 0, and rdot is NaN).
+ */
+struct rebx_geometry{
+    int source_index;           ///< Index of the source particle the separations are relative to
+    int N;                      ///< Number of particles the arrays are filled for
+    int N_allocated;            ///< Capacity of the arrays
+    unsigned int epoch;         ///< Value of rebx->geometry_epoch when last filled
+    const struct reb_particle* particles; ///< Particle array the separations were calculated from
+    double* dx;                 ///< x separation
+    double* dy;                 ///< y separation
+    double* dz;                 ///< z separation
+    double* dvx;                ///< x velocity difference
+    double* dvy;                ///< y velocity difference
+    double* dvz;                ///< z velocity difference
+    double* r2;                 ///< dx*dx + dy*dy + dz*dz
+    double* r;                  ///< sqrt(r2)
+    double* rdot;               ///< Radial velocity (dx*dvx + dy*dvy + dz*dvz)/r
+};
+
+/**
+ * @brief Positions and velocities of all particles in one coordinate system, shared by the forces evaluated in one call to rebx_additional_forces.
+ * @details Obtained with rebx_get_coordinates. Accelerations change during the pass, so they are not kept current in ps or coms.
+ */
+struct rebx_coordinates{
+    enum REBX_COORDINATES coordinates;  ///< Coordinate system
+    int reference_index;        ///< Particle without coordinates of its own (0 for Jacobi coordinates, the reference particle for REBX_COORDINATES_PARTICLE, e.g. 0 for heliocentric coordinates, and -1 for barycentric coordinates)
+    int N;                      ///< Number of particles the arrays are filled for
+    int N_allocated;            ///< Capacity of the arrays
+    unsigned int epoch;         ///< Value of rebx->geometry_epoch when last filled
+    const struct reb_particle* particles; ///< Particle array the coordinates were calculated from
+    struct reb_particle* ps;    ///< Particles in the coordinate system. With Jacobi coordinates, as calculated by REBOUND's reb_transformations_inertial_to_jacobi_posvel (ps[0] is the center of mass)
+    struct reb_particle* coms;  ///< What each particle is referenced to: the center of mass of the interior particles (Jacobi), of all particles (barycentric), or the reference particle. Entry at reference_index is unused
+    double* m_j;                ///< Jacobi masses (see rebx_calculate_jacobi_masses). Only filled for Jacobi coordinates
+};
+
+/**
+ * @brief Indices of the particles that have a given parameter set, in particle order, with pointers to their values.
+ * @details Obtained with rebx_get_param_list. Kernels can loop over the list instead of looking the param up on every particle.
+ */
+struct rebx_param_list{
+    int id;                     ///< Interned id of the param
+    int N;                      ///< Number of particles the list was built for
+    unsigned int param_generation; ///< Value of rebx->param_generation when built
+    const struct reb_particle* particles; ///< Particle array the list was built from
+    int N_particles;            ///< Number of particles in the list
+    int N_allocated;            ///< Capacity of the arrays
+    int* index;                 ///< Indices of the particles with the param set
+    void** values;              ///< Pointers to the values of the param on those particles
+};
+
+/**
+ * @brief Counters for a force or operator, recorded while rebx_extras.profiling is set. See rebx_profile_reset().
+ */
+struct rebx_profile{
+    unsigned long long calls;       ///< Number of evaluations
+    unsigned long long particles;   ///< Sum over evaluations of the number of particles passed (all real particles for operators)
+    double walltime;                ///< Cumulative wall time in seconds
+    unsigned long long culled;      ///< Sum over evaluations of the number of particles a force skipped (see rebx_force.skip)
+};
+
+/**
+ * @brief Categories of memory reported by rebx_memory_usage().
+ */
+enum rebx_memory_category{
+    REBX_MEMORY_PARAMS,             ///< Params of particles, forces and operators (with their names and values), and the param columns and lists built from them
+    REBX_MEMORY_FORCES,             ///< Force structures, their names, and the nodes of the force lists
+    REBX_MEMORY_OPERATORS,          ///< Operator and step structures, their names, and the nodes of the operator and step lists
+    REBX_MEMORY_WORKSPACES,         ///< Scratch space of forces, operators and integrate_force, shared geometries and coordinates, and the state of ODEs added by REBOUNDx
+    REBX_MEMORY_INTERPOLATORS,      ///< Series held by REBOUNDx, e.g. by param_driver. Interpolators created by the user aren't included
+    REBX_MEMORY_OTHER,              ///< The rebx_extras structure, its name and param tables, and the state kept for binary archives
+    REBX_MEMORY_N,                  ///< Number of categories
+};
+
+/**
+ * @brief Memory a rebx_extras instance holds, by category. Filled by rebx_memory_usage().
+ */
+struct rebx_memory_usage{
+    size_t bytes[REBX_MEMORY_N];        ///< Bytes requested from malloc in each category
+    size_t allocations[REBX_MEMORY_N];  ///< Number of allocations in each category
 };
 
 /**
@@ -205,6 +336,9 @@ struct rebx_force{
     // See comments in params.py in __init__
     enum rebx_force_type force_type;    ///< Force type for internal logic
     void (*update_accelerations) (struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N); ///< Function pointer to add additional accelerations
+    void (*update_constants) (struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N); ///< Optional. Called right before each update_accelerations with the same arguments, to compute quantities (e.g. time-dependent factors) once per evaluation rather than once per particle
+    struct rebx_profile profile;        ///< Evaluations of the force, also those by operators like integrate_force
+    const unsigned char* skip;          ///< Set during evaluations of sim->particles if the cull_threshold param is set (NULL otherwise). update_accelerations may leave out particles i with skip[i] != 0, including their back reactions
 };
 
 /**
@@ -217,15 +351,63 @@ struct rebx_operator{
     // See comments in params.py in __init__
     enum rebx_operator_type operator_type;  ///< Operator type for internal logic
     void (*step_function) (struct reb_simulation* sim, struct rebx_operator* operator, const double dt);       ///< Function pointer to execute step
+    struct rebx_profile profile;            ///< Steps taken with the operator. Includes time spent in forces it evaluates
+};
+
+/**
+ * @brief Particles of K simulations with the same forces and number of particles, laid out lane-wise so that batch kernels vectorize across simulations.
+ * @details Created with rebx_batch_create. Arrays hold entry REBX_LANE(batch, i, k) for sim->particles[i] of sims[k], so loops over
+ * k for a fixed i are unit stride. Accelerations are copied in and out around each batch kernel, which adds to them like update_accelerations does.
+ */
+struct rebx_batch{
+    int K;                          ///< Number of simulations (lanes)
+    int N;                          ///< Number of particles in each simulation (N - N_var)
+    struct reb_simulation** sims;   ///< The simulations, in lane order
+    int N_forces;                   ///< Number of additional forces in each simulation
+    struct rebx_force** forces;     ///< forces[j*K + k] is the jth force evaluated in sims[k]
+    void (**kernels) (struct rebx_batch* const batch, const int j); ///< Batch kernel of the jth force. NULL if it's evaluated on each simulation instead
+    double* G;                      ///< Gravitational constant of each simulation
+    double* x;                      ///< x position
+    double* y;                      ///< y position
+    double* z;                      ///< z position
+    double* vx;                     ///< x velocity
+    double* vy;                     ///< y velocity
+    double* vz;                     ///< z velocity
+    double* m;                      ///< Mass
+    double* r;                      ///< Physical radius
+    double* ax;                     ///< x acceleration
+    double* ay;                     ///< y acceleration
+    double* az;                     ///< z acceleration
+    double* scratch;                ///< Workspace for batch kernels. See rebx_batch_scratch
+    size_t N_scratch;               ///< Number of doubles in scratch
+};
+
+#define REBX_LANE(batch, i, k) ((i)*(batch)->K + (k))
+
+/**
+ * @brief Entry in the registry of effects that rebx_load_force and rebx_load_operator look names up in.
+ * @details Forces set update_accelerations and force_type (and optionally update_constants), operators set step_function and operator_type. The other fields are left zeroed. See rebx_register_effect.
+ */
+struct rebx_registered_effect{
+    const char* name;                       ///< Name the effect is loaded by
+    enum rebx_force_type force_type;        ///< Force type for forces
+    void (*update_accelerations) (struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);   ///< Set for forces
+    void (*update_constants) (struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N);       ///< Optional for forces
+    enum rebx_operator_type operator_type;  ///< Operator type for operators
+    void (*step_function) (struct reb_simulation* sim, struct rebx_operator* operator, const double dt);    ///< Set for operators
+    void (*update_accelerations_batch) (struct rebx_batch* const batch, const int j);   ///< Optional for forces. Adds the accelerations of the jth force in all lanes of batch (see rebx_batch_additional_forces). Must give the same results as update_accelerations on each simulation
 };
 
 /**
  * @brief Structure for a REBOUNDx step.
  * @details A step is just a combination of an operator with a fraction of a timestep (see Sec. 6 of REBOUNdx paper). Can use same operator for different steps of different lengths to build higher order splitting schemes.
+ * Slow processes can be applied once every few timesteps (see rebx_add_operator_step_every).
  */
 struct rebx_step{
     struct rebx_operator* operator;     ///< Pointer to operator to use
-    double dt_fraction;                 ///< Fraction of sim.dt to use each time it's called
+    double dt_fraction;                 ///< Fraction of sim.dt to use each time it's called. Multiplied by every
+    int every;                          ///< Called once every this many timesteps (default 1)
+    int phase;                          ///< Windows of every timesteps start when sim.steps_done % every == phase (0 <= phase < every)
 };
 
 /**
@@ -239,11 +421,51 @@ struct rebx_binary_field{
 struct rebx_interpolator{
     enum rebx_interpolation_type interpolation;
     double* times;
-    double* values;
+    double* values;                     ///< Nchannels series of Nvalues values each, one after the other
     int Nvalues;
     double* y2;
     int klo;
+    int Nchannels;                      ///< Number of value series sharing the same times
+    int owns_data;                      ///< 0 if times and values belong to the caller (see rebx_create_interpolator_borrowed)
+};
+/**
+ * @brief Fixed-size object pools used for the nodes and params on parameter lists.
+ */
+enum rebx_pool_type{
+    REBX_POOL_NODE,         ///< rebx_nodes on param lists
+    REBX_POOL_PARAM,        ///< rebx_param structs, with the values of fixed-size types stored inside them
+    REBX_POOL_N,            ///< Number of pools
+};
+
+/**
+ * @brief Slab allocator for small fixed-size objects.
+ * @details Objects are carved out of large slabs and recycled through a free list. All slabs are released at once when the rebx_extras instance is freed.
+ */
+struct rebx_pool{
+    size_t object_size;     ///< Size in bytes of each object handed out
+    void* free_list;        ///< Freed objects, linked through their first bytes
+    void* slabs;            ///< Linked list of allocated slabs
+    char* next;             ///< Next never-used object in the newest slab
+    char* end;              ///< End of the newest slab
+};
+
+/**
+ * @brief Slot in a rebx_name_table.
+ */
+struct rebx_name_entry{
+    const char* name;                   ///< Key. Points to memory owned by the object (NULL for an empty slot)
+    void* object;                       ///< Object stored under the name
+};
+
+/**
+ * @brief Hash table (open addressing, linear probing) from names to objects.
+ */
+struct rebx_name_table{
+    struct rebx_name_entry* entries;    ///< Slots
+    int size;                           ///< Number of slots (power of 2, or 0 if not allocated)
+    int N;                              ///< Number of used slots
 };
+
 /**
  * @brief Main REBOUNDx structure.
  * @details These fields are used internally by REBOUNDx and generally should not be changed manually by the user. Use the API instead.
@@ -255,9 +477,30 @@ struct rebx_extras {
     struct rebx_node* pre_timestep_modifications;   ///< Linked list of rebx_steps to apply before each timestep
 	struct rebx_node* post_timestep_modifications;  ///< Linked list of rebx_steps to apply after each timestep
 
-    struct rebx_node* registered_params;            ///< Linked list of rebx_params with all the parameter names registered with their type (for type safety)
+    struct rebx_node* registered_params;            ///< Linked list of rebx_params with the parameter names registered with their type (for type safety), on top of the shared default params
     struct rebx_node* allocated_forces;             ///< For memory management
     struct rebx_node* allocated_operators;          ///< For memory management
+    struct rebx_param** registered_param_table;     ///< Hash table (open addressing) of pointers into registered_params, for O(1) lookups by name
+    int registered_param_table_size;                ///< Number of slots in registered_param_table (power of 2)
+    int N_registered_params;                        ///< Number of registered params, including the shared default params. Ids are handed out in registration order
+    struct rebx_node* param_columns;                ///< Linked list of rebx_param_columns
+    int param_columns_dirty;                        ///< Set when particles are removed, so columns get rebuilt before next use
+    struct rebx_pool pools[REBX_POOL_N];            ///< Pools for param lists. Particle params are released together with the rebx_extras instance
+    struct rebx_node* geometries;                   ///< Linked list of rebx_geometry caches, one per source particle
+    struct rebx_node* coordinates;                  ///< Linked list of rebx_coordinates caches, one per coordinate system and reference particle
+    unsigned int geometry_epoch;                    ///< Odd while rebx_additional_forces runs. Incremented before and after, which invalidates geometries and coordinates
+    unsigned int param_generation;                  ///< Incremented when params are added or freed, param values move, pointer params change, or particles are removed. Effects caching pointers to param values check it
+    struct rebx_node* param_lists;                  ///< Linked list of rebx_param_list caches, one per param
+    char* archive_filename;                         ///< Binary that snapshots are automatically appended to (NULL if not automated)
+    double archive_auto_interval;                   ///< Simulation time between automatic snapshots (0 if not used)
+    double archive_next;                            ///< Time of next automatic snapshot
+    unsigned long long archive_auto_step;           ///< Number of timesteps between automatic snapshots (0 if not used)
+    unsigned long long archive_next_step;           ///< Timestep of next automatic snapshot
+    struct rebx_archive_delta* archive_delta;       ///< Param values in the last full snapshot written by rebx_output_binary_append_delta (NULL if none)
+    int profiling;                                  ///< Set to 1 to record the profile of each force and operator when it's evaluated (default 0)
+    struct rebx_name_table force_names;             ///< Most recently created force in allocated_forces with each name, for rebx_get_force
+    struct rebx_name_table operator_names;          ///< Most recently created operator in allocated_operators with each name, for rebx_get_operator
+    int default_params;                             ///< 1 if the default params are registered through the table shared by all instances. These aren't on registered_params
 };
 
 /****************************************
@@ -287,6 +530,21 @@ struct rebx_extras* rebx_attach(struct reb_simulation* sim);
  */
 void rebx_detach(struct reb_simulation* sim, struct rebx_extras* rebx);
 void rebx_extras_cleanup(struct reb_simulation* sim);
+/**
+ * @brief Zeroes the profiles of all forces and operators (see rebx_extras.profiling).
+ * @param rebx Pointer to the rebx_extras instance
+ */
+void rebx_profile_reset(struct rebx_extras* const rebx);
+
+/**
+ * @brief Adds up the memory the REBOUNDx instance currently holds.
+ * @details Walks the params, forces, operators and workspaces rather than counting as memory is allocated, so it costs nothing
+ * until called, and is as expensive as a pass over all particle params. Params are pooled, so whole pool slabs are counted.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param usage Structure to fill
+ */
+void rebx_memory_usage(struct rebx_extras* const rebx, struct rebx_memory_usage* const usage);
+
 /**
  * @brief Frees all memory allocated by REBOUNDx instance.
  * @details Should be called after simulation is done if memory is a concern.
@@ -294,6 +552,64 @@ void rebx_extras_cleanup(struct reb_simulation* sim);
  */
 void rebx_free(struct rebx_extras* rebx);
 
+/**
+ * @brief Attaches a copy of a configured REBOUNDx instance to another simulation, e.g. for each member of an ensemble.
+ * @details Copies the registered params, all forces and operators (added in the same order with the same steps), and the
+ * params on them and on sim's particles (by index, up to the smaller of the two particle numbers). Param values are copied.
+ * Pointer params (REBX_TYPE_POINTER, e.g. custom structs) are not copied and have to be set on the clone. Any params
+ * sim's particles already had are dropped, so particles can be copied from the source's simulation. If the source's
+ * tides_spin force has its spin ODE initialized, the clone's is initialized on sim.
+ *
+ * Different instances share no mutable state, so each clone can be integrated on its own thread. The only state shared
+ * by all instances (the default params and the registry of effects) is set up when the first instance is created, and
+ * is only read afterwards. So create the source (or any instance) before starting threads, and call
+ * rebx_register_effect before then too. Several threads can clone the same source at once, as long as it isn't
+ * modified or integrated in the meantime.
+ * @param source The rebx_extras instance to copy.
+ * @param sim Pointer to the simulation to attach the copy to. Must be different from the source's simulation.
+ * @return Pointer to the new rebx_extras instance, or NULL on failure.
+ */
+struct rebx_extras* rebx_clone(struct rebx_extras* const source, struct reb_simulation* const sim);
+
+/**
+ * @brief Same as rebx_clone(), but takes an extras instance (already initialized on a simulation, e.g. from Python).
+ * @param rebx Pointer to the rebx_extras instance to set up. Must not have any params registered yet.
+ * @param source The rebx_extras instance to copy.
+ * @return 1 on success, 0 on failure.
+ */
+int rebx_init_extras_from_clone(struct rebx_extras* const rebx, struct rebx_extras* const source);
+
+/**
+ * @brief Sets up the evaluation of the REBOUNDx forces of K simulations at once, e.g. members of an ensemble made with rebx_clone.
+ * @details The simulations must have REBOUNDx attached, the same number of particles and the same forces, added in the same order.
+ * Call again after adding or removing forces. Params can change freely in between evaluations.
+ * @param sims Array of K pointers to the simulations. The array is copied.
+ * @param K Number of simulations.
+ * @return Pointer to the batch (free with rebx_batch_free), or NULL on failure.
+ */
+struct rebx_batch* rebx_batch_create(struct reb_simulation** const sims, const int K);
+
+/**
+ * @brief Adds the accelerations of the REBOUNDx forces to the particles of all simulations in a batch.
+ * @details Gives the same result as calling sim->additional_forces on each simulation, but forces with a batch kernel
+ * (gr_potential, gravitational_harmonics and tides_constant_time_lag) are evaluated for all simulations in one call
+ * that vectorizes across them. Other forces are evaluated on each simulation in turn. Meant for drivers that advance
+ * an ensemble of small systems in lockstep and evaluate forces where each simulation would call additional_forces.
+ * The loops over simulations are marked omp simd, so they only vectorize when compiled with OpenMP (or -fopenmp-simd).
+ * @param batch Pointer to the batch returned by rebx_batch_create.
+ */
+void rebx_batch_additional_forces(struct rebx_batch* const batch);
+
+/**
+ * @brief Workspace of at least N doubles for batch kernels. Valid during the kernel call. NULL if out of memory.
+ */
+double* rebx_batch_scratch(struct rebx_batch* const batch, const size_t N);
+
+/**
+ * @brief Frees a batch created with rebx_batch_create. Doesn't affect the simulations.
+ */
+void rebx_batch_free(struct rebx_batch* const batch);
+
 int rebx_remove_force(struct rebx_extras* rebx, struct rebx_force* force);
 int rebx_remove_operator(struct rebx_extras* rebx, struct rebx_operator* operator);
 
@@ -304,6 +620,47 @@ int rebx_remove_operator(struct rebx_extras* rebx, struct rebx_operator* operato
  */
 void rebx_output_binary(struct rebx_extras* rebx, char* filename);
 
+/**
+ * @brief Same as rebx_output_binary(), but writes the binary into memory instead of a file.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param bufp Set to a newly allocated buffer holding the binary (NULL on failure). The caller frees it with free().
+ * @param sizep Set to the size of the buffer in bytes.
+ */
+void rebx_output_binary_to_buffer(struct rebx_extras* rebx, char** bufp, size_t* sizep);
+
+/**
+ * @brief Appends a snapshot of all effects and parameters to a binary file, creating it if it doesn't exist.
+ * @details Each snapshot is stamped with sim->t and sim->steps_done, and the index at the end of the file is updated so any snapshot can be loaded with a single seek.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param filename Filename of the binary file.
+ */
+void rebx_output_binary_append(struct rebx_extras* rebx, char* filename);
+
+/**
+ * @brief Like rebx_output_binary_append(), but only stores the particle params that changed since the last full snapshot.
+ * @details The first call writes a full snapshot. Later calls write a delta snapshot if the structure (particles, effects, registered and attached params) and all effect params are unchanged since then, and another full snapshot otherwise. Delta snapshots hold one column per param name with the indices of the particles whose value changed and their new values. Loading one reads its full snapshot and applies the column values.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param filename Filename of the binary file.
+ */
+void rebx_output_binary_append_delta(struct rebx_extras* rebx, char* filename);
+
+/**
+ * @brief Automatically appends snapshots to a binary file at fixed intervals in simulation time.
+ * @details Uses the same rule as reb_simulationarchive_automate_interval(), so if both are set up with the same interval before integrating, every SimulationArchive snapshot has a REBOUNDx snapshot at the same time. A first snapshot is written immediately. Snapshots are written with rebx_output_binary_append_delta().
+ * @param rebx Pointer to the rebx_extras instance
+ * @param filename Filename of the binary file.
+ * @param interval Simulation time between snapshots.
+ */
+void rebx_output_binary_archive_automate_interval(struct rebx_extras* rebx, const char* const filename, double interval);
+
+/**
+ * @brief Same as rebx_output_binary_archive_automate_interval(), but appends a snapshot every step timesteps like reb_simulationarchive_automate_step().
+ * @param rebx Pointer to the rebx_extras instance
+ * @param filename Filename of the binary file.
+ * @param step Number of timesteps between snapshots.
+ */
+void rebx_output_binary_archive_automate_step(struct rebx_extras* rebx, const char* const filename, unsigned long long step);
+
 /**
  * @brief Reads a REBOUNDx binary file, loads all effects and parameters.
  * @param sim Pointer to the simulation to which the effects and parameters should be added.
@@ -318,6 +675,48 @@ struct rebx_extras* rebx_create_extras_from_binary(struct reb_simulation* sim, c
  * @param warnings Pointer to an array of warnings to be populated during loading.
  */
 void rebx_init_extras_from_binary(struct rebx_extras* rebx, const char* const filename, enum rebx_input_binary_messages* warnings);
+
+/**
+ * @brief Same as rebx_create_extras_from_binary(), but loads a particular snapshot from a binary with several snapshots.
+ * @param sim Pointer to the simulation to which the effects and parameters should be added.
+ * @param filename Filename of the saved binary file.
+ * @param snapshot Index of the snapshot to load. Negative values count from the end (-1 is the last snapshot).
+ */
+struct rebx_extras* rebx_create_extras_from_binary_snapshot(struct reb_simulation* sim, const char* const filename, long snapshot);
+
+/**
+ * @brief Same as rebx_init_extras_from_binary(), but loads a particular snapshot. See rebx_create_extras_from_binary_snapshot().
+ */
+void rebx_init_extras_from_binary_snapshot(struct rebx_extras* rebx, const char* const filename, long snapshot, enum rebx_input_binary_messages* warnings);
+
+/**
+ * @brief Same as rebx_create_extras_from_binary_snapshot(), but loads from a binary in memory (e.g. from rebx_output_binary_to_buffer() or a memory mapped file).
+ * @details The buffer is parsed in place and is not modified. It's no longer needed once the function returns.
+ * @param sim Pointer to the simulation to which the effects and parameters should be added.
+ * @param buf Buffer holding the binary.
+ * @param size Size of the buffer in bytes.
+ * @param snapshot Index of the snapshot to load. Negative values count from the end (-1 is the last snapshot).
+ */
+struct rebx_extras* rebx_create_extras_from_buffer(struct reb_simulation* sim, const char* const buf, const size_t size, long snapshot);
+
+/**
+ * @brief Same as rebx_init_extras_from_binary_snapshot(), but loads from a binary in memory. See rebx_create_extras_from_buffer().
+ */
+void rebx_init_extras_from_buffer(struct rebx_extras* rebx, const char* const buf, const size_t size, long snapshot, enum rebx_input_binary_messages* warnings);
+
+/**
+ * @brief Finds the snapshot in a binary file whose time stamp is closest to t.
+ * @param filename Filename of the saved binary file.
+ * @param t Time to look for.
+ * @param warnings Pointer to warnings enum to store warnings that come up
+ * @return Index of the snapshot, or -1 if the file can't be read.
+ */
+long rebx_input_find_snapshot(const char* const filename, const double t, enum rebx_input_binary_messages* warnings);
+
+/**
+ * @brief Same as rebx_input_find_snapshot(), but for a binary in memory. See rebx_create_extras_from_buffer().
+ */
+long rebx_input_find_snapshot_in_buffer(const char* const buf, const size_t size, const double t, enum rebx_input_binary_messages* warnings);
 /** @} */
 /** @} */
 
@@ -343,11 +742,40 @@ void rebx_init_extras_from_binary(struct rebx_extras* rebx, const char* const fi
 //struct rebx_effect* rebx_add(struct rebx_extras* rebx, const char* name);
 int rebx_add_operator(struct rebx_extras* rebx, struct rebx_operator* operator);
 int rebx_add_operator_step(struct rebx_extras* rebx, struct rebx_operator* operator, const double dt_fraction, enum rebx_timing timing);
+/**
+ * @brief Adds an operator step that's only applied once every few timesteps, with its timestep scaled up to match.
+ * @details Timesteps are grouped into windows of every steps, starting when sim.steps_done % every == phase. Pre-timestep steps are applied
+ * before the first timestep of each window, post-timestep steps after the last, both with dt_fraction*every*sim.dt, so splitting schemes stay
+ * symmetric about the window. Useful to stagger slow operators (e.g. modify_mass with long timescales) with different phases.
+ * Assumes a fixed sim.dt. Windows are counted from steps_done = 0, so if the integration starts partway through one, its first application
+ * is still for a whole window. Every=1 is the same as rebx_add_operator_step.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param operator Operator to add
+ * @param dt_fraction Fraction of the window's length (every*sim.dt) to apply the operator for
+ * @param timing REBX_TIMING_PRE or REBX_TIMING_POST
+ * @param every Number of timesteps in each window (>= 1)
+ * @param phase Offset of the windows in timesteps (taken modulo every)
+ * @return 1 on success, 0 otherwise
+ */
+int rebx_add_operator_step_every(struct rebx_extras* rebx, struct rebx_operator* operator, const double dt_fraction, enum rebx_timing timing, const int every, const int phase);
+/**
+ * @brief Like rebx_add_operator, with the steps it adds applied once every every timesteps (see rebx_add_operator_step_every).
+ */
+int rebx_add_operator_every(struct rebx_extras* rebx, struct rebx_operator* operator, const int every, const int phase);
 int rebx_add_force(struct rebx_extras* rebx, struct rebx_force* force);
 struct rebx_operator* rebx_load_operator(struct rebx_extras* const rebx, const char* name);
 struct rebx_force* rebx_load_force(struct rebx_extras* const rebx, const char* name);
 struct rebx_operator* rebx_create_operator(struct rebx_extras* const rebx, const char* name);
 struct rebx_force* rebx_create_force(struct rebx_extras* const rebx, const char* name);
+
+/**
+ * @brief Adds a custom force or operator to the registry of effects, so it can be loaded by name with rebx_load_force or rebx_load_operator.
+ * @details The registry is shared by all rebx_extras instances in the process, so a custom effect registered once is also found when forces and operators are loaded from a binary. Registering is not thread safe, so register custom effects before running simulations in parallel.
+ * @param rebx Pointer to the rebx_extras instance (used for error messages)
+ * @param effect Effect to register. Its fields (including the name) are copied.
+ * @return 1 on success, 0 if the effect is not a valid force or operator, or an effect with that name already exists.
+ */
+int rebx_register_effect(struct rebx_extras* const rebx, const struct rebx_registered_effect* const effect);
 /**
  * @brief Function for adding a custom force in REBOUNDx.
  * @param rebx Pointer to the rebx_extras instance
@@ -417,6 +845,25 @@ int rebx_remove_param(struct rebx_node** apptr, const char* const param_name);
 
 void* rebx_get_param(struct rebx_extras* const rebx, struct rebx_node* ap, const char* const param_name);
 struct rebx_param* rebx_get_param_struct(struct rebx_extras* const rebx, struct rebx_node* ap, const char* const param_name);
+
+/**
+ * @brief Gets the integer id of a registered parameter name, for use with rebx_get_param_by_id.
+ * @details Lookups by id avoid string comparisons, so in loops over many particles, call rebx_intern once outside the loop and use rebx_get_param_by_id inside it. Ids are only valid for the rebx_extras instance that returned them.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param param_name Name of the registered parameter
+ * @return Id of the parameter. -1 (with error) if parameter name has not been registered.
+ */
+int rebx_intern(struct rebx_extras* const rebx, const char* const param_name);
+
+/**
+ * @brief Gets a parameter from a particle or effect using an id returned by rebx_intern.
+ * @details This still walks ap, but compares ints rather than strings. Objects hold only a few params, and ap stays a plain list that the Python side walks and OpenMP force loops read concurrently. For loops over many particles, use rebx_get_param_list or rebx_get_param_column, which index by particle.
+ * @param ap Pointer from which to get the param
+ * @param id Id returned by rebx_intern
+ * @return A void pointer to the parameter. NULL if not found.
+ */
+void* rebx_get_param_by_id(struct rebx_extras* const rebx, struct rebx_node* ap, const int id);
+struct rebx_param* rebx_get_param_struct_by_id(struct rebx_extras* const rebx, struct rebx_node* ap, const int id);
 void rebx_set_param_pointer(struct rebx_extras* const rebx, struct rebx_node** apptr, const char* const param_name, void* val);
 void rebx_set_param_double(struct rebx_extras* const rebx, struct rebx_node** apptr, const char* const param_name, double val);
 void rebx_set_param_int(struct rebx_extras* const rebx, struct rebx_node** apptr, const char* const param_name, int val);
@@ -424,6 +871,42 @@ void rebx_set_param_uint32(struct rebx_extras* const rebx, struct rebx_node** ap
 void rebx_set_param_vec3d(struct rebx_extras* const rebx, struct rebx_node** apptr, const char* const param_name, struct reb_vec3d val);
 void rebx_register_param(struct rebx_extras* const rebx, const char* name, enum rebx_param_type type);
 
+/**
+ * @brief Stores a per-particle double parameter contiguously across particles.
+ * @details Values already set on particles are moved into the column. Columns are kept in sync as particles are added or removed.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param param_name Name of a registered REBX_TYPE_DOUBLE parameter.
+ * @return 1 on success, 0 otherwise.
+ */
+int rebx_add_param_column(struct rebx_extras* const rebx, const char* const param_name);
+
+/**
+ * @brief Gets the column for a parameter, synced with the current particles.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param id Id of the parameter returned by rebx_intern
+ * @return Pointer to the column, or NULL if rebx_add_param_column was not called for this parameter.
+ */
+struct rebx_param_column* rebx_get_param_column(struct rebx_extras* const rebx, const int id);
+
+/**
+ * @brief Sets a parameter on many particles in one call.
+ * @details Adds the parameter to particles that don't have it yet. Params stored in a column (see rebx_add_param_column) are written to it directly.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param param_name Name of a registered parameter of type REBX_TYPE_DOUBLE, REBX_TYPE_INT, REBX_TYPE_UINT32 or REBX_TYPE_VEC3D.
+ * @param values Array of N values of the parameter's type.
+ * @param indices Indices in sim->particles of the particles to set, or NULL for the first N particles.
+ * @param N Number of values.
+ * @return 1 on success, 0 otherwise (with error).
+ */
+int rebx_set_particle_params(struct rebx_extras* const rebx, const char* const param_name, const void* const values, const int* const indices, const int N);
+
+/**
+ * @brief Gets a parameter from many particles in one call. See rebx_set_particle_params().
+ * @param values Array of N values of the parameter's type to fill. Entries for particles without the parameter are left unchanged.
+ * @return Number of particles that have the parameter, or -1 (with error) if it can't be accessed in bulk.
+ */
+int rebx_get_particle_params(struct rebx_extras* const rebx, const char* const param_name, void* const values, const int* const indices, const int N);
+
 /** @} */
 /** @} */
 
@@ -450,6 +933,46 @@ struct reb_vec3d rebx_tools_spin_angular_momentum(struct rebx_extras* const rebx
 
 void rebx_simulation_irotate(struct rebx_extras* const rebx, const struct reb_rotation q);
 
+/**
+ * @brief Gets the separations of all particles from a source particle.
+ * @details Within one call to rebx_additional_forces, all forces asking for the same source share one calculation, since forces only update accelerations.
+ * Outside of it (e.g. forces integrated as operators with integrate_force), the separations are recalculated on every call.
+ * The returned arrays stay valid until the next call for the same source.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param particles Particle array passed to the force
+ * @param N Number of particles passed to the force
+ * @param source_index Index of the source particle
+ * @return Pointer to the geometry, or NULL if memory could not be allocated.
+ */
+const struct rebx_geometry* rebx_get_geometry(struct rebx_extras* const rebx, const struct reb_particle* const particles, const int N, const int source_index);
+
+/**
+ * @brief Gets the coordinates of all particles in Jacobi, barycentric or particle-centered (e.g. heliocentric) coordinates.
+ * @details Within one call to rebx_additional_forces, all forces asking for the same coordinates share one calculation, like rebx_get_geometry.
+ * Outside of it, the coordinates are recalculated on every call.
+ * The returned arrays stay valid until the next call for the same coordinates.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param particles Particle array passed to the force
+ * @param N Number of particles passed to the force
+ * @param coordinates Coordinate system
+ * @param reference_index Index of the reference particle for REBX_COORDINATES_PARTICLE. Ignored otherwise
+ * @return Pointer to the coordinates, or NULL if memory could not be allocated.
+ */
+const struct rebx_coordinates* rebx_get_coordinates(struct rebx_extras* const rebx, const struct reb_particle* const particles, const int N, const enum REBX_COORDINATES coordinates, const int reference_index);
+
+/**
+ * @brief Gets the particles that have a parameter set.
+ * @details The list is cached, and only rebuilt when params are added, freed or moved, particles are removed, or the particles passed change.
+ * Values can still be changed through the pointers or the rebx_set_param_* functions without invalidating the list.
+ * The returned list stays valid until the next call for the same param.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param particles Particle array passed to the effect
+ * @param N Number of particles passed to the effect
+ * @param id Id of the parameter returned by rebx_intern
+ * @return Pointer to the list, or NULL if memory could not be allocated.
+ */
+const struct rebx_param_list* rebx_get_param_list(struct rebx_extras* const rebx, const struct reb_particle* const particles, const int N, const int id);
+
 
 
 /******************************************
@@ -658,6 +1181,23 @@ void rebx_drift_step(struct reb_simulation* const sim, struct rebx_operator* con
  * @param dt timestep for which to step in simulation time units.
  */
 void rebx_kick_step(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
+/**
+ * @brief Executes the substeps added with rebx_composite_add_substep for passed time dt, using the WHFast integrator in REBOUND.
+ * @details Stays in the coordinates set in sim.ri_whfast across the whole sequence, and only converts to inertial coordinates for interaction substeps and at the end.
+ * @param sim Pointer to the simulation to step.
+ * @param operator Pointer to the operator loaded with rebx_load_operator(rebx, "composite")
+ * @param dt timestep for which to step in simulation time units.
+ */
+void rebx_composite_step(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt);
+/**
+ * @brief Appends a substep to a composite operator.
+ * @param rebx Pointer to the rebx_extras instance
+ * @param operator Pointer to the operator loaded with rebx_load_operator(rebx, "composite")
+ * @param type Type of substep (see enum rebx_substep_type)
+ * @param dt_fraction Fraction of the operator's dt for this substep
+ * @return 1 on success, 0 on failure
+ */
+int rebx_composite_add_substep(struct rebx_extras* const rebx, struct rebx_operator* const operator, const enum rebx_substep_type type, const double dt_fraction);
 /** @} */
 /** @} */
 
@@ -685,6 +1225,23 @@ void rebx_kick_step(struct reb_simulation* const sim, struct rebx_operator* cons
  * @return Pointer to a rebx_interpolator structure. Call rebx_interpolate to get values.
  */
 struct rebx_interpolator* rebx_create_interpolator(struct rebx_extras* const rebx, const int Nvalues, const double* times, const double* values, enum rebx_interpolation_type interpolation);
+/**
+ * @brief Like rebx_create_interpolator, but for several series of values tabulated at the same times (e.g. mass, radius and luminosity along a stellar evolution track).
+ * @param rebx pointer to the REBOUNDx extras instance.
+ * @param Nvalues Length of times array, and of each series of values.
+ * @param Nchannels Number of series of values.
+ * @param times Array of times at which the corresponding values are supplied.
+ * @param values Array of Nchannels*Nvalues values, with the Nvalues of the first series first, then those of the second etc.
+ * @param interpolation Enum specifying the interpolation method.
+ * @return Pointer to a rebx_interpolator structure. Call rebx_interpolate_many to get values.
+ */
+struct rebx_interpolator* rebx_create_interpolator_channels(struct rebx_extras* const rebx, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation);
+/**
+ * @brief Like rebx_create_interpolator_channels, but uses the passed times and values arrays directly instead of copying them.
+ * @details The caller keeps ownership of both arrays, which must not be changed or freed while the interpolator is in use.
+ * Useful for long tabulated tracks, e.g. in a memory-mapped file.
+ */
+struct rebx_interpolator* rebx_create_interpolator_borrowed(struct rebx_extras* const rebx, const int Nvalues, const int Nchannels, const double* times, const double* values, enum rebx_interpolation_type interpolation);
 /**
  * @brief Frees the memory for a rebx_interpolator structure.
  */
@@ -699,6 +1256,40 @@ void rebx_free_interpolator(struct rebx_interpolator* const interpolator);
  * @return Interpolated value at passed time.
  */
 double rebx_interpolate(struct rebx_extras* const rebx, struct rebx_interpolator* const interpolator, const double time);
+/**
+ * @brief Interpolate all series of values at many times in one call.
+ * @details Times need not be sorted, but sequential queries are fastest.
+ * @param rebx Pointer to the REBOUNDx extras instance.
+ * @param interpolator Pointer to the rebx_interpolator structure to interpolate from.
+ * @param times Array of N times at which to interpolate.
+ * @param out Array of N*Nchannels doubles to fill. out[i*Nchannels + c] is the value of series c at times[i].
+ * @param N Number of times.
+ */
+void rebx_interpolate_many(struct rebx_extras* const rebx, struct rebx_interpolator* const interpolator, const double* times, double* out, const int N);
+/**
+ * @brief Has a param_driver operator set a particle parameter to the interpolated value at the start of each of its steps.
+ * @details The driver keeps its own copy of the series, so the interpolator can be freed afterwards. The copy is stored in binaries.
+ * Setting the same parameter again replaces the earlier series. See the param_driver documentation.
+ * @param rebx Pointer to the REBOUNDx extras instance.
+ * @param driver Operator loaded with rebx_load_operator(rebx, "param_driver").
+ * @param particle_index Index of the particle in sim->particles.
+ * @param param_name Name of a registered REBX_TYPE_DOUBLE parameter, or "m" or "r" to drive the particle's mass or radius.
+ * @param interpolator Interpolator with the values of the parameter.
+ * @param channel Series of a multi-channel interpolator to use (0 for single series).
+ * @return 1 on success, 0 otherwise.
+ */
+int rebx_drive_particle_param(struct rebx_extras* const rebx, struct rebx_operator* const driver, const int particle_index, const char* const param_name, const struct rebx_interpolator* const interpolator, const int channel);
+/**
+ * @brief Like rebx_drive_particle_param, but for a parameter of a force.
+ * @param rebx Pointer to the REBOUNDx extras instance.
+ * @param driver Operator loaded with rebx_load_operator(rebx, "param_driver").
+ * @param force Force whose parameter is set.
+ * @param param_name Name of a registered REBX_TYPE_DOUBLE parameter.
+ * @param interpolator Interpolator with the values of the parameter.
+ * @param channel Series of a multi-channel interpolator to use (0 for single series).
+ * @return 1 on success, 0 otherwise.
+ */
+int rebx_drive_force_param(struct rebx_extras* const rebx, struct rebx_operator* const driver, struct rebx_force* const force, const char* const param_name, const struct rebx_interpolator* const interpolator, const int channel);
 /** @} */
 /** @} */
 
@@ -1,6 +1,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "reboundx.h"
 
 struct reb_particle rebx_get_com_without_particle(struct reb_particle com, struct reb_particle p){
@@ -29,6 +30,14 @@ struct reb_particle rebx_get_com_without_particle(struct reb_particle com, struc
     return com;
 }
 
+int rebx_get_N_active(const struct reb_simulation* const sim, const int N){
+    return (sim->N_active < 0 || sim->N_active > N) ? N : sim->N_active;
+}
+
+int rebx_get_N_sources(const struct reb_simulation* const sim, const int N_active, const int N, const int i){
+    return (sim->testparticle_type == 1 && i < N_active) ? N : N_active;
+}
+
 
 static inline struct reb_particle rebx_particle_minus(struct reb_particle p1, struct reb_particle p2){
     struct reb_particle p = {0};
@@ -55,6 +64,24 @@ void rebx_calculate_jacobi_masses(const struct reb_particle* const ps, double* c
     m_j[0] = eta;
 }
 
+double rebx_tools_orbital_period(const double G, const struct reb_particle p, const struct reb_particle primary, int* err){
+    const double mu = G*(p.m + primary.m);
+    const double dx = p.x - primary.x;
+    const double dy = p.y - primary.y;
+    const double dz = p.z - primary.z;
+    const double d = sqrt(dx*dx + dy*dy + dz*dz);
+    if (primary.m == 0. || d == 0.){ // same cases reb_tools_particle_to_orbit_err flags
+        *err = 1;
+        return NAN;
+    }
+    const double dvx = p.vx - primary.vx;
+    const double dvy = p.vy - primary.vy;
+    const double dvz = p.vz - primary.vz;
+    const double v2 = dvx*dvx + dvy*dvy + dvz*dvz;
+    const double a = -mu/(v2 - 2.*mu/d); // vis-viva
+    return copysign(2.*M_PI*sqrt(fabs(a*a*a/mu)), a);
+}
+
 double rebx_Edot(struct reb_particle* const ps, const int N){
     double Edot = 0.;
     for(int i=0; i<N; i++){
@@ -63,20 +90,96 @@ double rebx_Edot(struct reb_particle* const ps, const int N){
     return Edot;
 }
 
+struct rebx_force_scratch{
+    size_t size;
+    void* data;
+};
+
+static void* rebx_get_force_buffer(struct rebx_extras* const rebx, struct rebx_force* const force, const char* const name, const size_t size){
+    struct rebx_force_scratch* scratch = rebx_get_param(rebx, force->ap, name);
+    if (scratch == NULL){
+        scratch = calloc(1, sizeof(*scratch));
+        if (scratch == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, name, scratch);
+    }
+    if (size > scratch->size || scratch->data == NULL){
+        void* data = realloc(scratch->data, size > 0 ? size : 1); // Always return a valid pointer, even for N=0
+        if (data == NULL){
+            return NULL;
+        }
+        if (scratch->data == NULL){ // zero on first allocation, so callers can tell it was never filled
+            memset(data, 0, size > 0 ? size : 1);
+        }
+        scratch->data = data;
+        scratch->size = size;
+    }
+    return scratch->data;
+}
+
+static void rebx_free_force_buffer(struct rebx_extras* const rebx, struct rebx_force* const force, const char* const name){
+    struct rebx_force_scratch* scratch = rebx_get_param(rebx, force->ap, name);
+    if (scratch == NULL){
+        return;
+    }
+    free(scratch->data);
+    free(scratch);
+    rebx_set_param_pointer(rebx, &force->ap, name, NULL);
+}
+
+void* rebx_get_force_scratch(struct rebx_extras* const rebx, struct rebx_force* const force, const size_t size){
+    return rebx_get_force_buffer(rebx, force, "force_scratch", size);
+}
+
+void* rebx_get_force_constants(struct rebx_extras* const rebx, struct rebx_force* const force, const size_t size){
+    return rebx_get_force_buffer(rebx, force, "force_constants", size);
+}
+
+void rebx_free_force_scratch(struct rebx_extras* const rebx, struct rebx_force* const force){
+    rebx_free_force_buffer(rebx, force, "force_scratch");
+    rebx_free_force_buffer(rebx, force, "force_constants");
+}
+
+void rebx_memory_add(struct rebx_memory_usage* const usage, const enum rebx_memory_category category, const void* const ptr, const size_t size){
+    if (ptr == NULL){
+        return;
+    }
+    usage->bytes[category] += size;
+    usage->allocations[category]++;
+}
+
+void rebx_force_scratch_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const char* const names[2] = {"force_scratch", "force_constants"};
+    for (int k=0; k<2; k++){
+        const struct rebx_force_scratch* const scratch = rebx_get_param(rebx, force->ap, names[k]);
+        if (scratch == NULL){
+            continue;
+        }
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, scratch, sizeof(*scratch));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, scratch->data, scratch->size > 0 ? scratch->size : 1);
+    }
+}
+
+/* calculate_force is evaluated for all particles in parallel when compiled with OpenMP, so it must not modify
+ * shared state (including source, which points into coordinates shared with other forces, see rebx_get_coordinates)
+ * and must not depend on the accelerations of p or source. Back reactions are then applied serially,
+ * in the same order as a serial run, so results do not depend on the number of threads.*/
 void rebx_com_force(struct reb_simulation* const sim, struct rebx_force* const force, const enum REBX_COORDINATES coordinates, const int back_reactions_inclusive, const char* reference_name, struct reb_vec3d (*calculate_force) (struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* p, struct reb_particle* source), struct reb_particle* const particles, const int N){
     struct rebx_extras* const rebx = sim->extras;
-    struct reb_particle com = reb_get_com(sim); // Start with full com for jacobi and barycentric coordinates.
 
     int refindex = -1;
+    enum REBX_COORDINATES reference_coordinates = coordinates; // barycentric if the reference particle isn't found
     if(coordinates == REBX_COORDINATES_JACOBI){
         refindex = 0;                           // There is no jacobi coordinate for the 0th particle, so set refindex to skip it in loop below.
     }
     else if(coordinates == REBX_COORDINATES_PARTICLE){
+        reference_coordinates = REBX_COORDINATES_BARYCENTRIC;
         for (int i=0; i < N; i++){
 			struct reb_particle* p = &particles[i];
             const int* const reference = rebx_get_param(rebx, p->ap, reference_name);
             if (reference){
-                com = particles[i];
+                reference_coordinates = REBX_COORDINATES_PARTICLE;
                 refindex = i;
                 break;
             }
@@ -89,16 +192,42 @@ void rebx_com_force(struct reb_simulation* const sim, struct rebx_force* const f
     }
 
 
-    for(int i=N-1; i>=0; i--){ // Run through backwards so each iteration does not depend on previous ones in Jacobi coordinates.
+    struct reb_vec3d* const as = rebx_get_force_scratch(rebx, force, N*sizeof(struct reb_vec3d));
+    // Centers of mass (or the reference particle) are shared with other forces asking for the same coordinates during the pass
+    const struct rebx_coordinates* const c = rebx_get_coordinates(rebx, particles, N, reference_coordinates, refindex);
+    if (as == NULL || c == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for back reactions.\n");
+        return;
+    }
+    const struct reb_particle* const coms = c->coms;
+
+#pragma omp parallel for schedule(guided)
+    for(int i=0; i<N; i++){
         if (i==refindex){
             continue;
         }
-        struct reb_particle* p = &particles[i];
-        if (coordinates == REBX_COORDINATES_JACOBI){
-            com = rebx_get_com_without_particle(com, *p);
+        if (force->skip != NULL && force->skip[i]){ // culled, so no acceleration or back reaction
+            as[i] = (struct reb_vec3d){0};
+            continue;
         }
+        as[i] = calculate_force(sim, force, &particles[i], (struct reb_particle*)&coms[i]); // calculate_force doesn't modify source (see above)
+    }
 
-        struct reb_vec3d a = calculate_force(sim, force, p, &com);
+    // Back reactions are summed as we go and applied once per particle, rather than to all particles j for every i.
+    // Barycentric: every particle feels the sum over all i. Jacobi: particle j feels the sum over i > j (i >= j if inclusive).
+    // Particle 0 feels every Jacobi back reaction, so those are subtracted from it directly as they come.
+    struct reb_vec3d back_reaction = {0};
+    for(int i=N-1; i>=0; i--){
+        struct reb_particle* p = &particles[i];
+        if (coordinates == REBX_COORDINATES_JACOBI && i != refindex){
+            p->ax -= back_reaction.x;
+            p->ay -= back_reaction.y;
+            p->az -= back_reaction.z;
+        }
+        if (i==refindex){
+            continue;
+        }
+        const struct reb_vec3d a = as[i];
         p->ax += a.x;
         p->ay += a.y;
         p->az += a.z;
@@ -106,35 +235,37 @@ void rebx_com_force(struct reb_simulation* const sim, struct rebx_force* const f
         double massratio;
         switch(coordinates){
             case REBX_COORDINATES_BARYCENTRIC:
-                massratio = p->m/com.m;
-                for(int j=0; j < N; j++){
-                    particles[j].ax -= massratio*a.x;
-                    particles[j].ay -= massratio*a.y;
-                    particles[j].az -= massratio*a.z;
-                }
+                massratio = p->m/coms[i].m;
+                back_reaction.x += massratio*a.x;
+                back_reaction.y += massratio*a.y;
+                back_reaction.z += massratio*a.z;
                 break;
             case REBX_COORDINATES_JACOBI:
                 if(back_reactions_inclusive){
-                    massratio = p->m/(com.m + p->m);
+                    massratio = p->m/(coms[i].m + p->m);
+                    p->ax -= massratio*a.x;
+                    p->ay -= massratio*a.y;
+                    p->az -= massratio*a.z;
                 }
                 else{
-                    massratio = p->m/com.m;
-                }
-                for(int j=0; j < i + back_reactions_inclusive; j++){    // stop at j=i if inclusive, at i-1 if not
-                    particles[j].ax -= massratio*a.x;
-                    particles[j].ay -= massratio*a.y;
-                    particles[j].az -= massratio*a.z;
+                    massratio = p->m/coms[i].m;
                 }
+                particles[refindex].ax -= massratio*a.x;
+                particles[refindex].ay -= massratio*a.y;
+                particles[refindex].az -= massratio*a.z;
+                back_reaction.x += massratio*a.x;
+                back_reaction.y += massratio*a.y;
+                back_reaction.z += massratio*a.z;
                 break;
             case REBX_COORDINATES_PARTICLE:
                 if(back_reactions_inclusive){
-                    massratio = p->m/(com.m + p->m);
+                    massratio = p->m/(coms[i].m + p->m);
                     p->ax -= massratio*a.x;
                     p->ay -= massratio*a.y;
                     p->az -= massratio*a.z;
                 }
                 else{
-                    massratio = p->m/com.m;
+                    massratio = p->m/coms[i].m;
                 }
                 particles[refindex].ax -= massratio*a.x;
                 particles[refindex].ay -= massratio*a.y;
@@ -144,6 +275,13 @@ void rebx_com_force(struct reb_simulation* const sim, struct rebx_force* const f
                 reb_error(sim, "Coordinates not supported in REBOUNDx.\n");
         }
     }
+    if (coordinates == REBX_COORDINATES_BARYCENTRIC){
+        for(int j=0; j < N; j++){
+            particles[j].ax -= back_reaction.x;
+            particles[j].ay -= back_reaction.y;
+            particles[j].az -= back_reaction.z;
+        }
+    }
 }
 
 static inline void rebx_subtract_posvel(struct reb_particle* p, struct reb_particle* diff, const double massratio){
@@ -155,6 +293,15 @@ static inline void rebx_subtract_posvel(struct reb_particle* p, struct reb_parti
     p->vz -= massratio*diff->vz;
 }
 
+static inline void rebx_add_posvel(struct reb_particle* sum, struct reb_particle* diff, const double massratio){
+    sum->x += massratio*diff->x;
+    sum->y += massratio*diff->y;
+    sum->z += massratio*diff->z;
+    sum->vx += massratio*diff->vx;
+    sum->vy += massratio*diff->vy;
+    sum->vz += massratio*diff->vz;
+}
+
 /* only accepts one reference particle if coordinates=REBX_COORDINATES_PARTICLE.
  * calculate_effect function should check for edge case where particle and reference are the same
  * (could happen e.g. with barycentric coordinates with test particles and single massive body)
@@ -187,11 +334,27 @@ void rebx_tools_com_ptm(struct reb_simulation* const sim, struct rebx_operator*
     }
 
 
+    // As in rebx_com_force, back reactions are summed as we go. Before its own step, particle i is shifted by those of
+    // the particles already processed, as it would have been by subtracting from all j for every i. In barycentric
+    // coordinates, particles processed earlier also feel the later ones, which are applied in a final pass. In Jacobi
+    // coordinates, particle 0 feels every back reaction, so those are subtracted from it directly as they come.
+    struct reb_particle back_reaction = {0};
+    struct reb_particle* back_reactions = NULL;
+    if (coordinates == REBX_COORDINATES_BARYCENTRIC){
+        back_reactions = malloc(N_real*sizeof(*back_reactions));
+        if (back_reactions == NULL && N_real > 0){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for back reactions.\n");
+            return;
+        }
+    }
     for(int i=N_real-1; i>=0; i--){ // Run through backwards so each iteration does not depend on previous ones in Jacobi coordinates.
+        struct reb_particle* p = &sim->particles[i];
+        if (coordinates == REBX_COORDINATES_BARYCENTRIC || (coordinates == REBX_COORDINATES_JACOBI && i != refindex)){
+            rebx_subtract_posvel(p, &back_reaction, 1.);
+        }
         if (i==refindex){
             continue;
         }
-        struct reb_particle* p = &sim->particles[i];
         if (coordinates == REBX_COORDINATES_JACOBI){
             com = rebx_get_com_without_particle(com, *p);
         }
@@ -209,20 +372,21 @@ void rebx_tools_com_ptm(struct reb_simulation* const sim, struct rebx_operator*
         switch(coordinates){
             case REBX_COORDINATES_BARYCENTRIC:
                 massratio = p->m/com.m;
-                for(int j=0; j < N_real; j++){
-                    rebx_subtract_posvel(&sim->particles[j], &diff, massratio);
-                }
+                rebx_subtract_posvel(p, &diff, massratio);
+                rebx_add_posvel(&back_reaction, &diff, massratio);
+                back_reactions[i] = (struct reb_particle){0};
+                rebx_add_posvel(&back_reactions[i], &diff, massratio);
                 break;
             case REBX_COORDINATES_JACOBI:
                 if(back_reactions_inclusive){
                     massratio = p->m/(com.m + p->m);
+                    rebx_subtract_posvel(p, &diff, massratio);
                 }
                 else{
                     massratio = p->m/com.m;
                 }
-                for(int j=0; j < i + back_reactions_inclusive; j++){    // stop at j=i if inclusive, at i-1 if not
-                    rebx_subtract_posvel(&sim->particles[j], &diff, massratio);
-                }
+                rebx_subtract_posvel(&sim->particles[refindex], &diff, massratio);
+                rebx_add_posvel(&back_reaction, &diff, massratio);
                 break;
             case REBX_COORDINATES_PARTICLE:
                 if(back_reactions_inclusive){
@@ -238,6 +402,14 @@ void rebx_tools_com_ptm(struct reb_simulation* const sim, struct rebx_operator*
                 reb_error(sim, "Coordinates not supported in REBOUNDx.\n");
         }
     }
+    if (coordinates == REBX_COORDINATES_BARYCENTRIC){
+        struct reb_particle sum = {0};  // back reactions of particles with index below j
+        for(int j=0; j < N_real; j++){
+            rebx_subtract_posvel(&sim->particles[j], &sum, 1.);
+            rebx_add_posvel(&sum, &back_reactions[j], 1.);
+        }
+        free(back_reactions);
+    }
 }
 
 struct reb_vec3d rebx_tools_spin_angular_momentum(struct rebx_extras* const rebx){
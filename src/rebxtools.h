@@ -26,6 +26,8 @@
 #ifndef _REBXTOOLS_H
 #define _REBXTOOLS_H
 
+#include <stddef.h>
+
 struct reb_simulation;
 struct rebx_extras;
 struct reb_particle;
@@ -33,7 +35,15 @@ struct reb_orbit;
 struct reb_vec3d;
 struct rebx_force;
 struct rebx_operator;
+struct rebx_memory_usage;
 enum REBX_COORDINATES;
+enum rebx_memory_category;
+
+void* rebx_get_force_scratch(struct rebx_extras* const rebx, struct rebx_force* const force, const size_t size); // Scratch space stored on the force, grown as needed and reused across calls
+void* rebx_get_force_constants(struct rebx_extras* const rebx, struct rebx_force* const force, const size_t size); // Like rebx_get_force_scratch, but for results of update_constants, which must survive update_accelerations
+void rebx_free_force_scratch(struct rebx_extras* const rebx, struct rebx_force* const force); // Frees both scratch and constants
+void rebx_force_scratch_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage); // Adds scratch and constants to usage as workspaces
+void rebx_memory_add(struct rebx_memory_usage* const usage, const enum rebx_memory_category category, const void* const ptr, const size_t size); // Adds one allocation of size bytes to the category, unless ptr is NULL (for workspace_memory functions)
 
 void rebx_com_force(struct reb_simulation* const sim, struct rebx_force* const force, const enum REBX_COORDINATES coordinates, const int back_reactions_inclusive, const char* reference_name, struct reb_vec3d (*calculate_force) (struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* p, struct reb_particle* source), struct reb_particle* const particles, const int N);
 
@@ -41,7 +51,12 @@ void rebx_tools_com_ptm(struct reb_simulation* const sim, struct rebx_operator*
 
 double rebx_Edot(struct reb_particle* const ps, const int N);
 
+double rebx_tools_orbital_period(const double G, const struct reb_particle p, const struct reb_particle primary, int* err); // Period from the energy alone, like reb_orbit.P (negative if hyperbolic). Sets *err for the cases reb_tools_particle_to_orbit_err flags
+
 void rebx_calculate_jacobi_masses(const struct reb_particle* const ps, double* const m_j, const int N);
+struct reb_particle rebx_get_com_without_particle(struct reb_particle com, struct reb_particle p); // Center of mass of com with p removed
+int rebx_get_N_active(const struct reb_simulation* const sim, const int N); // Number of active particles among the first N (REBOUND's N_active, or N if it is -1)
+int rebx_get_N_sources(const struct reb_simulation* const sim, const int N_active, const int N, const int i); // Particles j < N_sources act on particle i in pairwise effects. As in REBOUND's gravity, test particles only act on active particles, and only if testparticle_type is 1
 
 /****************************************
 Effect helper functions
@@ -37,9 +37,30 @@
  *
  * These are wrapper functions to taking steps with several of REBOUND's integrators in order to build custom splitting schemes.
  *
+ * By default the ias15 operator resets IAS15 and ramps up its timestep from a small fraction of dt on every call.
+ * Setting ``ias15_keep_state`` instead keeps IAS15's predictor between calls and starts from the last good timestep,
+ * as long as the number of particles and the sign of dt are unchanged. The predictor is only a starting guess for
+ * IAS15's iterations, so this does not affect the accuracy if other operators modify the particles in between.
+ *
+ * Chaining kepler, jump and interaction operators converts to and from the coordinates in sim.ri_whfast around every one of them.
+ * The composite operator instead executes a whole sequence of these substeps, added with ``rebx_composite_add_substep``
+ * (``rebx.composite_add_substep`` in Python), with a single conversion from inertial coordinates at the start.
+ * It only converts back before interaction substeps (to evaluate the accelerations) and at the end.
+ *
+ * The kick operator updates the accelerations every call. With ``kick_reuse_accelerations`` set, it keeps a copy of the positions,
+ * masses and resulting accelerations, and reuses them if none of the positions or masses changed since, e.g. for the second kick of
+ * one step and the first kick of the next in a kick-drift-kick scheme. This is never done with velocity-dependent forces, and should
+ * not be used with additional forces that depend explicitly on time.
+ *
  * **Effect Parameters**
  *
- * None
+ * ================================ =========== =======================================================
+ * Name (C type)                    Required    Description
+ * ================================ =========== =======================================================
+ * ias15_keep_state (int)           No          If set, the ias15 operator continues from its previous call (see above)
+ * skip_variational (int)           No          If set, the drift and kick operators leave variational particles untouched
+ * kick_reuse_accelerations (int)   No          If set, the kick operator reuses unchanged accelerations (see above)
+ * ================================ =========== =======================================================
  * 
  * **Particle Parameters**
  *
@@ -47,9 +68,43 @@
  *
  */
 
+#include <stdlib.h>
+#include <stdio.h>
 #include <math.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "rebxtools.h"
+
+// IAS15 state kept between calls for ias15_keep_state
+struct rebx_ias15_state{
+    int N;                      // Number of particles in the last call
+    double dt;                  // Last timestep IAS15 proposed that was not cut short to land on the end of the step (0 if none yet)
+};
+
+static void rebx_ias15_free_workspace(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_ias15_state* const state = rebx_get_param(rebx, operator->ap, "ias15_state");
+    free(state);
+    rebx_set_param_pointer(rebx, &operator->ap, "ias15_state", NULL);
+}
+
+static void rebx_ias15_workspace_memory(struct rebx_extras* const rebx, struct rebx_operator* const operator, struct rebx_memory_usage* const usage){
+    const struct rebx_ias15_state* const state = rebx_get_param(rebx, operator->ap, "ias15_state");
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, state, sizeof(*state));
+}
+
+static struct rebx_ias15_state* rebx_ias15_get_state(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_ias15_state* state = rebx_get_param(rebx, operator->ap, "ias15_state");
+    if (state == NULL){
+        state = calloc(1, sizeof(*state));
+        if (state == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &operator->ap, "ias15_state", state);
+        rebx_set_param_pointer(rebx, &operator->ap, "free_workspace", rebx_ias15_free_workspace);
+        rebx_set_param_pointer(rebx, &operator->ap, "workspace_memory", rebx_ias15_workspace_memory);
+    }
+    return state;
+}
 
 // will do IAS with gravity + any additional_forces
 
@@ -58,17 +113,40 @@ void rebx_ias15_step(struct reb_simulation* const sim, struct rebx_operator* con
     const double t_needed = old_t + dt;
     const double old_dt = sim->dt;
     sim->gravity_ignore_terms = 0;
-    reb_integrator_ias15_reset(sim);
+    struct rebx_ias15_state* state = NULL;
+    if (operator != NULL){
+        const int* const keep_state = rebx_get_param(sim->extras, operator->ap, "ias15_keep_state");
+        if (keep_state != NULL && *keep_state){
+            state = rebx_ias15_get_state(sim->extras, operator);
+        }
+    }
     
-    sim->dt = 0.0001*dt; // start with a small timestep.
+    if (state != NULL && state->dt != 0. && state->N == sim->N && (state->dt > 0.) == (dt > 0.)){
+        sim->dt = fabs(state->dt) < fabs(dt) ? state->dt : dt; // continue with the predictor from the previous call
+    }
+    else{
+        reb_integrator_ias15_reset(sim);
+        sim->dt = 0.0001*dt; // start with a small timestep.
+    }
     
+    double dt_good = sim->dt;
+    int shortened = 0;
     while(sim->t < t_needed && fabs(sim->dt/old_dt)>1e-14 ){
         reb_update_acceleration(sim);
         reb_integrator_ias15_part2(sim);
+        if (!shortened){
+            dt_good = sim->dt;
+        }
+        shortened = 0;
         if (sim->t+sim->dt > t_needed){
             sim->dt = t_needed-sim->t;
+            shortened = 1;
         }
     }
+    if (state != NULL){
+        state->N = sim->N;
+        state->dt = dt_good;
+    }
     sim->t = old_t;
     sim->dt = old_dt; // reset in case this is part of a chain of steps
 }
@@ -96,10 +174,21 @@ void rebx_interaction_step(struct reb_simulation* const sim, struct rebx_operato
     reb_integrator_whfast_to_inertial(sim);
 }
 
+// Number of particles the drift and kick operators act on
+static int rebx_steps_N(struct reb_simulation* const sim, struct rebx_operator* const operator){
+    if (operator != NULL){
+        const int* const skip_variational = rebx_get_param(sim->extras, operator->ap, "skip_variational");
+        if (skip_variational != NULL && *skip_variational){
+            return sim->N - sim->N_var;
+        }
+    }
+    return sim->N;
+}
+
 void rebx_drift_step(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
-	const int N = sim->N;
+	const int N = rebx_steps_N(sim, operator);
 	struct reb_particle* restrict const particles = sim->particles;
-#pragma omp parallel for schedule(guided)
+#pragma omp parallel for schedule(static)
 	for (int i=0;i<N;i++){
 		particles[i].x  += dt * particles[i].vx;
 		particles[i].y  += dt * particles[i].vy;
@@ -107,14 +196,205 @@ void rebx_drift_step(struct reb_simulation* const sim, struct rebx_operator* con
 	}
 }
 
+// Positions, masses and accelerations at the last acceleration update, for kick_reuse_accelerations
+struct rebx_kick_state{
+    int N_allocated;
+    int N;                      // 0 if nothing cached
+    int gravity_ignore_terms;
+    double* cache;              // x, y, z, m, ax, ay, az for each particle
+};
+
+static void rebx_kick_free_workspace(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_kick_state* const state = rebx_get_param(rebx, operator->ap, "kick_state");
+    if (state != NULL){
+        free(state->cache);
+    }
+    free(state);
+    rebx_set_param_pointer(rebx, &operator->ap, "kick_state", NULL);
+}
+
+static void rebx_kick_workspace_memory(struct rebx_extras* const rebx, struct rebx_operator* const operator, struct rebx_memory_usage* const usage){
+    const struct rebx_kick_state* const state = rebx_get_param(rebx, operator->ap, "kick_state");
+    if (state != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, state, sizeof(*state));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, state->cache, 7*state->N_allocated*sizeof(*state->cache));
+    }
+}
+
+static struct rebx_kick_state* rebx_kick_get_state(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_kick_state* state = rebx_get_param(rebx, operator->ap, "kick_state");
+    if (state == NULL){
+        state = calloc(1, sizeof(*state));
+        if (state == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &operator->ap, "kick_state", state);
+        rebx_set_param_pointer(rebx, &operator->ap, "free_workspace", rebx_kick_free_workspace);
+        rebx_set_param_pointer(rebx, &operator->ap, "workspace_memory", rebx_kick_workspace_memory);
+    }
+    return state;
+}
+
+// Restores the cached accelerations if nothing they depend on has changed. Returns 1 if they were restored
+static int rebx_kick_restore(struct reb_simulation* const sim, const struct rebx_kick_state* const state){
+    const int N = sim->N;
+    if (state->N != N || state->gravity_ignore_terms != sim->gravity_ignore_terms || sim->force_is_velocity_dependent){
+        return 0;
+    }
+    const struct reb_particle* const particles = sim->particles;
+    const double* const c = state->cache;
+    for (int i=0;i<N;i++){
+        if (c[7*i] != particles[i].x || c[7*i+1] != particles[i].y || c[7*i+2] != particles[i].z || c[7*i+3] != particles[i].m){
+            return 0;
+        }
+    }
+    for (int i=0;i<N;i++){ // other operators may have overwritten the accelerations in between
+        sim->particles[i].ax = c[7*i+4];
+        sim->particles[i].ay = c[7*i+5];
+        sim->particles[i].az = c[7*i+6];
+    }
+    return 1;
+}
+
+static void rebx_kick_save(struct reb_simulation* const sim, struct rebx_kick_state* const state){
+    const int N = sim->N;
+    state->N = 0;
+    if (N > state->N_allocated){
+        double* const cache = realloc(state->cache, 7*N*sizeof(*cache));
+        if (cache == NULL){
+            return;
+        }
+        state->cache = cache;
+        state->N_allocated = N;
+    }
+    const struct reb_particle* const particles = sim->particles;
+    double* const c = state->cache;
+    for (int i=0;i<N;i++){
+        c[7*i] = particles[i].x;
+        c[7*i+1] = particles[i].y;
+        c[7*i+2] = particles[i].z;
+        c[7*i+3] = particles[i].m;
+        c[7*i+4] = particles[i].ax;
+        c[7*i+5] = particles[i].ay;
+        c[7*i+6] = particles[i].az;
+    }
+    state->N = N;
+    state->gravity_ignore_terms = sim->gravity_ignore_terms;
+}
+
 void rebx_kick_step(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
-    reb_update_acceleration(sim);
-	const int N = sim->N;
+    struct rebx_kick_state* state = NULL;
+    if (operator != NULL){
+        const int* const reuse = rebx_get_param(sim->extras, operator->ap, "kick_reuse_accelerations");
+        if (reuse != NULL && *reuse){
+            state = rebx_kick_get_state(sim->extras, operator);
+        }
+    }
+    if (state == NULL || !rebx_kick_restore(sim, state)){
+        reb_update_acceleration(sim);
+        if (state != NULL){
+            rebx_kick_save(sim, state);
+        }
+    }
+	const int N = rebx_steps_N(sim, operator);
 	struct reb_particle* restrict const particles = sim->particles;
-#pragma omp parallel for schedule(guided)
+#pragma omp parallel for schedule(static)
 	for (int i=0;i<N;i++){
 		particles[i].vx += dt * particles[i].ax;
 		particles[i].vy += dt * particles[i].ay;
 		particles[i].vz += dt * particles[i].az;
 	}
 }
+
+// Sequence of substeps for the composite operator
+struct rebx_composite_substep{
+    enum rebx_substep_type type;
+    double dt_fraction;
+};
+
+struct rebx_composite{
+    int N_substeps;
+    int N_allocated;
+    struct rebx_composite_substep* substeps;
+};
+
+static void rebx_composite_free_workspace(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_composite* const composite = rebx_get_param(rebx, operator->ap, "composite_substeps");
+    if (composite != NULL){
+        free(composite->substeps);
+    }
+    free(composite);
+    rebx_set_param_pointer(rebx, &operator->ap, "composite_substeps", NULL);
+}
+
+static void rebx_composite_workspace_memory(struct rebx_extras* const rebx, struct rebx_operator* const operator, struct rebx_memory_usage* const usage){
+    const struct rebx_composite* const composite = rebx_get_param(rebx, operator->ap, "composite_substeps");
+    if (composite != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, composite, sizeof(*composite));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, composite->substeps, composite->N_allocated*sizeof(*composite->substeps));
+    }
+}
+
+int rebx_composite_add_substep(struct rebx_extras* const rebx, struct rebx_operator* const operator, const enum rebx_substep_type type, const double dt_fraction){
+    if (type != REBX_SUBSTEP_KEPLER && type != REBX_SUBSTEP_JUMP && type != REBX_SUBSTEP_INTERACTION){
+        char str[300];
+        sprintf(str, "REBOUNDx Error: Substep type %d passed to rebx_composite_add_substep not recognized.\n", type);
+        rebx_error(rebx, str);
+        return 0;
+    }
+    struct rebx_composite* composite = rebx_get_param(rebx, operator->ap, "composite_substeps");
+    if (composite == NULL){
+        composite = calloc(1, sizeof(*composite));
+        if (composite == NULL){
+            return 0;
+        }
+        rebx_set_param_pointer(rebx, &operator->ap, "composite_substeps", composite);
+        rebx_set_param_pointer(rebx, &operator->ap, "free_workspace", rebx_composite_free_workspace);
+        rebx_set_param_pointer(rebx, &operator->ap, "workspace_memory", rebx_composite_workspace_memory);
+    }
+    if (composite->N_substeps == composite->N_allocated){
+        const int N_new = composite->N_allocated ? 2*composite->N_allocated : 4;
+        struct rebx_composite_substep* const substeps = realloc(composite->substeps, N_new*sizeof(*substeps));
+        if (substeps == NULL){
+            return 0;
+        }
+        composite->substeps = substeps;
+        composite->N_allocated = N_new;
+    }
+    composite->substeps[composite->N_substeps] = (struct rebx_composite_substep){.type = type, .dt_fraction = dt_fraction};
+    composite->N_substeps++;
+    return 1;
+}
+
+void rebx_composite_step(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
+    struct rebx_extras* const rebx = sim->extras;
+    const struct rebx_composite* const composite = rebx_get_param(rebx, operator->ap, "composite_substeps");
+    if (composite == NULL || composite->N_substeps == 0){
+        reb_error(sim, "REBOUNDx Error: No substeps added to composite operator. See rebx_composite_add_substep.\n");
+        return;
+    }
+    reb_integrator_whfast_init(sim);
+    reb_integrator_whfast_from_inertial(sim);
+    int synchronized = 1; // whether sim->particles are up to date with the WHFast coordinates
+    for(int j=0; j<composite->N_substeps; j++){
+        const double h = composite->substeps[j].dt_fraction*dt;
+        switch(composite->substeps[j].type){
+            case REBX_SUBSTEP_KEPLER:
+                reb_whfast_kepler_step(sim, h);
+                reb_whfast_com_step(sim, h);
+                break;
+            case REBX_SUBSTEP_JUMP:
+                reb_whfast_jump_step(sim, h);
+                break;
+            case REBX_SUBSTEP_INTERACTION:
+                if (!synchronized){
+                    reb_integrator_whfast_to_inertial(sim);
+                }
+                reb_update_acceleration(sim);
+                reb_whfast_interaction_step(sim, h);
+                break;
+        }
+        synchronized = 0;
+    }
+    reb_integrator_whfast_to_inertial(sim);
+}
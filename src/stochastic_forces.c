@@ -45,6 +45,8 @@
  *
  * All particles which have the field kappa set, will experience stochastic forces.
  * The particle with index 0 cannot experience stochastic forces.
+ * Random numbers are drawn from a counter based generator keyed on the simulation's rand_seed, each particle's hash
+ * (or its index if no hash is set) and the current time, so results don't depend on the order particles are evaluated in.
  *
  * ============================ =========== ==================================================================================
  * Field (C type)               Required    Description
@@ -59,76 +61,264 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include "reboundx.h"
+#include "rebxtools.h"
 
 
-static void rebx_random_normal2(struct reb_simulation* r, double* n0, double* n1){
-	double v1,v2,rsq=1.;
-	while(rsq>=1. || rsq<1.0e-12){
-		v1=2.*((double)rand_r(&(r->rand_seed)))/((double)(RAND_MAX))-1.0;
-		v2=2.*((double)rand_r(&(r->rand_seed)))/((double)(RAND_MAX))-1.0;
-		rsq=v1*v1+v2*v2;
-	}
-	*n0 = v1*sqrt(-2.*log(rsq)/rsq);
-	*n1 = v2*sqrt(-2.*log(rsq)/rsq);
+// Philox4x32-10 counter based generator (Salmon et al. 2011). Output only depends on the counter and key,
+// so draws don't depend on the order in which particles are evaluated.
+static inline uint32_t rebx_mulhilo32(const uint32_t a, const uint32_t b, uint32_t* hi){
+    const uint64_t product = (uint64_t)a*(uint64_t)b;
+    *hi = (uint32_t)(product >> 32);
+    return (uint32_t)product;
 }
 
+static void rebx_philox4x32(uint32_t ctr[4], uint32_t key[2]){
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int round=0; round<10; round++){
+        uint32_t hi0, hi1;
+        const uint32_t lo0 = rebx_mulhilo32(0xD2511F53, ctr[0], &hi0);
+        const uint32_t lo1 = rebx_mulhilo32(0xCD9E8D57, ctr[2], &hi1);
+        ctr[0] = hi1^ctr[1]^k0;
+        ctr[1] = lo1;
+        ctr[2] = hi0^ctr[3]^k1;
+        ctr[3] = lo0;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+}
+
+// Stream identifiers so each random variable a particle needs gets independent draws
+enum REBX_STOCHASTIC_STREAM{
+    REBX_STOCHASTIC_STREAM_RPHI,
+    REBX_STOCHASTIC_STREAM_X,
+    REBX_STOCHASTIC_STREAM_Y,
+    REBX_STOCHASTIC_STREAM_Z,
+};
+
+// Two independent standard normals. Keyed on the simulation's seed and the particle's hash (or index if no hash is set),
+// with the current time, step and stream as the counter.
+static void rebx_random_normal2(struct reb_simulation* const sim, const struct reb_particle* const p, const int index, const enum REBX_STOCHASTIC_STREAM stream, double* n0, double* n1){
+    uint64_t tbits;
+    memcpy(&tbits, &sim->t, sizeof(tbits));
+    uint32_t key[2] = {sim->rand_seed, p->hash ? p->hash : (uint32_t)index};
+    uint32_t ctr[4] = {(uint32_t)tbits, (uint32_t)(tbits >> 32), (uint32_t)sim->steps_done, (uint32_t)stream | (p->hash ? 0 : 0x80000000u)};
+    rebx_philox4x32(ctr, key);
+
+    // 53 bit uniforms in the open interval (0,1) so the log below is always finite
+    const double u1 = ((double)((((uint64_t)ctr[0] << 32) | ctr[1]) >> 11) + 0.5)/9007199254740992.;
+    const double u2 = ((double)((((uint64_t)ctr[2] << 32) | ctr[3]) >> 11) + 0.5)/9007199254740992.;
+
+    // Box-Muller
+    const double rad = sqrt(-2.*log(u1));
+    *n0 = rad*cos(2.*M_PI*u2);
+    *n1 = rad*sin(2.*M_PI*u2);
+}
+
+
+// Quantities that only change between timesteps, cached so repeated force evaluations within a step (e.g. with IAS15)
+// skip the orbit calculation, exponentials and param lookups.
+struct rebx_stochastic_forces_entry{
+    int index;
+    double* kappa;                  // NULL if the particle has no kappa set (or is particle 0)
+    double* force_r;
+    double* force_phi;
+    double prefac;                  // exp(-dt/tau)
+    double std;
+    double* kappa_xyz[3];           // NULL for components without kappa_x, kappa_y, kappa_z set
+    double* force_xyz[3];
+    double prefac_xyz[3];
+    double std_xyz[3];
+};
+
+struct rebx_stochastic_forces_cache{
+    int valid;
+    int N;                          // Number of particles the cache was built for
+    unsigned long long steps_done;  // Step and dt the cache was built for
+    double dt_last_done;
+    int N_allocated;
+    int N_entries;
+    struct rebx_stochastic_forces_entry* entries;
+};
+
+static void rebx_stochastic_forces_free_workspace(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_stochastic_forces_cache* cache = rebx_get_param(rebx, force->ap, "stochastic_forces_cache");
+    if (cache == NULL){
+        return;
+    }
+    free(cache->entries);
+    free(cache);
+    rebx_set_param_pointer(rebx, &force->ap, "stochastic_forces_cache", NULL);
+}
 
-void rebx_stochastic_forces(struct reb_simulation* const sim, struct rebx_force* const radiation_forces, struct reb_particle* const particles, const int N){
+static void rebx_stochastic_forces_workspace_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const struct rebx_stochastic_forces_cache* const cache = rebx_get_param(rebx, force->ap, "stochastic_forces_cache");
+    if (cache == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cache, sizeof(*cache));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cache->entries, cache->N_allocated*sizeof(*cache->entries));
+}
+
+static double* rebx_stochastic_forces_get_or_add(struct rebx_extras* const rebx, struct reb_particle* const p, const char* const name){
+    double* value = rebx_get_param(rebx, p->ap, name);
+    if (value == NULL) { // First run?
+        rebx_set_param_double(rebx, (struct rebx_node**)&p->ap, name, 0.);
+        value = rebx_get_param(rebx, p->ap, name);
+    }
+    return value;
+}
+
+// Returns 0 (after raising an error) if the cache could not be built
+static int rebx_stochastic_forces_build_cache(struct reb_simulation* const sim, struct rebx_stochastic_forces_cache* const cache, struct reb_particle* const particles, const int N){
     struct rebx_extras* const rebx = sim->extras;
+    static const char* const kappa_names[3] = {"kappa_x", "kappa_y", "kappa_z"};
+    static const char* const tau_names[3] = {"tau_kappa_x", "tau_kappa_y", "tau_kappa_z"};
+    static const char* const force_names[3] = {"stochastic_force_x", "stochastic_force_y", "stochastic_force_z"};
+    const double dt = sim->dt_last_done;
+
+    cache->valid = 0;
+    if (N > cache->N_allocated){
+        struct rebx_stochastic_forces_entry* entries = realloc(cache->entries, N*sizeof(*entries));
+        if (entries == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for stochastic_forces.\n");
+            return 0;
+        }
+        cache->entries = entries;
+        cache->N_allocated = N;
+    }
+    cache->N_entries = 0;
+
     struct reb_particle com = particles[0];
-    
     for (int i=0; i<N; i++){
-        double* kappa = rebx_get_param(rebx, particles[i].ap, "kappa");
-        if (i>0 && kappa != NULL){
-            double* stochastic_force_r = rebx_get_param(rebx, particles[i].ap, "stochastic_force_r");
-            if (stochastic_force_r == NULL) { // First run?
-                rebx_set_param_double(rebx, (struct rebx_node**)&particles[i].ap, "stochastic_force_r", 0.);
-                stochastic_force_r = rebx_get_param(rebx, particles[i].ap, "stochastic_force_r");
-            }
-            double* stochastic_force_phi = rebx_get_param(rebx, particles[i].ap, "stochastic_force_phi");
-            if (stochastic_force_phi == NULL) { // First run?
-                rebx_set_param_double(rebx, (struct rebx_node**)&particles[i].ap, "stochastic_force_phi", 0.);
-                stochastic_force_phi = rebx_get_param(rebx, particles[i].ap, "stochastic_force_phi");
-            }
-
-            const struct reb_particle p = particles[i];
+        struct rebx_stochastic_forces_entry* const e = &cache->entries[cache->N_entries];
+        int has_kappa = 0;
+        e->index = i;
+        e->kappa = rebx_get_param(rebx, particles[i].ap, "kappa");
+        if (i>0 && e->kappa != NULL){
+            e->force_r = rebx_stochastic_forces_get_or_add(rebx, &particles[i], "stochastic_force_r");
+            e->force_phi = rebx_stochastic_forces_get_or_add(rebx, &particles[i], "stochastic_force_phi");
 
             // Get auto-correlation time
+            // Only the period is needed, which doesn't need the angles of a full orbit calculation
             int err=0;
-            struct reb_orbit o = reb_tools_particle_to_orbit_err(sim->G, particles[i], com, &err);
+            double tau = rebx_tools_orbital_period(sim->G, particles[i], com, &err); // Default is current orbital period.
             if (err){
                 reb_error(sim, "An error occured during the orbit calculation in rebx_stochastic_forces.\n");
-                return;
+                return 0;
             }
-            double tau = o.P; // Default is current orbital period.
             
             double* tau_kappa = rebx_get_param(rebx, particles[i].ap, "tau_kappa");
             if (tau_kappa != NULL){
                 tau *= *tau_kappa;
             }
 
-            double dt = sim->dt_last_done;
-            
-            double prefac = exp(-dt/tau);
+            e->prefac = exp(-dt/tau);
+            double variance = 1.- e->prefac*e->prefac;
+            if (variance <0.){
+                reb_error(sim, "Timestep is larger than the correlation time for stochastic forces.\n");
+                return 0;
+            }
+            e->std = sqrt(variance);
+            has_kappa = 1;
 
-            // Decay
-            *stochastic_force_r = (*stochastic_force_r) * prefac;
-            *stochastic_force_phi = (*stochastic_force_phi) * prefac;
+		    com = reb_get_com_of_pair(com, particles[i]);
+        }
+        else{
+            e->kappa = NULL;
+        }
+        for (int k=0; k<3; k++){
+            e->kappa_xyz[k] = rebx_get_param(rebx, particles[i].ap, kappa_names[k]);
+            if (e->kappa_xyz[k] == NULL){
+                continue;
+            }
+            e->force_xyz[k] = rebx_stochastic_forces_get_or_add(rebx, &particles[i], force_names[k]);
+            
+            double* tau_kappa_xyz = rebx_get_param(rebx, particles[i].ap, tau_names[k]);
+            if (tau_kappa_xyz == NULL){
+                char str[300];
+                sprintf(str, "Need to set %s to enable stochastic forces.\n", tau_names[k]);
+                reb_error(sim, str);
+                return 0;
+            }
 
-            double variance = 1.- prefac*prefac;
+            e->prefac_xyz[k] = exp(-dt/ (*tau_kappa_xyz));
+            double variance = 1.- e->prefac_xyz[k]*e->prefac_xyz[k];
             if (variance <0.){
                 reb_error(sim, "Timestep is larger than the correlation time for stochastic forces.\n");
-                return;
+                return 0;
             }
-            double std = sqrt(variance);
+            e->std_xyz[k] = (*e->kappa_xyz[k])*sqrt(variance);
+            has_kappa = 1;
+        }
+        if (has_kappa){
+            cache->N_entries++;
+        }
+    }
+
+    cache->N = N;
+    cache->steps_done = sim->steps_done;
+    cache->dt_last_done = sim->dt_last_done;
+    cache->valid = 1;
+    return 1;
+}
+
+// Decay and excitation of one cartesian component. Returns the updated stochastic force
+static double rebx_stochastic_forces_cartesian(struct reb_simulation* const sim, const struct rebx_stochastic_forces_entry* const e, struct reb_particle* const particles, const int k){
+    double* const stochastic_force = e->force_xyz[k];
+
+    // Decay
+    *stochastic_force = (*stochastic_force) * e->prefac_xyz[k];
+
+    // Excitation
+    double n0, n1;
+    rebx_random_normal2(sim, &particles[e->index], e->index, REBX_STOCHASTIC_STREAM_X + k, &n0, &n1);
+    *stochastic_force = (*stochastic_force) + n0*e->std_xyz[k];
+    return *stochastic_force;
+}
+
+void rebx_stochastic_forces(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
+    struct rebx_extras* const rebx = sim->extras;
+    struct rebx_stochastic_forces_cache* cache = rebx_get_param(rebx, force->ap, "stochastic_forces_cache");
+    if (cache == NULL){
+        cache = calloc(1, sizeof(*cache));
+        if (cache == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for stochastic_forces.\n");
+            return;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, "stochastic_forces_cache", cache);
+        rebx_set_param_pointer(rebx, &force->ap, "free_workspace", rebx_stochastic_forces_free_workspace);
+        rebx_set_param_pointer(rebx, &force->ap, "workspace_memory", rebx_stochastic_forces_workspace_memory);
+    }
+    // Rebuild once per step, or if the timestep or the particles changed
+    if (!cache->valid || cache->steps_done != sim->steps_done || cache->dt_last_done != sim->dt_last_done || cache->N != N){
+        if (!rebx_stochastic_forces_build_cache(sim, cache, particles, N)){
+            return;
+        }
+    }
+
+    struct reb_particle com = particles[0];
+    for (int j=0; j<cache->N_entries; j++){
+        const struct rebx_stochastic_forces_entry* const e = &cache->entries[j];
+        const int i = e->index;
+        if (e->kappa != NULL){
+            double* const stochastic_force_r = e->force_r;
+            double* const stochastic_force_phi = e->force_phi;
+            const struct reb_particle p = particles[i];
+
+            // Decay
+            *stochastic_force_r = (*stochastic_force_r) * e->prefac;
+            *stochastic_force_phi = (*stochastic_force_phi) * e->prefac;
 
             double n0, n1;
-            rebx_random_normal2(sim, &n0, &n1);
+            rebx_random_normal2(sim, &particles[i], i, REBX_STOCHASTIC_STREAM_RPHI, &n0, &n1);
             
             // Excitation
-            *stochastic_force_r = (*stochastic_force_r) + n0*std;
-            *stochastic_force_phi = (*stochastic_force_phi) + n1*std;
+            *stochastic_force_r = (*stochastic_force_r) + n0*e->std;
+            *stochastic_force_phi = (*stochastic_force_phi) + n1*e->std;
 
             const double dx = p.x - com.x; 
             const double dy = p.y - com.y;
@@ -140,113 +330,21 @@ void rebx_stochastic_forces(struct reb_simulation* const sim, struct rebx_force*
             const double dvz = p.vz - com.vz;
             const double dv = sqrt(dvx*dvx + dvy*dvy + dvz*dvz);
 
-            const double force_prefac = (*kappa) *sim->G/(dr*dr)*com.m;
+            const double force_prefac = (*e->kappa) *sim->G/(dr*dr)*com.m;
             particles[i].ax += force_prefac*(*stochastic_force_r*dx/dr + *stochastic_force_phi*dvx/dv);
             particles[i].ay += force_prefac*(*stochastic_force_r*dy/dr + *stochastic_force_phi*dvy/dv);
             particles[i].az += force_prefac*(*stochastic_force_r*dz/dr + *stochastic_force_phi*dvz/dv);
 
-
 		    com = reb_get_com_of_pair(com, p);
         }
-        double* kappa_x = rebx_get_param(rebx, particles[i].ap, "kappa_x");
-        if (kappa_x != NULL){
-            double* stochastic_force_x = rebx_get_param(rebx, particles[i].ap, "stochastic_force_x");
-            if (stochastic_force_x == NULL) { // First run?
-                rebx_set_param_double(rebx, (struct rebx_node**)&particles[i].ap, "stochastic_force_x", 0.);
-                stochastic_force_x = rebx_get_param(rebx, particles[i].ap, "stochastic_force_x");
-            }
-            
-            double* tau_kappa_x = rebx_get_param(rebx, particles[i].ap, "tau_kappa_x");
-            if (tau_kappa_x == NULL){
-                reb_error(sim, "Need to set tau_kappa_x to enable stochastic forces.\n");
-                return;
-            }
-
-            double dt = sim->dt_last_done;
-            double prefac = exp(-dt/ (*tau_kappa_x));
-
-            // Decay
-            *stochastic_force_x = (*stochastic_force_x) * prefac;
-
-            // Excitation
-            double variance = 1.- prefac*prefac;
-            if (variance <0.){
-                reb_error(sim, "Timestep is larger than the correlation time for stochastic forces.\n");
-                return;
-            }
-            double std = (*kappa_x)*sqrt(variance);
-            double n0, n1;
-            rebx_random_normal2(sim, &n0, &n1);
-            *stochastic_force_x = (*stochastic_force_x) + n0*std;
-            
-            particles[i].ax += *stochastic_force_x;
+        if (e->kappa_xyz[0] != NULL){
+            particles[i].ax += rebx_stochastic_forces_cartesian(sim, e, particles, 0);
         }
-        double* kappa_y = rebx_get_param(rebx, particles[i].ap, "kappa_y");
-        if (kappa_y != NULL){
-            double* stochastic_force_y = rebx_get_param(rebx, particles[i].ap, "stochastic_force_y");
-            if (stochastic_force_y == NULL) { // First run?
-                rebx_set_param_double(rebx, (struct rebx_node**)&particles[i].ap, "stochastic_force_y", 0.);
-                stochastic_force_y = rebx_get_param(rebx, particles[i].ap, "stochastic_force_y");
-            }
-            
-            double* tau_kappa_y = rebx_get_param(rebx, particles[i].ap, "tau_kappa_y");
-            if (tau_kappa_y == NULL){
-                reb_error(sim, "Need to set tau_kappa_y to enable stochastic forces.\n");
-                return;
-            }
-
-            double dt = sim->dt_last_done;
-            double prefac = exp(-dt/ (*tau_kappa_y));
-
-            // Decay
-            *stochastic_force_y = (*stochastic_force_y) * prefac;
-
-            // Excitation
-            double variance = 1.- prefac*prefac;
-            if (variance <0.){
-                reb_error(sim, "Timestep is larger than the correlation time for stochastic forces.\n");
-                return;
-            }
-            double std = (*kappa_y)*sqrt(variance);
-            double n0, n1;
-            rebx_random_normal2(sim, &n0, &n1);
-            *stochastic_force_y = (*stochastic_force_y) + n0*std;
-            
-            particles[i].ay += *stochastic_force_y;
+        if (e->kappa_xyz[1] != NULL){
+            particles[i].ay += rebx_stochastic_forces_cartesian(sim, e, particles, 1);
         }
-        double* kappa_z = rebx_get_param(rebx, particles[i].ap, "kappa_z");
-        if (kappa_z != NULL){
-            double* stochastic_force_z = rebx_get_param(rebx, particles[i].ap, "stochastic_force_z");
-            if (stochastic_force_z == NULL) { // First run?
-                rebx_set_param_double(rebx, (struct rebx_node**)&particles[i].ap, "stochastic_force_z", 0.);
-                stochastic_force_z = rebx_get_param(rebx, particles[i].ap, "stochastic_force_z");
-            }
-            
-            double* tau_kappa_z = rebx_get_param(rebx, particles[i].ap, "tau_kappa_z");
-            if (tau_kappa_z == NULL){
-                reb_error(sim, "Need to set tau_kappa_z to enable stochastic forces.\n");
-                return;
-            }
-
-            double dt = sim->dt_last_done;
-            double prefac = exp(-dt/ (*tau_kappa_z));
-
-            // Decay
-            *stochastic_force_z = (*stochastic_force_z) * prefac;
-
-            // Excitation
-            double variance = 1.- prefac*prefac;
-            if (variance <0.){
-                reb_error(sim, "Timestep is larger than the correlation time for stochastic forces.\n");
-                return;
-            }
-            double std = (*kappa_z)*sqrt(variance);
-            double n0, n1;
-            rebx_random_normal2(sim, &n0, &n1);
-            *stochastic_force_z = (*stochastic_force_z) + n0*std;
-            
-            particles[i].az += *stochastic_force_z;
+        if (e->kappa_xyz[2] != NULL){
+            particles[i].az += rebx_stochastic_forces_cartesian(sim, e, particles, 2);
         }
     }
 }
-
@@ -63,7 +63,8 @@
 #include <float.h>
 #include "reboundx.h"
 
-static void rebx_calculate_tides(struct reb_particle* source, struct reb_particle* target, const double G, const double k2, const double tau, const double Omega){
+// g holds separations relative to particles[0]. i is the index of the body that isn't particles[0], and sign is 1 if target is particles[i], or -1 if target is particles[0]
+static void rebx_calculate_tides(struct reb_particle* source, struct reb_particle* target, const struct rebx_geometry* const g, const int i, const double sign, const double G, const double k2, const double tau, const double Omega){
     const double ms = source->m;
     const double mt = target->m;
     const double Rt = target->r;
@@ -71,17 +72,17 @@ static void rebx_calculate_tides(struct reb_particle* source, struct reb_particl
     const double mratio = ms/mt; // have already checked for 0 and inf
     const double fac = mratio*k2*Rt*Rt*Rt*Rt*Rt;
     
-    const double dx = target->x - source->x;
-    const double dy = target->y - source->y;
-    const double dz = target->z - source->z;
-    const double dr2 = dx*dx + dy*dy + dz*dz;
+    const double dx = sign*g->dx[i];
+    const double dy = sign*g->dy[i];
+    const double dz = sign*g->dz[i];
+    const double dr2 = g->r2[i];
     const double prefac = -3*G/(dr2*dr2*dr2*dr2)*fac;
     double rfac = prefac;
 
     if (tau != 0){
-        const double dvx = target->vx - source->vx;
-        const double dvy = target->vy - source->vy;
-        const double dvz = target->vz - source->vz;
+        const double dvx = sign*g->dvx[i];
+        const double dvy = sign*g->dvy[i];
+        const double dvz = sign*g->dvz[i];
 
         rfac *= (1. + 3.*tau/dr2*(dx*dvx + dy*dvy + dz*dvz));
         const double thetafac = -prefac*tau;
@@ -125,6 +126,10 @@ void rebx_tides_constant_time_lag(struct reb_simulation* const sim, struct rebx_
     if (target->m == 0){                        // nothing makes sense if primary has no mass
         return;
     }
+    const struct rebx_geometry* const g = rebx_get_geometry(rebx, particles, N, 0);
+    if (g == NULL){
+        return;
+    }
     double* k2 = rebx_get_param(rebx, target->ap, "tctl_k2");
     if (k2 != NULL && target->r != 0){  // tides on star only nonzero if k2 and finite size are set
         // We don't require time lag tau to be set. Might just want conservative piece of tidal potential
@@ -140,32 +145,208 @@ void rebx_tides_constant_time_lag(struct reb_simulation* const sim, struct rebx_
         }
         for (int i=1; i<N; i++){
             struct reb_particle* source = &particles[i]; // planet raising the tides on the star
-            if (source->m == 0){
+            if (source->m == 0 || (tides->skip != NULL && tides->skip[i])){
                 continue;
             }
-            rebx_calculate_tides(source, target, G, *k2, tau, Omega);
+            rebx_calculate_tides(source, target, g, i, -1., G, *k2, tau, Omega);
         }
     }
 
     // Calculate tides raised on the planets
+    const struct rebx_param_list* const k2s = rebx_get_param_list(rebx, particles, N, rebx_intern(rebx, "tctl_k2"));
+    if (k2s == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_constant_time_lag.\n");
+        return;
+    }
+    const int id_tau = rebx_intern(rebx, "tctl_tau");
+    const int id_Omega = rebx_intern(rebx, "OmegaMag");
     struct reb_particle* source = &particles[0]; // Source is always the star (no planet-planet tides)
-    for (int i=1; i<N; i++){
+    for (int k=0; k<k2s->N_particles; k++){
+        const int i = k2s->index[k];
         struct reb_particle* target = &particles[i]; 
-        double* k2 = rebx_get_param(rebx, target->ap, "tctl_k2");
-        if (k2 == NULL || target->r == 0 || target->m == 0){
+        const double* const k2 = k2s->values[k];
+        if (i == 0 || target->r == 0 || target->m == 0 || (tides->skip != NULL && tides->skip[i])){
             continue;
         }
         double tau = 0.;
         double Omega = 0.;
-        double* tauptr = rebx_get_param(rebx, target->ap, "tctl_tau");
+        const double* const tauptr = rebx_get_param_by_id(rebx, target->ap, id_tau);
         if (tauptr){
             tau = *tauptr;
-            double* Omegaptr = rebx_get_param(rebx, target->ap, "OmegaMag");
+            const double* const Omegaptr = rebx_get_param_by_id(rebx, target->ap, id_Omega);
             if (Omegaptr){
                 Omega = *Omegaptr;
             }
         }
-        rebx_calculate_tides(source, target, G, *k2, tau, Omega);
+        rebx_calculate_tides(source, target, g, i, 1., G, *k2, tau, Omega);
+    }
+}
+
+// Dense lanes of the batch with the params of each tidal target, and on, which is 1 if tides are raised on the particle in that simulation
+struct rebx_tides_batch_lanes{
+    double* k2;
+    double* tau;
+    double* Omega;
+    double* on;
+};
+
+// Same as rebx_calculate_tides for the pair of particles 0 and i in all simulations of the batch. Params are taken from the lanes of target_index
+static void rebx_calculate_tides_batch(struct rebx_batch* const batch, const struct rebx_tides_batch_lanes lanes, const int i, const int target_index, const int source_index, const double sign){
+    const int K = batch->K;
+    const double* restrict const G = batch->G;
+    const double* restrict const k2 = lanes.k2 + target_index*K;
+    const double* restrict const tau = lanes.tau + target_index*K;
+    const double* restrict const Omega = lanes.Omega + target_index*K;
+    const double* restrict const on = lanes.on + target_index*K;
+    const double* restrict const ms = batch->m + source_index*K;
+    const double* restrict const mt = batch->m + target_index*K;
+    const double* restrict const Rt = batch->r + target_index*K;
+    // Rows of particles[0] and particles[i] never overlap, so the loop over simulations vectorizes
+    const double* restrict const x0 = batch->x;
+    const double* restrict const y0 = batch->y;
+    const double* restrict const z0 = batch->z;
+    const double* restrict const vx0 = batch->vx;
+    const double* restrict const vy0 = batch->vy;
+    const double* restrict const vz0 = batch->vz;
+    const double* restrict const x = batch->x + i*K;
+    const double* restrict const y = batch->y + i*K;
+    const double* restrict const z = batch->z + i*K;
+    const double* restrict const vx = batch->vx + i*K;
+    const double* restrict const vy = batch->vy + i*K;
+    const double* restrict const vz = batch->vz + i*K;
+    double* restrict const axt = batch->ax + target_index*K;
+    double* restrict const ayt = batch->ay + target_index*K;
+    double* restrict const azt = batch->az + target_index*K;
+    double* restrict const axs = batch->ax + source_index*K;
+    double* restrict const ays = batch->ay + source_index*K;
+    double* restrict const azs = batch->az + source_index*K;
+    // Masked simulations get k2 = 0 and a unit target mass, so all their increments are exactly zero. Masking by multiplication keeps the loop free of branches
+#pragma omp simd
+    for (int k=0; k<K; k++){
+        const double ms_k = ms[k];
+        const double active = ((on[k] != 0.) & (ms_k != 0.)) ? 1. : 0.;
+        const double k2_k = active*k2[k];
+        const double tau_k = active*tau[k];
+        const double mt_k = active*mt[k] + (1. - active);
+
+        const double mratio = ms_k/mt_k;
+        const double fac = mratio*k2_k*Rt[k]*Rt[k]*Rt[k]*Rt[k]*Rt[k];
+
+        const double gdx = x[k] - x0[k];
+        const double gdy = y[k] - y0[k];
+        const double gdz = z[k] - z0[k];
+        const double dx = sign*gdx;
+        const double dy = sign*gdy;
+        const double dz = sign*gdz;
+        const double dr2 = gdx*gdx + gdy*gdy + gdz*gdz;
+        const double prefac = -3*G[k]/(dr2*dr2*dr2*dr2)*fac;
+
+        const double dvx = sign*(vx[k] - vx0[k]);
+        const double dvy = sign*(vy[k] - vy0[k]);
+        const double dvz = sign*(vz[k] - vz0[k]);
+
+        // With tau = 0, rfac is prefac and the time lag terms vanish, like in rebx_calculate_tides
+        const double rfac = prefac*(1. + 3.*tau_k/dr2*(dx*dvx + dy*dvy + dz*dvz));
+        const double thetafac = -prefac*tau_k;
+
+        const double hx = dy*dvz - dz*dvy;
+        const double hy = dz*dvx - dx*dvz;
+        const double hz = dx*dvy - dy*dvx;
+
+        const double thetadotcrossrx = (hy*dz - hz*dy)/dr2;
+        const double thetadotcrossry = (hz*dx - hx*dz)/dr2;
+        const double thetadotcrossrz = (hx*dy - hy*dx)/dr2;
+
+        const double Omegacrossrx = -Omega[k]*dy;
+        const double Omegacrossry = Omega[k]*dx;
+        const double Omegacrossrz = 0.;
+
+        // The time lag terms are added before the conservative ones, like in rebx_calculate_tides
+        axt[k] += thetafac*ms_k*(Omegacrossrx-thetadotcrossrx);
+        ayt[k] += thetafac*ms_k*(Omegacrossry-thetadotcrossry);
+        azt[k] += thetafac*ms_k*(Omegacrossrz-thetadotcrossrz);
+        axs[k] -= thetafac*mt_k*(Omegacrossrx-thetadotcrossrx);
+        ays[k] -= thetafac*mt_k*(Omegacrossry-thetadotcrossry);
+        azs[k] -= thetafac*mt_k*(Omegacrossrz-thetadotcrossrz);
+
+        axt[k] += rfac*ms_k*dx;
+        ayt[k] += rfac*ms_k*dy;
+        azt[k] += rfac*ms_k*dz;
+        axs[k] -= rfac*mt_k*dx;
+        ays[k] -= rfac*mt_k*dy;
+        azs[k] -= rfac*mt_k*dz;
+    }
+}
+
+// Same as rebx_tides_constant_time_lag on each simulation of the batch, with the loop over simulations innermost
+void rebx_tides_constant_time_lag_batch(struct rebx_batch* const batch, const int j){
+    const int K = batch->K;
+    const int N = batch->N;
+    const int NK = N*K;
+    double* const block = rebx_batch_scratch(batch, 4*NK);
+    if (block == NULL){
+        return;
+    }
+    const struct rebx_tides_batch_lanes lanes = {.k2 = block, .tau = block + NK, .Omega = block + 2*NK, .on = block + 3*NK};
+    for (int l=0; l<4*NK; l++){
+        block[l] = 0.;
+    }
+    // default params have the same id in all instances
+    struct rebx_extras* const rebx0 = batch->sims[0]->extras;
+    const int id_k2 = rebx_intern(rebx0, "tctl_k2");
+    const int id_tau = rebx_intern(rebx0, "tctl_tau");
+    const int id_Omega = rebx_intern(rebx0, "OmegaMag");
+    int any_star = 0;
+    int any_planet = 0;
+    for (int k=0; k<K; k++){
+        struct reb_simulation* const sim = batch->sims[k];
+        struct rebx_extras* const rebx = sim->extras;
+        struct reb_particle* const particles = sim->particles;
+        if (particles[0].m == 0){ // nothing makes sense if primary has no mass
+            continue;
+        }
+        const struct rebx_param_list* const k2s = rebx_get_param_list(rebx, particles, N, id_k2);
+        if (k2s == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_constant_time_lag.\n");
+            continue;
+        }
+        for (int s=0; s<k2s->N_particles; s++){
+            const int i = k2s->index[s];
+            const struct reb_particle* const target = &particles[i];
+            if (target->r == 0 || (i != 0 && target->m == 0)){
+                continue;
+            }
+            const double* const k2 = k2s->values[s];
+            const int l = REBX_LANE(batch, i, k);
+            lanes.k2[l] = *k2;
+            const double* const tauptr = rebx_get_param_by_id(rebx, target->ap, id_tau);
+            if (tauptr){
+                lanes.tau[l] = *tauptr;
+                const double* const Omegaptr = rebx_get_param_by_id(rebx, target->ap, id_Omega);
+                if (Omegaptr){
+                    lanes.Omega[l] = *Omegaptr;
+                }
+            }
+            lanes.on[l] = 1.;
+            if (i == 0){
+                any_star = 1;
+            }
+            else{
+                any_planet = 1;
+            }
+        }
+    }
+
+    // Tides raised on the star by each planet, then tides raised on each planet by the star
+    if (any_star){
+        for (int i=1; i<N; i++){
+            rebx_calculate_tides_batch(batch, lanes, i, 0, i, -1.);
+        }
+    }
+    if (any_planet){
+        for (int i=1; i<N; i++){
+            rebx_calculate_tides_batch(batch, lanes, i, i, 0, 1.);
+        }
     }
 }
 
@@ -202,7 +383,8 @@ double rebx_tides_constant_time_lag_potential(struct rebx_extras* const rebx){
     if (target->m == 0){                        // No potential with massless primary
         return 0.;
     }
-    double* k2 = rebx_get_param(rebx, target->ap, "tctl_k2");
+    const int id_k2 = rebx_intern(rebx, "tctl_k2");
+    double* k2 = rebx_get_param_by_id(rebx, target->ap, id_k2);
     if (k2 != NULL && target->r != 0){  // tides on star only nonzero if k2 and finite size are set
         for (int i=1; i<N_real; i++){
             struct reb_particle* source = &particles[i]; // planet raising the tides on the star
@@ -214,11 +396,16 @@ double rebx_tides_constant_time_lag_potential(struct rebx_extras* const rebx){
     }
 
     // Calculate tides raised on the planets
+    const struct rebx_param_list* const k2s = rebx_get_param_list(rebx, particles, N_real, id_k2);
+    if (k2s == NULL){
+        return H;
+    }
     struct reb_particle* source = &particles[0]; // Source is always the star (no planet-planet tides)
-    for (int i=1; i<N_real; i++){
+    for (int k=0; k<k2s->N_particles; k++){
+        const int i = k2s->index[k];
         struct reb_particle* target = &particles[i]; 
-        double* k2 = rebx_get_param(rebx, target->ap, "tctl_k2");
-        if (k2 == NULL || target->r == 0 || target->m == 0){
+        const double* const k2 = k2s->values[k];
+        if (i == 0 || target->r == 0 || target->m == 0){
             continue;
         }
         H += rebx_calculate_tides_potential(source, target, G, *k2);
@@ -0,0 +1,252 @@
+/**
+ * @file    tides_secular.c
+ * @brief   Orbit-averaged equilibrium tides with a constant time lag, evolving semimajor axes, eccentricities and spins directly.
+ * @author  REBOUNDx developers
+ *
+ * @section     LICENSE
+ * Copyright (c) 2026 REBOUNDx developers
+ *
+ * This file is part of reboundx.
+ *
+ * reboundx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * reboundx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * The section after the dollar signs gets built into the documentation by a script.  All lines must start with space * space like below.
+ * Tables always must be preceded and followed by a blank line.  See http://docutils.sourceforge.net/docs/user/rst/quickstart.html for a primer on rst.
+ * $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+ *
+ * $Tides$       // Effect category (must be the first non-blank line after dollar signs and between dollar signs to be detected by script).
+ *
+ * ======================= ===============================================
+ * Authors                 REBOUNDx developers
+ * Implementation Paper    None
+ * Based on                `Hut 1981 <https://ui.adsabs.harvard.edu/abs/1981A%26A....99..126H/abstract>`_, `Eggleton et al. 1998 <https://iopscience.iop.org/article/10.1086/305670>`_.
+ * C Example               :ref:`c_example_tides_secular`
+ * Python Example          None
+ * ======================= ===============================================
+ *
+ * This operator evolves the orbit-averaged (secular) effect of equilibrium tides with a constant time lag on the orbits of all bodies around the primary (particles[0]),
+ * as well as the spins of the bodies, following Eqs. 9-11 of Hut (1981).
+ * Unlike tides_constant_time_lag and tides_spin, which resolve the tidal forces along the orbit and so need timesteps much shorter than the innermost orbital period,
+ * it can be applied over many orbits at a time (e.g. once every few hundred timesteps with rebx_add_operator_every), as long as that's short compared to the tidal evolution timescales.
+ *
+ * Like tides_constant_time_lag, only the tides raised on the primary by each body and on each body by the primary are included (no tides between bodies orbiting the primary).
+ * The semimajor axis and eccentricity of each body's two-body orbit around the primary are updated, keeping the other orbital elements fixed, and the changes are split between the body
+ * and the primary so the center of mass and total momentum are conserved.
+ * The spins are assumed to be aligned with the orbit normal: only the spin component along the orbit normal enters the equations and is evolved.
+ * If the moments of inertia I are set, the orbital plus spin angular momentum is conserved to the order of the step. Spins without I are held fixed, so the angular momentum they would exchange with the orbit is lost.
+ * It uses the same particle parameters as tides_spin.
+ *
+ * **Effect Parameters**
+ *
+ * None
+ *
+ * **Particle Parameters**
+ *
+ * A body is tidally deformed if it has a physical radius, and k2, tau and Omega are set.
+ *
+ * ============================ =========== ==================================================================
+ * Field (C type)               Required    Description
+ * ============================ =========== ==================================================================
+ * particles[i].r (float)       Yes         Physical radius (required for contribution from tides raised on the body).
+ * k2 (float)                   Yes         Potential Love number of degree 2.
+ * tau (float)                  Yes         Constant time lag.
+ * Omega (reb_vec3d)            Yes         Angular rotation frequency.
+ * I (float)                    No          Moment of inertia. If not set, the spin is held fixed.
+ * ============================ =========== ==================================================================
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "rebound.h"
+#include "reboundx.h"
+
+// A tidally deformed body
+struct rebx_tides_secular_body{
+    int on;                         // 0 if tides raised on the body are ignored
+    double m;
+    double R;
+    double k2;
+    double tau;
+    const double* I;                // NULL if the spin isn't evolved
+    struct reb_vec3d* Omega;
+};
+
+static struct rebx_tides_secular_body rebx_tides_secular_get_body(struct rebx_extras* const rebx, struct reb_particle* const p){
+    struct rebx_tides_secular_body body = {0};
+    const double* const k2 = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "k2"));
+    const double* const tau = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "tau"));
+    struct reb_vec3d* const Omega = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "Omega"));
+    if (k2 == NULL || tau == NULL || Omega == NULL || p->r == 0. || p->m == 0.){
+        return body;
+    }
+    body.on = 1;
+    body.m = p->m;
+    body.R = p->r;
+    body.k2 = *k2;
+    body.tau = *tau;
+    body.I = rebx_get_param_by_id(rebx, p->ap, rebx_intern(rebx, "I"));
+    body.Omega = Omega;
+    return body;
+}
+
+// Adds the rates from the tide raised on body by a companion of mass m (Hut 1981 Eqs. 9-11, with k2 in place of his k like in tides_constant_time_lag, and 1/T = G M tau/R^3)
+static void rebx_tides_secular_add_rates(const double G, const struct rebx_tides_secular_body* const body, const double m, const double a, const double e, const double n, const double Omega_h, double* const dadt, double* const dedt, double* const dOmegadt){
+    const double q = m/body->m;
+    const double e2 = e*e;
+    const double e4 = e2*e2;
+    const double e6 = e4*e2;
+    const double f1 = 1. + 31./2.*e2 + 255./8.*e4 + 185./16.*e6 + 25./64.*e4*e4;
+    const double f2 = 1. + 15./2.*e2 + 45./8.*e4 + 5./16.*e6;
+    const double f3 = 1. + 15./4.*e2 + 15./8.*e4 + 5./64.*e6;
+    const double f4 = 1. + 3./2.*e2 + 1./8.*e4;
+    const double f5 = 1. + 3.*e2 + 3./8.*e4;
+    const double ome2 = 1. - e2;
+    const double sqrt_ome2 = sqrt(ome2);
+    const double ome2_3_2 = ome2*sqrt_ome2;
+    const double ome2_6 = ome2*ome2*ome2*ome2*ome2*ome2;
+    const double Ra = body->R/a;
+    const double Ra2 = Ra*Ra;
+    const double Ra6 = Ra2*Ra2*Ra2;
+    const double kT = body->k2*G*body->m*body->tau/(body->R*body->R*body->R);
+    const double spin = Omega_h/n;
+
+    *dadt += -6.*kT*q*(1.+q)*Ra6*Ra2*a/(ome2_6*ome2_3_2)*(f1 - ome2_3_2*f2*spin);
+    *dedt += -27.*kT*q*(1.+q)*Ra6*Ra2*e/(ome2_6*sqrt_ome2)*(f3 - 11./18.*ome2_3_2*f4*spin);
+    if (body->I != NULL){
+        *dOmegadt += 3.*kT*q*q*body->m*body->R*body->R/(*body->I)*Ra6*n/ome2_6*(f2 - ome2_3_2*f5*spin);
+    }
+}
+
+// y = {a, e, spin of the primary along the orbit normal, spin of the body along the orbit normal}
+static void rebx_tides_secular_derivatives(const double G, const struct rebx_tides_secular_body* const primary, const struct rebx_tides_secular_body* const body, const double m0, const double m, const double* const y, double* const yDot){
+    const double a = y[0];
+    const double e = y[1] > 0. ? y[1] : 0.;
+    const double n = sqrt(G*(m0 + m)/(a*a*a));
+    yDot[0] = 0.;
+    yDot[1] = 0.;
+    yDot[2] = 0.;
+    yDot[3] = 0.;
+    if (primary->on){
+        rebx_tides_secular_add_rates(G, primary, m, a, e, n, y[2], &yDot[0], &yDot[1], &yDot[2]);
+    }
+    if (body->on){
+        rebx_tides_secular_add_rates(G, body, m0, a, e, n, y[3], &yDot[0], &yDot[1], &yDot[3]);
+    }
+}
+
+void rebx_tides_secular(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
+    struct rebx_extras* const rebx = sim->extras;
+    const int N_real = sim->N - sim->N_var;
+    const double G = sim->G;
+    struct reb_particle* const primary = &sim->particles[0]; // assumes nearly Keplerian motion around a single primary (particles[0])
+    if (N_real < 2 || primary->m == 0.){
+        return;
+    }
+    const struct rebx_tides_secular_body b0 = rebx_tides_secular_get_body(rebx, primary);
+    for (int i=1; i<N_real; i++){
+        struct reb_particle* const p = &sim->particles[i];
+        if (p->m == 0.){    // massless bodies neither raise tides nor feel them
+            continue;
+        }
+        const struct rebx_tides_secular_body bi = rebx_tides_secular_get_body(rebx, p);
+        if (!b0.on && !bi.on){
+            continue;
+        }
+        int err = 0;
+        struct reb_orbit o = reb_tools_particle_to_orbit_err(G, *p, *primary, &err);
+        if (err || o.a <= 0. || o.e >= 1.){ // no secular equations for unbound orbits
+            continue;
+        }
+
+        // Orbit normal
+        const double dx = p->x - primary->x;
+        const double dy = p->y - primary->y;
+        const double dz = p->z - primary->z;
+        const double dvx = p->vx - primary->vx;
+        const double dvy = p->vy - primary->vy;
+        const double dvz = p->vz - primary->vz;
+        const double hx = dy*dvz - dz*dvy;
+        const double hy = dz*dvx - dx*dvz;
+        const double hz = dx*dvy - dy*dvx;
+        const double h = sqrt(hx*hx + hy*hy + hz*hz);
+        const struct reb_vec3d hhat = {.x = hx/h, .y = hy/h, .z = hz/h};
+
+        // Midpoint step
+        double y0[4] = {o.a, o.e, 0., 0.};
+        if (b0.on){
+            y0[2] = b0.Omega->x*hhat.x + b0.Omega->y*hhat.y + b0.Omega->z*hhat.z;
+        }
+        if (bi.on){
+            y0[3] = bi.Omega->x*hhat.x + bi.Omega->y*hhat.y + bi.Omega->z*hhat.z;
+        }
+        double yDot[4];
+        double y1[4];
+        rebx_tides_secular_derivatives(G, &b0, &bi, primary->m, p->m, y0, yDot);
+        for (int k=0; k<4; k++){
+            y1[k] = y0[k] + dt/2.*yDot[k];
+        }
+        if (y1[0] <= 0.){
+            reb_warning(sim, "REBOUNDx Warning: Timestep too large in tides_secular, semimajor axis became negative. Skipping update.\n");
+            continue;
+        }
+        rebx_tides_secular_derivatives(G, &b0, &bi, primary->m, p->m, y1, yDot);
+        for (int k=0; k<4; k++){
+            y1[k] = y0[k] + dt*yDot[k];
+        }
+        if (y1[0] <= 0.){
+            reb_warning(sim, "REBOUNDx Warning: Timestep too large in tides_secular, semimajor axis became negative. Skipping update.\n");
+            continue;
+        }
+        o.a = y1[0];
+        o.e = y1[1] > 0. ? y1[1] : 0.;
+
+        // Update the relative orbit, and split the change between the pair so their center of mass is unchanged
+        const struct reb_particle updated = reb_tools_orbit_to_particle(G, *primary, p->m, o.a, o.e, o.inc, o.Omega, o.omega, o.f);
+        const double mtot = primary->m + p->m;
+        const double f0 = p->m/mtot;
+        const double fi = primary->m/mtot;
+        const double ddx = (updated.x - primary->x) - dx;
+        const double ddy = (updated.y - primary->y) - dy;
+        const double ddz = (updated.z - primary->z) - dz;
+        const double ddvx = (updated.vx - primary->vx) - dvx;
+        const double ddvy = (updated.vy - primary->vy) - dvy;
+        const double ddvz = (updated.vz - primary->vz) - dvz;
+        p->x += fi*ddx;
+        p->y += fi*ddy;
+        p->z += fi*ddz;
+        p->vx += fi*ddvx;
+        p->vy += fi*ddvy;
+        p->vz += fi*ddvz;
+        primary->x -= f0*ddx;
+        primary->y -= f0*ddy;
+        primary->z -= f0*ddz;
+        primary->vx -= f0*ddvx;
+        primary->vy -= f0*ddvy;
+        primary->vz -= f0*ddvz;
+
+        // Spins change along the orbit normal
+        if (b0.on && b0.I != NULL){
+            b0.Omega->x += (y1[2] - y0[2])*hhat.x;
+            b0.Omega->y += (y1[2] - y0[2])*hhat.y;
+            b0.Omega->z += (y1[2] - y0[2])*hhat.z;
+        }
+        if (bi.on && bi.I != NULL){
+            bi.Omega->x += (y1[3] - y0[3])*hhat.x;
+            bi.Omega->y += (y1[3] - y0[3])*hhat.y;
+            bi.Omega->z += (y1[3] - y0[3])*hhat.z;
+        }
+    }
+}
@@ -48,7 +48,29 @@
  *
  * **Effect Parameters**
  *
- * None
+ * By default all pairs of bodies interact. As for REBOUND's gravity, particles beyond sim->N_active are test particles that don't interact with one another,
+ * and only act back on (raise tides on, and feel back reactions from) active particles if sim->testparticle_type is 1.
+ * For many bodies, the optional parameters below restrict the pairs (j raising tides on i) that are included.
+ * The selected pairs are stored in a neighbour list, rebuilt every ts_neighbor_interval steps, and used both for the forces and for the spin evolution.
+ * With a ts_neighbor_skin, the list instead holds the pairs closer than ts_cutoff + ts_neighbor_skin, the cutoff is applied at every evaluation, and the list
+ * is only rebuilt once some body has moved more than half the skin since the last build (ts_neighbor_interval is then ignored). No pair inside the cutoff
+ * is then missed, and a skin of a few times the distance bodies travel per step avoids most rebuilds.
+ *
+ * ============================ =========== ==================================================================
+ * Field (C type)               Required    Description
+ * ============================ =========== ==================================================================
+ * ts_cutoff (double)           No          Only pairs closer than this distance (when the list is built, or at every evaluation with a skin) interact.
+ * ts_min_mass_ratio (double)   No          Only bodies j with m_j >= ts_min_mass_ratio * m_i raise tides on i.
+ * ts_structured_only (int)     No          If nonzero, only bodies with structure (k2 and Omega set) raise tides.
+ * ts_neighbor_interval (int)   No          Number of steps between neighbour list rebuilds. Defaults to 1.
+ * ts_neighbor_skin (double)    No          Extra distance beyond ts_cutoff kept in the neighbour list (see above). Only used with ts_cutoff.
+ * ts_spin_every (int)          No          Advance the spins once every this many steps (see below). Defaults to 1.
+ * ============================ =========== ==================================================================
+ *
+ * Spins typically evolve on tidal timescales much longer than the orbital period. With ts_spin_every = M > 1, the spin ODE is no longer
+ * integrated at every integrator stage. Instead, spins are held fixed for M timesteps while the torques at the end of each timestep are accumulated
+ * (weighted by the timestep), and then advanced by the accumulated change, i.e. with the orbit-averaged torque over the window. The forces are unchanged.
+ * This is first order in the window length, so M times the timestep should be short compared to the spin evolution timescales.
  *
  * **Particle Parameters**
  *
@@ -69,31 +91,14 @@
 #include <stdlib.h>
 #include <float.h>
 #include "reboundx.h"
+#include "rebxtools.h"
 
-struct reb_vec3d rebx_calculate_spin_orbit_accelerations(struct reb_particle* source, struct reb_particle* target, const double G, const double k2, const double sigma, const struct reb_vec3d Omega){
-  // All quantities associated with SOURCE
-  // This is the quadrupole potential/tides raised on the SOURCE
-  const double ms = source->m;
-  const double Rs = source->r;
-  const double mt = target->m;
+// Separations (source minus target) passed in, so the force loop can take them from the shared rebx_geometry
+static struct reb_vec3d rebx_spin_orbit_kernel(const double ms, const double Rs, const double mt, const double dx, const double dy, const double dz, const double d2, const double dr, const double dvx, const double dvy, const double dvz, const double G, const double k2, const double sigma, const struct reb_vec3d Omega){
   const double mtot = ms + mt;
   const double mu_ij = ms * mt / mtot; // have already checked for 0 and inf
   const double big_a = k2 * (Rs * Rs * Rs * Rs * Rs);
 
-  // distance vector FROM j TO i
-  const double dx = source->x - target->x;
-  const double dy = source->y - target->y;
-  const double dz = source->z - target->z;
-  const double d2 = dx * dx + dy * dy + dz * dz;
-  const double dr = sqrt(d2);
-
-  // Velocity vector: i to j
-  const double dvx = source->vx - target->vx;
-  const double dvy = source->vy - target->vy;
-  const double dvz = source->vz - target->vz;
-  //const double vel2 = dvx * dvx + dvy * dvy + dvz * dvz;
-  //const double vr = sqrt(vel2);
-
   struct reb_vec3d tot_force = {0};
 
   if (k2 != 0.0){
@@ -146,7 +151,28 @@ struct reb_vec3d rebx_calculate_spin_orbit_accelerations(struct reb_particle* so
   return tot_force;
 }
 
-static void rebx_spin_orbit_accelerations(struct reb_particle* source, struct reb_particle* target, const double G, const double k2, const double sigma, const struct reb_vec3d Omega){
+struct reb_vec3d rebx_calculate_spin_orbit_accelerations(struct reb_particle* source, struct reb_particle* target, const double G, const double k2, const double sigma, const struct reb_vec3d Omega){
+  // All quantities associated with SOURCE
+  // This is the quadrupole potential/tides raised on the SOURCE
+
+  // distance vector FROM j TO i
+  const double dx = source->x - target->x;
+  const double dy = source->y - target->y;
+  const double dz = source->z - target->z;
+  const double d2 = dx * dx + dy * dy + dz * dz;
+  const double dr = sqrt(d2);
+
+  // Velocity vector: i to j
+  const double dvx = source->vx - target->vx;
+  const double dvy = source->vy - target->vy;
+  const double dvz = source->vz - target->vz;
+
+  return rebx_spin_orbit_kernel(source->m, source->r, target->m, dx, dy, dz, d2, dr, dvx, dvy, dvz, G, k2, sigma, Omega);
+}
+
+// Applies the acceleration on target (particles[j]) if on_target is set, and returns the back reaction on source, which the caller adds to source.
+// g holds separations relative to source, i.e. target minus source
+static struct reb_vec3d rebx_spin_orbit_accelerations(struct reb_particle* source, struct reb_particle* target, const struct rebx_geometry* const g, const int j, const double G, const double k2, const double sigma, const struct reb_vec3d Omega, const int on_target){
 
     // Input params all associated with source
     const double ms = source->m;
@@ -154,132 +180,511 @@ static void rebx_spin_orbit_accelerations(struct reb_particle* source, struct re
     const double mtot = ms + mt;
 
     // check if ODE is set here
-    struct reb_vec3d tot_force = rebx_calculate_spin_orbit_accelerations(source, target, G, k2, sigma, Omega);
+    struct reb_vec3d tot_force = rebx_spin_orbit_kernel(ms, source->r, mt, -g->dx[j], -g->dy[j], -g->dz[j], g->r2[j], g->r[j], -g->dvx[j], -g->dvy[j], -g->dvz[j], G, k2, sigma, Omega);
 
-    target->ax -= ((ms / mtot) * tot_force.x);
-    target->ay -= ((ms / mtot) * tot_force.y);
-    target->az -= ((ms / mtot) * tot_force.z);
+    if (on_target){
+        target->ax -= ((ms / mtot) * tot_force.x);
+        target->ay -= ((ms / mtot) * tot_force.y);
+        target->az -= ((ms / mtot) * tot_force.z);
+    }
 
-    source->ax += ((mt / mtot) * tot_force.x);
-    source->ay += ((mt / mtot) * tot_force.y);
-    source->az += ((mt / mtot) * tot_force.z);
+    struct reb_vec3d back_reaction;
+    back_reaction.x = ((mt / mtot) * tot_force.x);
+    back_reaction.y = ((mt / mtot) * tot_force.y);
+    back_reaction.z = ((mt / mtot) * tot_force.z);
+    return back_reaction;
+}
 
+// Optional pair filters (see Effect Parameters). Pairs passing them are stored in a neighbour list that is rebuilt every
+// ts_neighbor_interval steps (or, with a skin, once a body has moved half the skin), and shared by the force and the spin ODE
+// so torques and forces always act on the same pairs.
+struct rebx_tides_spin_neighbors{
+    int built;                      // 0 until first built
+    int N;                          // Number of particles the list was built for
+    unsigned long long steps_done;  // Step at which the list was built
+    double skin;                    // ts_neighbor_skin the list was built with (0 if none)
+    double cutoff2;                 // Squared ts_cutoff checked at every evaluation if the list has a skin, INFINITY otherwise
+    int N_allocated_x0;
+    double* x0;                     // 3N. Positions when the list was built, to track displacements (only with a skin)
+    int N_allocated;
+    int* offsets;                   // N+1. Neighbours of particle i are neighbors[offsets[i]] to neighbors[offsets[i+1]-1]
+    int N_allocated_neighbors;
+    int* neighbors;                 // Particles j raising tides on i
+};
+
+// Index of the bodies whose spins are evolved by the spin ODE (in ODE order), with pointers to their param values.
+// Rebuilt only when the number of particles changes or params are added, freed or moved (rebx->param_generation).
+struct rebx_spin_body{
+    int index;                      // Index in sim->particles
+    const double* k2;
+    const double* tau;              // NULL if not set
+    const double* I;
+    struct reb_vec3d* Omega;
+};
+
+struct rebx_spin_index{
+    int built;                      // 0 until first built
+    int N;                          // Number of particles the index was built for
+    unsigned int param_generation;  // rebx->param_generation when built
+    int N_spins;
+    int N_allocated;
+    struct rebx_spin_body* bodies;
+};
+
+// Spin changes accumulated over the current window of ts_spin_every timesteps
+struct rebx_spin_window{
+    int steps;                      // Timesteps accumulated so far
+    int N_spins;                    // Number of spins the buffers are for. The window restarts if it changes
+    double* dOmega;                 // 3*N_spins. Sum over the window of the spin derivatives times the timestep
+    double* y;                      // 3*N_spins. Spins, and their derivatives, at the end of the current timestep
+    double* yDot;
+};
+
+static void rebx_tides_spin_free_workspace(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_tides_spin_neighbors* nl = rebx_get_param(rebx, force->ap, "ts_neighbor_list");
+    if (nl != NULL){
+        free(nl->offsets);
+        free(nl->neighbors);
+        free(nl->x0);
+        free(nl);
+        rebx_set_param_pointer(rebx, &force->ap, "ts_neighbor_list", NULL);
+    }
+    struct rebx_spin_index* index = rebx_get_param(rebx, force->ap, "ts_spin_index");
+    if (index != NULL){
+        free(index->bodies);
+        free(index);
+        rebx_set_param_pointer(rebx, &force->ap, "ts_spin_index", NULL);
+    }
+    struct rebx_spin_window* window = rebx_get_param(rebx, force->ap, "ts_spin_window");
+    if (window != NULL){
+        free(window->dOmega);
+        free(window->y);
+        free(window->yDot);
+        free(window);
+        rebx_set_param_pointer(rebx, &force->ap, "ts_spin_window", NULL);
+    }
 }
 
-static void rebx_spin_derivatives(struct reb_ode* const ode, double* const yDot, const double* const y, const double t){
-    struct reb_simulation* sim = ode->ref;
-    struct rebx_extras* const rebx = sim->extras;
-    unsigned int Nspins = 0;
-    const int N_real = sim->N - sim->N_var;
-    for (int i=0; i<N_real; i++){
-        struct reb_particle* pi = &sim->particles[i]; // target particle
-        const double* k2 = rebx_get_param(rebx, pi->ap, "k2"); // This is slow
-        const double* tau = rebx_get_param(rebx, pi->ap, "tau");
-        const double* I = rebx_get_param(rebx, pi->ap, "I");
+static void rebx_tides_spin_workspace_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const struct rebx_tides_spin_neighbors* const nl = rebx_get_param(rebx, force->ap, "ts_neighbor_list");
+    if (nl != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, nl, sizeof(*nl));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, nl->offsets, nl->N_allocated*sizeof(*nl->offsets));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, nl->neighbors, nl->N_allocated_neighbors*sizeof(*nl->neighbors));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, nl->x0, nl->N_allocated_x0*sizeof(*nl->x0));
+    }
+    const struct rebx_spin_index* const index = rebx_get_param(rebx, force->ap, "ts_spin_index");
+    if (index != NULL){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, index, sizeof(*index));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, index->bodies, index->N_allocated*sizeof(*index->bodies));
+    }
+    const struct rebx_spin_window* const window = rebx_get_param(rebx, force->ap, "ts_spin_window");
+    if (window != NULL){
+        const size_t size = (3*window->N_spins + 1)*sizeof(double);
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, window, sizeof(*window));
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, window->dOmega, size);
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, window->y, size);
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, window->yDot, size);
+    }
+}
+
+// Returns the up to date index of spinning bodies, or NULL if memory could not be allocated
+static struct rebx_spin_index* rebx_spin_get_index(struct rebx_extras* const rebx, struct rebx_force* const effect, struct reb_particle* const particles, const int N){
+    struct rebx_spin_index* index = rebx_get_param(rebx, effect->ap, "ts_spin_index");
+    if (index == NULL){
+        index = calloc(1, sizeof(*index));
+        if (index == NULL){
+            return NULL;
+        }
+        // Adding these params increments param_generation, so do it before building
+        rebx_set_param_pointer(rebx, &effect->ap, "ts_spin_index", index);
+        rebx_set_param_pointer(rebx, &effect->ap, "free_workspace", rebx_tides_spin_free_workspace);
+        rebx_set_param_pointer(rebx, &effect->ap, "workspace_memory", rebx_tides_spin_workspace_memory);
+    }
+    if (index->built && index->N == N && index->param_generation == rebx->param_generation){
+        return index;
+    }
 
-        // Particle MUST have k2 and moment of inertia to feel effects
-        if (k2 != NULL && I != NULL){
+    if (N > index->N_allocated){
+        struct rebx_spin_body* bodies = realloc(index->bodies, N*sizeof(*bodies));
+        if (bodies == NULL){
+            return NULL;
+        }
+        index->bodies = bodies;
+        index->N_allocated = N;
+    }
+    const int id_k2 = rebx_intern(rebx, "k2");
+    const int id_tau = rebx_intern(rebx, "tau");
+    const int id_I = rebx_intern(rebx, "I");
+    const int id_Omega = rebx_intern(rebx, "Omega");
+    int N_spins = 0;
+    for (int i=0; i<N; i++){
+        struct reb_particle* p = &particles[i];
+        // Only track spin if particle feels tides (k2), and has moment of inertia and valid spin axis set
+        const double* k2 = rebx_get_param_by_id(rebx, p->ap, id_k2);
+        const double* I = rebx_get_param_by_id(rebx, p->ap, id_I);
+        struct reb_vec3d* Omega = rebx_get_param_by_id(rebx, p->ap, id_Omega);
+        if (k2 != NULL && I != NULL && Omega != NULL){
+            struct rebx_spin_body* body = &index->bodies[N_spins];
+            body->index = i;
+            body->k2 = k2;
+            body->tau = rebx_get_param_by_id(rebx, p->ap, id_tau);
+            body->I = I;
+            body->Omega = Omega;
+            N_spins++;
+        }
+    }
+    index->N_spins = N_spins;
+    index->N = N;
+    index->param_generation = rebx->param_generation;
+    index->built = 1;
+    return index;
+}
 
-          // Tidal dissipation off by default. Check for non-zero tau here.
-          double sigma_in = 0.0;
-          if (tau != NULL){
-            sigma_in = 4 * (*tau) * sim->G / (3. * pi->r * pi->r * pi->r * pi->r * pi->r * (*k2));
-          }
-	       // Set initial spin accelerations to 0
-          yDot[3*Nspins] = 0;
-          yDot[3*Nspins + 1] = 0;
-          yDot[3*Nspins + 2] = 0;
-
-          const struct reb_vec3d Omega = {.x=y[3*Nspins], .y=y[3*Nspins+1], .z=y[3*Nspins+2]};
-          for (int j=0; j<N_real; j++){
-            if (i != j){
-                struct reb_particle* pj = &sim->particles[j];
-
-                // di - dj
-                const double dx = pi->x - pj->x;
-                const double dy = pi->y - pj->y;
-                const double dz = pi->z - pj->z;
-
-                const double mi = pi->m;
-                const double mj = pj->m;
-                const double mu_ij = (mi * mj) / (mi + mj);
-
-                struct reb_vec3d tf = rebx_calculate_spin_orbit_accelerations(pi, pj, sim->G, *k2, sigma_in, Omega);
-                // Eggleton et. al 1998 spin EoM (equation 36)
-                yDot[3*Nspins] += ((dy * tf.z - dz * tf.y) * (-mu_ij / *I));
-                yDot[3*Nspins + 1] += ((dz * tf.x - dx * tf.z) * (-mu_ij / *I));
-                yDot[3*Nspins + 2] += ((dx * tf.y - dy * tf.x) * (-mu_ij / *I));
+static int rebx_tides_spin_add_neighbor(struct rebx_tides_spin_neighbors* const nl, const int N_neighbors, const int j){
+    if (N_neighbors >= nl->N_allocated_neighbors){
+        const int N_allocated = nl->N_allocated_neighbors > 0 ? 2*nl->N_allocated_neighbors : 64;
+        int* neighbors = realloc(nl->neighbors, N_allocated*sizeof(*neighbors));
+        if (neighbors == NULL){
+            return 0;
+        }
+        nl->neighbors = neighbors;
+        nl->N_allocated_neighbors = N_allocated;
+    }
+    nl->neighbors[N_neighbors] = j;
+    return 1;
+}
+
+// Whether particles i and j are within the cutoff. Lists without a skin only hold such pairs, so this is only checked with one
+static inline int rebx_tides_spin_within_cutoff(const struct rebx_tides_spin_neighbors* const nl, const struct reb_particle* const pi, const struct reb_particle* const pj){
+    if (nl == NULL || nl->cutoff2 == INFINITY){
+        return 1;
+    }
+    const double dx = pi->x - pj->x;
+    const double dy = pi->y - pj->y;
+    const double dz = pi->z - pj->z;
+    return dx*dx + dy*dy + dz*dz <= nl->cutoff2;
+}
+
+// Whether some particle has moved more than half the skin since the list was built, so that a pair that was further apart
+// than cutoff + skin could now be within the cutoff
+static int rebx_tides_spin_skin_exceeded(const struct rebx_tides_spin_neighbors* const nl, const struct reb_particle* const particles, const int N){
+    const double max_dr2 = 0.25*nl->skin*nl->skin;
+    for (int i=0; i<N; i++){
+        const double dx = particles[i].x - nl->x0[3*i];
+        const double dy = particles[i].y - nl->x0[3*i+1];
+        const double dz = particles[i].z - nl->x0[3*i+2];
+        if (dx*dx + dy*dy + dz*dz > max_dr2){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Returns the neighbour list, rebuilding it if needed, or NULL if no pair filters are set on the effect (all pairs interact).
+// Sets *err if memory could not be allocated.
+static struct rebx_tides_spin_neighbors* rebx_tides_spin_get_neighbors(struct rebx_extras* const rebx, struct rebx_force* const effect, struct reb_particle* const particles, const int N, int* err){
+    struct reb_simulation* const sim = effect->sim;
+    const double* const cutoff = rebx_get_param(rebx, effect->ap, "ts_cutoff");
+    const double* const min_mass_ratio = rebx_get_param(rebx, effect->ap, "ts_min_mass_ratio");
+    const int* const structured_only = rebx_get_param(rebx, effect->ap, "ts_structured_only");
+    const int* const interval = rebx_get_param(rebx, effect->ap, "ts_neighbor_interval");
+    const double* const skin_param = rebx_get_param(rebx, effect->ap, "ts_neighbor_skin");
+    *err = 0;
+    if (cutoff == NULL && min_mass_ratio == NULL && (structured_only == NULL || *structured_only == 0) && interval == NULL){
+        return NULL;
+    }
+
+    struct rebx_tides_spin_neighbors* nl = rebx_get_param(rebx, effect->ap, "ts_neighbor_list");
+    if (nl == NULL){
+        nl = calloc(1, sizeof(*nl));
+        if (nl == NULL){
+            *err = 1;
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &effect->ap, "ts_neighbor_list", nl);
+        rebx_set_param_pointer(rebx, &effect->ap, "free_workspace", rebx_tides_spin_free_workspace);
+        rebx_set_param_pointer(rebx, &effect->ap, "workspace_memory", rebx_tides_spin_workspace_memory);
+    }
+    const double skin = (cutoff != NULL && skin_param != NULL && *skin_param > 0.) ? *skin_param : 0.;
+    const unsigned long long K = (interval != NULL && *interval > 1) ? *interval : 1;
+    if (nl->built && nl->N == N && nl->skin == skin){
+        if (skin > 0. ? !rebx_tides_spin_skin_exceeded(nl, particles, N) : sim->steps_done - nl->steps_done < K){
+            return nl;
+        }
+    }
+
+    if (N >= nl->N_allocated){
+        int* offsets = realloc(nl->offsets, (N+1)*sizeof(*offsets));
+        if (offsets == NULL){
+            *err = 1;
+            return NULL;
+        }
+        nl->offsets = offsets;
+        nl->N_allocated = N+1;
+    }
+    if (skin > 0. && 3*N > nl->N_allocated_x0){
+        double* x0 = realloc(nl->x0, 3*N*sizeof(*x0));
+        if (x0 == NULL){
+            *err = 1;
+            return NULL;
+        }
+        nl->x0 = x0;
+        nl->N_allocated_x0 = 3*N;
+    }
+    const double cutoff2 = cutoff != NULL ? (*cutoff + skin)*(*cutoff + skin) : INFINITY;
+    const int id_k2 = rebx_intern(rebx, "k2");
+    const int id_Omega = rebx_intern(rebx, "Omega");
+    const int N_active = rebx_get_N_active(sim, N);
+    int N_neighbors = 0;
+    for (int i=0; i<N; i++){
+        nl->offsets[i] = N_neighbors;
+        struct reb_particle* const pi = &particles[i];
+        if (rebx_get_param_by_id(rebx, pi->ap, id_k2) == NULL){
+            continue; // point particles don't feel tides
+        }
+        const int N_pairs = i < N_active ? N : N_active; // test particles only pair with active particles
+        for (int j=0; j<N_pairs; j++){
+            if (i == j){
+                continue;
             }
+            struct reb_particle* const pj = &particles[j];
+            const double dx = pi->x - pj->x;
+            const double dy = pi->y - pj->y;
+            const double dz = pi->z - pj->z;
+            if (dx*dx + dy*dy + dz*dz > cutoff2){
+                continue;
+            }
+            if (min_mass_ratio != NULL && pj->m < (*min_mass_ratio)*pi->m){
+                continue;
+            }
+            if (structured_only != NULL && *structured_only && (rebx_get_param_by_id(rebx, pj->ap, id_k2) == NULL || rebx_get_param_by_id(rebx, pj->ap, id_Omega) == NULL)){
+                continue;
+            }
+            if (!rebx_tides_spin_add_neighbor(nl, N_neighbors, j)){
+                *err = 1;
+                return NULL;
+            }
+            N_neighbors++;
+        }
+    }
+    nl->offsets[N] = N_neighbors;
+    if (skin > 0.){
+        for (int i=0; i<N; i++){
+            nl->x0[3*i] = particles[i].x;
+            nl->x0[3*i+1] = particles[i].y;
+            nl->x0[3*i+2] = particles[i].z;
+        }
+    }
+    nl->skin = skin;
+    nl->cutoff2 = skin > 0. ? (*cutoff)*(*cutoff) : INFINITY;
+    nl->N = N;
+    nl->steps_done = sim->steps_done;
+    nl->built = 1;
+    return nl;
+}
+
+// Number of timesteps the spins are held fixed for between updates (ts_spin_every)
+static int rebx_spin_every(struct rebx_extras* const rebx, const struct rebx_force* const effect){
+    const int* const every = rebx_get_param(rebx, effect->ap, "ts_spin_every");
+    return (every != NULL && *every > 1) ? *every : 1;
+}
+
+// Fills yDot with the spin derivatives of the bodies in index at spins y (Eggleton et. al 1998)
+static void rebx_spin_torques(struct reb_simulation* const sim, const struct rebx_spin_index* const index, const struct rebx_tides_spin_neighbors* const nl, double* const yDot, const double* const y){
+    const int N_real = sim->N - sim->N_var;
+    const int N_active = rebx_get_N_active(sim, N_real);
+    for (int s=0; s<index->N_spins; s++){
+        const struct rebx_spin_body* const body = &index->bodies[s];
+        const int i = body->index;
+        const int N_sources = rebx_get_N_sources(sim, N_active, N_real, i); // bodies raising tides on i
+        struct reb_particle* pi = &sim->particles[i]; // target particle
+        const double* k2 = body->k2;
+        const double* tau = body->tau;
+        const double* I = body->I;
+
+        // Tidal dissipation off by default. Check for non-zero tau here.
+        double sigma_in = 0.0;
+        if (tau != NULL){
+          sigma_in = 4 * (*tau) * sim->G / (3. * pi->r * pi->r * pi->r * pi->r * pi->r * (*k2));
+        }
+        // Set initial spin accelerations to 0
+        yDot[3*s] = 0;
+        yDot[3*s + 1] = 0;
+        yDot[3*s + 2] = 0;
+
+        const struct reb_vec3d Omega = {.x=y[3*s], .y=y[3*s+1], .z=y[3*s+2]};
+        const int N_pairs = nl != NULL ? nl->offsets[i+1] - nl->offsets[i] : N_sources;
+        for (int k=0; k<N_pairs; k++){
+          const int j = nl != NULL ? nl->neighbors[nl->offsets[i] + k] : k;
+          if (i != j && j < N_sources && rebx_tides_spin_within_cutoff(nl, pi, &sim->particles[j])){
+              struct reb_particle* pj = &sim->particles[j];
+
+              // di - dj
+              const double dx = pi->x - pj->x;
+              const double dy = pi->y - pj->y;
+              const double dz = pi->z - pj->z;
+
+              const double mi = pi->m;
+              const double mj = pj->m;
+              const double mu_ij = (mi * mj) / (mi + mj);
+
+              struct reb_vec3d tf = rebx_calculate_spin_orbit_accelerations(pi, pj, sim->G, *k2, sigma_in, Omega);
+              // Eggleton et. al 1998 spin EoM (equation 36)
+              yDot[3*s] += ((dy * tf.z - dz * tf.y) * (-mu_ij / *I));
+              yDot[3*s + 1] += ((dz * tf.x - dx * tf.z) * (-mu_ij / *I));
+              yDot[3*s + 2] += ((dx * tf.y - dy * tf.x) * (-mu_ij / *I));
           }
-          Nspins += 1;
-      }
+        }
     }
-    if (ode->length != Nspins*3){
+}
+
+static void rebx_spin_derivatives(struct reb_ode* const ode, double* const yDot, const double* const y, const double t){
+    struct rebx_force* const effect = ode->ref;
+    struct reb_simulation* sim = effect->sim;
+    struct rebx_extras* const rebx = sim->extras;
+    const int N_real = sim->N - sim->N_var;
+    const struct rebx_spin_index* const index = rebx_spin_get_index(rebx, effect, sim->particles, N_real);
+    int err;
+    const struct rebx_tides_spin_neighbors* const nl = rebx_tides_spin_get_neighbors(rebx, effect, sim->particles, N_real, &err);
+    if (index == NULL || err){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+        return;
+    }
+    if (ode->length != index->N_spins*3){
         reb_error(sim, "rebx_spin ODE is not of the expected length.\n");
         exit(1);
     }
+    if (rebx_spin_every(rebx, effect) > 1){ // spins are held fixed, and advanced in rebx_spin_sync_post
+        for (int k=0; k<ode->length; k++){
+            yDot[k] = 0.;
+        }
+        return;
+    }
+    rebx_spin_torques(sim, index, nl, yDot, y);
+}
+
+// Accumulates the torques at the end of the timestep, and advances the spins at the end of each window of ts_spin_every timesteps
+static void rebx_spin_window_step(struct reb_simulation* const sim, struct rebx_force* const effect, const struct rebx_spin_index* const index, const int every){
+    struct rebx_extras* const rebx = sim->extras;
+    struct rebx_spin_window* window = rebx_get_param(rebx, effect->ap, "ts_spin_window");
+    if (window == NULL){
+        window = calloc(1, sizeof(*window));
+        if (window == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+            return;
+        }
+        rebx_set_param_pointer(rebx, &effect->ap, "ts_spin_window", window);
+        rebx_set_param_pointer(rebx, &effect->ap, "free_workspace", rebx_tides_spin_free_workspace);
+        rebx_set_param_pointer(rebx, &effect->ap, "workspace_memory", rebx_tides_spin_workspace_memory);
+    }
+    const int N_spins = index->N_spins;
+    if (window->dOmega == NULL || window->N_spins != N_spins){
+        free(window->dOmega);
+        free(window->y);
+        free(window->yDot);
+        window->dOmega = calloc(3*N_spins + 1, sizeof(*window->dOmega)); // +1 so no spins don't give NULL
+        window->y = malloc((3*N_spins + 1)*sizeof(*window->y));
+        window->yDot = malloc((3*N_spins + 1)*sizeof(*window->yDot));
+        window->N_spins = N_spins;
+        window->steps = 0;
+    }
+    int err;
+    const struct rebx_tides_spin_neighbors* const nl = rebx_tides_spin_get_neighbors(rebx, effect, sim->particles, sim->N - sim->N_var, &err);
+    if (window->dOmega == NULL || window->y == NULL || window->yDot == NULL || err){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+        return;
+    }
+
+    for (int s=0; s<N_spins; s++){
+        const struct reb_vec3d* const Omega = index->bodies[s].Omega;
+        window->y[3*s] = Omega->x;
+        window->y[3*s+1] = Omega->y;
+        window->y[3*s+2] = Omega->z;
+    }
+    rebx_spin_torques(sim, index, nl, window->yDot, window->y);
+    const double dt = sim->dt_last_done;
+    for (int k=0; k<3*N_spins; k++){
+        window->dOmega[k] += window->yDot[k]*dt;
+    }
+    window->steps++;
+    if (window->steps < every){
+        return;
+    }
 
+    for (int s=0; s<N_spins; s++){
+        struct reb_vec3d* const Omega = index->bodies[s].Omega;
+        Omega->x += window->dOmega[3*s];
+        Omega->y += window->dOmega[3*s+1];
+        Omega->z += window->dOmega[3*s+2];
+    }
+    for (int k=0; k<3*N_spins; k++){
+        window->dOmega[k] = 0.;
+    }
+    window->steps = 0;
 }
 
 static void rebx_spin_sync_pre(struct reb_ode* const ode, const double* const y0){
-    struct reb_simulation* sim = ode->ref;
+    struct rebx_force* const effect = ode->ref;
+    struct reb_simulation* sim = effect->sim;
     struct rebx_extras* const rebx = sim->extras;
-    unsigned int Nspins = 0;
     const int N_real = sim->N - sim->N_var;
-    for (int i=0; i<N_real; i++){
-        struct reb_particle* p = &sim->particles[i];
-        const double* k2 = rebx_get_param(rebx, p->ap, "k2");
-        if (k2 != NULL){
-            const struct reb_vec3d* Omega = rebx_get_param(rebx, p->ap, "Omega");
-            ode->y[3*Nspins] = Omega->x;
-            ode->y[3*Nspins+1] = Omega->y;
-            ode->y[3*Nspins+2] = Omega->z;
-            Nspins += 1;
-        }
+    const struct rebx_spin_index* const index = rebx_spin_get_index(rebx, effect, sim->particles, N_real);
+    if (index == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+        return;
     }
-
-    if (ode->length != Nspins*3){
+    if (ode->length != index->N_spins*3){
         reb_error(sim, "rebx_spin ODE is not of the expected length.\n");
         exit(1);
     }
+    for (int s=0; s<index->N_spins; s++){
+        const struct reb_vec3d* Omega = index->bodies[s].Omega;
+        ode->y[3*s] = Omega->x;
+        ode->y[3*s+1] = Omega->y;
+        ode->y[3*s+2] = Omega->z;
+    }
 }
 
 static void rebx_spin_sync_post(struct reb_ode* const ode, const double* const y0){
-    struct reb_simulation* sim = ode->ref;
+    struct rebx_force* const effect = ode->ref;
+    struct reb_simulation* sim = effect->sim;
     struct rebx_extras* const rebx = sim->extras;
-    unsigned int Nspins = 0;
     const int N_real = sim->N - sim->N_var;
-    for (int i=0; i<N_real; i++){
-        struct reb_particle* p = &sim->particles[i];
-        const double* k2 = rebx_get_param(rebx, p->ap, "k2");
-        if (k2 != NULL){
-            rebx_set_param_vec3d(rebx, (struct rebx_node**)&p->ap, "Omega", (struct reb_vec3d){.x=y0[3*Nspins], .y=y0[3*Nspins+1], .z=y0[3*Nspins+2]});
-            Nspins += 1;
-        }
+    const struct rebx_spin_index* const index = rebx_spin_get_index(rebx, effect, sim->particles, N_real);
+    if (index == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+        return;
     }
-    if (ode->length != Nspins*3){
+    if (ode->length != index->N_spins*3){
         reb_error(sim, "rebx_spin ODE is not of the expected length.\n");
         exit(0);
     }
+    // Write directly through the cached pointers, rather than walking each particle's param list
+    for (int s=0; s<index->N_spins; s++){
+        struct reb_vec3d* Omega = index->bodies[s].Omega;
+        Omega->x = y0[3*s];
+        Omega->y = y0[3*s+1];
+        Omega->z = y0[3*s+2];
+    }
+    const int every = rebx_spin_every(rebx, effect);
+    if (every > 1){
+        rebx_spin_window_step(sim, effect, index, every);
+    }
 }
 
 void rebx_spin_initialize_ode(struct rebx_extras* const rebx, struct rebx_force* const effect){
     struct reb_simulation* sim = rebx->sim;
-    unsigned int Nspins = 0;
     const int N_real = sim->N - sim->N_var;
-    for (int i=0; i<N_real; i++){
-        struct reb_particle* p = &sim->particles[i];
-        // Only track spin if particle has moment of inertia and valid spin axis set
-        double* I = rebx_get_param(rebx, p->ap, "I");
-        struct reb_vec3d* Omega = rebx_get_param(rebx, p->ap, "Omega");
-        if (I != NULL && Omega != NULL){
-            Nspins += 1;
-        }
+    const struct rebx_spin_index* const index = rebx_spin_get_index(rebx, effect, sim->particles, N_real);
+    if (index == NULL){
+        rebx_error(rebx, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+        return;
     }
 
-    if (Nspins > 0){
-        struct reb_ode* spin_ode = reb_create_ode(sim, Nspins*3);
-        spin_ode->ref = sim;
+    if (index->N_spins > 0){
+        struct reb_ode* spin_ode = reb_create_ode(sim, index->N_spins*3);
+        spin_ode->ref = effect;
         spin_ode->derivatives = rebx_spin_derivatives;
         spin_ode->pre_timestep = rebx_spin_sync_pre;
         spin_ode->post_timestep = rebx_spin_sync_post;
@@ -297,12 +702,23 @@ void rebx_tides_spin(struct reb_simulation* const sim, struct rebx_force* const
       reb_warning(sim, "Spin axes are not being evolved. Call rebx_spin_initialize_ode to evolve\n");
     }
 
+    const int id_k2 = rebx_intern(rebx, "k2");
+    const int id_tau = rebx_intern(rebx, "tau");
+    const int id_Omega = rebx_intern(rebx, "Omega");
+    struct reb_vec3d* const back_reactions = rebx_get_force_scratch(rebx, effect, N*sizeof(*back_reactions));
+    int err;
+    const struct rebx_tides_spin_neighbors* const nl = rebx_tides_spin_get_neighbors(rebx, effect, particles, N, &err);
+    if (back_reactions == NULL || err){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for tides_spin.\n");
+        return;
+    }
+    const int N_active = rebx_get_N_active(sim, N);
     for (int i=0; i<N; i++){
         struct reb_particle* source = &particles[i];
         // Particle must have a k2 set, otherwise we treat this body as a point particle
-        const double* k2 = rebx_get_param(rebx, source->ap, "k2");
-        const double* tau = rebx_get_param(rebx, source->ap, "tau");
-        const struct reb_vec3d* Omega = rebx_get_param(rebx, source->ap, "Omega");
+        const double* k2 = rebx_get_param_by_id(rebx, source->ap, id_k2);
+        const double* tau = rebx_get_param_by_id(rebx, source->ap, id_tau);
+        const struct reb_vec3d* Omega = rebx_get_param_by_id(rebx, source->ap, id_Omega);
 
         // Particle needs all three spin components and k2 to feel additional forces
         if (Omega != NULL && k2 != NULL){
@@ -312,16 +728,31 @@ void rebx_tides_spin(struct reb_simulation* const sim, struct rebx_force* const
             sigma_in = 4 * (*tau) * sim->G / (3. * source->r * source->r * source->r * source->r * source->r * (*k2));
           }
 
-          for (int j=0; j<N; j++){
-              if (i==j){
-                  continue;
-              }
+          const struct rebx_geometry* const g = rebx_get_geometry(rebx, particles, N, i);
+          if (g == NULL){
+              return;
+          }
+          // Without pair filters, every other particle raises tides on i (only the active ones if i is a test particle)
+          const int N_pairs = nl != NULL ? nl->offsets[i+1] - nl->offsets[i] : (i < N_active ? N : N_active);
+          const int* const pairs = nl != NULL ? &nl->neighbors[nl->offsets[i]] : NULL;
+          const int N_sources = rebx_get_N_sources(sim, N_active, N, i);
+#pragma omp parallel for schedule(guided)
+          for (int k=0; k<N_pairs; k++){
+              const int j = pairs != NULL ? pairs[k] : k;
               struct reb_particle* target = &particles[j]; // j raises tides on i
-              if (source->m == 0 || target->m == 0){
+              if (i==j || source->m == 0 || target->m == 0 || !rebx_tides_spin_within_cutoff(nl, source, target)){
+                  back_reactions[k] = (struct reb_vec3d){.x=-0., .y=-0., .z=-0.}; // adding -0. leaves the sum unchanged
                   continue;
               }
 
-              rebx_spin_orbit_accelerations(source, target, G, *k2, sigma_in, *Omega);
+              const struct reb_vec3d back_reaction = rebx_spin_orbit_accelerations(source, target, g, j, G, *k2, sigma_in, *Omega, i < rebx_get_N_sources(sim, N_active, N, j));
+              back_reactions[k] = j < N_sources ? back_reaction : (struct reb_vec3d){.x=-0., .y=-0., .z=-0.};
+          }
+          // Sum back reactions on the source in particle order, so results don't depend on the number of threads
+          for (int k=0; k<N_pairs; k++){
+              source->ax += back_reactions[k].x;
+              source->ay += back_reactions[k].y;
+              source->az += back_reactions[k].z;
           }
       }
     }
@@ -359,28 +790,38 @@ double rebx_tides_spin_energy(struct rebx_extras* const rebx){
     }
     struct reb_simulation* const sim = rebx->sim;
     const int N_real = sim->N - sim->N_var;
+    const int N_active = rebx_get_N_active(sim, N_real);
     struct reb_particle* const particles = sim->particles;
     const double G = sim->G;
     double E=0.;
 
-    for (int i=0; i<N_real; i++){
+    // Only bodies with k2 contribute, so loop over the cached list of them rather than all particles
+    const struct rebx_param_list* const k2s = rebx_get_param_list(rebx, particles, N_real, rebx_intern(rebx, "k2"));
+    if (k2s == NULL){
+        return 0.;
+    }
+    const int id_Omega = rebx_intern(rebx, "Omega");
+    const int id_I = rebx_intern(rebx, "I");
+    for (int k=0; k<k2s->N_particles; k++){
+        const int i = k2s->index[k];
         struct reb_particle* source = &particles[i];
         // Particle must have a k2, radius and mass set, otherwise we treat this body as a point particle
-        const double* k2 = rebx_get_param(rebx, source->ap, "k2");
-        const struct reb_vec3d* Omegaptr = rebx_get_param(rebx, source->ap, "Omega");
-        if (k2 == NULL || source->m == 0 || source->r == 0){
+        const double* const k2 = k2s->values[k];
+        if (source->m == 0 || source->r == 0){
             continue;
         }
+        const struct reb_vec3d* Omegaptr = rebx_get_param_by_id(rebx, source->ap, id_Omega);
         struct reb_vec3d Omega = {0};
         if (Omegaptr != NULL){
             Omega = *Omegaptr;
         }
-        double* I = rebx_get_param(rebx, source->ap, "I");
+        const double* const I = rebx_get_param_by_id(rebx, source->ap, id_I);
         if (I != NULL){
             const double omega_squared = Omega.x * Omega.x + Omega.y * Omega.y + Omega.z * Omega.z;
             E += 0.5 * (*I) * omega_squared;
         }
-        for (int j=0; j<N_real; j++){
+        const int N_sources = rebx_get_N_sources(sim, N_active, N_real, i);
+        for (int j=0; j<N_sources; j++){
             if (i==j){
                 continue;
             }
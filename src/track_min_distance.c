@@ -38,14 +38,29 @@
  *
  * **Effect Parameters**
  * 
- * *None*
+ * With many tracked particles, most are far from their targets most of the time. Setting min_distance_skip_factor lets the effect skip a particle
+ * until it could first get within min_distance, assuming it closes in at min_distance_skip_factor times its current relative speed.
+ * Larger values are more conservative (accelerations during close approaches can increase the relative speed).
+ *
+ * ================================ =========== =======================================================
+ * Name (C type)                    Required    Description
+ * ================================ =========== =======================================================
+ * min_distance_skip_factor (double) No         If set, skip particles that can't reach min_distance before the next check (see above).
+ * min_distance_interpolate (int)   No          If nonzero, also find minima between calls (see below).
+ * ================================ =========== =======================================================
+ *
+ * By default, distances are only sampled when the operator is called. With min_distance_interpolate, when a particle approaches its
+ * source at the previous call and recedes at the current one, the minimum in between is found on the cubic Hermite interpolant of the
+ * separation, built from the positions and velocities at both calls. min_distance_orbit is then calculated at the interpolated point.
  * 
  * **Particle Parameters**
  * 
  * Only particles with their ``min_distance`` parameter set initially will track their minimum distance. The effect will
  * update this parameter when the particle gets closer than the value of ``min_distance``, so the user has to set it
  * initially.  By default, distance is measured from sim->particles[0], but you can specify a different particle by setting
- * the ``min_distance_from`` parameter to the hash of the target particle.
+ * the ``min_distance_from`` parameter to the hash of the target particle. Alternatively, setting ``min_distance_target``
+ * on several particles (e.g. planets) measures the distance from the closest of them, and ``min_distance_closest`` is
+ * set to the hash of the target at the minimum distance.
  * 
  * ================================ =========== =======================================================
  * Name (C type)                    Required    Description
@@ -53,6 +68,8 @@
  * min_distance (double)            Yes         Particle's mininimum distance.
  * min_distance_from (uint32)       No          Hash for particle from which to measure distance
  * min_distance_orbit (reb_orbit)   No          Parameter to store orbital elements at moment corresponding to min_distance (heliocentric)
+ * min_distance_target (int)        No          Set on the bodies to measure from, for particles without min_distance_from
+ * min_distance_closest (uint32)    No          Set by the effect to the hash of the target at min_distance (0 until one is found), when using min_distance_target
  * ================================ =========== =======================================================
  *
  */
@@ -62,34 +79,303 @@
 #include <math.h>
 #include "rebound.h"
 #include "reboundx.h"
+#include "rebxtools.h"
 
-void rebx_track_min_distance(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
+/* Tracked particles and their targets are cached on the operator, and only looked up again when particles are added or
+ * removed or params change (rebx->param_generation). Targets are stored as indices, and their hashes checked before use. */
+// Separation from a source at the last check, for interpolating between checks
+struct rebx_tmd_sample{
+    double x, y, z;
+    double vx, vy, vz;
+};
+
+struct rebx_tmd_tracked{
+    int index;                      // Index of the tracked particle in sim->particles
+    double* min_distance;
+    const uint32_t* from;           // NULL if measuring from particles[0] or the min_distance_target bodies
+    uint32_t* closest;              // min_distance_closest if measuring from the min_distance_target bodies, NULL otherwise
+    int from_index;                 // Index of the particle with hash *from
+    struct reb_orbit* orbit;        // NULL if not set
+    double t_next;                  // Next time the particle needs to be checked, if skipping
+    int has_samples;                // 1 if samples hold the separations from the last call
+    double t_sample;                // Time of the samples
+};
+
+struct rebx_tmd_cache{
+    int N;
+    unsigned int param_generation;
+    int N_tracked;
+    int N_targets;                  // Number of bodies with min_distance_target set
+    int N_allocated;
+    struct rebx_tmd_tracked* tracked;
+    int* targets;                   // Indices of bodies with min_distance_target set
+    int N_samples_allocated;
+    struct rebx_tmd_sample* samples;// N_tracked x max(N_targets, 1). Only allocated for min_distance_interpolate
+};
+
+static void rebx_tmd_free_workspace(struct rebx_extras* const rebx, struct rebx_operator* const operator){
+    struct rebx_tmd_cache* const cache = rebx_get_param(rebx, operator->ap, "tmd_cache");
+    if (cache == NULL){
+        return;
+    }
+    free(cache->tracked);
+    free(cache->targets);
+    free(cache->samples);
+    free(cache);
+    rebx_set_param_pointer(rebx, &operator->ap, "tmd_cache", NULL);
+}
+
+static void rebx_tmd_workspace_memory(struct rebx_extras* const rebx, struct rebx_operator* const operator, struct rebx_memory_usage* const usage){
+    const struct rebx_tmd_cache* const cache = rebx_get_param(rebx, operator->ap, "tmd_cache");
+    if (cache == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cache, sizeof(*cache));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cache->tracked, cache->N_allocated*sizeof(*cache->tracked));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cache->targets, cache->N_allocated*sizeof(*cache->targets));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, cache->samples, cache->N_samples_allocated*sizeof(*cache->samples));
+}
+
+static int rebx_tmd_find(struct reb_simulation* const sim, const uint32_t hash){
+    struct reb_particle* const p = reb_get_particle_by_hash(sim, hash);
+    return p == NULL ? -1 : (int)(p - sim->particles);
+}
+
+// Returns the up to date cache, or NULL (after raising an error) if memory could not be allocated
+static struct rebx_tmd_cache* rebx_tmd_get_cache(struct reb_simulation* const sim, struct rebx_operator* const operator, const int N){
     struct rebx_extras* const rebx = sim->extras;
-    const int N = sim->N - sim->N_var;
+    struct rebx_tmd_cache* cache = rebx_get_param(rebx, operator->ap, "tmd_cache");
+    if (cache == NULL){
+        cache = calloc(1, sizeof(*cache));
+        if (cache == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for track_min_distance.\n");
+            return NULL;
+        }
+        cache->N = -1; // never matches, so gets built below
+        // Adding these params increments param_generation, so do it before building
+        rebx_set_param_pointer(rebx, &operator->ap, "tmd_cache", cache);
+        rebx_set_param_pointer(rebx, &operator->ap, "free_workspace", rebx_tmd_free_workspace);
+        rebx_set_param_pointer(rebx, &operator->ap, "workspace_memory", rebx_tmd_workspace_memory);
+    }
+    if (cache->N == N && cache->param_generation == rebx->param_generation){
+        return cache;
+    }
+
+    if (N > cache->N_allocated){
+        struct rebx_tmd_tracked* tracked = realloc(cache->tracked, N*sizeof(*tracked));
+        int* targets = realloc(cache->targets, N*sizeof(*targets));
+        if (tracked != NULL){
+            cache->tracked = tracked;
+        }
+        if (targets != NULL){
+            cache->targets = targets;
+        }
+        if (tracked == NULL || targets == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for track_min_distance.\n");
+            return NULL;
+        }
+        cache->N_allocated = N;
+    }
+    const int id_min_distance = rebx_intern(rebx, "min_distance");
+    const int id_min_distance_from = rebx_intern(rebx, "min_distance_from");
+    const int id_min_distance_orbit = rebx_intern(rebx, "min_distance_orbit");
+    const int id_min_distance_target = rebx_intern(rebx, "min_distance_target");
+    const int id_min_distance_closest = rebx_intern(rebx, "min_distance_closest");
+    cache->N_tracked = 0;
+    cache->N_targets = 0;
+    for(int i=0; i<N; i++){
+        const int* const target = rebx_get_param_by_id(rebx, sim->particles[i].ap, id_min_distance_target);
+        if (target != NULL && *target){
+            cache->targets[cache->N_targets++] = i;
+        }
+    }
+    if (cache->N_targets > 0){
+        // Adding min_distance_closest increments param_generation, so add it (hash 0 until a target is found) before caching any pointers
+        for(int i=0; i<N; i++){
+            struct reb_particle* const p = &sim->particles[i];
+            if (rebx_get_param_by_id(rebx, p->ap, id_min_distance) != NULL && rebx_get_param_by_id(rebx, p->ap, id_min_distance_from) == NULL && rebx_get_param_by_id(rebx, p->ap, id_min_distance_closest) == NULL){
+                rebx_set_param_uint32(rebx, (struct rebx_node**)&p->ap, "min_distance_closest", 0);
+            }
+        }
+    }
     for(int i=0; i<N; i++){
         struct reb_particle* const p = &sim->particles[i];
-        double* min_distance = rebx_get_param(rebx, p->ap, "min_distance");
-        if (min_distance != NULL){
-            const uint32_t* const target = rebx_get_param(rebx, p->ap, "min_distance_from");
-            struct reb_particle* source;
-            if (target == NULL){
-                source = &sim->particles[0];
+        double* const min_distance = rebx_get_param_by_id(rebx, p->ap, id_min_distance);
+        if (min_distance == NULL){
+            continue;
+        }
+        struct rebx_tmd_tracked* const t = &cache->tracked[cache->N_tracked++];
+        t->index = i;
+        t->min_distance = min_distance;
+        t->from = rebx_get_param_by_id(rebx, p->ap, id_min_distance_from);
+        t->from_index = t->from != NULL ? rebx_tmd_find(sim, *t->from) : 0;
+        t->closest = t->from == NULL && cache->N_targets > 0 ? rebx_get_param_by_id(rebx, p->ap, id_min_distance_closest) : NULL;
+        t->orbit = rebx_get_param_by_id(rebx, p->ap, id_min_distance_orbit);
+        t->t_next = -INFINITY;
+        t->has_samples = 0;
+    }
+    cache->N = N;
+    cache->param_generation = rebx->param_generation;
+    return cache;
+}
+
+// Cubic Hermite interpolant of the separation between samples a (s=0) and b (s=1), h apart in time
+static struct rebx_tmd_sample rebx_tmd_hermite(const struct rebx_tmd_sample* const a, const struct rebx_tmd_sample* const b, const double h, const double s){
+    const double s2 = s*s;
+    const double s3 = s2*s;
+    const double h00 = 2.*s3 - 3.*s2 + 1.;
+    const double h10 = (s3 - 2.*s2 + s)*h;
+    const double h01 = -2.*s3 + 3.*s2;
+    const double h11 = (s3 - s2)*h;
+    const double d00 = (6.*s2 - 6.*s)/h; // derivatives, divided by h to give velocities
+    const double d10 = 3.*s2 - 4.*s + 1.;
+    const double d11 = 3.*s2 - 2.*s;
+    struct rebx_tmd_sample r;
+    r.x = h00*a->x + h10*a->vx + h01*b->x + h11*b->vx;
+    r.y = h00*a->y + h10*a->vy + h01*b->y + h11*b->vy;
+    r.z = h00*a->z + h10*a->vz + h01*b->z + h11*b->vz;
+    r.vx = d00*(a->x - b->x) + d10*a->vx + d11*b->vx;
+    r.vy = d00*(a->y - b->y) + d10*a->vy + d11*b->vy;
+    r.vz = d00*(a->z - b->z) + d10*a->vz + d11*b->vz;
+    return r;
+}
+
+static double rebx_tmd_r2(const struct rebx_tmd_sample* const r){
+    return r->x*r->x + r->y*r->y + r->z*r->z;
+}
+
+// Minimum of the separation on the interpolant between samples a and b. Only called when approaching at a and receding at b,
+// so the minimum is in between, and we find it by golden section search.
+static struct rebx_tmd_sample rebx_tmd_interpolated_min(const struct rebx_tmd_sample* const a, const struct rebx_tmd_sample* const b, const double h){
+    const double invphi = 0.5*(sqrt(5.) - 1.);
+    double lo = 0.;
+    double hi = 1.;
+    double s1 = hi - invphi*(hi - lo);
+    double s2 = lo + invphi*(hi - lo);
+    struct rebx_tmd_sample r1 = rebx_tmd_hermite(a, b, h, s1);
+    struct rebx_tmd_sample r2 = rebx_tmd_hermite(a, b, h, s2);
+    for (int k=0; k<40; k++){ // interval shrinks by 0.618 each iteration, so 40 gives ~1e-8 of the step
+        if (rebx_tmd_r2(&r1) < rebx_tmd_r2(&r2)){
+            hi = s2;
+            s2 = s1;
+            r2 = r1;
+            s1 = hi - invphi*(hi - lo);
+            r1 = rebx_tmd_hermite(a, b, h, s1);
+        }
+        else{
+            lo = s1;
+            s1 = s2;
+            r1 = r2;
+            s2 = lo + invphi*(hi - lo);
+            r2 = rebx_tmd_hermite(a, b, h, s2);
+        }
+    }
+    return rebx_tmd_r2(&r1) < rebx_tmd_r2(&r2) ? r1 : r2;
+}
+
+void rebx_track_min_distance(struct reb_simulation* const sim, struct rebx_operator* const operator, const double dt){
+    struct rebx_extras* const rebx = sim->extras;
+    const int N = sim->N - sim->N_var;
+    struct rebx_tmd_cache* const cache = rebx_tmd_get_cache(sim, operator, N);
+    if (cache == NULL){
+        return;
+    }
+    const double* const skip_factor = rebx_get_param(rebx, operator->ap, "min_distance_skip_factor");
+    const int* const interpolate_ptr = rebx_get_param(rebx, operator->ap, "min_distance_interpolate");
+    const int interpolate = interpolate_ptr != NULL && *interpolate_ptr;
+    const int stride = cache->N_targets > 0 ? cache->N_targets : 1;
+    if (interpolate && cache->N_tracked*stride > cache->N_samples_allocated){
+        struct rebx_tmd_sample* samples = realloc(cache->samples, cache->N_tracked*stride*sizeof(*samples));
+        if (samples == NULL){
+            reb_error(sim, "REBOUNDx Error: Could not allocate memory for track_min_distance.\n");
+            return;
+        }
+        cache->samples = samples;
+        cache->N_samples_allocated = cache->N_tracked*stride;
+    }
+    const double direction = dt < 0. ? -1. : 1.; // times below are multiplied by this, so they increase when integrating backwards too
+    const double t_now = direction*sim->t;
+    for(int k=0; k<cache->N_tracked; k++){
+        struct rebx_tmd_tracked* const tracked = &cache->tracked[k];
+        if (skip_factor != NULL && t_now < tracked->t_next){
+            tracked->has_samples = 0; // too old to interpolate from at the next check
+            continue;
+        }
+        struct reb_particle* const p = &sim->particles[tracked->index];
+
+        // Sources this particle measures from (targets are only used for particles without min_distance_from)
+        int N_sources = 1;
+        const int* sources = &tracked->from_index;
+        if (tracked->from != NULL){
+            if (tracked->from_index < 0 || sim->particles[tracked->from_index].hash != *tracked->from){ // particles were reordered, or hash changed
+                tracked->from_index = rebx_tmd_find(sim, *tracked->from);
+                if (tracked->from_index < 0){
+                    reb_error(sim, "REBOUNDx Error: Particle with hash min_distance_from not found in track_min_distance.\n");
+                    continue;
+                }
             }
-            else{
-                source = reb_get_particle_by_hash(sim, *target);
+        }
+        else if (cache->N_targets > 0){
+            N_sources = cache->N_targets;
+            sources = cache->targets;
+        }
+
+        double dt_skip = INFINITY;
+        for (int s=0; s<N_sources; s++){
+            if (sources == cache->targets && sources[s] == tracked->index){
+                continue; // a target measuring its distance from the other targets
             }
+            struct reb_particle* const source = &sim->particles[sources[s]];
             const double dx = p->x-source->x;
             const double dy = p->y-source->y;
             const double dz = p->z-source->z;
             const double r2 = dx*dx + dy*dy + dz*dz;
-            if (r2 < *min_distance*(*min_distance)){
-                *min_distance = sqrt(r2);
-                struct reb_orbit* const orbit = rebx_get_param(rebx, p->ap, "min_distance_orbit");
-                if (orbit != NULL){
-                    *orbit = reb_tools_particle_to_orbit(sim->G, *p, *source);
+            if (r2 < *tracked->min_distance*(*tracked->min_distance)){
+                *tracked->min_distance = sqrt(r2);
+                if (tracked->orbit != NULL){
+                    *tracked->orbit = reb_tools_particle_to_orbit(sim->G, *p, *source);
+                }
+                if (tracked->closest != NULL){
+                    *tracked->closest = source->hash;
+                }
+            }
+            if (interpolate){
+                struct rebx_tmd_sample* const sample = &cache->samples[k*stride + s];
+                const struct rebx_tmd_sample current = {.x=dx, .y=dy, .z=dz, .vx=p->vx-source->vx, .vy=p->vy-source->vy, .vz=p->vz-source->vz};
+                const double h = sim->t - tracked->t_sample;
+                // Approaching at the last call and receding now, so the closest approach was in between
+                if (tracked->has_samples && h != 0. && h*(sample->x*sample->vx + sample->y*sample->vy + sample->z*sample->vz) < 0. && h*(dx*current.vx + dy*current.vy + dz*current.vz) > 0.){
+                    const struct rebx_tmd_sample rmin = rebx_tmd_interpolated_min(sample, &current, h);
+                    const double rmin2 = rebx_tmd_r2(&rmin);
+                    if (rmin2 < *tracked->min_distance*(*tracked->min_distance)){
+                        *tracked->min_distance = sqrt(rmin2);
+                        if (tracked->orbit != NULL){
+                            const struct reb_particle primary = {.m=source->m};
+                            const struct reb_particle interpolated = {.m=p->m, .x=rmin.x, .y=rmin.y, .z=rmin.z, .vx=rmin.vx, .vy=rmin.vy, .vz=rmin.vz};
+                            *tracked->orbit = reb_tools_particle_to_orbit(sim->G, interpolated, primary);
+                        }
+                        if (tracked->closest != NULL){
+                            *tracked->closest = source->hash;
+                        }
+                    }
                 }
+                *sample = current;
             }
+            if (skip_factor != NULL){
+                const double dvx = p->vx-source->vx;
+                const double dvy = p->vy-source->vy;
+                const double dvz = p->vz-source->vz;
+                const double closing_speed = *skip_factor*sqrt(dvx*dvx + dvy*dvy + dvz*dvz);
+                const double gap = sqrt(r2) - *tracked->min_distance; // 0 once within min_distance, so never skips
+                dt_skip = fmin(dt_skip, closing_speed > 0. ? gap/closing_speed : 0.);
+            }
+        }
+        if (skip_factor != NULL){
+            tracked->t_next = dt_skip > 0. ? t_now + dt_skip : -INFINITY;
+        }
+        if (interpolate){
+            tracked->has_samples = 1;
+            tracked->t_sample = sim->t;
         }
     }
 }
-
@@ -51,8 +51,15 @@
  * tIm_scale_height_1 (double)           Yes         The scale height at one code unit from the star; used to find the aspect ratio at any distance from the star
  * tIm_surface_density_exponent (double) Yes         Exponent of disk surface density, indicative of the surface density profile of the disk
  * tIm_flaring_index (double)            Yes         The flaring index; 1 means disk is irradiated by only the stellar flux
+ * tIm_table_N (int)                     No          If set, tabulate the disk profile at this many points between tIm_table_rmin and tIm_table_rmax (see below)
+ * tIm_table_rmin (double)               No          Inner edge of the tabulated disk profile. Required with tIm_table_N
+ * tIm_table_rmax (double)               No          Outer edge of the tabulated disk profile. Required with tIm_table_N
  * ===================================== =========== ==================================================================================================================
  *
+ * By default the surface density, aspect ratio and inner disk edge factor are calculated from their power laws for every planet at every step.
+ * With tIm_table_N set, they are instead tabulated with their derivatives on a uniform grid (rebuilt whenever a disk parameter changes),
+ * and evaluated by cubic Hermite interpolation, which is accurate to order (grid spacing)^4. Planets outside the table use the power laws.
+ *
  */
 
 #include <stdio.h>
@@ -66,12 +73,16 @@
 /* Calculating the t_wave: damping timescale or orbital evolution timescale, from Tanaka & Ward 2004. 
 h = aspect ratio, h2 = aspect ratio squared, sma = semi-major axis, sd = disk surface denisty to be calculated at every r, ms = stellar mass, mp = planet mass */
 
+static double rebx_calculate_damping_timescale_sd(const double G, const double sd, const double ms, const double mp, const double sma, const double h2){
+    return (sqrt(ms*ms*ms)*h2*h2)/(mp*sd*sqrt(sma*G));
+}
+
 const double rebx_calculate_damping_timescale(const double G, const double sd0, const double r, const double s, const double ms, const double mp, const double sma, const double h2){
     double sd;
     double t_wave;
     
     sd = sd0*pow(r, -s);
-    t_wave = (sqrt(ms*ms*ms)*h2*h2)/(mp*sd*sqrt(sma*G));
+    t_wave = rebx_calculate_damping_timescale_sd(G, sd, ms, mp, sma, h2);
 
     return t_wave;
 }
@@ -112,18 +123,161 @@ const double rebx_calculate_inclination_damping_timescale(const double wave, con
     return t_i;
 }
 
-static struct reb_vec3d rebx_calculate_modify_orbits_with_type_I_migration(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* p, struct reb_particle* source){
-    double invtau_mig;
-    double tau_e;
-    double tau_inc;
+/* A radial profile tabulated with its derivative at N uniformly spaced points, for cubic Hermite interpolation */
+struct rebx_tIm_profile{
+    int N;                  // 0 if not tabulated
+    double x0;
+    double dx;
+    double inv_dx;
+    double* values;         // 2N. Value and derivative times dx at each point
+};
+
+/* Tabulated disk profile, stored on the force as "tIm_tables". Rebuilt when any of the params it was built from change */
+struct rebx_tIm_tables{
+    int N;
+    double rmin, rmax, beta, h0, sd0, s, dedge, hedge;
+    struct rebx_tIm_profile sd;     // Surface density vs distance
+    struct rebx_tIm_profile h;      // Aspect ratio vs distance
+    struct rebx_tIm_profile trap;   // Inner disk edge factor vs semimajor axis, only across the edge where it isn't constant
+};
+
+static void rebx_tIm_free_workspace(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_tIm_tables* const tables = rebx_get_param(rebx, force->ap, "tIm_tables");
+    if (tables == NULL){
+        return;
+    }
+    free(tables->sd.values);
+    free(tables->h.values);
+    free(tables->trap.values);
+    free(tables);
+    rebx_set_param_pointer(rebx, &force->ap, "tIm_tables", NULL);
+}
+
+static void rebx_tIm_workspace_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const struct rebx_tIm_tables* const tables = rebx_get_param(rebx, force->ap, "tIm_tables");
+    if (tables == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, tables, sizeof(*tables));
+    const struct rebx_tIm_profile* const profiles[3] = {&tables->sd, &tables->h, &tables->trap};
+    for (int k=0; k<3; k++){
+        rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, profiles[k]->values, 2*profiles[k]->N*sizeof(*profiles[k]->values));
+    }
+}
+
+static int rebx_tIm_profile_allocate(struct rebx_tIm_profile* const profile, const int N, const double xmin, const double xmax){
+    double* values = realloc(profile->values, 2*N*sizeof(*values));
+    if (values == NULL){
+        return 0;
+    }
+    profile->values = values;
+    profile->N = N;
+    profile->x0 = xmin;
+    profile->dx = (xmax - xmin)/(N - 1);
+    profile->inv_dx = 1./profile->dx;
+    return 1;
+}
+
+/* Returns 1 and sets *f if x is inside the table */
+static int rebx_tIm_interpolate(const struct rebx_tIm_profile* const profile, const double x, double* const f){
+    const double u = (x - profile->x0)*profile->inv_dx;
+    if (!(u >= 0. && u < profile->N - 1)){ // also catches NaN and untabulated profiles
+        return 0;
+    }
+    const int k = (int)u;
+    const double t = u - k;
+    const double* const v = &profile->values[2*k];
+    const double t2 = t*t;
+    const double t3 = t2*t;
+    *f = (2.*t3 - 3.*t2 + 1.)*v[0] + (t3 - 2.*t2 + t)*v[1] + (-2.*t3 + 3.*t2)*v[2] + (t3 - t2)*v[3];
+    return 1;
+}
+
+static struct rebx_tIm_tables* rebx_tIm_get_tables(struct reb_simulation* const sim, struct rebx_force* const force, const int N, const double rmin, const double rmax, const double beta, const double h0, const double sd0, const double s, const double dedge, const double hedge){
+    struct rebx_extras* const rebx = sim->extras;
+    struct rebx_tIm_tables* tables = rebx_get_param(rebx, force->ap, "tIm_tables");
+    if (tables == NULL){
+        tables = calloc(1, sizeof(*tables));
+        if (tables == NULL){
+            return NULL;
+        }
+        rebx_set_param_pointer(rebx, &force->ap, "tIm_tables", tables);
+        rebx_set_param_pointer(rebx, &force->ap, "free_workspace", rebx_tIm_free_workspace);
+        rebx_set_param_pointer(rebx, &force->ap, "workspace_memory", rebx_tIm_workspace_memory);
+    }
+    if (tables->N == N && tables->rmin == rmin && tables->rmax == rmax && tables->beta == beta && tables->h0 == h0
+            && tables->sd0 == sd0 && tables->s == s && tables->dedge == dedge && tables->hedge == hedge){
+        return tables;
+    }
+
+    tables->N = 0;
+    if (!rebx_tIm_profile_allocate(&tables->sd, N, rmin, rmax) || !rebx_tIm_profile_allocate(&tables->h, N, rmin, rmax)){
+        return NULL;
+    }
+    for (int k=0; k<N; k++){
+        const double r = rmin + k*tables->sd.dx;
+        const double sd = sd0*pow(r, -s);
+        const double h = h0*pow(r, beta);
+        tables->sd.values[2*k] = sd;
+        tables->sd.values[2*k+1] = -s*sd/r*tables->sd.dx;
+        tables->h.values[2*k] = h;
+        tables->h.values[2*k+1] = beta*h/r*tables->h.dx;
+    }
+
+    tables->trap.N = 0;
+    const double width = 2.*hedge*dedge;
+    if (width > 0.){
+        if (!rebx_tIm_profile_allocate(&tables->trap, N, dedge*(1.0 - hedge), dedge*(1.0 + hedge))){
+            return NULL;
+        }
+        const double omega = 2*M_PI/(4*hedge*dedge); // matches rebx_calculate_planet_trap
+        for (int k=0; k<N; k++){
+            const double a = tables->trap.x0 + k*tables->trap.dx;
+            const double phase = (dedge*(1.0 + hedge) - a)*omega;
+            tables->trap.values[2*k] = 5.5*cos(phase) - 4.5;
+            tables->trap.values[2*k+1] = 5.5*omega*sin(phase)*tables->trap.dx;
+        }
+    }
+
+    tables->N = N;
+    tables->rmin = rmin;
+    tables->rmax = rmax;
+    tables->beta = beta;
+    tables->h0 = h0;
+    tables->sd0 = sd0;
+    tables->s = s;
+    tables->dedge = dedge;
+    tables->hedge = hedge;
+    return tables;
+}
+
+/* Disk parameters, looked up once per evaluation in rebx_modify_orbits_with_type_I_migration_constants rather than for every particle */
+struct rebx_tIm_constants{
+    const struct reb_particle* particles;   // Array and time they were looked up for
+    double t;
+    double beta;
+    double h0;
+    double sd0;
+    double s;
+    double dedge;
+    double hedge;
+    const struct rebx_tIm_tables* tables;   // NULL unless tIm_table_N is set
+};
+
+void rebx_modify_orbits_with_type_I_migration_constants(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
+    struct rebx_tIm_constants* const c = rebx_get_force_constants(sim->extras, force, sizeof(*c));
+    if (c == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for type_I_migration.\n");
+        return;
+    }
 
     /* Default values for the parameters in case the user forgets to define them when using this code */
-    double beta = 0.0;
-    double h0 = 0.01;
-    double sd0 = 0.0;
-    double s = 0.0;
-    double dedge = 0.0;
-    double hedge = 0.0;
+    c->beta = 0.0;
+    c->h0 = 0.01;
+    c->sd0 = 0.0;
+    c->s = 0.0;
+    c->dedge = 0.0;
+    c->hedge = 0.0;
 
     /* Parameters that should be changed/set in Python notebook or in C outside of this */
     const double* const dedge_ptr = rebx_get_param(sim->extras, force->ap, "ide_position");
@@ -133,6 +287,57 @@ static struct reb_vec3d rebx_calculate_modify_orbits_with_type_I_migration(struc
     const double* const sd0_ptr = rebx_get_param(sim->extras, force->ap, "tIm_surface_density_1");
     const double* const h0_ptr = rebx_get_param(sim->extras, force->ap, "tIm_scale_height_1");
 
+    if (beta_ptr != NULL){
+        c->beta = *beta_ptr;
+    }
+    if (s_ptr != NULL){
+        c->s = *s_ptr;
+    }
+    if (sd0_ptr != NULL){
+        c->sd0 = *sd0_ptr;
+    }
+    if (h0_ptr != NULL){
+        c->h0 = *h0_ptr;
+    }
+    if (dedge_ptr != NULL){
+        c->dedge = *dedge_ptr;
+    }
+    if (hedge_ptr != NULL){
+        c->hedge = *hedge_ptr;
+    }
+
+    c->tables = NULL;
+    const int* const table_N = rebx_get_param(sim->extras, force->ap, "tIm_table_N");
+    if (table_N != NULL){
+        const double* const rmin = rebx_get_param(sim->extras, force->ap, "tIm_table_rmin");
+        const double* const rmax = rebx_get_param(sim->extras, force->ap, "tIm_table_rmax");
+        if (rmin == NULL || rmax == NULL || !(*rmin > 0.) || !(*rmax > *rmin) || *table_N < 2){
+            reb_error(sim, "REBOUNDx Error: tIm_table_N needs tIm_table_rmin and tIm_table_rmax set, with 0 < tIm_table_rmin < tIm_table_rmax, and at least 2 points.\n");
+        }
+        else{
+            c->tables = rebx_tIm_get_tables(sim, force, *table_N, *rmin, *rmax, c->beta, c->h0, c->sd0, c->s, c->dedge, c->hedge);
+            if (c->tables == NULL){
+                reb_error(sim, "REBOUNDx Error: Could not allocate memory for type_I_migration.\n");
+            }
+        }
+    }
+    c->particles = particles;
+    c->t = sim->t;
+}
+
+static struct reb_vec3d rebx_calculate_modify_orbits_with_type_I_migration(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* p, struct reb_particle* source){
+    double invtau_mig;
+    double tau_e;
+    double tau_inc;
+
+    const struct rebx_tIm_constants* const c = rebx_get_force_constants(sim->extras, force, 0); // filled by rebx_modify_orbits_with_type_I_migration
+    const double beta = c->beta;
+    const double h0 = c->h0;
+    const double sd0 = c->sd0;
+    const double s = c->s;
+    const double dedge = c->dedge;
+    const double hedge = c->hedge;
+
     /* Accessing the calculated semi-major axis, eccentricity and inclination for each integration step, via modify_orbits_direct where they are calculated and returned*/
     int err=0;
     struct reb_orbit o = reb_tools_particle_to_orbit_err(sim->G, *p, *source, &err);
@@ -151,36 +356,29 @@ static struct reb_vec3d rebx_calculate_modify_orbits_with_type_I_migration(struc
     const double dz = p->z-source->z;
     const double r2 = dx*dx + dy*dy + dz*dz;
 
-    if (beta_ptr != NULL){
-        beta = *beta_ptr;
-    }
-    if (s_ptr != NULL){
-        s = *s_ptr;
-    }
-    if (sd0_ptr != NULL){
-        sd0 = *sd0_ptr;
-    }
-    if (h0_ptr != NULL){
-        h0 = *h0_ptr;
-    }
-    if (dedge_ptr != NULL){
-        dedge = *dedge_ptr;
-    }
-    if (hedge_ptr != NULL){
-        hedge = *hedge_ptr;
-    }
-
     /* Calculating the aspect ratio evaluated at the position of the planet, r and defining other variables */
 
-    const double h = (h0) * pow(r2, beta/2); 
+    const double G = sim->G;
+    double h, wave, trap;
+    double sd;
+    const double r = sqrt(r2);
+    if (c->tables != NULL && rebx_tIm_interpolate(&c->tables->h, r, &h) && rebx_tIm_interpolate(&c->tables->sd, r, &sd)){
+        const double h2 = h*h;
+        wave = rebx_calculate_damping_timescale_sd(G, sd, ms, mp, a0, h2);
+    }
+    else{
+        h = (h0) * pow(r2, beta/2); 
+        wave = rebx_calculate_damping_timescale(G, sd0, r, s, ms, mp, a0, h*h);
+    }
     const double h2 = h*h;
 
     const double eh = e0/h;
     const double ih = inc0/h;
 
-    const double G = sim->G;
-    const double wave = rebx_calculate_damping_timescale(G, sd0, sqrt(r2), s, ms, mp, a0, h2);
-    invtau_mig = rebx_calculate_planet_trap(a0, dedge, hedge)/(rebx_calculate_migration_timescale(wave, eh, ih, h2, s));
+    if (c->tables == NULL || !rebx_tIm_interpolate(&c->tables->trap, a0, &trap)){ // the edge factor is constant outside its table
+        trap = rebx_calculate_planet_trap(a0, dedge, hedge);
+    }
+    invtau_mig = trap/(rebx_calculate_migration_timescale(wave, eh, ih, h2, s));
     tau_e = rebx_calculate_eccentricity_damping_timescale(wave, eh, ih);
     tau_inc = rebx_calculate_inclination_damping_timescale(wave, eh, ih);
 
@@ -208,6 +406,14 @@ void rebx_modify_orbits_with_type_I_migration(struct reb_simulation* const sim,
     if (ptr != NULL){
         coordinates = *ptr;
     }
+    const struct rebx_tIm_constants* const c = rebx_get_force_constants(sim->extras, force, sizeof(*c));
+    if (c == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for type_I_migration.\n");
+        return;
+    }
+    if (c->particles != particles || c->t != sim->t){ // update_accelerations was called without update_constants
+        rebx_modify_orbits_with_type_I_migration_constants(sim, force, particles, N);
+    }
     const int back_reactions_inclusive = 1;
     const char* reference_name = "primary";
     rebx_com_force(sim, force, coordinates, back_reactions_inclusive, reference_name, rebx_calculate_modify_orbits_with_type_I_migration, particles, N);
@@ -65,6 +65,9 @@
  * ye_spin_axis_z (float)       No          The z value for the spin axis vector of an object (Required for full version)
  * ============================ =========== ==================================================================
  *
+ * Everything that doesn't depend on a body's orbit (its prefactors and spin axis) is cached and recalculated only when one of
+ * the above params, its radius, or an effect parameter changes.
+ *
  */
 
 #include <stdio.h>
@@ -72,177 +75,311 @@
 #include <stdlib.h>
 #include <float.h>
 #include "reboundx.h"
+#include "rebxtools.h"
 
-static void rebx_calculate_yarkovsky_effect(struct reb_simulation* sim, struct reb_particle* target, struct reb_particle* star, double G, double *density, double *lstar, double *rotation_period, double *Gamma, double *albedo, double *emissivity, double *k, double *c, double *stef_boltz, int *yark_flag, double *sx, double *sy, double *sz){
-    
-    int i; //variables needed for future iteration loops
-    int j;
-    double unit_matrix[3][3] = {{1.0, 0.0, 0.0},{0.0, 1.0, 0.0},{0.0, 0.0, 1.0}};
+// Param values a body's constants were calculated from. Compared on every call, so changing any of them triggers a recalculation
+struct rebx_yark_inputs{
+    int flag;
+    double r;
+    double density;
+    double albedo;
+    double rotation_period;
+    double Gamma;
+    double emissivity;
+    double k;
+    double sx, sy, sz;
+};
 
-    double radius = target->r;
-    
-    double q_yar = 1.0-(*albedo);
-    
-    double dx = target->x - star->x;
-    double dy = target->y - star->y;
-    double dz = target->z - star->z;
-    
-    double dvx = target->vx - star->vx;
-    double dvy = target->vy - star->vy;
-    double dvz = target->vz - star->vz;
-    
-    double distance = sqrt((dx*dx)+(dy*dy)+(dz*dz)); //distance of asteroid from the star
-    
-    double rdotv = ((dx*dvx)+(dy*dvy)+(dz*dvz))/((*c)*distance); //dot product of position and velocity vectors- the term in the denominator is needed when calculating the i-vector
-    
-    double i_vector[3][1];
-    
-    i_vector[0][0] = ((1-rdotv)*(dx/distance))-(dvx/(*c));
-    i_vector[1][0] = ((1-rdotv)*(dy/distance))-(dvy/(*c));
-    i_vector[2][0] = ((1-rdotv)*(dz/distance))-(dvz/(*c));
-    
-    double yarkovsky_magnitude; //magnitude of force created by the effect
+// Cached pointers to a body's params (valid until rebx->param_generation changes), and everything that doesn't depend on its orbit
+struct rebx_yark_body{
+    int index;                      // Index in particles
+    const int* flag;
+    const double* density;
+    const double* albedo;
+    const double* rotation_period;  // The remaining params are only needed (and may be NULL) for the simple version
+    const double* Gamma;
+    const double* emissivity;
+    const double* k;
+    const double* sx;
+    const double* sy;
+    const double* sz;
+    int valid;                      // 1 if the constants below are up to date with inputs
+    struct rebx_yark_inputs inputs;
+    double magnitude;               // Magnitude of the acceleration times distance^2
+    double lq;                      // Absorbed luminosity, lstar*(1-albedo)
+    double thermal;                 // 0.5*(stef_boltz*emissivity/pi^5)^(1/4)/|Gamma|. Multiplies sqrt(period) in tan of the lag angles
+    double sqrt_rotation_period;
+    double s[3];                    // Unit spin axis
+};
 
-    double yark_matrix[3][3] = {{0.0, 0.0, 0.0},{0.0, 0.0, 0.0},{0.0, 0.0, 0.0}};
-    
-    
-    if (*yark_flag == 1) {
-        
-        yark_matrix[1][0] = 1.0; // maximizes the effect pushing outwards
-        
-        yarkovsky_magnitude = (3*q_yar*(*lstar))/(64*M_PI*radius*(*density)*(*c)*distance*distance);
-    }
-    
-    if (*yark_flag == -1) {
-        
-        yark_matrix[0][1] = 1.0; //maximizes the effect pushing inwards
-        
-        yarkovsky_magnitude = (3*q_yar*(*lstar))/(64*M_PI*radius*(*density)*(*c)*distance*distance);
+// Bodies with the params needed for either version, stored on the force as "ye_index"
+struct rebx_yark_index{
+    int built;
+    int N;
+    unsigned int param_generation;
+    double lstar;                   // Force params the constants were calculated with
+    double c;
+    double stef_boltz;
+    int N_bodies;
+    int N_allocated;
+    struct rebx_yark_body* bodies;
+};
+
+static void rebx_yarkovsky_free_workspace(struct rebx_extras* const rebx, struct rebx_force* const force){
+    struct rebx_yark_index* const index = rebx_get_param(rebx, force->ap, "ye_index");
+    if (index == NULL){
+        return;
     }
-    
-    //will run through full equations to create the yark_matrix
-    if (*yark_flag == 0) {
-        
-        //makes sure all necessary parameters have been entered
-        if (stef_boltz == NULL || rotation_period == NULL || Gamma == NULL || albedo == NULL || emissivity == NULL || k == NULL || sx == NULL || sy == NULL || sz == NULL) {
-            reb_error(sim, "REBOUNDx Error: One or more parameters missing for this version of the Yarkovsky effect in Rebx. Please make sure you've given values to all variables for this version before running simulations. See documentation and YarkovskyEffect.ipynb. If you'd rather use the simplified version of this effect (requires fewer parameters), then please set 'yark_flag' to -1 or 1.\n\n");
-            return;
-        }
-        
-        struct reb_orbit o = reb_tools_particle_to_orbit(G, *target, *star);
-        
-        yarkovsky_magnitude = (3*(*k)*q_yar*(*lstar))/(16*M_PI*radius*(*density)*(*c)*distance*distance);
+    free(index->bodies);
+    free(index);
+    rebx_set_param_pointer(rebx, &force->ap, "ye_index", NULL);
+}
 
-        double Smag = sqrt(((*sx)*(*sx))+ (*sy)*(*sy) + (*sz)*(*sz));
-    
-        double hx = (dy*dvz)-(dz*dvy);
-        double hy = (dz*dvx)-(dx*dvz);
-        double hz = (dx*dvy)-(dy*dvx);
-        double Hmag = sqrt((hx*hx)+ (hy*hy) + (hz*hz));
-    
-        double inv_smag = 1.0/Smag;
-        double inv_mag_sqrd = 1.0/(Smag*Smag);
-        double inv_hmag = 1.0/Hmag;
-        double inv_hmag_sqrd = 1.0/(Hmag*Hmag);
-    
-        double R1s[3][3] = {{0.0, -(*sz)*inv_smag, (*sy)*inv_smag},{(*sz)*inv_smag, 0.0, -(*sx)*inv_smag},{-(*sy)*inv_smag, (*sx)*inv_smag, 0.0}};
-        
-        double R2s[3][3] = {{(*sx)*(*sx)*inv_mag_sqrd, (*sx)*(*sy)*inv_mag_sqrd, (*sx)*(*sz)*inv_mag_sqrd},{(*sx)*(*sy)*inv_mag_sqrd, (*sy)*(*sy)*inv_mag_sqrd, (*sy)*(*sz)*inv_mag_sqrd},{(*sx)*(*sz)*inv_mag_sqrd, (*sy)*(*sz)*inv_mag_sqrd, (*sz)*(*sz)*inv_mag_sqrd}};
-        
-        double R1h[3][3] = {{0.0, -hz*inv_hmag, hy*inv_hmag},{hz*inv_hmag, 0.0, -hx*inv_hmag},{-hy*inv_hmag, hx*inv_hmag, 0.0}};
-        
-        double R2h[3][3] = {{hx*hx*inv_hmag_sqrd, hx*hy*inv_hmag_sqrd, hx*hz*inv_hmag_sqrd},{hx*hy*inv_hmag_sqrd, hy*hy*inv_hmag_sqrd, hy*hz*inv_hmag_sqrd},{hx*hz*inv_hmag_sqrd, hy*hz*inv_hmag_sqrd, hz*hz*inv_hmag_sqrd}};
+static void rebx_yarkovsky_workspace_memory(struct rebx_extras* const rebx, struct rebx_force* const force, struct rebx_memory_usage* const usage){
+    const struct rebx_yark_index* const index = rebx_get_param(rebx, force->ap, "ye_index");
+    if (index == NULL){
+        return;
+    }
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, index, sizeof(*index));
+    rebx_memory_add(usage, REBX_MEMORY_WORKSPACES, index->bodies, index->N_allocated*sizeof(*index->bodies));
+}
 
-        double tanPhi = 1.0/(1.0+(.5*pow(((*stef_boltz)*(*emissivity))/(M_PI*M_PI*M_PI*M_PI*M_PI), .25))*sqrt((*rotation_period)/((*Gamma)*(*Gamma)))*pow((*lstar*q_yar)/(distance*distance), .75));
-    
-        double tanEpsilon = 1.0/(1.0+(.5*pow((*stef_boltz*(*emissivity))/(M_PI*M_PI*M_PI*M_PI*M_PI), .25))*sqrt((o.P)/((*Gamma)*(*Gamma)))*pow((*lstar*q_yar)/(distance*distance), .75));
-    
-        double Phi = atan(tanPhi);
-        double Epsilon = atan(tanEpsilon);
-        
-        double cos_phi = cos(Phi);
-        double sin_phi = sin(Phi);
-        double cos_epsilon = cos(Epsilon);
-        double sin_epsilon = sin(Epsilon);
-    
-        double Rys[3][3]; //diurnal conntribution for effect
-    
-        for (i=0; i<3; i++){
-            for (j=0; j<3; j++){
-                Rys[i][j] = (cos_phi*unit_matrix[i][j]) + (sin_phi*R1s[i][j]) + ((1.0-cos_phi)*R2s[i][j]);
-            }
+static struct rebx_yark_index* rebx_yarkovsky_get_index(struct rebx_extras* const rebx, struct rebx_force* const force, struct reb_particle* const particles, const int N){
+    struct rebx_yark_index* index = rebx_get_param(rebx, force->ap, "ye_index");
+    if (index == NULL){
+        index = calloc(1, sizeof(*index));
+        if (index == NULL){
+            return NULL;
         }
-    
-        double Ryh[3][3];
-    
-        for (i=0; i<3; i++){ //seasonal contribution for effect
-            for (j=0; j<3; j++){
-                Ryh[i][j] = (cos_epsilon*unit_matrix[i][j]) - (sin_epsilon*R1h[i][j]) + ((1-cos_epsilon)*R2h[i][j]);
-            }
+        // Adding these params increments param_generation, so do it before building
+        rebx_set_param_pointer(rebx, &force->ap, "ye_index", index);
+        rebx_set_param_pointer(rebx, &force->ap, "free_workspace", rebx_yarkovsky_free_workspace);
+        rebx_set_param_pointer(rebx, &force->ap, "workspace_memory", rebx_yarkovsky_workspace_memory);
+    }
+    if (index->built && index->N == N && index->param_generation == rebx->param_generation){
+        return index;
+    }
+
+    if (N > index->N_allocated){
+        struct rebx_yark_body* bodies = realloc(index->bodies, N*sizeof(*bodies));
+        if (bodies == NULL){
+            return NULL;
         }
-    
-        for (i=0; i<3; i++){
-            for(j=0; j<3; j++){
-                yark_matrix[i][j] = (Rys[i][0]*Ryh[0][j]) + (Rys[i][1]*Ryh[1][j]) + (Rys[i][2]*Ryh[2][j]);
-            }
+        index->bodies = bodies;
+        index->N_allocated = N;
+    }
+    // Intern particle param names so building only does integer compares
+    const int id_density = rebx_intern(rebx, "ye_body_density");
+    const int id_rotation_period = rebx_intern(rebx, "ye_rotation_period");
+    const int id_Gamma = rebx_intern(rebx, "ye_thermal_inertia");
+    const int id_albedo = rebx_intern(rebx, "ye_albedo");
+    const int id_emissivity = rebx_intern(rebx, "ye_emissivity");
+    const int id_k = rebx_intern(rebx, "ye_k");
+    const int id_yark_flag = rebx_intern(rebx, "ye_flag");
+    const int id_sx = rebx_intern(rebx, "ye_spin_axis_x");
+    const int id_sy = rebx_intern(rebx, "ye_spin_axis_y");
+    const int id_sz = rebx_intern(rebx, "ye_spin_axis_z");
+    int N_bodies = 0;
+    for (int i=1; i<N; i++){ // particles[0] is the star
+        struct rebx_node* const ap = particles[i].ap;
+        const int* const flag = rebx_get_param_by_id(rebx, ap, id_yark_flag);
+        const double* const density = rebx_get_param_by_id(rebx, ap, id_density);
+        const double* const albedo = rebx_get_param_by_id(rebx, ap, id_albedo);
+        if (flag == NULL || density == NULL || albedo == NULL){
+            continue;
         }
+        struct rebx_yark_body* const body = &index->bodies[N_bodies];
+        body->index = i;
+        body->flag = flag;
+        body->density = density;
+        body->albedo = albedo;
+        body->rotation_period = rebx_get_param_by_id(rebx, ap, id_rotation_period);
+        body->Gamma = rebx_get_param_by_id(rebx, ap, id_Gamma);
+        body->emissivity = rebx_get_param_by_id(rebx, ap, id_emissivity);
+        body->k = rebx_get_param_by_id(rebx, ap, id_k);
+        body->sx = rebx_get_param_by_id(rebx, ap, id_sx);
+        body->sy = rebx_get_param_by_id(rebx, ap, id_sy);
+        body->sz = rebx_get_param_by_id(rebx, ap, id_sz);
+        body->valid = 0;
+        N_bodies++;
     }
-    
-    double direction_matrix[3][1];
-    
- 
-    
-    //calcuates a vector which gives the direction of the acceleration created by the effect
-    for (i=0; i<3; i++){
-        direction_matrix[i][0] = (yark_matrix[i][0]*i_vector[0][0]) + (yark_matrix[i][1]*i_vector[1][0]) + (yark_matrix[i][2]*i_vector[2][0]);
+    index->N_bodies = N_bodies;
+    index->N = N;
+    index->param_generation = rebx->param_generation;
+    index->built = 1;
+    return index;
+}
+
+static double rebx_yark_value(const double* const ptr){
+    return ptr != NULL ? *ptr : 0.;
+}
+
+// Returns 1 if all the params needed for the body's version of the effect are set
+static int rebx_yarkovsky_update_constants(struct rebx_yark_body* const body, const struct reb_particle* const target, const double lstar, const double c, const double* const stef_boltz){
+    struct rebx_yark_inputs in;
+    in.flag = *body->flag;
+    in.r = target->r;
+    in.density = *body->density;
+    in.albedo = *body->albedo;
+    in.rotation_period = rebx_yark_value(body->rotation_period);
+    in.Gamma = rebx_yark_value(body->Gamma);
+    in.emissivity = rebx_yark_value(body->emissivity);
+    in.k = rebx_yark_value(body->k);
+    in.sx = rebx_yark_value(body->sx);
+    in.sy = rebx_yark_value(body->sy);
+    in.sz = rebx_yark_value(body->sz);
+
+    const struct rebx_yark_inputs* const old = &body->inputs;
+    if (body->valid && in.flag == old->flag && in.r == old->r && in.density == old->density && in.albedo == old->albedo
+            && in.rotation_period == old->rotation_period && in.Gamma == old->Gamma && in.emissivity == old->emissivity
+            && in.k == old->k && in.sx == old->sx && in.sy == old->sy && in.sz == old->sz){
+        return 1;
     }
-    
-    double yarkovsky_acceleration[3][1];
-    
-    for (i=0; i<3; i++){
-     
-        //final result for particle's change in acceleration due to the effect
-        yarkovsky_acceleration[i][0] = (yarkovsky_magnitude*direction_matrix[i][0]);
-        
+
+    if (in.flag == 0 && (stef_boltz == NULL || body->rotation_period == NULL || body->Gamma == NULL || body->emissivity == NULL || body->k == NULL || body->sx == NULL || body->sy == NULL || body->sz == NULL)){
+        body->valid = 0;
+        return 0;
     }
-    
-        //adds Yarkovsky aceleration to the asteroid's acceleration in the sim
-        target->ax += yarkovsky_acceleration[0][0];
-        target->ay += yarkovsky_acceleration[1][0];
-        target->az += yarkovsky_acceleration[2][0];
-    
-    
-    
+    const double q_yar = 1.0-in.albedo;
+    body->lq = lstar*q_yar;
+    if (in.flag == 0){
+        body->magnitude = (3*in.k*q_yar*lstar)/(16*M_PI*in.r*in.density*c);
+        body->thermal = .5*pow((*stef_boltz*in.emissivity)/(M_PI*M_PI*M_PI*M_PI*M_PI), .25)*sqrt(1./(in.Gamma*in.Gamma));
+        body->sqrt_rotation_period = sqrt(in.rotation_period);
+        const double inv_smag = 1.0/sqrt(in.sx*in.sx + in.sy*in.sy + in.sz*in.sz);
+        body->s[0] = in.sx*inv_smag;
+        body->s[1] = in.sy*inv_smag;
+        body->s[2] = in.sz*inv_smag;
+    }
+    else{
+        body->magnitude = (3*q_yar*lstar)/(64*M_PI*in.r*in.density*c);
+    }
+    body->inputs = in;
+    body->valid = 1;
+    return 1;
+}
+
+// Rotates w about the unit vector u by the angle with the given cosine and sine (Rodrigues' formula)
+static void rebx_yark_rotate(double out[3], const double u[3], const double w[3], const double cos_angle, const double sin_angle){
+    const double udotw = u[0]*w[0] + u[1]*w[1] + u[2]*w[2];
+    const double uxw[3] = {u[1]*w[2] - u[2]*w[1], u[2]*w[0] - u[0]*w[2], u[0]*w[1] - u[1]*w[0]};
+    for (int i=0; i<3; i++){
+        out[i] = cos_angle*w[i] + sin_angle*uxw[i] + (1.0-cos_angle)*u[i]*udotw;
+    }
+}
+
+static void rebx_calculate_yarkovsky_effect(const struct rebx_yark_body* const body, struct reb_particle* target, const struct reb_particle* star, const double G, const double c){
+    const double dx = target->x - star->x;
+    const double dy = target->y - star->y;
+    const double dz = target->z - star->z;
+
+    const double dvx = target->vx - star->vx;
+    const double dvy = target->vy - star->vy;
+    const double dvz = target->vz - star->vz;
+
+    const double distance2 = (dx*dx)+(dy*dy)+(dz*dz);
+    const double distance = sqrt(distance2); //distance of asteroid from the star
+
+    const double rdotv = ((dx*dvx)+(dy*dvy)+(dz*dvz))/(c*distance); //dot product of position and velocity vectors- the term in the denominator is needed when calculating the i-vector
+
+    const double i_vector[3] = {((1-rdotv)*(dx/distance))-(dvx/c), ((1-rdotv)*(dy/distance))-(dvy/c), ((1-rdotv)*(dz/distance))-(dvz/c)};
+
+    const double yarkovsky_magnitude = body->magnitude/distance2; //magnitude of force created by the effect
+    double direction[3];    // direction of the acceleration, the product of the yarkovsky matrix and i_vector
+
+    switch (body->inputs.flag){
+        case 1: // maximizes the effect pushing outwards
+            direction[0] = 0.;
+            direction[1] = i_vector[0];
+            direction[2] = 0.;
+            break;
+        case -1: // maximizes the effect pushing inwards
+            direction[0] = i_vector[1];
+            direction[1] = 0.;
+            direction[2] = 0.;
+            break;
+        case 0: // full version: seasonal rotation about the orbit normal, then diurnal rotation about the spin axis
+        {
+            int err = 0;
+            const double P = rebx_tools_orbital_period(G, *target, *star, &err);
+
+            const double hx = (dy*dvz)-(dz*dvy);
+            const double hy = (dz*dvx)-(dx*dvz);
+            const double hz = (dx*dvy)-(dy*dvx);
+            const double inv_hmag = 1.0/sqrt((hx*hx)+ (hy*hy) + (hz*hz));
+            const double h[3] = {hx*inv_hmag, hy*inv_hmag, hz*inv_hmag};
+
+            const double sqrt_flux = sqrt(body->lq/distance2);
+            const double flux34 = sqrt_flux*sqrt(sqrt_flux); // (lstar*q/distance^2)^(3/4)
+            const double tanPhi = 1.0/(1.0+body->thermal*body->sqrt_rotation_period*flux34);
+            const double tanEpsilon = 1.0/(1.0+body->thermal*sqrt(P)*flux34);
+
+            // cos and sin of atan(x) without the trig calls
+            const double cos_phi = 1.0/sqrt(1.0 + tanPhi*tanPhi);
+            const double sin_phi = tanPhi*cos_phi;
+            const double cos_epsilon = 1.0/sqrt(1.0 + tanEpsilon*tanEpsilon);
+            const double sin_epsilon = tanEpsilon*cos_epsilon;
+
+            double seasonal[3];
+            rebx_yark_rotate(seasonal, h, i_vector, cos_epsilon, -sin_epsilon);
+            rebx_yark_rotate(direction, body->s, seasonal, cos_phi, sin_phi);
+            break;
+        }
+        default:
+            return;
     }
 
+    //adds Yarkovsky aceleration to the asteroid's acceleration in the sim
+    target->ax += yarkovsky_magnitude*direction[0];
+    target->ay += yarkovsky_magnitude*direction[1];
+    target->az += yarkovsky_magnitude*direction[2];
+}
+
 void rebx_yarkovsky_effect(struct reb_simulation* const sim, struct rebx_force* const force, struct reb_particle* const particles, const int N){
         
     struct rebx_extras* const rebx = sim->extras;
-    double G = sim->G;
-    
-    
-    for (int i=1; i<N; i++){
-        
-        struct reb_particle* target = &particles[i];
-        struct reb_particle* star = &particles[0];
-        
-        double* density = rebx_get_param(rebx, target->ap, "ye_body_density");
-        double* lstar = rebx_get_param(rebx, force->ap, "ye_lstar");
-        double* rotation_period = rebx_get_param(rebx, target->ap, "ye_rotation_period");
-        double* Gamma = rebx_get_param(rebx, target->ap, "ye_thermal_inertia");
-        double* albedo = rebx_get_param(rebx, target->ap, "ye_albedo");
-        double* emissivity = rebx_get_param(rebx, target->ap, "ye_emissivity");
-        double* k = rebx_get_param(rebx, target->ap, "ye_k");
-        double* c = rebx_get_param(rebx, force->ap, "ye_c");
-        double* stef_boltz = rebx_get_param(rebx, force->ap, "ye_stef_boltz");
-        int* yark_flag = rebx_get_param(rebx, target->ap, "ye_flag");
-        double* sx = rebx_get_param(rebx, target->ap, "ye_spin_axis_x");
-        double* sy = rebx_get_param(rebx, target->ap, "ye_spin_axis_y");
-        double* sz = rebx_get_param(rebx, target->ap, "ye_spin_axis_z");
-        
-        //if these necessary conditions are met the Yarkovsky effect will be calculated for a particle in the sim
-        if (density != NULL && target->r != 0 && albedo != NULL && lstar != NULL && c != NULL && yark_flag != NULL){
-            rebx_calculate_yarkovsky_effect(sim, target, star, G, density, lstar, rotation_period, Gamma, albedo, emissivity, k, c, stef_boltz, yark_flag, sx, sy, sz);
+    const double G = sim->G;
+    
+    // Force params are the same for all particles, so only look them up once
+    const double* const lstar = rebx_get_param(rebx, force->ap, "ye_lstar");
+    const double* const c = rebx_get_param(rebx, force->ap, "ye_c");
+    const double* const stef_boltz = rebx_get_param(rebx, force->ap, "ye_stef_boltz");
+    if (lstar == NULL || c == NULL){
+        return;
+    }
+
+    struct rebx_yark_index* const index = rebx_yarkovsky_get_index(rebx, force, particles, N);
+    if (index == NULL){
+        reb_error(sim, "REBOUNDx Error: Could not allocate memory for yarkovsky_effect.\n");
+        return;
+    }
+    const double stef_boltz_value = stef_boltz != NULL ? *stef_boltz : NAN;
+    if (*lstar != index->lstar || *c != index->c || !(stef_boltz_value == index->stef_boltz || (isnan(stef_boltz_value) && isnan(index->stef_boltz)))){
+        for (int b=0; b<index->N_bodies; b++){
+            index->bodies[b].valid = 0;
+        }
+        index->lstar = *lstar;
+        index->c = *c;
+        index->stef_boltz = stef_boltz_value;
+    }
+
+    // All bodies orbit particles[0], and each body only touches its own cached constants and accelerations
+    const struct reb_particle* const star = &particles[0];
+    int missing = 0;
+#pragma omp parallel for schedule(guided) reduction(+:missing)
+    for (int b=0; b<index->N_bodies; b++){
+        struct rebx_yark_body* const body = &index->bodies[b];
+        struct reb_particle* const target = &particles[body->index];
+        if (target->r == 0){
+            continue;
+        }
+        if (!rebx_yarkovsky_update_constants(body, target, *lstar, *c, stef_boltz)){
+            missing++;
+            continue;
         }
+        rebx_calculate_yarkovsky_effect(body, target, star, G, *c);
+    }
+    if (missing > 0){
+        reb_error(sim, "REBOUNDx Error: One or more parameters missing for this version of the Yarkovsky effect in Rebx. Please make sure you've given values to all variables for this version before running simulations. See documentation and YarkovskyEffect.ipynb. If you'd rather use the simplified version of this effect (requires fewer parameters), then please set 'yark_flag' to -1 or 1.\n\n");
     }
 }